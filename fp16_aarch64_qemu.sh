@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# Cross-build the AArch64 conformance checks and run them under qemu-user, so that the NEON and SVE kernels of
+# fp16_arm.h and fp16_rounding.hpp can be checked on an x86 machine.
+#
+# Needs an AArch64 cross compiler (aarch64-linux-gnu-gcc and -g++ on Debian and Ubuntu), qemu-aarch64 (qemu-user), and
+# <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16.
+#
+# Usage: FP16_INCLUDE=<FP16>/include ./fp16_aarch64_qemu.sh [build_dir]
+#
+# CC, CXX, QEMU and MARCHS override the compilers, the emulator command and the list of -march values. Every program
+# is built statically once per -march value: armv8.2-a checks the NEON kernels, armv8.2-a+sve the SVE ones, which qemu
+# runs with 256-bit vectors. qemu is one to two orders of magnitude slower than hardware, so the sweeps are limited to
+# ranges around the boundaries of the formats instead of all 2**32 inputs:
+#
+# - fp16_conformance: fp32 subnormals, the smallest fp16 subnormals, the fp16 normal/subnormal boundary, the overflow
+#   threshold and NaN, with both signs,
+# - fp16_fp8_conformance: all fp8 encodings and fp16 inputs, and the fp32 inputs around the E4M3 subnormals and the
+#   E4M3 and E5M2 overflow thresholds,
+# - fp16_rounding_conformance: the same ranges as fp16_conformance, each with the default FPCR and with flush to zero
+#   and round toward zero.
+#
+# Every program exits with 1 on a mismatch, and so does the script.
+set -eu
+
+CC=${CC:-aarch64-linux-gnu-gcc}
+CXX=${CXX:-aarch64-linux-gnu-g++}
+QEMU=${QEMU:-"qemu-aarch64 -cpu max,sve256=on"}
+MARCHS=${MARCHS:-"armv8.2-a armv8.2-a+sve"}
+FP16_INCLUDE=${FP16_INCLUDE:?set FP16_INCLUDE to the include directory of https://github.com/Maratyszcza/FP16}
+SRC=$(cd "$(dirname "$0")" && pwd)
+BUILD=${1:-build-aarch64}
+
+FP16_RANGES="0x00000000:0x000FFFFF 0x33000000:0x330FFFFF 0x387F8000:0x3880FFFF 0x477F8000:0x4780FFFF
+	0x7F800000:0x7F8FFFFF 0x80000000:0x800FFFFF 0xB3000000:0xB30FFFFF 0xC77F8000:0xC780FFFF 0xFFF00000:0xFFFFFFFF"
+FP8_RANGES="0x3AF00000:0x3B0FFFFF 0x43E00000:0x43EFFFFF 0x476F0000:0x4770FFFF 0xC3E00000:0xC3EFFFFF"
+
+mkdir -p "$BUILD"
+for march in $MARCHS; do
+	suffix=$(echo "$march" | tr -c 'a-z0-9\n' '_')
+	flags="-O2 -march=$march -static -I$FP16_INCLUDE"
+	$CC $flags "$SRC/fp16_conformance.c" -o "$BUILD/fp16_conformance_$suffix" -lm -pthread
+	$CC $flags "$SRC/fp16_fp8_conformance.c" -o "$BUILD/fp16_fp8_conformance_$suffix" -lm -pthread
+	$CXX -std=c++20 $flags "$SRC/fp16_rounding_conformance.cpp" -o "$BUILD/fp16_rounding_conformance_$suffix" -pthread
+
+	echo "== $march"
+	for range in $FP16_RANGES; do
+		$QEMU "$BUILD/fp16_conformance_$suffix" -b "${range%:*}" -e "${range#*:}"
+		$QEMU "$BUILD/fp16_rounding_conformance_$suffix" -b "${range%:*}" -e "${range#*:}"
+	done
+	for range in $FP8_RANGES; do
+		$QEMU "$BUILD/fp16_fp8_conformance_$suffix" -b "${range%:*}" -e "${range#*:}"
+	done
+done
+echo "all AArch64 checks passed"
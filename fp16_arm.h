@@ -0,0 +1,431 @@
+#pragma once
+#ifndef FP16_ARM_H
+#define FP16_ARM_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cstddef>
+	#include <cstdint>
+#else
+	#include <stddef.h>
+	#include <stdint.h>
+#endif
+
+#include <arm_neon.h>
+#if defined(__ARM_FEATURE_SVE)
+	#include <arm_sve.h>
+#endif
+#if defined(__linux__)
+	#include <sys/auxv.h>
+	#include <asm/hwcap.h>
+#endif
+
+#include "fp16_study.h"
+
+/*
+ * AArch64 SIMD kernels for the bulk conversions in fp16_array.h, for the IEEE and the ARM alternative half-precision
+ * formats.
+ *
+ * Like the x86 kernels, every NEON kernel converts the largest multiple of its vector width that fits in n and returns
+ * the number of elements it converted. The SVE kernels use predicated loops (svwhilelt), so they convert all n elements
+ * and need no scalar tail.
+ *
+ * | kernel | IEEE fp32 -> fp16           | IEEE fp16 -> fp32 | alt fp32 -> fp16                  | alt fp16 -> fp32                |
+ * |--------|-----------------------------|-------------------|-----------------------------------|---------------------------------|
+ * | neon   | vcvt_f16_f32 + NaN fix-up   | vcvt_f32_f16      | fp16_alt_from_fp32_value, 8 lanes | fp16_alt_to_fp32_value, 8 lanes |
+ * | sve    | svcvt_f16_f32 + NaN fix-up  | svcvt_f32_f16     | fp16_alt_from_fp32_value, VL lanes| fp16_alt_to_fp32_value, VL lanes|
+ * | neonint| fp16_ieee_from_fp32_bits    | -                 | -                                 | -                               |
+ *
+ * IEEE format: FCVT rounds to nearest even (the Linux default FPCR), but it keeps the NaN payload, while
+ * fp16_ieee_from_fp32_value returns the canonical 0x7E00 (with the input sign), so NaN lanes are patched. FCVT from
+ * half to single sets the quiet bit of signaling NaN, just like the multiplication in fp16_ieee_to_fp32_value.
+ *
+ * bfloat16 (bf16_* of fp16_study.h): the fp32 -> bf16 rounding is the integer work of bf16_from_fp32_value, 4 lanes at a
+ * time, and bf16 -> fp32 is a widening shift (vshll). The transcodings between IEEE half precision and bfloat16 widen to
+ * fp32 in registers only. The sve entry uses the NEON bf16 kernels, and the NEON fused scale kernels (FMLA, clamp,
+ * FCVT) too.
+ *
+ * FPCR: the IEEE kernels above need round to nearest, IEEE half precision and no default NaN. In any other state
+ * fp16_ieee_from_fp32_array uses the neonint kernel, which rounds on the bits like fp16_ieee_from_fp32_bits, and
+ * fp16_ieee_to_fp32_array the scalar function.
+ *
+ * Alternative format: FCVT only produces it when FPCR.AHP is set, and it turns NaN into zero, while
+ * fp16_alt_from_fp32_value saturates NaN to 0x7FFF like infinity. Rather than toggling FPCR around every call and
+ * fixing up NaN lanes, the alt kernels are a lane by lane port of the scalar functions: the same clamp to 131008, the
+ * same bias addition, the same masks. Both are integer and add/select work that NEON and SVE do at full width.
+ */
+
+/*
+ * fp16_alt_from_fp32_value, 4 lanes.
+ */
+static inline uint32x4_t fp16_alt_from_fp32_neon_x4(float32x4_t f) {
+	const uint32x4_t w = vreinterpretq_u32_f32(f);
+	const uint32x4_t sign = vandq_u32(w, vdupq_n_u32(UINT32_C(0x80000000)));
+	const uint32x4_t shl1_w = vaddq_u32(w, w);
+
+	const uint32x4_t shl1_base = vminq_u32(shl1_w, vdupq_n_u32(UINT32_C(0x8FFFC000)));
+	const uint32x4_t shl1_bias = vmaxq_u32(vandq_u32(shl1_base, vdupq_n_u32(UINT32_C(0xFF000000))),
+		vdupq_n_u32((127 - 1 - (23 - 10)) << 24));
+
+	const float32x4_t bias = vreinterpretq_f32_u32(vaddq_u32(vshrq_n_u32(shl1_bias, 1), vdupq_n_u32((23 - 10 + 2) << 23)));
+	const float32x4_t base = vaddq_f32(
+		vreinterpretq_f32_u32(vaddq_u32(vshrq_n_u32(shl1_base, 1), vdupq_n_u32(2 << 23))), bias);
+
+	const uint32x4_t bits = vreinterpretq_u32_f32(base);
+	const uint32x4_t exp_bits = vandq_u32(vshrq_n_u32(bits, 13), vdupq_n_u32(UINT32_C(0x00007C00)));
+	const uint32x4_t mantissa_bits = vandq_u32(bits, vdupq_n_u32(UINT32_C(0x00000FFF)));
+	return vorrq_u32(vshrq_n_u32(sign, 16), vaddq_u32(exp_bits, mantissa_bits));
+}
+
+/*
+ * fp16_alt_to_fp32_value, 4 lanes. w holds the half-precision number in the high 16 bits of each 32-bit lane.
+ */
+static inline float32x4_t fp16_alt_to_fp32_neon_x4(uint32x4_t w) {
+	const uint32x4_t sign = vandq_u32(w, vdupq_n_u32(UINT32_C(0x80000000)));
+	const uint32x4_t two_w = vaddq_u32(w, w);
+
+	const uint32x4_t normalized_value = vaddq_u32(vshrq_n_u32(two_w, 4), vdupq_n_u32(UINT32_C(0x70) << 23));
+
+	const float32x4_t denormalized_value = vsubq_f32(
+		vreinterpretq_f32_u32(vorrq_u32(vshrq_n_u32(two_w, 17), vdupq_n_u32(UINT32_C(126) << 23))), vdupq_n_f32(0.5f));
+
+	const uint32x4_t is_denormalized = vcltq_u32(two_w, vdupq_n_u32(UINT32_C(1) << 27));
+	return vreinterpretq_f32_u32(vorrq_u32(sign,
+		vbslq_u32(is_denormalized, vreinterpretq_u32_f32(denormalized_value), normalized_value)));
+}
+
+/*
+ * fp16_ieee_from_fp32_value, 8 lanes, with FCVT. Canonical NaN: keep the sign bit of the hardware result, replace
+ * exponent and mantissa with 0x7E00.
+ */
+static inline uint16x8_t fp16_ieee_from_fp32_neon_x8(float32x4_t lo, float32x4_t hi) {
+	const uint16x8_t h = vreinterpretq_u16_f16(vcvt_high_f16_f32(vcvt_f16_f32(lo), hi));
+	const uint16x8_t is_not_nan = vcombine_u16(vmovn_u32(vceqq_f32(lo, lo)), vmovn_u32(vceqq_f32(hi, hi)));
+	const uint16x8_t canonical = vorrq_u16(vandq_u16(h, vdupq_n_u16(UINT16_C(0x8000))), vdupq_n_u16(UINT16_C(0x7E00)));
+	return vbslq_u16(is_not_nan, h, canonical);
+}
+
+static inline size_t fp16_ieee_from_fp32_neon(const float* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		vst1q_u16(dst + i, fp16_ieee_from_fp32_neon_x8(vld1q_f32(src + i), vld1q_f32(src + i + 4)));
+	}
+	return i;
+}
+
+static inline size_t fp16_ieee_to_fp32_neon(const uint16_t* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(src + i));
+		vst1q_f32(dst + i, vcvt_f32_f16(vget_low_f16(h)));
+		vst1q_f32(dst + i + 4, vcvt_high_f32_f16(h));
+	}
+	return i;
+}
+
+/*
+ * fp16_ieee_from_fp32_bits, 4 lanes, for an FPCR that is not in the state FCVT needs (see fp16_arm_fpcr_is_default).
+ * USHL shifts every lane by its own amount, negative for a right shift, and URSHL rounds the shifted-out half up, so
+ * adding lsb - 1 first makes it round to nearest even like the normal results.
+ */
+static inline uint32x4_t fp16_ieee_from_fp32_neonint_x4(uint32x4_t w) {
+	const uint32x4_t sign = vandq_u32(vshrq_n_u32(w, 16), vdupq_n_u32(UINT32_C(0x8000)));
+	const uint32x4_t nonsign = vandq_u32(w, vdupq_n_u32(UINT32_C(0x7FFFFFFF)));
+
+	const uint32x4_t odd = vandq_u32(vshrq_n_u32(nonsign, 13), vdupq_n_u32(1));
+	const uint32x4_t normal = vshrq_n_u32(
+		vaddq_u32(vsubq_u32(nonsign, vdupq_n_u32(UINT32_C(0x38000000) - UINT32_C(0xFFF))), odd), 13);
+
+	const int32x4_t shift = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(nonsign, 23)), vdupq_n_s32(126));
+	const uint32x4_t mantissa =
+		vorrq_u32(vandq_u32(nonsign, vdupq_n_u32(UINT32_C(0x007FFFFF))), vdupq_n_u32(UINT32_C(0x00800000)));
+	const uint32x4_t lsb = vandq_u32(vshlq_u32(mantissa, shift), vdupq_n_u32(1));
+	const uint32x4_t subnormal = vandq_u32(vrshlq_u32(vsubq_u32(vaddq_u32(mantissa, lsb), vdupq_n_u32(1)), shift),
+		vcgeq_u32(nonsign, vdupq_n_u32(UINT32_C(0x33000000))));
+
+	const uint32x4_t finite = vbslq_u32(vcgeq_u32(nonsign, vdupq_n_u32(UINT32_C(0x38800000))), normal, subnormal);
+	const uint32x4_t special = vbslq_u32(vcgtq_u32(nonsign, vdupq_n_u32(UINT32_C(0x7F800000))),
+		vdupq_n_u32(UINT32_C(0x7E00)), vdupq_n_u32(UINT32_C(0x7C00)));
+	return vorrq_u32(sign, vbslq_u32(vcgeq_u32(nonsign, vdupq_n_u32(UINT32_C(0x477FF000))), special, finite));
+}
+
+static inline size_t fp16_ieee_from_fp32_neonint(const float* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const uint32x4_t lo = fp16_ieee_from_fp32_neonint_x4(vreinterpretq_u32_f32(vld1q_f32(src + i)));
+		const uint32x4_t hi = fp16_ieee_from_fp32_neonint_x4(vreinterpretq_u32_f32(vld1q_f32(src + i + 4)));
+		vst1q_u16(dst + i, vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+	}
+	return i;
+}
+
+static inline size_t fp16_alt_from_fp32_neon(const float* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const uint32x4_t lo = fp16_alt_from_fp32_neon_x4(vld1q_f32(src + i));
+		const uint32x4_t hi = fp16_alt_from_fp32_neon_x4(vld1q_f32(src + i + 4));
+		vst1q_u16(dst + i, vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+	}
+	return i;
+}
+
+static inline size_t fp16_alt_to_fp32_neon(const uint16_t* src, float* dst, size_t n) {
+	const uint16x8_t zero = vdupq_n_u16(0);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const uint16x8_t h = vld1q_u16(src + i);
+		// zip with zero from below puts every half-precision number into the high 16 bits of a 32-bit lane
+		vst1q_f32(dst + i, fp16_alt_to_fp32_neon_x4(vreinterpretq_u32_u16(vzip1q_u16(zero, h))));
+		vst1q_f32(dst + i + 4, fp16_alt_to_fp32_neon_x4(vreinterpretq_u32_u16(vzip2q_u16(zero, h))));
+	}
+	return i;
+}
+
+/*
+ * bf16_from_fp32_value, 4 lanes. The rounding and the NaN quieting are integer work, as in the scalar function.
+ */
+static inline uint32x4_t bf16_from_fp32_neon_x4(float32x4_t f) {
+	const uint32x4_t w = vreinterpretq_u32_f32(f);
+	const uint32x4_t lsb = vandq_u32(vshrq_n_u32(w, 16), vdupq_n_u32(1));
+	const uint32x4_t rounded = vshrq_n_u32(vaddq_u32(w, vaddq_u32(lsb, vdupq_n_u32(UINT32_C(0x7FFF)))), 16);
+	const uint32x4_t quiet = vorrq_u32(vshrq_n_u32(w, 16), vdupq_n_u32(UINT32_C(0x0040)));
+	const uint32x4_t is_nan = vcgtq_u32(vandq_u32(w, vdupq_n_u32(UINT32_C(0x7FFFFFFF))), vdupq_n_u32(UINT32_C(0x7F800000)));
+	return vbslq_u32(is_nan, quiet, rounded);
+}
+
+static inline size_t bf16_from_fp32_neon(const float* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const uint32x4_t lo = bf16_from_fp32_neon_x4(vld1q_f32(src + i));
+		const uint32x4_t hi = bf16_from_fp32_neon_x4(vld1q_f32(src + i + 4));
+		vst1q_u16(dst + i, vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+	}
+	return i;
+}
+
+static inline size_t bf16_to_fp32_neon(const uint16_t* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const uint16x8_t h = vld1q_u16(src + i);
+		vst1q_f32(dst + i, vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(h), 16)));
+		vst1q_f32(dst + i + 4, vreinterpretq_f32_u32(vshll_high_n_u16(h, 16)));
+	}
+	return i;
+}
+
+static inline size_t bf16_from_fp16_ieee_neon(const uint16_t* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(src + i));
+		const uint32x4_t lo = bf16_from_fp32_neon_x4(vcvt_f32_f16(vget_low_f16(h)));
+		const uint32x4_t hi = bf16_from_fp32_neon_x4(vcvt_high_f32_f16(h));
+		vst1q_u16(dst + i, vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+	}
+	return i;
+}
+
+static inline size_t fp16_ieee_from_bf16_neon(const uint16_t* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const uint16x8_t h = vld1q_u16(src + i);
+		const float32x4_t lo = vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(h), 16));
+		const float32x4_t hi = vreinterpretq_f32_u32(vshll_high_n_u16(h, 16));
+		vst1q_u16(dst + i, fp16_ieee_from_fp32_neon_x8(lo, hi));
+	}
+	return i;
+}
+
+/*
+ * Fused scale: fp16_ieee_from_fp32_scaled_value of fp16_array.h, 8 lanes. FMLA rounds x * scale + bias once like fmaf,
+ * and FMIN / FMAX return NaN when an operand is NaN, so NaN goes on to the fix-up of fp16_ieee_from_fp32_neon_x8.
+ */
+static inline float32x4_t fp16_scale_clamp_neon_x4(float32x4_t f, float32x4_t scale, float32x4_t bias) {
+	const float32x4_t y = vfmaq_f32(bias, f, scale);
+	return vmaxq_f32(vminq_f32(y, vdupq_n_f32(65504.0f)), vdupq_n_f32(-65504.0f));
+}
+
+static inline size_t fp16_ieee_from_fp32_scaled_neon(const float* src, uint16_t* dst, size_t n, float scale, float bias) {
+	const float32x4_t scale_v = vdupq_n_f32(scale);
+	const float32x4_t bias_v = vdupq_n_f32(bias);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const float32x4_t lo = fp16_scale_clamp_neon_x4(vld1q_f32(src + i), scale_v, bias_v);
+		const float32x4_t hi = fp16_scale_clamp_neon_x4(vld1q_f32(src + i + 4), scale_v, bias_v);
+		vst1q_u16(dst + i, fp16_ieee_from_fp32_neon_x8(lo, hi));
+	}
+	return i;
+}
+
+static inline size_t fp16_ieee_from_fp32_scaled_channels_neon(const float* src, uint16_t* dst, size_t n,
+	const float* scale, const float* bias)
+{
+	const float32x4_t no_bias = vdupq_n_f32(-0.0f);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const float32x4_t bias_lo = bias != NULL ? vld1q_f32(bias + i) : no_bias;
+		const float32x4_t bias_hi = bias != NULL ? vld1q_f32(bias + i + 4) : no_bias;
+		const float32x4_t lo = fp16_scale_clamp_neon_x4(vld1q_f32(src + i), vld1q_f32(scale + i), bias_lo);
+		const float32x4_t hi = fp16_scale_clamp_neon_x4(vld1q_f32(src + i + 4), vld1q_f32(scale + i + 4), bias_hi);
+		vst1q_u16(dst + i, fp16_ieee_from_fp32_neon_x8(lo, hi));
+	}
+	return i;
+}
+
+#if defined(__ARM_FEATURE_SVE)
+/*
+ * The SVE conversions work on 32-bit containers: svcvt_f16_f32 leaves the half-precision result in the low 16 bits of
+ * every 32-bit lane, and svst1h_u32 stores exactly those bits. In the other direction svld1uh_u32 zero-extends every
+ * half-precision number into a 32-bit lane, ready for svcvt_f32_f16.
+ */
+static inline size_t fp16_ieee_from_fp32_sve(const float* src, uint16_t* dst, size_t n) {
+	for (size_t i = 0; i < n; i += svcntw()) {
+		const svbool_t pg = svwhilelt_b32_u64(i, n);
+		const svfloat32_t f = svld1_f32(pg, src + i);
+		const svuint32_t h = svreinterpret_u32_f16(svcvt_f16_f32_x(pg, f));
+		const svbool_t is_nan = svcmpuo_f32(pg, f, f);
+		const svuint32_t canonical = svorr_n_u32_x(pg, svand_n_u32_x(pg, h, UINT32_C(0x8000)), UINT32_C(0x7E00));
+		svst1h_u32(pg, dst + i, svsel_u32(is_nan, canonical, h));
+	}
+	return n;
+}
+
+static inline size_t fp16_ieee_to_fp32_sve(const uint16_t* src, float* dst, size_t n) {
+	for (size_t i = 0; i < n; i += svcntw()) {
+		const svbool_t pg = svwhilelt_b32_u64(i, n);
+		const svuint32_t h = svld1uh_u32(pg, src + i);
+		svst1_f32(pg, dst + i, svcvt_f32_f16_x(pg, svreinterpret_f16_u32(h)));
+	}
+	return n;
+}
+
+static inline size_t fp16_alt_from_fp32_sve(const float* src, uint16_t* dst, size_t n) {
+	for (size_t i = 0; i < n; i += svcntw()) {
+		const svbool_t pg = svwhilelt_b32_u64(i, n);
+		const svuint32_t w = svreinterpret_u32_f32(svld1_f32(pg, src + i));
+		const svuint32_t sign = svand_n_u32_x(pg, w, UINT32_C(0x80000000));
+		const svuint32_t shl1_w = svadd_u32_x(pg, w, w);
+
+		const svuint32_t shl1_base = svmin_n_u32_x(pg, shl1_w, UINT32_C(0x8FFFC000));
+		const svuint32_t shl1_bias = svmax_n_u32_x(pg, svand_n_u32_x(pg, shl1_base, UINT32_C(0xFF000000)),
+			(127 - 1 - (23 - 10)) << 24);
+
+		const svfloat32_t bias = svreinterpret_f32_u32(
+			svadd_n_u32_x(pg, svlsr_n_u32_x(pg, shl1_bias, 1), (23 - 10 + 2) << 23));
+		const svfloat32_t base = svadd_f32_x(pg,
+			svreinterpret_f32_u32(svadd_n_u32_x(pg, svlsr_n_u32_x(pg, shl1_base, 1), 2 << 23)), bias);
+
+		const svuint32_t bits = svreinterpret_u32_f32(base);
+		const svuint32_t exp_bits = svand_n_u32_x(pg, svlsr_n_u32_x(pg, bits, 13), UINT32_C(0x00007C00));
+		const svuint32_t mantissa_bits = svand_n_u32_x(pg, bits, UINT32_C(0x00000FFF));
+		svst1h_u32(pg, dst + i, svorr_u32_x(pg, svlsr_n_u32_x(pg, sign, 16), svadd_u32_x(pg, exp_bits, mantissa_bits)));
+	}
+	return n;
+}
+
+static inline size_t fp16_alt_to_fp32_sve(const uint16_t* src, float* dst, size_t n) {
+	for (size_t i = 0; i < n; i += svcntw()) {
+		const svbool_t pg = svwhilelt_b32_u64(i, n);
+		const svuint32_t w = svlsl_n_u32_x(pg, svld1uh_u32(pg, src + i), 16);
+		const svuint32_t sign = svand_n_u32_x(pg, w, UINT32_C(0x80000000));
+		const svuint32_t two_w = svadd_u32_x(pg, w, w);
+
+		const svuint32_t normalized_value = svadd_n_u32_x(pg, svlsr_n_u32_x(pg, two_w, 4), UINT32_C(0x70) << 23);
+		const svfloat32_t denormalized_value = svsub_n_f32_x(pg,
+			svreinterpret_f32_u32(svorr_n_u32_x(pg, svlsr_n_u32_x(pg, two_w, 17), UINT32_C(126) << 23)), 0.5f);
+
+		const svbool_t is_denormalized = svcmplt_n_u32(pg, two_w, UINT32_C(1) << 27);
+		const svuint32_t result = svorr_u32_x(pg, sign,
+			svsel_u32(is_denormalized, svreinterpret_u32_f32(denormalized_value), normalized_value));
+		svst1_f32(pg, dst + i, svreinterpret_f32_u32(result));
+	}
+	return n;
+}
+#endif
+
+/*
+ * Runtime dispatch, the same scheme as fp16_x86.h. NEON is part of the AArch64 baseline. The SVE kernels are only
+ * compiled when the compiler targets SVE (-march=armv8.2-a+sve or later), and only used when the kernel reports SVE
+ * in the auxiliary vector.
+ */
+typedef size_t (*fp16_from_fp32_kernel)(const float* src, uint16_t* dst, size_t n);
+typedef size_t (*fp16_to_fp32_kernel)(const uint16_t* src, float* dst, size_t n);
+typedef size_t (*fp16_transcode_kernel)(const uint16_t* src, uint16_t* dst, size_t n);
+typedef size_t (*fp16_from_fp32_scaled_kernel)(const float* src, uint16_t* dst, size_t n, float scale, float bias);
+typedef size_t (*fp16_from_fp32_scaled_channels_kernel)(const float* src, uint16_t* dst, size_t n,
+	const float* scale, const float* bias);
+
+struct fp16_arm_kernel {
+	const char* name;
+	int (*supported)(void);
+	fp16_from_fp32_kernel ieee_from_fp32;
+	fp16_to_fp32_kernel ieee_to_fp32;
+	fp16_from_fp32_kernel alt_from_fp32;
+	fp16_to_fp32_kernel alt_to_fp32;
+	fp16_from_fp32_kernel bf16_from_fp32;
+	fp16_to_fp32_kernel bf16_to_fp32;
+	fp16_transcode_kernel bf16_from_fp16_ieee;
+	fp16_transcode_kernel fp16_ieee_from_bf16;
+	fp16_from_fp32_scaled_kernel ieee_from_fp32_scaled;
+	fp16_from_fp32_scaled_channels_kernel ieee_from_fp32_scaled_channels;
+};
+
+static inline int fp16_arm_has_neon(void) {
+	return 1;
+}
+
+#if defined(__ARM_FEATURE_SVE)
+static inline int fp16_arm_has_sve(void) {
+#if defined(__linux__) && defined(HWCAP_SVE)
+	return (getauxval(AT_HWCAP) & HWCAP_SVE) != 0;
+#else
+	return 1;
+#endif
+}
+#endif
+
+static const struct fp16_arm_kernel fp16_arm_kernel_table[] = {
+	{ "neon", fp16_arm_has_neon,
+		fp16_ieee_from_fp32_neon, fp16_ieee_to_fp32_neon, fp16_alt_from_fp32_neon, fp16_alt_to_fp32_neon,
+		bf16_from_fp32_neon, bf16_to_fp32_neon, bf16_from_fp16_ieee_neon, fp16_ieee_from_bf16_neon,
+		fp16_ieee_from_fp32_scaled_neon, fp16_ieee_from_fp32_scaled_channels_neon },
+#if defined(__ARM_FEATURE_SVE)
+	{ "sve", fp16_arm_has_sve,
+		fp16_ieee_from_fp32_sve, fp16_ieee_to_fp32_sve, fp16_alt_from_fp32_sve, fp16_alt_to_fp32_sve,
+		bf16_from_fp32_neon, bf16_to_fp32_neon, bf16_from_fp16_ieee_neon, fp16_ieee_from_bf16_neon,
+		fp16_ieee_from_fp32_scaled_neon, fp16_ieee_from_fp32_scaled_channels_neon },
+#endif
+};
+
+#define FP16_ARM_KERNEL_COUNT (sizeof(fp16_arm_kernel_table) / sizeof(fp16_arm_kernel_table[0]))
+
+static struct fp16_arm_kernel fp16_arm_kernels = {
+	"neon", fp16_arm_has_neon,
+	fp16_ieee_from_fp32_neon, fp16_ieee_to_fp32_neon, fp16_alt_from_fp32_neon, fp16_alt_to_fp32_neon,
+	bf16_from_fp32_neon, bf16_to_fp32_neon, bf16_from_fp16_ieee_neon, fp16_ieee_from_bf16_neon,
+	fp16_ieee_from_fp32_scaled_neon, fp16_ieee_from_fp32_scaled_channels_neon
+};
+
+/*
+ * Whether FPCR of the calling thread is in the state the FCVT kernels rely on: round to nearest (RMode 0), IEEE half
+ * precision (AHP 0) and NaN propagation (DN 0, a default NaN would lose the sign that the NaN fix-up keeps). That is
+ * the state Linux starts threads in. FZ and FZ16 do not matter: FZ16 does not apply to conversions, and FZ only flushes
+ * single-precision subnormal inputs, which round to zero anyway. FPCR is per thread and can change between two calls,
+ * so it is read on every call.
+ */
+static inline int fp16_arm_fpcr_is_default(void) {
+	uint64_t fpcr;
+	__asm__ volatile("mrs %0, fpcr" : "=r"(fpcr));
+	return (fpcr & ((UINT64_C(3) << 22) | (UINT64_C(1) << 25) | (UINT64_C(1) << 26))) == 0;
+}
+
+#if defined(__GNUC__)
+__attribute__((__constructor__, __unused__))
+#endif
+static void fp16_arm_init(void) {
+	for (size_t k = 0; k < FP16_ARM_KERNEL_COUNT; k++) {
+		if (fp16_arm_kernel_table[k].supported()) {
+			fp16_arm_kernels = fp16_arm_kernel_table[k];
+		}
+	}
+}
+
+#endif /* FP16_ARM_H */
@@ -0,0 +1,488 @@
+#pragma once
+#ifndef FP16_ARRAY_H
+#define FP16_ARRAY_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cmath>
+	#include <cstddef>
+	#include <cstdint>
+#else
+	#include <math.h>
+	#include <stddef.h>
+	#include <stdint.h>
+#endif
+
+#include "fp16_study.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(FP16_ARRAY_SCALAR_ONLY)
+	#include "fp16_x86.h"
+	#define FP16_ARRAY_X86 1
+#elif defined(__aarch64__) && !defined(FP16_ARRAY_SCALAR_ONLY)
+	#include "fp16_arm.h"
+	#define FP16_ARRAY_ARM 1
+#endif
+
+/*
+ * Bulk versions of the scalar conversions in fp16_study.h.
+ *
+ * The scalar functions convert one value per call. Calling them in a loop works, but the loop carries the call overhead
+ * and the compiler can not keep several independent conversions in flight. The array functions below split the input
+ * into three parts:
+ *
+ *      +------+--------------------------------------+------+
+ *      | head |     body, FP16_ARRAY_BLOCK at a time | tail |
+ *      +------+--------------------------------------+------+
+ *
+ * - head: elements converted one at a time until the fp16 side reaches a FP16_ARRAY_ALIGNMENT-byte boundary,
+ * - body: whole blocks, where all the conversions of a block are independent of each other,
+ * - tail: the remaining (less than a block) elements, one at a time.
+ *
+ * On x86 and AArch64 the body goes to the SIMD kernel picked at startup (see fp16_x86.h and fp16_arm.h). Otherwise
+ * every element goes through the same fp16_study.h function. Either way the output is bit-identical to the scalar loop.
+ * Define FP16_ARRAY_SCALAR_ONLY to disable the SIMD kernels. The bfloat16 functions and the fused scale functions at
+ * the end follow the same scheme.
+ *
+ * The head aligns the fp16 side to a cache line, so the vector stores (or loads) of the body never split one.
+ */
+#define FP16_ARRAY_BLOCK 8
+#define FP16_ARRAY_ALIGNMENT 64
+
+/*
+ * Number of leading elements to convert one at a time before the uint16_t side is FP16_ARRAY_ALIGNMENT-byte aligned.
+ * If the pointer is not even 2-byte aligned, it never becomes aligned, and the whole array is treated as body.
+ */
+static inline size_t fp16_array_head(const uint16_t* p, size_t n) {
+	const uintptr_t misalignment = (uintptr_t) p & (FP16_ARRAY_ALIGNMENT - 1);
+	size_t head = 0;
+	if (misalignment != 0 && (misalignment & 1) == 0) {
+		head = (FP16_ARRAY_ALIGNMENT - misalignment) / sizeof(uint16_t);
+	}
+	return head < n ? head : n;
+}
+
+/*
+ * Convert n 32-bit floating-point numbers in IEEE single-precision format to 16-bit floating-point numbers in
+ * IEEE half-precision format, in bit representation.
+ *
+ * The elements outside the SIMD body go through fp16_ieee_from_fp32_bits, which gives the same result without
+ * floating-point operations, and the body kernel is picked from the MXCSR / FPCR of the calling thread (see
+ * fp16_x86_rounds_to_nearest and fp16_arm_fpcr_is_default). So the result does not depend on the rounding mode, and a
+ * single-precision subnormal input never reaches a floating-point instruction, with or without FTZ / DAZ.
+ *
+ * @note The result is bit-identical to calling fp16_ieee_from_fp32_value on every element in the default
+ * floating-point environment.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void fp16_ieee_from_fp32_array(const float* src, uint16_t* dst, size_t n) {
+	const size_t head = fp16_array_head(dst, n);
+	size_t i = 0;
+	for (; i < head; i++) {
+		dst[i] = fp16_ieee_from_fp32_bits(fp32_to_bits(src[i]));
+	}
+#ifdef FP16_ARRAY_X86
+	const struct fp16_x86_kernel* kernels =
+		fp16_x86_rounds_to_nearest() ? &fp16_x86_kernels : &fp16_x86_rounding_kernels;
+	if (kernels->ieee_from_fp32 != NULL) {
+		i += kernels->ieee_from_fp32(src + i, dst + i, n - i);
+	}
+#endif
+#ifdef FP16_ARRAY_ARM
+	if (fp16_arm_fpcr_is_default()) {
+		i += fp16_arm_kernels.ieee_from_fp32(src + i, dst + i, n - i);
+	} else {
+		i += fp16_ieee_from_fp32_neonint(src + i, dst + i, n - i);
+	}
+#endif
+	for (; n - i >= FP16_ARRAY_BLOCK; i += FP16_ARRAY_BLOCK) {
+		dst[i + 0] = fp16_ieee_from_fp32_bits(fp32_to_bits(src[i + 0]));
+		dst[i + 1] = fp16_ieee_from_fp32_bits(fp32_to_bits(src[i + 1]));
+		dst[i + 2] = fp16_ieee_from_fp32_bits(fp32_to_bits(src[i + 2]));
+		dst[i + 3] = fp16_ieee_from_fp32_bits(fp32_to_bits(src[i + 3]));
+		dst[i + 4] = fp16_ieee_from_fp32_bits(fp32_to_bits(src[i + 4]));
+		dst[i + 5] = fp16_ieee_from_fp32_bits(fp32_to_bits(src[i + 5]));
+		dst[i + 6] = fp16_ieee_from_fp32_bits(fp32_to_bits(src[i + 6]));
+		dst[i + 7] = fp16_ieee_from_fp32_bits(fp32_to_bits(src[i + 7]));
+	}
+	for (; i < n; i++) {
+		dst[i] = fp16_ieee_from_fp32_bits(fp32_to_bits(src[i]));
+	}
+}
+
+/*
+ * Convert n 16-bit floating-point numbers in IEEE half-precision format, in bit representation, to
+ * 32-bit floating-point numbers in IEEE single-precision format.
+ *
+ * @note The result is bit-identical to calling fp16_ieee_to_fp32_value on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void fp16_ieee_to_fp32_array(const uint16_t* src, float* dst, size_t n) {
+	const size_t head = fp16_array_head(src, n);
+	size_t i = 0;
+	for (; i < head; i++) {
+		dst[i] = fp16_ieee_to_fp32_value(src[i]);
+	}
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_kernels.ieee_to_fp32 != NULL) {
+		i += fp16_x86_kernels.ieee_to_fp32(src + i, dst + i, n - i);
+	}
+#endif
+#ifdef FP16_ARRAY_ARM
+	if (fp16_arm_fpcr_is_default()) {
+		i += fp16_arm_kernels.ieee_to_fp32(src + i, dst + i, n - i);
+	}
+#endif
+	for (; n - i >= FP16_ARRAY_BLOCK; i += FP16_ARRAY_BLOCK) {
+		dst[i + 0] = fp16_ieee_to_fp32_value(src[i + 0]);
+		dst[i + 1] = fp16_ieee_to_fp32_value(src[i + 1]);
+		dst[i + 2] = fp16_ieee_to_fp32_value(src[i + 2]);
+		dst[i + 3] = fp16_ieee_to_fp32_value(src[i + 3]);
+		dst[i + 4] = fp16_ieee_to_fp32_value(src[i + 4]);
+		dst[i + 5] = fp16_ieee_to_fp32_value(src[i + 5]);
+		dst[i + 6] = fp16_ieee_to_fp32_value(src[i + 6]);
+		dst[i + 7] = fp16_ieee_to_fp32_value(src[i + 7]);
+	}
+	for (; i < n; i++) {
+		dst[i] = fp16_ieee_to_fp32_value(src[i]);
+	}
+}
+
+/*
+ * Convert n 32-bit floating-point numbers in IEEE single-precision format to 16-bit floating-point numbers in
+ * ARM alternative half-precision format, in bit representation.
+ *
+ * @note The result is bit-identical to calling fp16_alt_from_fp32_value on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void fp16_alt_from_fp32_array(const float* src, uint16_t* dst, size_t n) {
+	const size_t head = fp16_array_head(dst, n);
+	size_t i = 0;
+	for (; i < head; i++) {
+		dst[i] = fp16_alt_from_fp32_value(src[i]);
+	}
+#ifdef FP16_ARRAY_ARM
+	i += fp16_arm_kernels.alt_from_fp32(src + i, dst + i, n - i);
+#endif
+	for (; n - i >= FP16_ARRAY_BLOCK; i += FP16_ARRAY_BLOCK) {
+		dst[i + 0] = fp16_alt_from_fp32_value(src[i + 0]);
+		dst[i + 1] = fp16_alt_from_fp32_value(src[i + 1]);
+		dst[i + 2] = fp16_alt_from_fp32_value(src[i + 2]);
+		dst[i + 3] = fp16_alt_from_fp32_value(src[i + 3]);
+		dst[i + 4] = fp16_alt_from_fp32_value(src[i + 4]);
+		dst[i + 5] = fp16_alt_from_fp32_value(src[i + 5]);
+		dst[i + 6] = fp16_alt_from_fp32_value(src[i + 6]);
+		dst[i + 7] = fp16_alt_from_fp32_value(src[i + 7]);
+	}
+	for (; i < n; i++) {
+		dst[i] = fp16_alt_from_fp32_value(src[i]);
+	}
+}
+
+/*
+ * Convert n 16-bit floating-point numbers in ARM alternative half-precision format, in bit representation, to
+ * 32-bit floating-point numbers in IEEE single-precision format.
+ *
+ * @note The result is bit-identical to calling fp16_alt_to_fp32_value on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void fp16_alt_to_fp32_array(const uint16_t* src, float* dst, size_t n) {
+	const size_t head = fp16_array_head(src, n);
+	size_t i = 0;
+	for (; i < head; i++) {
+		dst[i] = fp16_alt_to_fp32_value(src[i]);
+	}
+#ifdef FP16_ARRAY_ARM
+	i += fp16_arm_kernels.alt_to_fp32(src + i, dst + i, n - i);
+#endif
+	for (; n - i >= FP16_ARRAY_BLOCK; i += FP16_ARRAY_BLOCK) {
+		dst[i + 0] = fp16_alt_to_fp32_value(src[i + 0]);
+		dst[i + 1] = fp16_alt_to_fp32_value(src[i + 1]);
+		dst[i + 2] = fp16_alt_to_fp32_value(src[i + 2]);
+		dst[i + 3] = fp16_alt_to_fp32_value(src[i + 3]);
+		dst[i + 4] = fp16_alt_to_fp32_value(src[i + 4]);
+		dst[i + 5] = fp16_alt_to_fp32_value(src[i + 5]);
+		dst[i + 6] = fp16_alt_to_fp32_value(src[i + 6]);
+		dst[i + 7] = fp16_alt_to_fp32_value(src[i + 7]);
+	}
+	for (; i < n; i++) {
+		dst[i] = fp16_alt_to_fp32_value(src[i]);
+	}
+}
+
+/*
+ * Convert n 32-bit floating-point numbers in IEEE single-precision format to 16-bit floating-point numbers in
+ * bfloat16 format, in bit representation, rounding to nearest even.
+ *
+ * @note The result is bit-identical to calling bf16_from_fp32_value on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void bf16_from_fp32_array(const float* src, uint16_t* dst, size_t n) {
+	const size_t head = fp16_array_head(dst, n);
+	size_t i = 0;
+	for (; i < head; i++) {
+		dst[i] = bf16_from_fp32_value(src[i]);
+	}
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_bf16_kernels.bf16_from_fp32 != NULL) {
+		i += fp16_x86_bf16_kernels.bf16_from_fp32(src + i, dst + i, n - i);
+	}
+#endif
+#ifdef FP16_ARRAY_ARM
+	i += fp16_arm_kernels.bf16_from_fp32(src + i, dst + i, n - i);
+#endif
+	for (; n - i >= FP16_ARRAY_BLOCK; i += FP16_ARRAY_BLOCK) {
+		dst[i + 0] = bf16_from_fp32_value(src[i + 0]);
+		dst[i + 1] = bf16_from_fp32_value(src[i + 1]);
+		dst[i + 2] = bf16_from_fp32_value(src[i + 2]);
+		dst[i + 3] = bf16_from_fp32_value(src[i + 3]);
+		dst[i + 4] = bf16_from_fp32_value(src[i + 4]);
+		dst[i + 5] = bf16_from_fp32_value(src[i + 5]);
+		dst[i + 6] = bf16_from_fp32_value(src[i + 6]);
+		dst[i + 7] = bf16_from_fp32_value(src[i + 7]);
+	}
+	for (; i < n; i++) {
+		dst[i] = bf16_from_fp32_value(src[i]);
+	}
+}
+
+/*
+ * Convert n 32-bit floating-point numbers in IEEE single-precision format to 16-bit floating-point numbers in
+ * bfloat16 format, in bit representation, rounding toward zero.
+ *
+ * A shift and an or per element: compilers vectorize this loop by themselves, so it has no SIMD kernels.
+ *
+ * @note The result is bit-identical to calling bf16_trunc_from_fp32_value on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void bf16_trunc_from_fp32_array(const float* src, uint16_t* dst, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		dst[i] = bf16_trunc_from_fp32_value(src[i]);
+	}
+}
+
+/*
+ * Convert n 16-bit floating-point numbers in bfloat16 format, in bit representation, to 32-bit floating-point numbers
+ * in IEEE single-precision format.
+ *
+ * @note The result is bit-identical to calling bf16_to_fp32_value on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void bf16_to_fp32_array(const uint16_t* src, float* dst, size_t n) {
+	const size_t head = fp16_array_head(src, n);
+	size_t i = 0;
+	for (; i < head; i++) {
+		dst[i] = bf16_to_fp32_value(src[i]);
+	}
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_bf16_kernels.bf16_to_fp32 != NULL) {
+		i += fp16_x86_bf16_kernels.bf16_to_fp32(src + i, dst + i, n - i);
+	}
+#endif
+#ifdef FP16_ARRAY_ARM
+	i += fp16_arm_kernels.bf16_to_fp32(src + i, dst + i, n - i);
+#endif
+	for (; n - i >= FP16_ARRAY_BLOCK; i += FP16_ARRAY_BLOCK) {
+		dst[i + 0] = bf16_to_fp32_value(src[i + 0]);
+		dst[i + 1] = bf16_to_fp32_value(src[i + 1]);
+		dst[i + 2] = bf16_to_fp32_value(src[i + 2]);
+		dst[i + 3] = bf16_to_fp32_value(src[i + 3]);
+		dst[i + 4] = bf16_to_fp32_value(src[i + 4]);
+		dst[i + 5] = bf16_to_fp32_value(src[i + 5]);
+		dst[i + 6] = bf16_to_fp32_value(src[i + 6]);
+		dst[i + 7] = bf16_to_fp32_value(src[i + 7]);
+	}
+	for (; i < n; i++) {
+		dst[i] = bf16_to_fp32_value(src[i]);
+	}
+}
+
+/*
+ * Convert n 16-bit floating-point numbers in IEEE half-precision format to 16-bit floating-point numbers in bfloat16
+ * format, both in bit representation, without a single-precision buffer in between.
+ *
+ * @note The result is bit-identical to calling bf16_from_fp16_ieee_value on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void bf16_from_fp16_ieee_array(const uint16_t* src, uint16_t* dst, size_t n) {
+	const size_t head = fp16_array_head(dst, n);
+	size_t i = 0;
+	for (; i < head; i++) {
+		dst[i] = bf16_from_fp16_ieee_value(src[i]);
+	}
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_bf16_kernels.bf16_from_fp16_ieee != NULL) {
+		i += fp16_x86_bf16_kernels.bf16_from_fp16_ieee(src + i, dst + i, n - i);
+	}
+#endif
+#ifdef FP16_ARRAY_ARM
+	i += fp16_arm_kernels.bf16_from_fp16_ieee(src + i, dst + i, n - i);
+#endif
+	for (; n - i >= FP16_ARRAY_BLOCK; i += FP16_ARRAY_BLOCK) {
+		dst[i + 0] = bf16_from_fp16_ieee_value(src[i + 0]);
+		dst[i + 1] = bf16_from_fp16_ieee_value(src[i + 1]);
+		dst[i + 2] = bf16_from_fp16_ieee_value(src[i + 2]);
+		dst[i + 3] = bf16_from_fp16_ieee_value(src[i + 3]);
+		dst[i + 4] = bf16_from_fp16_ieee_value(src[i + 4]);
+		dst[i + 5] = bf16_from_fp16_ieee_value(src[i + 5]);
+		dst[i + 6] = bf16_from_fp16_ieee_value(src[i + 6]);
+		dst[i + 7] = bf16_from_fp16_ieee_value(src[i + 7]);
+	}
+	for (; i < n; i++) {
+		dst[i] = bf16_from_fp16_ieee_value(src[i]);
+	}
+}
+
+/*
+ * Convert n 16-bit floating-point numbers in bfloat16 format to 16-bit floating-point numbers in IEEE half-precision
+ * format, both in bit representation, without a single-precision buffer in between.
+ *
+ * @note The result is bit-identical to calling fp16_ieee_from_bf16_value on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void fp16_ieee_from_bf16_array(const uint16_t* src, uint16_t* dst, size_t n) {
+	const size_t head = fp16_array_head(dst, n);
+	size_t i = 0;
+	for (; i < head; i++) {
+		dst[i] = fp16_ieee_from_bf16_value(src[i]);
+	}
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_bf16_kernels.fp16_ieee_from_bf16 != NULL) {
+		i += fp16_x86_bf16_kernels.fp16_ieee_from_bf16(src + i, dst + i, n - i);
+	}
+#endif
+#ifdef FP16_ARRAY_ARM
+	i += fp16_arm_kernels.fp16_ieee_from_bf16(src + i, dst + i, n - i);
+#endif
+	for (; n - i >= FP16_ARRAY_BLOCK; i += FP16_ARRAY_BLOCK) {
+		dst[i + 0] = fp16_ieee_from_bf16_value(src[i + 0]);
+		dst[i + 1] = fp16_ieee_from_bf16_value(src[i + 1]);
+		dst[i + 2] = fp16_ieee_from_bf16_value(src[i + 2]);
+		dst[i + 3] = fp16_ieee_from_bf16_value(src[i + 3]);
+		dst[i + 4] = fp16_ieee_from_bf16_value(src[i + 4]);
+		dst[i + 5] = fp16_ieee_from_bf16_value(src[i + 5]);
+		dst[i + 6] = fp16_ieee_from_bf16_value(src[i + 6]);
+		dst[i + 7] = fp16_ieee_from_bf16_value(src[i + 7]);
+	}
+	for (; i < n; i++) {
+		dst[i] = fp16_ieee_from_bf16_value(src[i]);
+	}
+}
+
+/*
+ * Fused quantization: y = x * scale + bias, clamped to the finite half-precision range and rounded to half precision,
+ * in one pass over memory. Compared with scaling into a fp32 buffer and converting that, the fp32 intermediate is never
+ * written and read back, so a bandwidth-bound conversion moves 6 instead of 14 bytes per element.
+ *
+ * x * scale + bias is computed with a single rounding (fmaf), which the SIMD kernels do with FMA instructions. Without
+ * a bias the functions add -0.0f, which leaves every product, -0 included, unchanged. The clamp to +-65504 replaces
+ * overflow to Inf (including Inf inputs) by the largest finite value, the usual behavior of inference quantizers; NaN
+ * stays NaN and becomes the canonical 0x7E00 with its sign. y is narrowed with fp16_ieee_from_fp32_bits, in integer
+ * arithmetic: round to nearest-even whatever the MXCSR or FPCR, and no denormal assist when y is a fp32 subnormal,
+ * like the heads and tails of fp16_ieee_from_fp32_array.
+ *
+ * Unlike the narrowing, the fmaf does follow the floating-point environment of the thread: a directed rounding mode
+ * rounds y in that direction, and FTZ / DAZ (FZ on AArch64) flush subnormal operands and y. The SIMD kernels are
+ * bit-identical to the scalar code in every environment, not only the default one:
+ * - on x86 the FMA instructions round and flush by MXCSR like fmaf (which is the same instruction on every CPU with
+ *   FMA), and vcvtps2ph rounds to nearest-even by its immediate, so the kernels need no MXCSR check;
+ * - on AArch64 FCVTN rounds by FPCR, so the NEON / SVE kernels only run when fp16_arm_fpcr_is_default, and the scalar
+ *   loop does the whole array otherwise.
+ * fp16_fenv_bench checks the scaled functions against fp16_ieee_from_fp32_scaled_value under FTZ / DAZ and the three
+ * directed modes.
+ */
+static inline uint16_t fp16_ieee_from_fp32_scaled_value(float f, float scale, float bias) {
+	float y = fmaf(f, scale, bias);
+	y = y > 65504.0f ? 65504.0f : y;
+	y = y < -65504.0f ? -65504.0f : y;
+	return fp16_ieee_from_fp32_bits(fp32_to_bits(y));
+}
+
+/*
+ * Per-tensor scale and bias: dst[i] = fp16(clamp(src[i] * scale + bias)).
+ *
+ * @note The result is bit-identical to calling fp16_ieee_from_fp32_scaled_value on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void fp16_ieee_from_fp32_scaled_bias(const float* src, uint16_t* dst, size_t n, float scale, float bias) {
+	const size_t head = fp16_array_head(dst, n);
+	size_t i = 0;
+	for (; i < head; i++) {
+		dst[i] = fp16_ieee_from_fp32_scaled_value(src[i], scale, bias);
+	}
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_scaled_kernels.ieee_from_fp32_scaled != NULL) {
+		i += fp16_x86_scaled_kernels.ieee_from_fp32_scaled(src + i, dst + i, n - i, scale, bias);
+	}
+#endif
+#ifdef FP16_ARRAY_ARM
+	if (fp16_arm_fpcr_is_default()) {
+		i += fp16_arm_kernels.ieee_from_fp32_scaled(src + i, dst + i, n - i, scale, bias);
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i] = fp16_ieee_from_fp32_scaled_value(src[i], scale, bias);
+	}
+}
+
+/*
+ * Per-tensor scale: dst[i] = fp16(clamp(src[i] * scale)).
+ *
+ * @note The result is bit-identical to calling fp16_ieee_from_fp32_scaled_value(src[i], scale, -0.0f) on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void fp16_ieee_from_fp32_scaled(const float* src, uint16_t* dst, size_t n, float scale) {
+	fp16_ieee_from_fp32_scaled_bias(src, dst, n, scale, -0.0f);
+}
+
+/*
+ * Per-channel scale for a [rows][channels] array, the channel being the innermost index (NHWC activations, the output
+ * features of a linear layer): dst[r * channels + c] = fp16(clamp(src[r * channels + c] * scale[c] + bias[c])).
+ * bias may be NULL.
+ *
+ * @note The result is bit-identical to calling fp16_ieee_from_fp32_scaled_value on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void fp16_ieee_from_fp32_scaled_channels(const float* src, uint16_t* dst, size_t rows, size_t channels,
+	const float* scale, const float* bias)
+{
+#ifdef FP16_ARRAY_ARM
+	const int fpcr_is_default = fp16_arm_fpcr_is_default();
+#endif
+	for (size_t r = 0; r < rows; r++) {
+		const float* row_src = src + r * channels;
+		uint16_t* row_dst = dst + r * channels;
+		size_t c = 0;
+#ifdef FP16_ARRAY_X86
+		if (fp16_x86_scaled_kernels.ieee_from_fp32_scaled_channels != NULL) {
+			c = fp16_x86_scaled_kernels.ieee_from_fp32_scaled_channels(row_src, row_dst, channels, scale, bias);
+		}
+#endif
+#ifdef FP16_ARRAY_ARM
+		if (fpcr_is_default) {
+			c = fp16_arm_kernels.ieee_from_fp32_scaled_channels(row_src, row_dst, channels, scale, bias);
+		}
+#endif
+		for (; c < channels; c++) {
+			row_dst[c] = fp16_ieee_from_fp32_scaled_value(row_src[c], scale[c], bias != NULL ? bias[c] : -0.0f);
+		}
+	}
+}
+
+/*
+ * Per-group scale: consecutive groups of group_size elements share a scale and a bias, dst[i] =
+ * fp16(clamp(src[i] * scale[i / group_size] + bias[i / group_size])). This covers per-channel scales of NCHW tensors
+ * (group_size = H * W) and block-wise quantization. group_size must not be 0, the last group may be shorter, and bias
+ * may be NULL.
+ *
+ * @note The result is bit-identical to calling fp16_ieee_from_fp32_scaled_value on every element.
+ * @note src and dst can have any alignment, but must not overlap.
+ */
+static inline void fp16_ieee_from_fp32_scaled_groups(const float* src, uint16_t* dst, size_t n, size_t group_size,
+	const float* scale, const float* bias)
+{
+	for (size_t g = 0, i = 0; i < n; g++, i += group_size) {
+		const size_t count = n - i < group_size ? n - i : group_size;
+		fp16_ieee_from_fp32_scaled_bias(src + i, dst + i, count, scale[g], bias != NULL ? bias[g] : -0.0f);
+	}
+}
+
+#endif /* FP16_ARRAY_H */
@@ -0,0 +1,468 @@
+/*
+ * Throughput of the bulk conversions in fp16_array.h (and of the instrumented one of fp16_stats.h), and of every SIMD
+ * kernel of fp16_x86.h / fp16_arm.h the CPU supports. The kernels are checked against the scalar functions of
+ * fp16_study.h first, and the program exits with 1 on any difference, so it can also be run under qemu-user on a
+ * non-native CI host, e.g.
+ *   aarch64-linux-gnu-gcc -O2 -march=armv8.2-a+sve -static -I<FP16>/include fp16_bench.c -o fp16_bench -lm
+ *   qemu-aarch64 -cpu max,sve256=on ./fp16_bench 100000 1
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_bench.c -o fp16_bench -lm -pthread
+ * or, with the OpenMP back end of fp16_parallel.h:
+ *   cc -O2 -fopenmp -DFP16_PARALLEL_OPENMP -I<FP16>/include fp16_bench.c -o fp16_bench -lm
+ *
+ * Usage: ./fp16_bench [number of elements] [repetitions] [maximum number of threads]
+ *
+ * The parallel section runs 1, 2, 4, ... threads up to the maximum (default: all online CPUs), to show where the
+ * conversion becomes bound by memory bandwidth. Use a number of elements well above the last level cache for it.
+ *
+ * GB/s counts both the bytes read and the bytes written, so a conversion of n elements moves 6 * n bytes in
+ * either direction. The fused scale section reports the same 6 bytes per element for the two-pass version, which
+ * really moves 14 (read fp32, write fp32, read it back, write fp16), so its lower GB/s is the cost of the extra pass.
+ */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fp16_array.h"
+#include "fp16_parallel.h"
+#include "fp16_stats.h"
+
+#if defined(FP16_ARRAY_X86)
+	#define BENCH_KERNEL_TABLE fp16_x86_kernel_table
+	#define BENCH_KERNEL_COUNT FP16_X86_KERNEL_COUNT
+	#define BENCH_KERNELS fp16_x86_kernels
+	#define BENCH_BF16_KERNEL_TABLE fp16_x86_bf16_kernel_table
+	#define BENCH_BF16_KERNEL_COUNT FP16_X86_BF16_KERNEL_COUNT
+	#define BENCH_SCALED_KERNEL_TABLE fp16_x86_scaled_kernel_table
+	#define BENCH_SCALED_KERNEL_COUNT FP16_X86_SCALED_KERNEL_COUNT
+#elif defined(FP16_ARRAY_ARM)
+	#define BENCH_KERNEL_TABLE fp16_arm_kernel_table
+	#define BENCH_KERNEL_COUNT FP16_ARM_KERNEL_COUNT
+	#define BENCH_KERNELS fp16_arm_kernels
+	#define BENCH_BF16_KERNEL_TABLE fp16_arm_kernel_table
+	#define BENCH_BF16_KERNEL_COUNT FP16_ARM_KERNEL_COUNT
+	#define BENCH_SCALED_KERNEL_TABLE fp16_arm_kernel_table
+	#define BENCH_SCALED_KERNEL_COUNT FP16_ARM_KERNEL_COUNT
+#endif
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* xorshift32, only used to fill the input with something that is not all the same value */
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static void report(const char* name, size_t n, int reps, double seconds) {
+	const double per_call = seconds / reps;
+	const double bytes = (double) n * (sizeof(float) + sizeof(uint16_t));
+	printf("%-32s %10.3f ns/element %8.2f GB/s\n", name, per_call * 1e9 / (double) n, bytes / per_call * 1e-9);
+}
+
+int main(int argc, char** argv) {
+	const size_t n = argc > 1 ? (size_t) strtoull(argv[1], NULL, 0) : (size_t) 1 << 24;
+	const int reps = argc > 2 ? atoi(argv[2]) : 10;
+	const long online = sysconf(_SC_NPROCESSORS_ONLN);
+	const size_t max_threads = argc > 3 ? (size_t) strtoull(argv[3], NULL, 0) : online > 0 ? (size_t) online : 1;
+
+	/* +1 so that the unaligned runs below still have n elements */
+	float* f32 = malloc((n + 1) * sizeof(float));
+	float* f32_back = malloc((n + 1) * sizeof(float));
+	uint16_t* f16 = malloc((n + 1) * sizeof(uint16_t));
+	uint16_t* f16_ref = malloc((n + 1) * sizeof(uint16_t));
+	if (f32 == NULL || f32_back == NULL || f16 == NULL || f16_ref == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	/* Normal fp16 range, [-2**15, 2**15) */
+	uint32_t state = UINT32_C(0x12345678);
+	for (size_t i = 0; i < n + 1; i++) {
+		f32[i] = (float) ((int32_t) next_random(&state)) * 0x1.0p-16f;
+	}
+
+	/* Bit-exactness against the scalar reference, aligned and unaligned */
+	for (size_t i = 0; i < n + 1; i++) {
+		f16_ref[i] = fp16_ieee_from_fp32_value(f32[i]);
+	}
+	fp16_ieee_from_fp32_array(f32, f16, n);
+	if (memcmp(f16, f16_ref, n * sizeof(uint16_t)) != 0) {
+		fprintf(stderr, "fp16_ieee_from_fp32_array differs from fp16_ieee_from_fp32_value\n");
+		return 1;
+	}
+	fp16_ieee_from_fp32_array(f32 + 1, f16 + 1, n);
+	if (memcmp(f16 + 1, f16_ref + 1, n * sizeof(uint16_t)) != 0) {
+		fprintf(stderr, "fp16_ieee_from_fp32_array differs from fp16_ieee_from_fp32_value (unaligned)\n");
+		return 1;
+	}
+
+	double start = now_seconds();
+	for (int r = 0; r < reps; r++) {
+		for (size_t i = 0; i < n; i++) {
+			f16[i] = fp16_ieee_from_fp32_value(f32[i]);
+		}
+	}
+	report("fp16_ieee_from_fp32_value loop", n, reps, now_seconds() - start);
+
+	start = now_seconds();
+	for (int r = 0; r < reps; r++) {
+		fp16_ieee_from_fp32_array(f32, f16, n);
+	}
+	report("fp16_ieee_from_fp32_array", n, reps, now_seconds() - start);
+
+	/* The instrumented conversion of fp16_stats.h: the classes only (the default), and with the errors */
+	for (uint32_t flags = FP16_STATS_COUNTS; flags <= FP16_STATS_ERRORS; flags++) {
+		struct fp16_conversion_stats stats;
+		fp16_conversion_stats_init(&stats, flags);
+		fp16_ieee_from_fp32_array_stats(f32, f16, n, &stats);
+		if (memcmp(f16, f16_ref, n * sizeof(uint16_t)) != 0 || stats.count != n) {
+			fprintf(stderr, "fp16_ieee_from_fp32_array_stats differs from fp16_ieee_from_fp32_value\n");
+			return 1;
+		}
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			fp16_conversion_stats_init(&stats, flags);
+			fp16_ieee_from_fp32_array_stats(f32, f16, n, &stats);
+		}
+		const char* name = flags & FP16_STATS_ERRORS ? "array_stats, errors" : "array_stats, counts";
+		report(name, n, reps, now_seconds() - start);
+	}
+
+	start = now_seconds();
+	for (int r = 0; r < reps; r++) {
+		for (size_t i = 0; i < n; i++) {
+			f32_back[i] = fp16_ieee_to_fp32_value(f16[i]);
+		}
+	}
+	report("fp16_ieee_to_fp32_value loop", n, reps, now_seconds() - start);
+
+	start = now_seconds();
+	for (int r = 0; r < reps; r++) {
+		fp16_ieee_to_fp32_array(f16, f32_back, n);
+	}
+	report("fp16_ieee_to_fp32_array", n, reps, now_seconds() - start);
+
+#if defined(FP16_ARRAY_X86) || defined(FP16_ARRAY_ARM)
+	/*
+	 * Every SIMD kernel the CPU supports, not only the one picked by the dispatcher. Before timing, the kernels are
+	 * checked against the scalar functions: fp32 -> fp16 on the benchmark input, fp16 -> fp32 on all 2**16 inputs.
+	 */
+	printf("dispatcher selected: %s\n", BENCH_KERNELS.name);
+	uint16_t* all_f16 = malloc(65536 * sizeof(uint16_t));
+	float* all_f32 = malloc(65536 * sizeof(float));
+	for (uint32_t h = 0; h < 65536; h++) {
+		all_f16[h] = (uint16_t) h;
+	}
+	for (size_t k = 0; k < BENCH_KERNEL_COUNT; k++) {
+		char name[64];
+		if (!BENCH_KERNEL_TABLE[k].supported()) {
+			printf("%-32s not supported\n", BENCH_KERNEL_TABLE[k].name);
+			continue;
+		}
+
+		size_t done = BENCH_KERNEL_TABLE[k].ieee_from_fp32(f32, f16, n);
+		if (memcmp(f16, f16_ref, done * sizeof(uint16_t)) != 0) {
+			fprintf(stderr, "%s kernel differs from fp16_ieee_from_fp32_value\n", BENCH_KERNEL_TABLE[k].name);
+			return 1;
+		}
+		done = BENCH_KERNEL_TABLE[k].ieee_to_fp32(all_f16, all_f32, 65536);
+		for (size_t h = 0; h < done; h++) {
+			if (fp32_to_bits(all_f32[h]) != fp32_to_bits(fp16_ieee_to_fp32_value((uint16_t) h))) {
+				fprintf(stderr, "%s kernel differs from fp16_ieee_to_fp32_value at 0x%04X\n",
+					BENCH_KERNEL_TABLE[k].name, (unsigned) h);
+				return 1;
+			}
+		}
+#ifdef FP16_ARRAY_ARM
+		done = BENCH_KERNEL_TABLE[k].alt_from_fp32(f32, f16, n);
+		for (size_t i = 0; i < done; i++) {
+			if (f16[i] != fp16_alt_from_fp32_value(f32[i])) {
+				fprintf(stderr, "%s kernel differs from fp16_alt_from_fp32_value\n", BENCH_KERNEL_TABLE[k].name);
+				return 1;
+			}
+		}
+		done = BENCH_KERNEL_TABLE[k].alt_to_fp32(all_f16, all_f32, 65536);
+		for (size_t h = 0; h < done; h++) {
+			if (fp32_to_bits(all_f32[h]) != fp32_to_bits(fp16_alt_to_fp32_value((uint16_t) h))) {
+				fprintf(stderr, "%s kernel differs from fp16_alt_to_fp32_value at 0x%04X\n",
+					BENCH_KERNEL_TABLE[k].name, (unsigned) h);
+				return 1;
+			}
+		}
+#endif
+
+		snprintf(name, sizeof(name), "%s fp32->fp16", BENCH_KERNEL_TABLE[k].name);
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			BENCH_KERNEL_TABLE[k].ieee_from_fp32(f32, f16, n);
+		}
+		report(name, n, reps, now_seconds() - start);
+
+		snprintf(name, sizeof(name), "%s fp16->fp32", BENCH_KERNEL_TABLE[k].name);
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			BENCH_KERNEL_TABLE[k].ieee_to_fp32(f16, f32_back, n);
+		}
+		report(name, n, reps, now_seconds() - start);
+	}
+
+	/*
+	 * The bfloat16 kernels, checked against bf16_from_fp32_value on the benchmark input plus a few special values, and
+	 * against the scalar functions on all 2**16 inputs for the other directions.
+	 */
+	uint16_t* all_out = malloc(65536 * sizeof(uint16_t));
+	float special[32];
+	for (int s = 0; s < 32; s++) {
+		/* NaN with payload only in the low half, ties, fp32 subnormals, overflow to Inf, Inf */
+		static const uint32_t bits[8] = {
+			UINT32_C(0x7F800001), UINT32_C(0xFF800123), UINT32_C(0x3F808000), UINT32_C(0x3F818000),
+			UINT32_C(0x00018000), UINT32_C(0x80000001), UINT32_C(0x7F7FFFFF), UINT32_C(0xFF800000),
+		};
+		special[s] = fp32_from_bits(bits[s % 8] + (uint32_t) (s / 8));
+	}
+	for (size_t k = 0; k < BENCH_BF16_KERNEL_COUNT; k++) {
+		char name[64];
+		if (!BENCH_BF16_KERNEL_TABLE[k].supported()) {
+			continue;
+		}
+
+		size_t done = BENCH_BF16_KERNEL_TABLE[k].bf16_from_fp32(f32, f16, n);
+		for (size_t i = 0; i < done; i++) {
+			if (f16[i] != bf16_from_fp32_value(f32[i])) {
+				fprintf(stderr, "%s kernel differs from bf16_from_fp32_value\n", BENCH_BF16_KERNEL_TABLE[k].name);
+				return 1;
+			}
+		}
+		done = BENCH_BF16_KERNEL_TABLE[k].bf16_from_fp32(special, all_out, 32);
+		for (size_t i = 0; i < done; i++) {
+			if (all_out[i] != bf16_from_fp32_value(special[i])) {
+				fprintf(stderr, "%s kernel differs from bf16_from_fp32_value at 0x%08X\n",
+					BENCH_BF16_KERNEL_TABLE[k].name, (unsigned) fp32_to_bits(special[i]));
+				return 1;
+			}
+		}
+		done = BENCH_BF16_KERNEL_TABLE[k].bf16_to_fp32(all_f16, all_f32, 65536);
+		for (size_t h = 0; h < done; h++) {
+			if (fp32_to_bits(all_f32[h]) != bf16_to_fp32_bits((uint16_t) h)) {
+				fprintf(stderr, "%s kernel differs from bf16_to_fp32_value at 0x%04X\n",
+					BENCH_BF16_KERNEL_TABLE[k].name, (unsigned) h);
+				return 1;
+			}
+		}
+		done = BENCH_BF16_KERNEL_TABLE[k].bf16_from_fp16_ieee(all_f16, all_out, 65536);
+		for (size_t h = 0; h < done; h++) {
+			if (all_out[h] != bf16_from_fp16_ieee_value((uint16_t) h)) {
+				fprintf(stderr, "%s kernel differs from bf16_from_fp16_ieee_value at 0x%04X\n",
+					BENCH_BF16_KERNEL_TABLE[k].name, (unsigned) h);
+				return 1;
+			}
+		}
+		done = BENCH_BF16_KERNEL_TABLE[k].fp16_ieee_from_bf16(all_f16, all_out, 65536);
+		for (size_t h = 0; h < done; h++) {
+			if (all_out[h] != fp16_ieee_from_bf16_value((uint16_t) h)) {
+				fprintf(stderr, "%s kernel differs from fp16_ieee_from_bf16_value at 0x%04X\n",
+					BENCH_BF16_KERNEL_TABLE[k].name, (unsigned) h);
+				return 1;
+			}
+		}
+
+		snprintf(name, sizeof(name), "%s fp32->bf16", BENCH_BF16_KERNEL_TABLE[k].name);
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			BENCH_BF16_KERNEL_TABLE[k].bf16_from_fp32(f32, f16, n);
+		}
+		report(name, n, reps, now_seconds() - start);
+
+		snprintf(name, sizeof(name), "%s bf16->fp32", BENCH_BF16_KERNEL_TABLE[k].name);
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			BENCH_BF16_KERNEL_TABLE[k].bf16_to_fp32(f16, f32_back, n);
+		}
+		report(name, n, reps, now_seconds() - start);
+	}
+	free(all_out);
+	free(all_f16);
+	free(all_f32);
+#endif
+
+	/*
+	 * Fused scale against two passes over memory (scale into a fp32 buffer, then convert it). The scale of 3 takes the
+	 * larger inputs past 65504, so the clamp is exercised. Checked first against fp16_ieee_from_fp32_scaled_value: the
+	 * per-tensor, per-channel and per-group functions, special values, and every fused kernel the CPU supports.
+	 */
+	{
+		const float scale = 3.0f;
+		const float bias = -0.25f;
+		enum { CHANNELS = 67, GROUP_SIZE = 1000 };
+		const size_t groups = (n + GROUP_SIZE - 1) / GROUP_SIZE;
+		float channel_scale[CHANNELS], channel_bias[CHANNELS];
+		float* group_scale = calloc(groups, sizeof(float));
+		float* group_bias = calloc(groups, sizeof(float));
+		if (group_scale == NULL || group_bias == NULL) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		for (size_t c = 0; c < CHANNELS; c++) {
+			channel_scale[c] = (float) (next_random(&state) >> 8) * 0x1.0p-22f;
+			channel_bias[c] = (float) ((int32_t) next_random(&state)) * 0x1.0p-31f;
+		}
+		for (size_t g = 0; g < groups; g++) {
+			group_scale[g] = (float) (next_random(&state) >> 8) * 0x1.0p-22f;
+			group_bias[g] = (float) ((int32_t) next_random(&state)) * 0x1.0p-31f;
+		}
+
+		fp16_ieee_from_fp32_scaled_bias(f32, f16, n, scale, bias);
+		for (size_t i = 0; i < n; i++) {
+			if (f16[i] != fp16_ieee_from_fp32_scaled_value(f32[i], scale, bias)) {
+				fprintf(stderr, "fp16_ieee_from_fp32_scaled_bias differs from fp16_ieee_from_fp32_scaled_value\n");
+				return 1;
+			}
+		}
+		const size_t rows = n / CHANNELS;
+		fp16_ieee_from_fp32_scaled_channels(f32, f16, rows, CHANNELS, channel_scale, channel_bias);
+		for (size_t i = 0; i < rows * CHANNELS; i++) {
+			if (f16[i] != fp16_ieee_from_fp32_scaled_value(f32[i], channel_scale[i % CHANNELS], channel_bias[i % CHANNELS])) {
+				fprintf(stderr, "fp16_ieee_from_fp32_scaled_channels differs from fp16_ieee_from_fp32_scaled_value\n");
+				return 1;
+			}
+		}
+		fp16_ieee_from_fp32_scaled_groups(f32, f16, n, GROUP_SIZE, group_scale, NULL);
+		for (size_t i = 0; i < n; i++) {
+			if (f16[i] != fp16_ieee_from_fp32_scaled_value(f32[i], group_scale[i / GROUP_SIZE], -0.0f)) {
+				fprintf(stderr, "fp16_ieee_from_fp32_scaled_groups differs from fp16_ieee_from_fp32_scaled_value\n");
+				return 1;
+			}
+		}
+
+		/* -0 stays -0 without a bias, Inf and overflow saturate, NaN is canonical */
+		static const uint32_t special_bits[8] = {
+			UINT32_C(0x80000000), UINT32_C(0x00000000), UINT32_C(0x7F800000), UINT32_C(0xFF800000),
+			UINT32_C(0x7FC00123), UINT32_C(0xFF800001), UINT32_C(0x47000000), UINT32_C(0x3F800000),
+		};
+		static const uint16_t special_expected[8] = {
+			UINT16_C(0x8000), UINT16_C(0x0000), UINT16_C(0x7BFF), UINT16_C(0xFBFF),
+			UINT16_C(0x7E00), UINT16_C(0xFE00), UINT16_C(0x7BFF), UINT16_C(0x4400),
+		};
+		float special_in[64];
+		uint16_t special_out[64];
+		for (size_t i = 0; i < 64; i++) {
+			special_in[i] = fp32_from_bits(special_bits[i % 8]);
+		}
+		fp16_ieee_from_fp32_scaled(special_in, special_out, 64, 4.0f);
+		for (size_t i = 0; i < 64; i++) {
+			if (special_out[i] != special_expected[i % 8]) {
+				fprintf(stderr, "fp16_ieee_from_fp32_scaled gives 0x%04X for 0x%08X\n",
+					(unsigned) special_out[i], (unsigned) special_bits[i % 8]);
+				return 1;
+			}
+		}
+
+#if defined(FP16_ARRAY_X86) || defined(FP16_ARRAY_ARM)
+		for (size_t k = 0; k < BENCH_SCALED_KERNEL_COUNT; k++) {
+			if (!BENCH_SCALED_KERNEL_TABLE[k].supported()) {
+				continue;
+			}
+			size_t done = BENCH_SCALED_KERNEL_TABLE[k].ieee_from_fp32_scaled(f32, f16, n, scale, bias);
+			for (size_t i = 0; i < done; i++) {
+				if (f16[i] != fp16_ieee_from_fp32_scaled_value(f32[i], scale, bias)) {
+					fprintf(stderr, "%s kernel differs from fp16_ieee_from_fp32_scaled_value\n",
+						BENCH_SCALED_KERNEL_TABLE[k].name);
+					return 1;
+				}
+			}
+			done = BENCH_SCALED_KERNEL_TABLE[k].ieee_from_fp32_scaled_channels(special_in, special_out, 64, special_in, NULL);
+			for (size_t i = 0; i < done; i++) {
+				if (special_out[i] != fp16_ieee_from_fp32_scaled_value(special_in[i], special_in[i], -0.0f)) {
+					fprintf(stderr, "%s kernel differs from fp16_ieee_from_fp32_scaled_value at 0x%08X\n",
+						BENCH_SCALED_KERNEL_TABLE[k].name, (unsigned) fp32_to_bits(special_in[i]));
+					return 1;
+				}
+			}
+		}
+#endif
+
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			for (size_t i = 0; i < n; i++) {
+				f32_back[i] = f32[i] * scale + bias;
+			}
+			fp16_ieee_from_fp32_array(f32_back, f16, n);
+		}
+		report("two-pass scale, fp32->fp16", n, reps, now_seconds() - start);
+
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			fp16_ieee_from_fp32_scaled_bias(f32, f16, n, scale, bias);
+		}
+		report("fused scale fp32->fp16", n, reps, now_seconds() - start);
+
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			fp16_ieee_from_fp32_scaled_channels(f32, f16, rows, CHANNELS, channel_scale, channel_bias);
+		}
+		report("fused per-channel fp32->fp16", rows * CHANNELS, reps, now_seconds() - start);
+
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			fp16_ieee_from_fp32_scaled_groups(f32, f16, n, GROUP_SIZE, group_scale, group_bias);
+		}
+		report("fused per-group fp32->fp16", n, reps, now_seconds() - start);
+
+		free(group_scale);
+		free(group_bias);
+	}
+
+	for (size_t threads = 1;; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+		char name[64];
+		struct fp16_parallel_pool* pool = fp16_parallel_pool_create(threads, 1);
+		if (pool == NULL) {
+			fprintf(stderr, "can not create a pool of %zu threads\n", threads);
+			return 1;
+		}
+
+		fp16_ieee_from_fp32_parallel(pool, f32, f16, n);
+		if (memcmp(f16, f16_ref, n * sizeof(uint16_t)) != 0) {
+			fprintf(stderr, "fp16_ieee_from_fp32_parallel differs from fp16_ieee_from_fp32_value\n");
+			return 1;
+		}
+
+		snprintf(name, sizeof(name), "parallel x%zu fp32->fp16", threads);
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			fp16_ieee_from_fp32_parallel(pool, f32, f16, n);
+		}
+		report(name, n, reps, now_seconds() - start);
+
+		snprintf(name, sizeof(name), "parallel x%zu fp16->fp32", threads);
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			fp16_ieee_to_fp32_parallel(pool, f16, f32_back, n);
+		}
+		report(name, n, reps, now_seconds() - start);
+
+		fp16_parallel_pool_destroy(pool);
+		if (threads >= max_threads) {
+			break;
+		}
+	}
+
+	free(f32);
+	free(f32_back);
+	free(f16);
+	free(f16_ref);
+	return 0;
+}
@@ -0,0 +1,521 @@
+#pragma once
+#ifndef FP16_BLAS_H
+#define FP16_BLAS_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cstddef>
+	#include <cstdint>
+	#include <cstring>
+#else
+	#include <stddef.h>
+	#include <stdint.h>
+	#include <string.h>
+#endif
+
+#include "fp16_array.h"
+
+/*
+ * Linear algebra on half-precision weights with single-precision arithmetic, without an expanded copy of the weights.
+ *
+ * The usual way to multiply by a matrix stored in IEEE half precision is to expand it with fp16_ieee_to_fp32_array
+ * into a fp32 buffer and run fp32 code on that buffer. For a matrix-vector product that reads 2 bytes, writes 4 and
+ * reads 4 again per weight. The kernels below load the half-precision numbers and widen them in registers, with the
+ * decoders of fp16_x86.h / fp16_arm.h, so every weight is read once, as 2 bytes:
+ *
+ * | kernel  | ISA                 | widening                                   | multiply-add      |
+ * |---------|---------------------|--------------------------------------------|-------------------|
+ * | scalar  | any                 | fp16_ieee_to_fp32_value                    | separate          |
+ * | sse2    | SSE2                | fp16_ieee_to_fp32_sse2_x4 (magic bias)     | separate          |
+ * | f16c    | AVX2 + F16C + FMA   | vcvtph2ps ymm                              | vfmadd ymm        |
+ * | avx512f | AVX-512F (+ FMA)    | vcvtph2ps zmm                              | vfmadd zmm        |
+ * | neon    | AArch64             | FCVTL                                      | FMLA              |
+ *
+ * The functions, all with row-major matrices and fp32 accumulation:
+ * - fp16_ieee_dot(x, y, n): sum of x[i] * y[i], x half precision, y single precision,
+ * - fp16_ieee_axpy(n, alpha, x, y): y[i] += alpha * x[i], x half precision,
+ * - fp16_ieee_gemv(m, k, a, lda, x, y): y = A x for a m x k half-precision matrix A,
+ * - fp16_ieee_gemm(m, n, k, a, lda, b, ldb, c, ldc): C += A B for a m x k single-precision A and a k x n
+ *   half-precision B (the weights), so that C = activations times weights.
+ *
+ * The SIMD kernels keep several partial sums per output, so the rounding of the sums differs from a sequential loop
+ * (and between kernels). The decoding is exact, but a product of an fp16 and an fp32 number has up to 35 significant
+ * bits: the scalar and sse2 kernels round it to fp32 before the addition, only the FMA kernels (f16c, avx512f, neon)
+ * add it unrounded. fp16_blas_bench.c checks every kernel against a double-precision reference.
+ *
+ * GEMM is blocked: a FP16_BLAS_KC x FP16_BLAS_NC panel of B (64 KB of fp16) stays in L2 while the micro-kernel walks
+ * over the rows of A, 4 rows and one tile_width wide strip of B at a time, with the 4 x tile_width block of C in
+ * registers. The strip is widened again for every 4 rows of A, which costs a conversion instruction per 8 or 16
+ * weights, but never a store.
+ */
+#define FP16_BLAS_KC 256
+#define FP16_BLAS_NC 128
+#define FP16_BLAS_MAX_TILE_WIDTH 32
+
+typedef float (*fp16_blas_dot_kernel)(const uint16_t* x, const float* y, size_t n);
+typedef void (*fp16_blas_axpy_kernel)(size_t n, float alpha, const uint16_t* x, float* y);
+/* Four dot products with the same y, for four rows of a matrix: out[r] = dot(x[r], y, n) */
+typedef void (*fp16_blas_dot4_kernel)(const uint16_t* const x[4], const float* y, size_t n, float out[4]);
+/* C[0..3][0..tile_width-1] += A[0..3][0..k-1] * B[0..k-1][0..tile_width-1] */
+typedef void (*fp16_blas_tile_kernel)(size_t k, const float* a, size_t lda, const uint16_t* b, size_t ldb,
+	float* c, size_t ldc);
+
+struct fp16_blas_kernel {
+	const char* name;
+	int (*supported)(void);
+	fp16_blas_dot_kernel dot;
+	fp16_blas_axpy_kernel axpy;
+	fp16_blas_dot4_kernel dot4;
+	fp16_blas_tile_kernel tile;
+	size_t tile_width;
+};
+
+static inline float fp16_blas_dot_scalar(const uint16_t* x, const float* y, size_t n) {
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		sum += fp16_ieee_to_fp32_value(x[i]) * y[i];
+	}
+	return sum;
+}
+
+static inline void fp16_blas_axpy_scalar(size_t n, float alpha, const uint16_t* x, float* y) {
+	for (size_t i = 0; i < n; i++) {
+		y[i] += alpha * fp16_ieee_to_fp32_value(x[i]);
+	}
+}
+
+static inline void fp16_blas_dot4_scalar(const uint16_t* const x[4], const float* y, size_t n, float out[4]) {
+	for (int r = 0; r < 4; r++) {
+		out[r] = fp16_blas_dot_scalar(x[r], y, n);
+	}
+}
+
+static inline void fp16_blas_tile_scalar(size_t k, const float* a, size_t lda, const uint16_t* b, size_t ldb,
+	float* c, size_t ldc)
+{
+	for (size_t p = 0; p < k; p++) {
+		for (size_t j = 0; j < 8; j++) {
+			const float w = fp16_ieee_to_fp32_value(b[p * ldb + j]);
+			for (size_t r = 0; r < 4; r++) {
+				c[r * ldc + j] += a[r * lda + p] * w;
+			}
+		}
+	}
+}
+
+static inline int fp16_blas_has_scalar(void) {
+	return 1;
+}
+
+#ifdef FP16_ARRAY_X86
+FP16_X86_TARGET("sse2")
+static inline float fp16_blas_hsum_sse2(__m128 v) {
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 0x55));
+	return _mm_cvtss_f32(v);
+}
+
+/* 8 half-precision numbers to two vectors of 4, with the integer decoder of fp16_x86.h */
+FP16_X86_TARGET("sse2")
+static inline void fp16_blas_load8_sse2(const uint16_t* p, __m128* lo, __m128* hi) {
+	const __m128i h = _mm_loadu_si128((const __m128i*) p);
+	*lo = fp16_ieee_to_fp32_sse2_x4(_mm_unpacklo_epi16(_mm_setzero_si128(), h));
+	*hi = fp16_ieee_to_fp32_sse2_x4(_mm_unpackhi_epi16(_mm_setzero_si128(), h));
+}
+
+FP16_X86_TARGET("sse2")
+static inline float fp16_blas_dot_sse2(const uint16_t* x, const float* y, size_t n) {
+	__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		__m128 lo, hi;
+		fp16_blas_load8_sse2(x + i, &lo, &hi);
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(lo, _mm_loadu_ps(y + i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(hi, _mm_loadu_ps(y + i + 4)));
+	}
+	return fp16_blas_hsum_sse2(_mm_add_ps(acc0, acc1)) + fp16_blas_dot_scalar(x + i, y + i, n - i);
+}
+
+FP16_X86_TARGET("sse2")
+static inline void fp16_blas_axpy_sse2(size_t n, float alpha, const uint16_t* x, float* y) {
+	const __m128 alpha_v = _mm_set1_ps(alpha);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		__m128 lo, hi;
+		fp16_blas_load8_sse2(x + i, &lo, &hi);
+		_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(alpha_v, lo)));
+		_mm_storeu_ps(y + i + 4, _mm_add_ps(_mm_loadu_ps(y + i + 4), _mm_mul_ps(alpha_v, hi)));
+	}
+	fp16_blas_axpy_scalar(n - i, alpha, x + i, y + i);
+}
+
+FP16_X86_TARGET("sse2")
+static inline void fp16_blas_dot4_sse2(const uint16_t* const x[4], const float* y, size_t n, float out[4]) {
+	__m128 acc[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m128 y_lo = _mm_loadu_ps(y + i);
+		const __m128 y_hi = _mm_loadu_ps(y + i + 4);
+		for (int r = 0; r < 4; r++) {
+			__m128 lo, hi;
+			fp16_blas_load8_sse2(x[r] + i, &lo, &hi);
+			acc[r] = _mm_add_ps(acc[r], _mm_add_ps(_mm_mul_ps(lo, y_lo), _mm_mul_ps(hi, y_hi)));
+		}
+	}
+	for (int r = 0; r < 4; r++) {
+		out[r] = fp16_blas_hsum_sse2(acc[r]) + fp16_blas_dot_scalar(x[r] + i, y + i, n - i);
+	}
+}
+
+FP16_X86_TARGET("sse2")
+static inline void fp16_blas_tile_sse2(size_t k, const float* a, size_t lda, const uint16_t* b, size_t ldb,
+	float* c, size_t ldc)
+{
+	__m128 acc[4][2];
+	for (int r = 0; r < 4; r++) {
+		acc[r][0] = _mm_loadu_ps(c + r * ldc);
+		acc[r][1] = _mm_loadu_ps(c + r * ldc + 4);
+	}
+	for (size_t p = 0; p < k; p++) {
+		__m128 lo, hi;
+		fp16_blas_load8_sse2(b + p * ldb, &lo, &hi);
+		for (int r = 0; r < 4; r++) {
+			const __m128 a_v = _mm_set1_ps(a[r * lda + p]);
+			acc[r][0] = _mm_add_ps(acc[r][0], _mm_mul_ps(a_v, lo));
+			acc[r][1] = _mm_add_ps(acc[r][1], _mm_mul_ps(a_v, hi));
+		}
+	}
+	for (int r = 0; r < 4; r++) {
+		_mm_storeu_ps(c + r * ldc, acc[r][0]);
+		_mm_storeu_ps(c + r * ldc + 4, acc[r][1]);
+	}
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline float fp16_blas_hsum_avx(__m256 v) {
+	const __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	return fp16_blas_hsum_sse2(s);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline __m256 fp16_blas_load8_f16c(const uint16_t* p) {
+	return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) p));
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline float fp16_blas_dot_f16c(const uint16_t* x, const float* y, size_t n) {
+	__m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		acc0 = _mm256_fmadd_ps(fp16_blas_load8_f16c(x + i), _mm256_loadu_ps(y + i), acc0);
+		acc1 = _mm256_fmadd_ps(fp16_blas_load8_f16c(x + i + 8), _mm256_loadu_ps(y + i + 8), acc1);
+	}
+	return fp16_blas_hsum_avx(_mm256_add_ps(acc0, acc1)) + fp16_blas_dot_scalar(x + i, y + i, n - i);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline void fp16_blas_axpy_f16c(size_t n, float alpha, const uint16_t* x, float* y) {
+	const __m256 alpha_v = _mm256_set1_ps(alpha);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		_mm256_storeu_ps(y + i, _mm256_fmadd_ps(alpha_v, fp16_blas_load8_f16c(x + i), _mm256_loadu_ps(y + i)));
+	}
+	fp16_blas_axpy_scalar(n - i, alpha, x + i, y + i);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline void fp16_blas_dot4_f16c(const uint16_t* const x[4], const float* y, size_t n, float out[4]) {
+	__m256 acc[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256 y_v = _mm256_loadu_ps(y + i);
+		for (int r = 0; r < 4; r++) {
+			acc[r] = _mm256_fmadd_ps(fp16_blas_load8_f16c(x[r] + i), y_v, acc[r]);
+		}
+	}
+	for (int r = 0; r < 4; r++) {
+		out[r] = fp16_blas_hsum_avx(acc[r]) + fp16_blas_dot_scalar(x[r] + i, y + i, n - i);
+	}
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline void fp16_blas_tile_f16c(size_t k, const float* a, size_t lda, const uint16_t* b, size_t ldb,
+	float* c, size_t ldc)
+{
+	__m256 acc[4][2];
+	for (int r = 0; r < 4; r++) {
+		acc[r][0] = _mm256_loadu_ps(c + r * ldc);
+		acc[r][1] = _mm256_loadu_ps(c + r * ldc + 8);
+	}
+	for (size_t p = 0; p < k; p++) {
+		const __m256 lo = fp16_blas_load8_f16c(b + p * ldb);
+		const __m256 hi = fp16_blas_load8_f16c(b + p * ldb + 8);
+		for (int r = 0; r < 4; r++) {
+			const __m256 a_v = _mm256_broadcast_ss(a + r * lda + p);
+			acc[r][0] = _mm256_fmadd_ps(a_v, lo, acc[r][0]);
+			acc[r][1] = _mm256_fmadd_ps(a_v, hi, acc[r][1]);
+		}
+	}
+	for (int r = 0; r < 4; r++) {
+		_mm256_storeu_ps(c + r * ldc, acc[r][0]);
+		_mm256_storeu_ps(c + r * ldc + 8, acc[r][1]);
+	}
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline __m512 fp16_blas_load16_avx512f(const uint16_t* p) {
+	return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*) p));
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline float fp16_blas_dot_avx512f(const uint16_t* x, const float* y, size_t n) {
+	__m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		acc0 = _mm512_fmadd_ps(fp16_blas_load16_avx512f(x + i), _mm512_loadu_ps(y + i), acc0);
+		acc1 = _mm512_fmadd_ps(fp16_blas_load16_avx512f(x + i + 16), _mm512_loadu_ps(y + i + 16), acc1);
+	}
+	return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1)) + fp16_blas_dot_scalar(x + i, y + i, n - i);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline void fp16_blas_axpy_avx512f(size_t n, float alpha, const uint16_t* x, float* y) {
+	const __m512 alpha_v = _mm512_set1_ps(alpha);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		_mm512_storeu_ps(y + i, _mm512_fmadd_ps(alpha_v, fp16_blas_load16_avx512f(x + i), _mm512_loadu_ps(y + i)));
+	}
+	fp16_blas_axpy_scalar(n - i, alpha, x + i, y + i);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline void fp16_blas_dot4_avx512f(const uint16_t* const x[4], const float* y, size_t n, float out[4]) {
+	__m512 acc[4] = { _mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps() };
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m512 y_v = _mm512_loadu_ps(y + i);
+		for (int r = 0; r < 4; r++) {
+			acc[r] = _mm512_fmadd_ps(fp16_blas_load16_avx512f(x[r] + i), y_v, acc[r]);
+		}
+	}
+	for (int r = 0; r < 4; r++) {
+		out[r] = _mm512_reduce_add_ps(acc[r]) + fp16_blas_dot_scalar(x[r] + i, y + i, n - i);
+	}
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline void fp16_blas_tile_avx512f(size_t k, const float* a, size_t lda, const uint16_t* b, size_t ldb,
+	float* c, size_t ldc)
+{
+	__m512 acc[4][2];
+	for (int r = 0; r < 4; r++) {
+		acc[r][0] = _mm512_loadu_ps(c + r * ldc);
+		acc[r][1] = _mm512_loadu_ps(c + r * ldc + 16);
+	}
+	for (size_t p = 0; p < k; p++) {
+		const __m512 lo = fp16_blas_load16_avx512f(b + p * ldb);
+		const __m512 hi = fp16_blas_load16_avx512f(b + p * ldb + 16);
+		for (int r = 0; r < 4; r++) {
+			const __m512 a_v = _mm512_set1_ps(a[r * lda + p]);
+			acc[r][0] = _mm512_fmadd_ps(a_v, lo, acc[r][0]);
+			acc[r][1] = _mm512_fmadd_ps(a_v, hi, acc[r][1]);
+		}
+	}
+	for (int r = 0; r < 4; r++) {
+		_mm512_storeu_ps(c + r * ldc, acc[r][0]);
+		_mm512_storeu_ps(c + r * ldc + 16, acc[r][1]);
+	}
+}
+#endif
+
+#ifdef FP16_ARRAY_ARM
+static inline float32x4_t fp16_blas_load4_neon(const uint16_t* p) {
+	return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p)));
+}
+
+static inline float fp16_blas_dot_neon(const uint16_t* x, const float* y, size_t n) {
+	float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		acc0 = vfmaq_f32(acc0, fp16_blas_load4_neon(x + i), vld1q_f32(y + i));
+		acc1 = vfmaq_f32(acc1, fp16_blas_load4_neon(x + i + 4), vld1q_f32(y + i + 4));
+	}
+	return vaddvq_f32(vaddq_f32(acc0, acc1)) + fp16_blas_dot_scalar(x + i, y + i, n - i);
+}
+
+static inline void fp16_blas_axpy_neon(size_t n, float alpha, const uint16_t* x, float* y) {
+	size_t i = 0;
+	for (; n - i >= 4; i += 4) {
+		vst1q_f32(y + i, vfmaq_n_f32(vld1q_f32(y + i), fp16_blas_load4_neon(x + i), alpha));
+	}
+	fp16_blas_axpy_scalar(n - i, alpha, x + i, y + i);
+}
+
+static inline void fp16_blas_dot4_neon(const uint16_t* const x[4], const float* y, size_t n, float out[4]) {
+	float32x4_t acc[4] = { vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f), vdupq_n_f32(0.0f) };
+	size_t i = 0;
+	for (; n - i >= 4; i += 4) {
+		const float32x4_t y_v = vld1q_f32(y + i);
+		for (int r = 0; r < 4; r++) {
+			acc[r] = vfmaq_f32(acc[r], fp16_blas_load4_neon(x[r] + i), y_v);
+		}
+	}
+	for (int r = 0; r < 4; r++) {
+		out[r] = vaddvq_f32(acc[r]) + fp16_blas_dot_scalar(x[r] + i, y + i, n - i);
+	}
+}
+
+static inline void fp16_blas_tile_neon(size_t k, const float* a, size_t lda, const uint16_t* b, size_t ldb,
+	float* c, size_t ldc)
+{
+	float32x4_t acc[4][4];
+	for (int r = 0; r < 4; r++) {
+		for (int v = 0; v < 4; v++) {
+			acc[r][v] = vld1q_f32(c + r * ldc + 4 * v);
+		}
+	}
+	for (size_t p = 0; p < k; p++) {
+		float32x4_t w[4];
+		for (int v = 0; v < 4; v++) {
+			w[v] = fp16_blas_load4_neon(b + p * ldb + 4 * v);
+		}
+		for (int r = 0; r < 4; r++) {
+			const float a_s = a[r * lda + p];
+			for (int v = 0; v < 4; v++) {
+				acc[r][v] = vfmaq_n_f32(acc[r][v], w[v], a_s);
+			}
+		}
+	}
+	for (int r = 0; r < 4; r++) {
+		for (int v = 0; v < 4; v++) {
+			vst1q_f32(c + r * ldc + 4 * v, acc[r][v]);
+		}
+	}
+}
+#endif
+
+/*
+ * Runtime dispatch, the same scheme as fp16_x86.h: fp16_blas_kernel_table from the slowest to the fastest entry,
+ * fp16_blas_kernels the best one the CPU supports, picked at startup by fp16_blas_init. The scalar entry is always
+ * supported, so the pointers are never NULL.
+ */
+static const struct fp16_blas_kernel fp16_blas_kernel_table[] = {
+	{ "scalar", fp16_blas_has_scalar,
+		fp16_blas_dot_scalar, fp16_blas_axpy_scalar, fp16_blas_dot4_scalar, fp16_blas_tile_scalar, 8 },
+#ifdef FP16_ARRAY_X86
+	{ "sse2", fp16_x86_has_sse2,
+		fp16_blas_dot_sse2, fp16_blas_axpy_sse2, fp16_blas_dot4_sse2, fp16_blas_tile_sse2, 8 },
+	{ "f16c", fp16_x86_has_fma,
+		fp16_blas_dot_f16c, fp16_blas_axpy_f16c, fp16_blas_dot4_f16c, fp16_blas_tile_f16c, 16 },
+	{ "avx512f", fp16_x86_has_avx512f_fma,
+		fp16_blas_dot_avx512f, fp16_blas_axpy_avx512f, fp16_blas_dot4_avx512f, fp16_blas_tile_avx512f, 32 },
+#endif
+#ifdef FP16_ARRAY_ARM
+	{ "neon", fp16_arm_has_neon,
+		fp16_blas_dot_neon, fp16_blas_axpy_neon, fp16_blas_dot4_neon, fp16_blas_tile_neon, 16 },
+#endif
+};
+
+#define FP16_BLAS_KERNEL_COUNT (sizeof(fp16_blas_kernel_table) / sizeof(fp16_blas_kernel_table[0]))
+
+static struct fp16_blas_kernel fp16_blas_kernels = {
+	"scalar", fp16_blas_has_scalar,
+	fp16_blas_dot_scalar, fp16_blas_axpy_scalar, fp16_blas_dot4_scalar, fp16_blas_tile_scalar, 8
+};
+
+#if defined(__GNUC__)
+__attribute__((__constructor__, __unused__))
+#endif
+static void fp16_blas_init(void) {
+	for (size_t k = 0; k < FP16_BLAS_KERNEL_COUNT; k++) {
+		if (fp16_blas_kernel_table[k].supported()) {
+			fp16_blas_kernels = fp16_blas_kernel_table[k];
+		}
+	}
+}
+
+/*
+ * Sum of x[i] * y[i] for i < n, x in IEEE half precision (bit representation), y in single precision.
+ */
+static inline float fp16_ieee_dot(const uint16_t* x, const float* y, size_t n) {
+	return fp16_blas_kernels.dot(x, y, n);
+}
+
+/*
+ * y[i] += alpha * x[i] for i < n, x in IEEE half precision (bit representation), y in single precision.
+ */
+static inline void fp16_ieee_axpy(size_t n, float alpha, const uint16_t* x, float* y) {
+	fp16_blas_kernels.axpy(n, alpha, x, y);
+}
+
+/*
+ * y = A x, A a m x k matrix in IEEE half precision, row-major with a leading dimension (row stride) of lda elements,
+ * x and y in single precision. Four rows at a time share the loads of x.
+ */
+static inline void fp16_ieee_gemv(size_t m, size_t k, const uint16_t* a, size_t lda, const float* x, float* y) {
+	size_t i = 0;
+	for (; m - i >= 4; i += 4) {
+		const uint16_t* const rows[4] = { a + i * lda, a + (i + 1) * lda, a + (i + 2) * lda, a + (i + 3) * lda };
+		fp16_blas_kernels.dot4(rows, x, k, y + i);
+	}
+	for (; i < m; i++) {
+		y[i] = fp16_blas_kernels.dot(a + i * lda, x, k);
+	}
+}
+
+/*
+ * C += A B, A a m x k single-precision matrix, B a k x n matrix in IEEE half precision, C a m x n single-precision
+ * matrix, all row-major with leading dimensions lda, ldb and ldc. Set C to zero first for C = A B.
+ *
+ * Rows of A beyond the last multiple of 4 go through the micro-kernel on copies padded with zero rows; columns of B
+ * beyond the last multiple of tile_width are done with scalar loops.
+ */
+static inline void fp16_ieee_gemm(size_t m, size_t n, size_t k, const float* a, size_t lda, const uint16_t* b,
+	size_t ldb, float* c, size_t ldc)
+{
+	const fp16_blas_tile_kernel tile = fp16_blas_kernels.tile;
+	const size_t width = fp16_blas_kernels.tile_width;
+	for (size_t jc = 0; jc < n; jc += FP16_BLAS_NC) {
+		const size_t nc = n - jc < FP16_BLAS_NC ? n - jc : FP16_BLAS_NC;
+		const size_t n_tiled = nc - nc % width;
+		for (size_t pc = 0; pc < k; pc += FP16_BLAS_KC) {
+			const size_t kc = k - pc < FP16_BLAS_KC ? k - pc : FP16_BLAS_KC;
+			for (size_t i = 0; i < m; i += 4) {
+				const size_t rows = m - i < 4 ? m - i : 4;
+				const float* a_block = a + i * lda + pc;
+				float* c_block = c + i * ldc + jc;
+				if (rows == 4) {
+					for (size_t j = 0; j < n_tiled; j += width) {
+						tile(kc, a_block, lda, b + pc * ldb + jc + j, ldb, c_block + j, ldc);
+					}
+				} else if (n_tiled != 0) {
+					float a_pad[4 * FP16_BLAS_KC];
+					float c_pad[4 * FP16_BLAS_MAX_TILE_WIDTH];
+					memset(a_pad, 0, sizeof(a_pad));
+					for (size_t r = 0; r < rows; r++) {
+						memcpy(a_pad + r * FP16_BLAS_KC, a_block + r * lda, kc * sizeof(float));
+					}
+					for (size_t j = 0; j < n_tiled; j += width) {
+						memset(c_pad, 0, sizeof(c_pad));
+						for (size_t r = 0; r < rows; r++) {
+							memcpy(c_pad + r * width, c_block + r * ldc + j, width * sizeof(float));
+						}
+						tile(kc, a_pad, FP16_BLAS_KC, b + pc * ldb + jc + j, ldb, c_pad, width);
+						for (size_t r = 0; r < rows; r++) {
+							memcpy(c_block + r * ldc + j, c_pad + r * width, width * sizeof(float));
+						}
+					}
+				}
+				for (size_t r = 0; r < rows; r++) {
+					for (size_t p = 0; p < kc; p++) {
+						const float a_s = a_block[r * lda + p];
+						for (size_t j = n_tiled; j < nc; j++) {
+							c_block[r * ldc + j] += a_s * fp16_ieee_to_fp32_value(b[(pc + p) * ldb + jc + j]);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+#endif /* FP16_BLAS_H */
@@ -0,0 +1,257 @@
+/*
+ * Checks and throughput of the fused half-precision dot / AXPY / GEMV / GEMM kernels of fp16_blas.h.
+ *
+ * Every kernel the CPU supports is compared with a double-precision reference first. The decoding and the products
+ * are exact, so only the order of the fp32 sums differs, and the error bound is n * 2^-24 * sum |x[i] * y[i]|. The
+ * program exits with 1 on any result outside that bound.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_blas_bench.c -o fp16_blas_bench -lm
+ *
+ * Usage: ./fp16_blas_bench [GEMV rows] [GEMV columns] [repetitions]
+ *
+ * The timing compares each fused function with expanding the half-precision operand by fp16_ieee_to_fp32_array into a
+ * buffer and running the same kernel's fp32 loop on it. GB/s counts the bytes of the half-precision matrix only.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fp16_blas.h"
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* xorshift32, only used to fill the inputs */
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+/* Uniform in [-1, 1), as half precision and as single precision */
+static void fill_fp16(uint16_t* x, size_t n, uint32_t* state) {
+	for (size_t i = 0; i < n; i++) {
+		x[i] = fp16_ieee_from_fp32_value((float) ((int32_t) next_random(state)) * 0x1.0p-31f);
+	}
+}
+
+static void fill_fp32(float* x, size_t n, uint32_t* state) {
+	for (size_t i = 0; i < n; i++) {
+		x[i] = (float) ((int32_t) next_random(state)) * 0x1.0p-31f;
+	}
+}
+
+static int check(const char* kernel, const char* what, size_t index, float result, double reference, double magnitude,
+	size_t terms)
+{
+	const double bound = (double) (terms + 2) * 0x1.0p-24 * magnitude;
+	if (fabs((double) result - reference) > bound) {
+		printf("%s %s[%zu]: %.9g, expected %.9g +- %.3g\n", kernel, what, index, result, reference, bound);
+		return 1;
+	}
+	return 0;
+}
+
+static int check_kernel(const struct fp16_blas_kernel* kernel) {
+	/* Sizes around the vector widths and the GEMM blocking, so that every tail and remainder path runs */
+	static const size_t sizes[] = { 0, 1, 3, 7, 8, 15, 16, 17, 31, 32, 33, 63, 100, 255, 256, 257, 600 };
+	/* room for the largest GEMV matrix, 600 rows with a leading dimension of 609 */
+	const size_t max_size = 610;
+	uint32_t state = 12345;
+	int errors = 0;
+
+	uint16_t* h = malloc(max_size * max_size * sizeof(uint16_t));
+	float* f = malloc(max_size * max_size * sizeof(float));
+	float* y = malloc(max_size * max_size * sizeof(float));
+	float* c = malloc(max_size * max_size * sizeof(float));
+	if (h == NULL || f == NULL || y == NULL || c == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	fill_fp16(h, max_size * max_size, &state);
+	fill_fp32(f, max_size * max_size, &state);
+	/* Specials that must pass through exactly: subnormals, the largest finite number, signed zeros */
+	h[1] = UINT16_C(0x0001);
+	h[2] = UINT16_C(0x83FF);
+	h[5] = UINT16_C(0x7BFF);
+	h[6] = UINT16_C(0x8000);
+
+	const struct fp16_blas_kernel saved = fp16_blas_kernels;
+	fp16_blas_kernels = *kernel;
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && errors < 10; s++) {
+		const size_t n = sizes[s];
+
+		double reference = 0.0, magnitude = 0.0;
+		for (size_t i = 0; i < n; i++) {
+			const double p = (double) fp16_ieee_to_fp32_value(h[i]) * (double) f[i];
+			reference += p;
+			magnitude += fabs(p);
+		}
+		errors += check(kernel->name, "dot", n, fp16_ieee_dot(h, f, n), reference, magnitude, n);
+
+		const float alpha = -0.75f;
+		memcpy(y, f + n, n * sizeof(float));
+		fp16_ieee_axpy(n, alpha, h, y);
+		for (size_t i = 0; i < n; i++) {
+			const float expected = f[n + i] + alpha * fp16_ieee_to_fp32_value(h[i]);
+			errors += check(kernel->name, "axpy", i, y[i], (double) expected, fabs((double) expected) + 1.0, 1);
+		}
+
+		/* GEMV of a n x (n + 5) matrix with a leading dimension of n + 9 */
+		const size_t k = n + 5, lda = n + 9;
+		fp16_ieee_gemv(n, k, h, lda, f, y);
+		for (size_t i = 0; i < n; i++) {
+			double ref = 0.0, mag = 0.0;
+			for (size_t p = 0; p < k; p++) {
+				const double t = (double) fp16_ieee_to_fp32_value(h[i * lda + p]) * (double) f[p];
+				ref += t;
+				mag += fabs(t);
+			}
+			errors += check(kernel->name, "gemv", i, y[i], ref, mag, k);
+		}
+
+		/* GEMM: C (n x (n + 3)) += A (n x (n + 1)) B ((n + 1) x (n + 3)), C starting at 1 */
+		const size_t m = n, cols = n + 3, depth = n + 1;
+		for (size_t i = 0; i < m * cols; i++) {
+			c[i] = 1.0f;
+		}
+		fp16_ieee_gemm(m, cols, depth, f, depth, h, cols, c, cols);
+		for (size_t i = 0; i < m; i++) {
+			for (size_t j = 0; j < cols; j++) {
+				double ref = 1.0, mag = 1.0;
+				for (size_t p = 0; p < depth; p++) {
+					const double t = (double) f[i * depth + p] * (double) fp16_ieee_to_fp32_value(h[p * cols + j]);
+					ref += t;
+					mag += fabs(t);
+				}
+				errors += check(kernel->name, "gemm", i * cols + j, c[i * cols + j], ref, mag, depth);
+			}
+		}
+	}
+
+	fp16_blas_kernels = saved;
+	free(h);
+	free(f);
+	free(y);
+	free(c);
+	return errors;
+}
+
+/*
+ * The two-pass baseline: expand the half-precision operand, then a fp32 dot product. Eight partial sums let the
+ * compiler vectorize it without -ffast-math, like the fused kernels do by hand.
+ */
+static float dot_fp32(const float* x, const float* y, size_t n) {
+	float sum[8] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		for (size_t j = 0; j < 8; j++) {
+			sum[j] += x[i + j] * y[i + j];
+		}
+	}
+	for (; i < n; i++) {
+		sum[0] += x[i] * y[i];
+	}
+	return ((sum[0] + sum[1]) + (sum[2] + sum[3])) + ((sum[4] + sum[5]) + (sum[6] + sum[7]));
+}
+
+int main(int argc, char** argv) {
+	const size_t m = argc > 1 ? (size_t) strtoull(argv[1], NULL, 0) : 4096;
+	const size_t k = argc > 2 ? (size_t) strtoull(argv[2], NULL, 0) : 4096;
+	const int reps = argc > 3 ? atoi(argv[3]) : 20;
+
+	int errors = 0;
+	for (size_t i = 0; i < FP16_BLAS_KERNEL_COUNT; i++) {
+		if (!fp16_blas_kernel_table[i].supported()) {
+			printf("%-8s not supported\n", fp16_blas_kernel_table[i].name);
+			continue;
+		}
+		const int e = check_kernel(&fp16_blas_kernel_table[i]);
+		printf("%-8s %s\n", fp16_blas_kernel_table[i].name, e == 0 ? "ok" : "FAILED");
+		errors += e;
+	}
+	if (errors != 0) {
+		return 1;
+	}
+	printf("using %s\n", fp16_blas_kernels.name);
+
+	uint16_t* a = malloc(m * k * sizeof(uint16_t));
+	float* expanded = malloc(m * k * sizeof(float));
+	float* x = malloc(k * sizeof(float));
+	float* y = malloc(m * sizeof(float));
+	if (a == NULL || expanded == NULL || x == NULL || y == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	uint32_t state = 1;
+	fill_fp16(a, m * k, &state);
+	fill_fp32(x, k, &state);
+	volatile float sink = 0.0f;
+
+	double start = now_seconds();
+	for (int r = 0; r < reps; r++) {
+		fp16_ieee_to_fp32_array(a, expanded, m * k);
+		for (size_t i = 0; i < m; i++) {
+			y[i] = dot_fp32(expanded + i * k, x, k);
+		}
+		sink += y[0];
+	}
+	double seconds = (now_seconds() - start) / reps;
+	printf("%-28s %8.3f ms %8.2f GB/s\n", "gemv, expand + fp32", seconds * 1e3, (double) (m * k * 2) / seconds * 1e-9);
+
+	start = now_seconds();
+	for (int r = 0; r < reps; r++) {
+		fp16_ieee_gemv(m, k, a, k, x, y);
+		sink += y[0];
+	}
+	seconds = (now_seconds() - start) / reps;
+	printf("%-28s %8.3f ms %8.2f GB/s\n", "gemv, fused", seconds * 1e3, (double) (m * k * 2) / seconds * 1e-9);
+
+	start = now_seconds();
+	for (int r = 0; r < reps; r++) {
+		for (size_t i = 0; i < m; i++) {
+			fp16_ieee_axpy(k, x[i % k], a + i * k, expanded);
+		}
+		sink += expanded[0];
+	}
+	seconds = (now_seconds() - start) / reps;
+	printf("%-28s %8.3f ms %8.2f GB/s\n", "axpy rows, fused", seconds * 1e3, (double) (m * k * 2) / seconds * 1e-9);
+
+	/* GEMM with 64 rows of activations against the first k x 1024 weights (or fewer) */
+	const size_t rows = 64, cols = m < 1024 ? m : 1024;
+	float* act = malloc(rows * k * sizeof(float));
+	float* out = calloc(rows * cols, sizeof(float));
+	if (act == NULL || out == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	fill_fp32(act, rows * k, &state);
+	start = now_seconds();
+	for (int r = 0; r < reps; r++) {
+		fp16_ieee_gemm(rows, cols, k, act, k, a, cols, out, cols);
+		sink += out[0];
+	}
+	seconds = (now_seconds() - start) / reps;
+	printf("%-28s %8.3f ms %8.2f GFLOP/s\n", "gemm 64 rows, fused", seconds * 1e3,
+		2.0 * (double) (rows * cols * k) / seconds * 1e-9);
+
+	(void) sink;
+	free(a);
+	free(expanded);
+	free(x);
+	free(y);
+	free(act);
+	free(out);
+	return 0;
+}
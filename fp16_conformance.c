@@ -0,0 +1,400 @@
+/*
+ * Exhaustive conformance sweep: every one of the 2**32 fp32 bit patterns goes through every implementation of
+ * fp16_impls.h and every SIMD kernel, and the result is compared with fp16_ieee_from_fp32_value of fp16_study.h.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_conformance.c -o fp16_conformance -lm -pthread
+ *
+ * Usage: ./fp16_conformance [-t threads] [-b first_bits] [-e last_bits]
+ *
+ * The sweep is split into blocks of 2**20 inputs that the threads take from a shared counter. The divergences are
+ * counted per category:
+ *
+ * | category         | input                                                   | result                    |
+ * |------------------|---------------------------------------------------------|---------------------------|
+ * | nan_sign         | NaN                                                     | NaN, other sign           |
+ * | nan_payload      | NaN                                                     | NaN, other mantissa       |
+ * | nan_lost         | NaN                                                     | not a NaN                 |
+ * | ties             | exactly halfway between two fp16 values                 | rounded the other way     |
+ * | fp32_subnormal   | fp32 subnormal                                          | anything else             |
+ * | fp16_subnormal   | fp16 subnormal (or zero) result, not a tie              | anything else             |
+ * | overflow         | reference result is Inf                                 | anything else             |
+ * | other            | everything not covered above                            | anything else             |
+ *
+ * The five study implementations differ from the reference on purpose (see README.md), so they are only reported.
+ * The SIMD kernels, the table encoder of fp16_table.h and fp16_ieee_from_fp32_array must be bit-exact: the program
+ * exits with 1 if any of them differs.
+ *
+ * The kernels that fp16_ieee_from_fp32_array uses when the thread does not round to nearest (the entries of
+ * fp16_x86_rounding_kernel_table, the neonint kernel on AArch64) run with round toward zero and flush to zero set in
+ * MXCSR / FPCR, and so does a second fp16_ieee_from_fp32_array candidate: their results must not change.
+ */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "fp16_array.h"
+#include "fp16_impls.h"
+
+#define BLOCK_SIZE ((uint64_t) 1 << 20)
+#define MAX_THREADS 256
+
+enum category {
+	CATEGORY_NAN_SIGN,
+	CATEGORY_NAN_PAYLOAD,
+	CATEGORY_NAN_LOST,
+	CATEGORY_TIES,
+	CATEGORY_FP32_SUBNORMAL,
+	CATEGORY_FP16_SUBNORMAL,
+	CATEGORY_OVERFLOW,
+	CATEGORY_OTHER,
+	CATEGORY_COUNT
+};
+
+static const char* const category_names[CATEGORY_COUNT] = {
+	"nan_sign", "nan_payload", "nan_lost", "ties", "fp32_subnormal", "fp16_subnormal", "overflow", "other",
+};
+
+/*
+ * A bulk path converts a block of inputs at once. The study implementations get a loop around them, the SIMD kernels
+ * and fp16_ieee_from_fp32_array are used as they are.
+ */
+struct candidate {
+	char name[64];
+	size_t impl;          /* index into fp16_impl_table, or FP16_IMPL_COUNT for a bulk path */
+	size_t (*bulk)(const float* src, uint16_t* dst, size_t n);
+	int must_match;
+	int directed;         /* run with round toward zero and flush to zero */
+};
+
+struct result {
+	uint64_t count[CATEGORY_COUNT];
+	uint32_t example[CATEGORY_COUNT];
+};
+
+struct sweep {
+	const struct candidate* candidates;
+	size_t candidate_count;
+	uint64_t first;
+	uint64_t end;
+	uint64_t next;
+	struct result* results; /* [thread][candidate] */
+};
+
+struct worker {
+	struct sweep* sweep;
+	size_t index;
+};
+
+static int is_nan16(uint16_t h) {
+	return (h & UINT16_C(0x7C00)) == UINT16_C(0x7C00) && (h & UINT16_C(0x03FF)) != 0;
+}
+
+/* Whether the fp32 input is exactly halfway between two neighbouring fp16 values */
+static int is_tie(uint32_t x) {
+	const uint32_t e = (x >> 23) & 0xFF;
+	const uint32_t m = (x & UINT32_C(0x007FFFFF)) | UINT32_C(0x00800000);
+	if (e >= 113 && e <= 142) {
+		return (m & UINT32_C(0x1FFF)) == UINT32_C(0x1000);
+	}
+	if (e >= 102 && e <= 112) {
+		const uint32_t shift = 126 - e;
+		return (m & ((UINT32_C(1) << shift) - 1)) == (UINT32_C(1) << (shift - 1));
+	}
+	return 0;
+}
+
+static enum category classify(uint32_t x, uint16_t reference) {
+	const uint32_t nonsign = x & UINT32_C(0x7FFFFFFF);
+	if (nonsign > UINT32_C(0x7F800000)) {
+		return CATEGORY_OTHER; /* refined by the caller, it needs the candidate result */
+	}
+	if (is_tie(x)) {
+		return CATEGORY_TIES;
+	}
+	if (nonsign != 0 && nonsign < UINT32_C(0x00800000)) {
+		return CATEGORY_FP32_SUBNORMAL;
+	}
+	if ((reference & UINT16_C(0x7C00)) == 0) {
+		return CATEGORY_FP16_SUBNORMAL;
+	}
+	if ((reference & UINT16_C(0x7FFF)) == UINT16_C(0x7C00)) {
+		return CATEGORY_OVERFLOW;
+	}
+	return CATEGORY_OTHER;
+}
+
+static void record(struct result* result, uint32_t x, uint16_t reference, uint16_t actual) {
+	enum category category = classify(x, reference);
+	if ((x & UINT32_C(0x7FFFFFFF)) > UINT32_C(0x7F800000)) {
+		if (!is_nan16(actual)) {
+			category = CATEGORY_NAN_LOST;
+		} else if ((actual ^ reference) & UINT16_C(0x8000)) {
+			category = CATEGORY_NAN_SIGN;
+		} else {
+			category = CATEGORY_NAN_PAYLOAD;
+		}
+	}
+	if (result->count[category]++ == 0) {
+		result->example[category] = x;
+	}
+}
+
+/* Set round toward zero and flush to zero (and DAZ on x86) if directed, return the previous control register */
+static uint64_t set_directed(int directed) {
+#if defined(FP16_ARRAY_X86)
+	const unsigned saved = _mm_getcsr();
+	if (directed) {
+		_mm_setcsr(saved | _MM_ROUND_TOWARD_ZERO | _MM_FLUSH_ZERO_ON | _MM_DENORMALS_ZERO_ON);
+	}
+	return saved;
+#elif defined(FP16_ARRAY_ARM)
+	uint64_t saved;
+	__asm__ volatile("mrs %0, fpcr" : "=r"(saved));
+	if (directed) {
+		/* RMode 3 (toward zero), FZ */
+		const uint64_t fpcr = saved | (UINT64_C(3) << 22) | (UINT64_C(1) << 24);
+		__asm__ volatile("msr fpcr, %0" : : "r"(fpcr));
+	}
+	return saved;
+#else
+	(void) directed;
+	return 0;
+#endif
+}
+
+static void restore_directed(uint64_t saved) {
+#if defined(FP16_ARRAY_X86)
+	_mm_setcsr((unsigned) saved);
+#elif defined(FP16_ARRAY_ARM)
+	__asm__ volatile("msr fpcr, %0" : : "r"(saved));
+#else
+	(void) saved;
+#endif
+}
+
+static void* worker_main(void* arg) {
+	const struct worker* worker = (const struct worker*) arg;
+	struct sweep* sweep = worker->sweep;
+	struct result* results = sweep->results + worker->index * sweep->candidate_count;
+	float* input = (float*) malloc(BLOCK_SIZE * sizeof(float));
+	uint16_t* reference = (uint16_t*) malloc(BLOCK_SIZE * sizeof(uint16_t));
+	uint16_t* output = (uint16_t*) malloc(BLOCK_SIZE * sizeof(uint16_t));
+
+	for (;;) {
+		const uint64_t begin = __atomic_fetch_add(&sweep->next, BLOCK_SIZE, __ATOMIC_RELAXED);
+		if (begin >= sweep->end) {
+			break;
+		}
+		const size_t n = (size_t) (sweep->end - begin < BLOCK_SIZE ? sweep->end - begin : BLOCK_SIZE);
+		for (size_t i = 0; i < n; i++) {
+			input[i] = fp32_from_bits((uint32_t) (begin + i));
+			reference[i] = fp16_ieee_from_fp32_value(input[i]);
+		}
+
+		for (size_t c = 0; c < sweep->candidate_count; c++) {
+			const struct candidate* candidate = &sweep->candidates[c];
+			size_t done = 0;
+			if (candidate->bulk != NULL) {
+				const uint64_t saved = set_directed(candidate->directed);
+				done = candidate->bulk(input, output, n);
+				restore_directed(saved);
+			} else {
+				const fp16_impl_fn convert = fp16_impl_table[candidate->impl].from_fp32_bits;
+				for (size_t i = 0; i < n; i++) {
+					output[i] = convert((uint32_t) (begin + i));
+				}
+				done = n;
+			}
+			for (size_t i = 0; i < done; i++) {
+				if (output[i] != reference[i]) {
+					record(&results[c], (uint32_t) (begin + i), reference[i], output[i]);
+				}
+			}
+		}
+	}
+
+	free(input);
+	free(reference);
+	free(output);
+	return NULL;
+}
+
+#ifdef FP16_TABLE_X86
+static size_t table_avx2_bulk(const float* src, uint16_t* dst, size_t n) {
+	return fp16_ieee_from_fp32_table_avx2(src, dst, n);
+}
+#endif
+
+static size_t array_bulk(const float* src, uint16_t* dst, size_t n) {
+	fp16_ieee_from_fp32_array(src, dst, n);
+	return n;
+}
+
+int main(int argc, char** argv) {
+	const long online = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t threads = online > 0 ? (size_t) online : 1;
+	uint64_t first = 0;
+	uint64_t last = UINT32_MAX;
+
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+			threads = (size_t) strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-b") == 0 && a + 1 < argc) {
+			first = strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-e") == 0 && a + 1 < argc) {
+			last = strtoull(argv[++a], NULL, 0);
+		} else {
+			fprintf(stderr, "usage: %s [-t threads] [-b first_bits] [-e last_bits]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (threads == 0 || threads > MAX_THREADS || first > last || last > UINT32_MAX) {
+		fprintf(stderr, "invalid arguments\n");
+		return 1;
+	}
+
+	fp16_encode_table_init();
+
+	/* The reference itself (entry 0 of fp16_impl_table) is not a candidate */
+	struct candidate candidates[FP16_IMPL_COUNT + 16];
+	size_t candidate_count = 0;
+	for (size_t k = 1; k < FP16_IMPL_COUNT; k++) {
+		struct candidate* candidate = &candidates[candidate_count++];
+		snprintf(candidate->name, sizeof(candidate->name), "%s", fp16_impl_table[k].name);
+		candidate->impl = k;
+		candidate->bulk = NULL;
+		/* The table encoder is meant to be bit-exact, unlike the study implementations */
+		candidate->must_match = fp16_impl_table[k].from_fp32_bits == fp16_impl_table_encoder;
+		candidate->directed = 0;
+	}
+	for (int directed = 0; directed < 2; directed++) {
+		struct candidate* candidate = &candidates[candidate_count++];
+		snprintf(candidate->name, sizeof(candidate->name), "fp16_ieee_from_fp32_array%s",
+			directed ? ", toward zero" : "");
+		candidate->impl = FP16_IMPL_COUNT;
+		candidate->bulk = array_bulk;
+		candidate->must_match = 1;
+		candidate->directed = directed;
+	}
+#ifdef FP16_TABLE_X86
+	if (__builtin_cpu_supports("avx2")) {
+		struct candidate* candidate = &candidates[candidate_count++];
+		snprintf(candidate->name, sizeof(candidate->name), "fp16_ieee_from_fp32_table_avx2");
+		candidate->impl = FP16_IMPL_COUNT;
+		candidate->bulk = table_avx2_bulk;
+		candidate->must_match = 1;
+		candidate->directed = 0;
+	}
+#endif
+#if defined(FP16_ARRAY_X86) || defined(FP16_ARRAY_ARM)
+	#if defined(FP16_ARRAY_X86)
+		#define KERNEL_TABLE fp16_x86_kernel_table
+		#define KERNEL_COUNT FP16_X86_KERNEL_COUNT
+	#else
+		#define KERNEL_TABLE fp16_arm_kernel_table
+		#define KERNEL_COUNT FP16_ARM_KERNEL_COUNT
+	#endif
+	for (size_t k = 0; k < KERNEL_COUNT; k++) {
+		if (KERNEL_TABLE[k].supported()) {
+			struct candidate* candidate = &candidates[candidate_count++];
+			snprintf(candidate->name, sizeof(candidate->name), "%s kernel", KERNEL_TABLE[k].name);
+			candidate->impl = FP16_IMPL_COUNT;
+			candidate->bulk = KERNEL_TABLE[k].ieee_from_fp32;
+			candidate->must_match = 1;
+			candidate->directed = 0;
+		}
+	}
+#endif
+#if defined(FP16_ARRAY_X86)
+	for (size_t k = 0; k < FP16_X86_ROUNDING_KERNEL_COUNT; k++) {
+		if (fp16_x86_rounding_kernel_table[k].supported()) {
+			struct candidate* candidate = &candidates[candidate_count++];
+			snprintf(candidate->name, sizeof(candidate->name), "%s kernel, toward zero",
+				fp16_x86_rounding_kernel_table[k].name);
+			candidate->impl = FP16_IMPL_COUNT;
+			candidate->bulk = fp16_x86_rounding_kernel_table[k].ieee_from_fp32;
+			candidate->must_match = 1;
+			candidate->directed = 1;
+		}
+	}
+#elif defined(FP16_ARRAY_ARM)
+	{
+		struct candidate* candidate = &candidates[candidate_count++];
+		snprintf(candidate->name, sizeof(candidate->name), "neonint kernel, toward zero");
+		candidate->impl = FP16_IMPL_COUNT;
+		candidate->bulk = fp16_ieee_from_fp32_neonint;
+		candidate->must_match = 1;
+		candidate->directed = 1;
+	}
+#endif
+
+	struct sweep sweep;
+	sweep.candidates = candidates;
+	sweep.candidate_count = candidate_count;
+	sweep.first = first;
+	sweep.end = last + 1;
+	sweep.next = first;
+	sweep.results = (struct result*) calloc(threads * candidate_count, sizeof(struct result));
+
+	struct timespec start, stop;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_t thread_ids[MAX_THREADS];
+	struct worker workers[MAX_THREADS];
+	for (size_t t = 0; t < threads; t++) {
+		workers[t].sweep = &sweep;
+		workers[t].index = t;
+		pthread_create(&thread_ids[t], NULL, worker_main, &workers[t]);
+	}
+	for (size_t t = 0; t < threads; t++) {
+		pthread_join(thread_ids[t], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	printf("inputs 0x%08llX..0x%08llX, %zu threads, %.1f s, reference fp16_ieee_from_fp32_value\n",
+		(unsigned long long) first, (unsigned long long) last, threads,
+		(double) (stop.tv_sec - start.tv_sec) + (double) (stop.tv_nsec - start.tv_nsec) * 1e-9);
+	int status = 0;
+	for (size_t c = 0; c < candidate_count; c++) {
+		struct result total;
+		memset(&total, 0, sizeof(total));
+		/* Merge the threads, the example of a category is the one of the first thread that saw it */
+		for (size_t t = 0; t < threads; t++) {
+			const struct result* result = &sweep.results[t * candidate_count + c];
+			for (int k = 0; k < CATEGORY_COUNT; k++) {
+				if (total.count[k] == 0 && result->count[k] != 0) {
+					total.example[k] = result->example[k];
+				}
+				total.count[k] += result->count[k];
+			}
+		}
+
+		uint64_t sum = 0;
+		for (int k = 0; k < CATEGORY_COUNT; k++) {
+			sum += total.count[k];
+		}
+		printf("%-40s %s\n", candidates[c].name, sum == 0 ? "identical" : "");
+		for (int k = 0; k < CATEGORY_COUNT; k++) {
+			if (total.count[k] != 0) {
+				const uint32_t x = total.example[k];
+				printf("    %-16s %12llu  e.g. 0x%08X -> 0x%04X, reference 0x%04X\n", category_names[k],
+					(unsigned long long) total.count[k], x,
+					candidates[c].bulk != NULL ? 0 : fp16_impl_table[candidates[c].impl].from_fp32_bits(x),
+					fp16_ieee_from_fp32_value(fp32_from_bits(x)));
+			}
+		}
+		if (sum != 0 && candidates[c].must_match) {
+			status = 1;
+		}
+	}
+
+	free(sweep.results);
+	return status;
+}
@@ -0,0 +1,326 @@
+/*
+ * fp32 -> fp16 conversion under the floating-point environments a program can leave behind: FTZ / DAZ (FZ on AArch64)
+ * and the directed rounding modes.
+ *
+ * First every kernel is run in every environment on inputs that hit the corner cases: random bit patterns, halfway
+ * values, fp16 subnormal results and fp32 subnormal inputs. The reference is fp16_ieee_from_fp32_value in the default
+ * environment. A kernel that depends on the environment (on x86 the sse2 and avx512fp16 kernels under a directed
+ * rounding mode) is only reported; fp16_ieee_from_fp32_array and fp16_ieee_from_fp32_bits must match everywhere, and
+ * the program exits with 1 if they do not. So must the fused scale functions, against fp16_ieee_from_fp32_scaled_value
+ * in the same environment: their fmaf rounds by the environment, but the same way with and without SIMD.
+ *
+ * Then the timing: normal inputs, inputs whose results are fp16 subnormals, and fp32 subnormal inputs, each with FTZ /
+ * DAZ off and on, through the scalar functions, every kernel the CPU supports and fp16_ieee_from_fp32_array. fp32
+ * subnormal inputs are where a floating-point instruction takes a microcode assist on x86 when DAZ is off.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_fenv_bench.c -o fp16_fenv_bench -lm
+ *
+ * Usage: ./fp16_fenv_bench [elements] [repetitions]
+ *
+ * The default of 64K elements keeps the buffers in L2, so the numbers are the cost of the conversion itself.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fp16_array.h"
+
+#if !defined(FP16_ARRAY_X86) && !defined(FP16_ARRAY_ARM)
+	#error "fp16_fenv_bench needs the x86 or the AArch64 kernels of fp16_array.h"
+#endif
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* xorshift32, only used to fill the inputs */
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+/*
+ * The environments, as MXCSR values on x86 and FPCR values on AArch64. The first one is the default, the second one
+ * flushes subnormals, the others round in the three directed modes.
+ */
+#define ENV_COUNT 5
+static const char* const env_names[ENV_COUNT] = { "default", "FTZ+DAZ", "down", "up", "toward zero" };
+#if defined(FP16_ARRAY_X86)
+static const uint32_t env_values[ENV_COUNT] = {
+	0x1F80, 0x1F80 | _MM_FLUSH_ZERO_ON | _MM_DENORMALS_ZERO_ON, 0x1F80 | _MM_ROUND_DOWN, 0x1F80 | _MM_ROUND_UP,
+	0x1F80 | _MM_ROUND_TOWARD_ZERO,
+};
+
+static void set_env(int env) {
+	_mm_setcsr(env_values[env]);
+}
+#else
+static const uint64_t env_values[ENV_COUNT] = {
+	0, UINT64_C(1) << 24, UINT64_C(2) << 22, UINT64_C(1) << 22, UINT64_C(3) << 22,
+};
+
+static void set_env(int env) {
+	__asm__ volatile("msr fpcr, %0" : : "r"(env_values[env]));
+}
+#endif
+
+struct bench_kernel {
+	const char* name;
+	int (*supported)(void);
+	fp16_from_fp32_kernel ieee_from_fp32;
+};
+
+/* Every fp32 -> fp16 kernel of fp16_x86.h / fp16_arm.h, each once */
+static size_t list_kernels(struct bench_kernel* kernels) {
+	size_t count = 0;
+#if defined(FP16_ARRAY_X86)
+	for (size_t k = 0; k < FP16_X86_KERNEL_COUNT; k++) {
+		const struct bench_kernel kernel = {
+			fp16_x86_kernel_table[k].name, fp16_x86_kernel_table[k].supported, fp16_x86_kernel_table[k].ieee_from_fp32,
+		};
+		kernels[count++] = kernel;
+	}
+	for (size_t k = 0; k < FP16_X86_ROUNDING_KERNEL_COUNT; k++) {
+		int listed = 0;
+		for (size_t j = 0; j < count; j++) {
+			listed |= kernels[j].ieee_from_fp32 == fp16_x86_rounding_kernel_table[k].ieee_from_fp32;
+		}
+		if (!listed) {
+			const struct bench_kernel kernel = {
+				fp16_x86_rounding_kernel_table[k].name, fp16_x86_rounding_kernel_table[k].supported,
+				fp16_x86_rounding_kernel_table[k].ieee_from_fp32,
+			};
+			kernels[count++] = kernel;
+		}
+	}
+#else
+	for (size_t k = 0; k < FP16_ARM_KERNEL_COUNT; k++) {
+		const struct bench_kernel kernel = {
+			fp16_arm_kernel_table[k].name, fp16_arm_kernel_table[k].supported, fp16_arm_kernel_table[k].ieee_from_fp32,
+		};
+		kernels[count++] = kernel;
+	}
+	const struct bench_kernel neonint = { "neonint", fp16_arm_has_neon, fp16_ieee_from_fp32_neonint };
+	kernels[count++] = neonint;
+#endif
+	return count;
+}
+
+/*
+ * Inputs for the checks: a quarter of random bit patterns, the rest around the places where the rounding happens, i.e.
+ * halfway between two fp16 numbers (and one ulp either side) over the whole range, including the subnormals, and fp32
+ * subnormals.
+ */
+static void fill_check_input(float* x, size_t n, uint32_t* state) {
+	for (size_t i = 0; i < n; i++) {
+		const uint32_t r = next_random(state);
+		uint32_t w;
+		switch (r % 4) {
+			case 0:
+				w = next_random(state);
+				break;
+			case 1:
+				w = next_random(state) & UINT32_C(0x807FFFFF);
+				break;
+			default: {
+				// A halfway value for the exponents of fp16 normals and subnormals, +-0 or 1 ulp
+				const uint32_t exponent = 103 + next_random(state) % 40;
+				const uint32_t dropped = exponent >= 113 ? 13 : 126 - exponent;
+				const uint32_t mantissa = next_random(state) & UINT32_C(0x007FFFFF) & ~((UINT32_C(1) << dropped) - 1);
+				w = (r & UINT32_C(0x80000000)) | exponent << 23 | mantissa | UINT32_C(1) << (dropped - 1);
+				w += (r >> 8) % 3 - 1;
+				break;
+			}
+		}
+		x[i] = fp32_from_bits(w);
+	}
+}
+
+#define SCALE_CHANNELS 64
+
+static int check(const struct bench_kernel* kernels, size_t kernel_count) {
+	const size_t n = (size_t) 1 << 20;
+	float* x = malloc(n * sizeof(float));
+	uint16_t* h = malloc(n * sizeof(uint16_t));
+	uint16_t* h_ref = malloc(n * sizeof(uint16_t));
+	uint16_t* h_scaled = malloc(n * sizeof(uint16_t));
+	uint16_t* h_channels = malloc(n * sizeof(uint16_t));
+	uint16_t* h_channels_ref = malloc(n * sizeof(uint16_t));
+	if (x == NULL || h == NULL || h_ref == NULL || h_scaled == NULL || h_channels == NULL || h_channels_ref == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	uint32_t state = 1;
+	fill_check_input(x, n, &state);
+	set_env(0);
+	for (size_t i = 0; i < n; i++) {
+		h_ref[i] = fp16_ieee_from_fp32_value(x[i]);
+	}
+	// Per-channel scales of all magnitudes, so that products land on fp16 halfway values, subnormals and past 65504
+	float channel_scale[SCALE_CHANNELS];
+	for (size_t c = 0; c < SCALE_CHANNELS; c++) {
+		channel_scale[c] = fp32_from_bits(UINT32_C(0x30000000) + next_random(&state) % UINT32_C(0x1C000000));
+	}
+
+	int errors = 0;
+	for (int env = 0; env < ENV_COUNT; env++) {
+		printf("%-12s", env_names[env]);
+		for (size_t k = 0; k < kernel_count; k++) {
+			if (!kernels[k].supported()) {
+				continue;
+			}
+			set_env(env);
+			const size_t done = kernels[k].ieee_from_fp32(x, h, n);
+			set_env(0);
+			size_t wrong = 0;
+			for (size_t i = 0; i < done; i++) {
+				wrong += h[i] != h_ref[i];
+			}
+			printf(" %s %s", kernels[k].name, wrong == 0 ? "ok" : "differs");
+		}
+
+		set_env(env);
+		fp16_ieee_from_fp32_array(x, h, n);
+		set_env(0);
+		const int array_ok = memcmp(h, h_ref, n * sizeof(uint16_t)) == 0;
+		set_env(env);
+		for (size_t i = 0; i < n; i++) {
+			h[i] = fp16_ieee_from_fp32_bits(fp32_to_bits(x[i]));
+		}
+		set_env(0);
+		const int bits_ok = memcmp(h, h_ref, n * sizeof(uint16_t)) == 0;
+
+		// The scaled functions against fp16_ieee_from_fp32_scaled_value in the same environment, which rounds the fmaf
+		set_env(env);
+		fp16_ieee_from_fp32_scaled_bias(x, h, n, 0.75f, 0x1.0p-20f);
+		fp16_ieee_from_fp32_scaled_channels(x, h_channels, n / SCALE_CHANNELS, SCALE_CHANNELS, channel_scale, NULL);
+		for (size_t i = 0; i < n; i++) {
+			h_scaled[i] = fp16_ieee_from_fp32_scaled_value(x[i], 0.75f, 0x1.0p-20f);
+			h_channels_ref[i] = fp16_ieee_from_fp32_scaled_value(x[i], channel_scale[i % SCALE_CHANNELS], -0.0f);
+		}
+		set_env(0);
+		const int scaled_ok = memcmp(h, h_scaled, n * sizeof(uint16_t)) == 0 &&
+			memcmp(h_channels, h_channels_ref, n * sizeof(uint16_t)) == 0;
+		printf(", array %s, bits %s, scaled %s\n", array_ok ? "ok" : "FAILED", bits_ok ? "ok" : "FAILED",
+			scaled_ok ? "ok" : "FAILED");
+		errors += !array_ok + !bits_ok + !scaled_ok;
+	}
+	free(x);
+	free(h);
+	free(h_ref);
+	free(h_scaled);
+	free(h_channels);
+	free(h_channels_ref);
+	return errors;
+}
+
+/* Both loops are kept out of line, so that the compiler can not hoist the conversion out of the repetitions */
+#if defined(__GNUC__)
+__attribute__((__noinline__))
+#endif
+static void convert_value(const float* x, uint16_t* h, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		h[i] = fp16_ieee_from_fp32_value(x[i]);
+	}
+}
+
+#if defined(__GNUC__)
+__attribute__((__noinline__))
+#endif
+static void convert_bits(const float* x, uint16_t* h, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		h[i] = fp16_ieee_from_fp32_bits(fp32_to_bits(x[i]));
+	}
+}
+
+#define INPUT_COUNT 3
+static const char* const input_names[INPUT_COUNT] = { "normal", "fp16 subnormal", "fp32 subnormal" };
+
+static void fill_bench_input(float* x, size_t n, int input, uint32_t* state) {
+	for (size_t i = 0; i < n; i++) {
+		const uint32_t r = next_random(state);
+		uint32_t w;
+		switch (input) {
+			case 0:
+				// [2**(-14), 65504]
+				w = UINT32_C(0x38800000) + r % UINT32_C(0x0EF7E000);
+				break;
+			case 1:
+				// [2**(-25), 2**(-14))
+				w = UINT32_C(0x33000000) + r % UINT32_C(0x05800000);
+				break;
+			default:
+				w = r & UINT32_C(0x007FFFFF);
+				break;
+		}
+		x[i] = fp32_from_bits(w | (r & UINT32_C(0x80000000)));
+	}
+}
+
+static void report(const char* input, const char* env, const char* name, size_t n, size_t repetitions, double seconds) {
+	const double elements = (double) n * (double) repetitions;
+	printf("%-16s %-8s %-28s %8.3f ns/element\n", input, env, name, seconds * 1e9 / elements);
+}
+
+int main(int argc, char** argv) {
+	const size_t n = argc > 1 ? (size_t) strtoull(argv[1], NULL, 0) : (size_t) 1 << 16;
+	const size_t repetitions = argc > 2 ? (size_t) strtoull(argv[2], NULL, 0) : 200;
+
+	struct bench_kernel kernels[16];
+	const size_t kernel_count = list_kernels(kernels);
+	const int errors = check(kernels, kernel_count);
+	printf("array, bits and scaled functions in every environment: %s\n\n", errors == 0 ? "ok" : "FAILED");
+
+	float* x = malloc(n * sizeof(float));
+	uint16_t* h = malloc(n * sizeof(uint16_t));
+	if (x == NULL || h == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	uint32_t state = 1;
+	for (int input = 0; input < INPUT_COUNT; input++) {
+		fill_bench_input(x, n, input, &state);
+		for (int env = 0; env < 2; env++) {
+			const char* env_name = env == 0 ? "FTZ off" : "FTZ on";
+			set_env(env);
+			double start = now_seconds();
+			for (size_t r = 0; r < repetitions; r++) {
+				convert_value(x, h, n);
+			}
+			report(input_names[input], env_name, "fp16_ieee_from_fp32_value", n, repetitions, now_seconds() - start);
+			start = now_seconds();
+			for (size_t r = 0; r < repetitions; r++) {
+				convert_bits(x, h, n);
+			}
+			report(input_names[input], env_name, "fp16_ieee_from_fp32_bits", n, repetitions, now_seconds() - start);
+			for (size_t k = 0; k < kernel_count; k++) {
+				if (!kernels[k].supported()) {
+					continue;
+				}
+				start = now_seconds();
+				for (size_t r = 0; r < repetitions; r++) {
+					kernels[k].ieee_from_fp32(x, h, n);
+				}
+				report(input_names[input], env_name, kernels[k].name, n, repetitions, now_seconds() - start);
+			}
+			start = now_seconds();
+			for (size_t r = 0; r < repetitions; r++) {
+				fp16_ieee_from_fp32_array(x, h, n);
+			}
+			report(input_names[input], env_name, "fp16_ieee_from_fp32_array", n, repetitions, now_seconds() - start);
+			set_env(0);
+		}
+	}
+	free(x);
+	free(h);
+	return errors != 0;
+}
@@ -0,0 +1,231 @@
+#pragma once
+#ifndef FP16_FORMAT_HPP
+#define FP16_FORMAT_HPP
+
+#if !defined(__cplusplus) || __cplusplus < 202002L
+	#error "fp16_format.hpp needs C++20 (std::bit_cast)"
+#endif
+
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+
+/*
+ * Conversions between IEEE single precision and any narrower binary floating-point format, generated at compile time
+ * from the parameters of the format:
+ *
+ *      fp16::float_format<ExpBits, MantBits, Specials, Bias>
+ *
+ * ExpBits and MantBits are the widths of the exponent and mantissa fields (plus one sign bit). Specials says which
+ * encodings are not finite numbers:
+ * - nonfinite::inf_nan (the default): the largest exponent is reserved as in IEEE 754, all-zero mantissa for Inf,
+ *   anything else for NaN. Out of range inputs round to Inf.
+ * - nonfinite::none: the largest exponent holds normal numbers, as in the ARM alternative half precision, and out of
+ *   range inputs, Inf and NaN saturate to the largest finite value with the sign of the input.
+ * - nonfinite::finite_nan: the largest exponent holds normal numbers except for the all-ones mantissa, which is NaN,
+ *   as in OCP FP8 E4M3 (S.1111.111). There is no Inf: out of range inputs and Inf saturate to the largest finite value,
+ *   which is fp8_e4m3_from_fp32_value with saturate = 1, and NaN stays NaN.
+ * Bias defaults to the IEEE bias 2**(ExpBits-1) - 1.
+ *
+ * Every constant the hand-written converters spell out (the masks, 0x38800000 for the smallest normal, the overflow
+ * threshold, the biases of fp16_ieee_from_fp32_value and FP16_BIAS_E of mldev_utils_scalar.c) is a static constexpr
+ * member here, so each instance compiles to straight-line code with the constants folded in:
+ *
+ * - from_fp32 rounds to nearest even. When the format range allows it (see uses_float_addition), it is the float
+ *   addition trick of fp16_ieee_from_fp32_value: a power of two whose unit in the last place is the quantum of the
+ *   target format at the exponent of the input, 2**(max(e, min_exponent) - MantBits), is added to the absolute value,
+ *   and the floating-point adder shifts the mantissa right and rounds it, for normal and subnormal results alike. The
+ *   power of two must stay finite, so formats whose largest exponent is close to the single-precision one (bfloat16,
+ *   TF32) round with integers instead: the significand is shifted right by 23 - MantBits plus the subnormal shift,
+ *   after adding half a quantum minus one plus the lowest kept bit. A carry out of the mantissa moves into the exponent
+ *   in both cases. NaN becomes the quiet NaN with the input sign (0x7E00 for half precision, as in
+ *   fp16_ieee_from_fp32_value).
+ * - from_fp32_toward_zero truncates: the dropped bits are discarded and finite values never overflow to Inf. This is
+ *   the TF32 conversion of tensor cores and the bf16_trunc_from_fp32_value rounding.
+ * - to_fp32 is exact: normal numbers move their fields into place and add the difference of the biases, subnormal
+ *   numbers multiply the integer mantissa by the smallest subnormal. Signaling NaN is quieted, like
+ *   fp16_ieee_to_fp32_value does.
+ * - round_fp32 is to_fp32(from_fp32(f)): a float that holds the nearest value of the format, for emulation.
+ *
+ * All of them are constexpr (floating-point addition and std::bit_cast are constant expressions in C++20), and the
+ * encodings are bit-identical to fp16_ieee_from_fp32_value, fp16_alt_from_fp32_value, bf16_from_fp32_value (except
+ * for the NaN payload) and the E4M3 (saturating) and E5M2 encoders of fp16_fp8.h for the corresponding instances
+ * below. fp16_format_conformance.cpp checks this for all 2**32 inputs.
+ *
+ * The format must fit into single precision: its largest finite value and its smallest subnormal must be single
+ * precision numbers, and MantBits is at most 22 so the rounding has a bit to drop.
+ */
+namespace fp16 {
+
+enum class nonfinite {
+	none,
+	inf_nan,
+	finite_nan,
+};
+
+template <unsigned ExpBits, unsigned MantBits, nonfinite Specials = nonfinite::inf_nan,
+	int Bias = (1 << (ExpBits - 1)) - 1>
+struct float_format {
+	static constexpr unsigned exponent_bits = ExpBits;
+	static constexpr unsigned mantissa_bits = MantBits;
+	static constexpr nonfinite specials = Specials;
+	static constexpr bool has_inf_nan = Specials == nonfinite::inf_nan;
+	static constexpr bool has_nan = Specials != nonfinite::none;
+	static constexpr int bias = Bias;
+	static constexpr unsigned total_bits = 1 + ExpBits + MantBits;
+
+	static_assert(ExpBits >= 2 && ExpBits <= 8, "the exponent must fit into the single-precision exponent");
+	static_assert(MantBits <= 22, "the mantissa must be narrower than the single-precision mantissa");
+	static_assert(!has_nan || MantBits >= 1, "NaN needs a mantissa bit");
+
+	using storage_type = std::conditional_t<total_bits <= 8, uint8_t,
+		std::conditional_t<total_bits <= 16, uint16_t, uint32_t>>;
+
+	/* Unbiased exponents of the smallest normal and of the largest finite numbers */
+	static constexpr int min_exponent = 1 - Bias;
+	static constexpr int max_exponent = (1 << ExpBits) - (has_inf_nan ? 2 : 1) - Bias;
+	static_assert(max_exponent <= 127, "the largest finite value must be a single-precision number");
+	static_assert(min_exponent >= -126, "the smallest normal number must be a single-precision normal number");
+	static_assert(min_exponent - (int) MantBits >= -149, "the smallest subnormal must be a single-precision number");
+
+	static constexpr storage_type sign_mask = (storage_type) (UINT32_C(1) << (ExpBits + MantBits));
+	static constexpr uint32_t mantissa_mask = (UINT32_C(1) << MantBits) - 1;
+	static constexpr uint32_t exponent_mask = ((UINT32_C(1) << ExpBits) - 1) << MantBits;
+	/* The largest finite value has an all-ones mantissa, except with finite_nan where that is NaN */
+	static constexpr uint32_t max_mantissa = Specials == nonfinite::finite_nan ? mantissa_mask - 1 : mantissa_mask;
+	static constexpr storage_type max_bits =
+		(storage_type) ((has_inf_nan ? exponent_mask - (UINT32_C(1) << MantBits) : exponent_mask) | max_mantissa);
+	static constexpr storage_type inf_bits = (storage_type) (has_inf_nan ? exponent_mask : max_bits);
+	static constexpr storage_type nan_bits = (storage_type) (Specials == nonfinite::inf_nan ?
+		exponent_mask | (mantissa_mask + 1) >> 1 : Specials == nonfinite::finite_nan ? exponent_mask | mantissa_mask :
+		max_bits);
+
+	/* Biased single-precision exponent of the smallest normal number of the format, 113 for half precision */
+	static constexpr uint32_t min_exponent_bits = (uint32_t) (127 + min_exponent);
+	/* Bits of the largest finite value as a single-precision number */
+	static constexpr uint32_t max_fp32_bits =
+		((uint32_t) (127 + max_exponent) << 23) | (max_mantissa << (23 - MantBits));
+	/*
+	 * Bits of the smallest single-precision number that rounds past the largest finite value: the largest value plus
+	 * half a quantum. When the largest mantissa is all ones, the tie rounds up (to the next power of two) and belongs
+	 * to the overflow range. 0x477FF000 (65520) for half precision, where float_to_half_fast3_rtne.c checks 0x47800000
+	 * and lets the rounding carry do the rest, and 0x47FFF000 (131040) for the alternative one. With finite_nan the
+	 * largest mantissa is even and the tie rounds down, so overflow starts one bit higher (464 for E4M3).
+	 */
+	static constexpr uint32_t overflow_bits =
+		max_fp32_bits + (UINT32_C(1) << (22 - MantBits)) + (Specials == nonfinite::finite_nan ? 1 : 0);
+
+	/*
+	 * The float addition needs the power of two 2**(e + 23 - MantBits) for every exponent e of an input that doesn't
+	 * overflow, up to max_exponent; it must be a finite single-precision number.
+	 */
+	static constexpr bool uses_float_addition = max_exponent + 23 - (int) MantBits <= 127;
+
+	static constexpr storage_type from_fp32(float f) {
+		const uint32_t w = std::bit_cast<uint32_t>(f);
+		const storage_type sign = (storage_type) ((w >> (31 - ExpBits - MantBits)) & sign_mask);
+		const uint32_t nonsign = w & UINT32_C(0x7FFFFFFF);
+		/*
+		 * Without a branch: the input is clamped to overflow_bits, which rounds up to Inf, or to the largest value for
+		 * the formats without Inf, so only NaN needs a select (as in fp16_ieee_from_fp32_value). Inf and NaN never go
+		 * through the rounding, which keeps it a constant expression.
+		 */
+		const uint32_t saturation_bits = has_inf_nan ? overflow_bits : max_fp32_bits;
+		const uint32_t rounded = round_nonsign(nonsign < saturation_bits ? nonsign : saturation_bits);
+		return (storage_type) (sign | (has_nan && nonsign > UINT32_C(0x7F800000) ? nan_bits : rounded));
+	}
+
+	static constexpr storage_type from_fp32_toward_zero(float f) {
+		const uint32_t w = std::bit_cast<uint32_t>(f);
+		const storage_type sign = (storage_type) ((w >> (31 - ExpBits - MantBits)) & sign_mask);
+		const uint32_t nonsign = w & UINT32_C(0x7FFFFFFF);
+		if (nonsign > UINT32_C(0x7F800000)) {
+			return (storage_type) (sign | nan_bits);
+		}
+		if (nonsign >= max_fp32_bits) {
+			/* At or above the largest value: only Inf stays Inf */
+			return (storage_type) (sign | (has_inf_nan && nonsign == UINT32_C(0x7F800000) ? inf_bits : max_bits));
+		}
+		const uint32_t e = nonsign >> 23;
+		const uint32_t m = e != 0 ? (nonsign & UINT32_C(0x007FFFFF)) | UINT32_C(0x00800000) : nonsign;
+		const uint32_t effective_e = e != 0 ? e : 1;
+		const uint32_t subnormal_shift = effective_e < min_exponent_bits ? min_exponent_bits - effective_e : 0;
+		const uint32_t shift = subnormal_shift < 8 + MantBits ? 23 - MantBits + subnormal_shift : 31;
+		const uint32_t base = effective_e >= min_exponent_bits ? (effective_e - min_exponent_bits) << MantBits : 0;
+		return (storage_type) (sign | (base + (m >> shift)));
+	}
+
+	static constexpr float to_fp32(storage_type h) {
+		const uint32_t sign = (uint32_t) (h & sign_mask) << (31 - ExpBits - MantBits);
+		const uint32_t nonsign = (uint32_t) h & (exponent_mask | mantissa_mask);
+		if (has_inf_nan && nonsign >= exponent_mask) {
+			const uint32_t quiet = nonsign > exponent_mask ? UINT32_C(0x00400000) : 0;
+			return std::bit_cast<float>(sign | UINT32_C(0x7F800000) | quiet | ((nonsign & mantissa_mask) << (23 - MantBits)));
+		}
+		if (Specials == nonfinite::finite_nan && nonsign == (exponent_mask | mantissa_mask)) {
+			/* The quiet NaN of fp8_e4m3_to_fp32_value: there is no payload */
+			return std::bit_cast<float>(sign | UINT32_C(0x7FC00000));
+		}
+		if (nonsign < (UINT32_C(1) << MantBits)) {
+			const float value = (float) nonsign * smallest_subnormal;
+			return std::bit_cast<float>(sign | std::bit_cast<uint32_t>(value));
+		}
+		return std::bit_cast<float>(sign | ((nonsign << (23 - MantBits)) + ((uint32_t) (127 - Bias) << 23)));
+	}
+
+	static constexpr float round_fp32(float f) {
+		return to_fp32(from_fp32(f));
+	}
+
+private:
+	/* Round the absolute value of a single-precision number up to overflow_bits to nearest even */
+	static constexpr uint32_t round_nonsign(uint32_t nonsign) {
+		if constexpr (uses_float_addition) {
+			uint32_t exponent = nonsign & UINT32_C(0x7F800000);
+			if (exponent < (min_exponent_bits << 23)) {
+				exponent = min_exponent_bits << 23;
+			}
+			const uint32_t magic = exponent + ((23 - MantBits) << 23);
+			const uint32_t quanta =
+				std::bit_cast<uint32_t>(std::bit_cast<float>(nonsign) + std::bit_cast<float>(magic)) - magic;
+			return (((exponent >> 23) - min_exponent_bits) << MantBits) + quanta;
+		} else {
+			/* Single-precision subnormal numbers have no implicit bit and the exponent of the smallest normal */
+			const uint32_t e = nonsign >> 23;
+			const uint32_t m = e != 0 ? (nonsign & UINT32_C(0x007FFFFF)) | UINT32_C(0x00800000) : nonsign;
+			const uint32_t effective_e = e != 0 ? e : 1;
+			const uint32_t subnormal_shift = effective_e < min_exponent_bits ? min_exponent_bits - effective_e : 0;
+			/* From 25 on everything rounds to zero; 31 keeps the shifts defined */
+			const uint32_t shift = subnormal_shift < 8 + MantBits ? 23 - MantBits + subnormal_shift : 31;
+			const uint32_t base = effective_e >= min_exponent_bits ? (effective_e - min_exponent_bits) << MantBits : 0;
+			const uint32_t round = (UINT32_C(1) << (shift - 1)) - 1;
+			return base + ((m + round + ((m >> shift) & 1)) >> shift);
+		}
+	}
+
+	/* 2**(min_exponent - MantBits), a single-precision subnormal number for bfloat16 and TF32 */
+	static constexpr float smallest_subnormal = min_exponent - (int) MantBits >= -126 ?
+		std::bit_cast<float>((uint32_t) (127 + min_exponent - (int) MantBits) << 23) :
+		std::bit_cast<float>(UINT32_C(1) << (149 + min_exponent - (int) MantBits));
+};
+
+using ieee_half_format = float_format<5, 10>;
+using alt_half_format = float_format<5, 10, nonfinite::none>;
+using bfloat16_format = float_format<8, 7>;
+using tf32_format = float_format<8, 10>;
+using fp8_e4m3_format = float_format<4, 3, nonfinite::finite_nan>;
+using fp8_e5m2_format = float_format<5, 2>;
+
+static_assert(ieee_half_format::uses_float_addition && ieee_half_format::overflow_bits == UINT32_C(0x477FF000));
+static_assert(ieee_half_format::min_exponent_bits << 23 == UINT32_C(0x38800000));
+static_assert(!bfloat16_format::uses_float_addition && !tf32_format::uses_float_addition);
+static_assert(std::is_same_v<tf32_format::storage_type, uint32_t> && std::is_same_v<fp8_e5m2_format::storage_type, uint8_t>);
+static_assert(ieee_half_format::from_fp32(1.0f) == UINT16_C(0x3C00) && ieee_half_format::from_fp32(65520.0f) == UINT16_C(0x7C00));
+static_assert(alt_half_format::from_fp32(1.0e9f) == UINT16_C(0x7FFF) && alt_half_format::to_fp32(UINT16_C(0x7FFF)) == 131008.0f);
+static_assert(bfloat16_format::from_fp32(1.00390625f) == UINT16_C(0x3F80) && bfloat16_format::to_fp32(UINT16_C(0x0001)) > 0.0f);
+static_assert(fp8_e4m3_format::max_bits == 0x7E && fp8_e4m3_format::nan_bits == 0x7F);
+static_assert(fp8_e4m3_format::to_fp32(0x7E) == 448.0f && fp8_e4m3_format::from_fp32(464.0f) == 0x7E);
+
+} // namespace fp16
+
+#endif /* FP16_FORMAT_HPP */
@@ -0,0 +1,212 @@
+/*
+ * Check of the generic converters of fp16_format.hpp against the hand-written ones, and their speed.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   c++ -std=c++20 -O2 -I<FP16>/include fp16_format_conformance.cpp -o fp16_format_conformance -pthread
+ *
+ * Usage: ./fp16_format_conformance [-t threads] [-b first_bits] [-e last_bits]
+ *
+ * The program checks
+ * - every encoding of the 8- and 16-bit instances through to_fp32, against fp16_ieee_to_fp32_value,
+ *   fp16_alt_to_fp32_value, bf16_to_fp32_value, fp8_e4m3_to_fp32_value and fp8_e5m2_to_fp32_value,
+ * - the fp32 bit patterns first_bits..last_bits (by default all 2**32), split into blocks of 2**20 inputs that the
+ *   threads take from a shared counter, through from_fp32 of
+ *   - ieee_half_format against fp16_ieee_from_fp32_value,
+ *   - alt_half_format against fp16_alt_from_fp32_value,
+ *   - bfloat16_format against bf16_from_fp32_value, and from_fp32_toward_zero against bf16_trunc_from_fp32_value,
+ *     NaN only for being a NaN of the same sign (the payloads differ),
+ *   - tf32_format against the integer rounding of the low 13 bits,
+ *   - fp8_e4m3_format against fp8_e4m3_from_fp32_value with saturation,
+ *   - fp8_e5m2_format against fp8_e5m2_from_fp32_value without saturation.
+ * It prints the first mismatches, then the time per element of ieee_half_format::from_fp32 and of
+ * fp16_ieee_from_fp32_value in a loop over 16M random floats, and exits with 1 if there was any mismatch.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fp16_format.hpp"
+#include "fp16_fp8.h"
+
+using fp16::alt_half_format;
+using fp16::bfloat16_format;
+using fp16::fp8_e4m3_format;
+using fp16::fp8_e5m2_format;
+using fp16::ieee_half_format;
+using fp16::tf32_format;
+
+constexpr uint64_t block_size = uint64_t(1) << 20;
+constexpr uint64_t max_reports = 8;
+
+static std::atomic<uint64_t> mismatches{0};
+static std::mutex report_mutex;
+
+static void report(const char* what, uint32_t input, uint32_t actual, uint32_t expected) {
+	std::lock_guard<std::mutex> lock(report_mutex);
+	if (mismatches++ < max_reports) {
+		std::printf("%-32s input 0x%08X -> 0x%08X, expected 0x%08X\n", what, input, actual, expected);
+	}
+}
+
+/* Equal bits, or both NaN with the same sign, in a format with the given Inf encoding and sign bit */
+static bool same_encoding(uint32_t a, uint32_t b, uint32_t inf_bits, uint32_t sign_mask) {
+	const bool a_nan = (a & ~sign_mask) > inf_bits;
+	const bool b_nan = (b & ~sign_mask) > inf_bits;
+	return a == b || (a_nan && b_nan && (a & sign_mask) == (b & sign_mask));
+}
+
+static void check_decode() {
+	for (uint32_t h = 0; h < 65536; h++) {
+		const uint32_t ieee = fp32_to_bits(ieee_half_format::to_fp32((uint16_t) h));
+		if (ieee != fp32_to_bits(fp16_ieee_to_fp32_value((uint16_t) h))) {
+			report("ieee_half_format::to_fp32", h, ieee, fp32_to_bits(fp16_ieee_to_fp32_value((uint16_t) h)));
+		}
+		const uint32_t alt = fp32_to_bits(alt_half_format::to_fp32((uint16_t) h));
+		if (alt != fp32_to_bits(fp16_alt_to_fp32_value((uint16_t) h))) {
+			report("alt_half_format::to_fp32", h, alt, fp32_to_bits(fp16_alt_to_fp32_value((uint16_t) h)));
+		}
+		// bf16_to_fp32_value keeps signaling NaN signaling, to_fp32 quiets it like fp16_ieee_to_fp32_value
+		const uint32_t bf16 = fp32_to_bits(bfloat16_format::to_fp32((uint16_t) h));
+		const uint32_t bf16_reference = fp32_to_bits(bf16_to_fp32_value((uint16_t) h));
+		if (!same_encoding(bf16, bf16_reference, UINT32_C(0x7F800000), UINT32_C(0x80000000))) {
+			report("bfloat16_format::to_fp32", h, bf16, bf16_reference);
+		}
+	}
+	for (uint32_t b = 0; b < 256; b++) {
+		const uint32_t e4m3 = fp32_to_bits(fp8_e4m3_format::to_fp32((uint8_t) b));
+		if (e4m3 != fp32_to_bits(fp8_e4m3_to_fp32_value((uint8_t) b))) {
+			report("fp8_e4m3_format::to_fp32", b, e4m3, fp32_to_bits(fp8_e4m3_to_fp32_value((uint8_t) b)));
+		}
+		const uint32_t e5m2 = fp32_to_bits(fp8_e5m2_format::to_fp32((uint8_t) b));
+		if (e5m2 != fp32_to_bits(fp8_e5m2_to_fp32_value((uint8_t) b))) {
+			report("fp8_e5m2_format::to_fp32", b, e5m2, fp32_to_bits(fp8_e5m2_to_fp32_value((uint8_t) b)));
+		}
+	}
+}
+
+/* TF32 keeps the single-precision exponent, so rounding the low 13 bits of the bits to nearest even is the reference */
+static uint32_t tf32_reference(uint32_t w) {
+	const uint32_t sign = (w >> 13) & UINT32_C(0x40000);
+	const uint32_t nonsign = w & UINT32_C(0x7FFFFFFF);
+	if (nonsign > UINT32_C(0x7F800000)) {
+		return sign | tf32_format::nan_bits;
+	}
+	return sign | ((nonsign + UINT32_C(0xFFF) + ((nonsign >> 13) & 1)) >> 13);
+}
+
+static void sweep(std::atomic<uint64_t>* next, uint64_t end) {
+	for (;;) {
+		const uint64_t first = next->fetch_add(block_size, std::memory_order_relaxed);
+		if (first >= end) {
+			break;
+		}
+		const uint64_t last = end - first < block_size ? end : first + block_size;
+		for (uint64_t x = first; x < last; x++) {
+			const uint32_t w = (uint32_t) x;
+			const float f = fp32_from_bits(w);
+			if (ieee_half_format::from_fp32(f) != fp16_ieee_from_fp32_value(f)) {
+				report("ieee_half_format::from_fp32", w, ieee_half_format::from_fp32(f), fp16_ieee_from_fp32_value(f));
+			}
+			if (alt_half_format::from_fp32(f) != fp16_alt_from_fp32_value(f)) {
+				report("alt_half_format::from_fp32", w, alt_half_format::from_fp32(f), fp16_alt_from_fp32_value(f));
+			}
+			const uint16_t bf16 = bfloat16_format::from_fp32(f);
+			if (!same_encoding(bf16, bf16_from_fp32_value(f), 0x7F80, 0x8000)) {
+				report("bfloat16_format::from_fp32", w, bf16, bf16_from_fp32_value(f));
+			}
+			const uint16_t bf16_trunc = bfloat16_format::from_fp32_toward_zero(f);
+			if (!same_encoding(bf16_trunc, bf16_trunc_from_fp32_value(f), 0x7F80, 0x8000)) {
+				report("bfloat16_format::from_fp32_toward_zero", w, bf16_trunc, bf16_trunc_from_fp32_value(f));
+			}
+			if (tf32_format::from_fp32(f) != tf32_reference(w)) {
+				report("tf32_format::from_fp32", w, tf32_format::from_fp32(f), tf32_reference(w));
+			}
+			if (fp8_e4m3_format::from_fp32(f) != fp8_e4m3_from_fp32_value(f, 1)) {
+				report("fp8_e4m3_format::from_fp32", w, fp8_e4m3_format::from_fp32(f), fp8_e4m3_from_fp32_value(f, 1));
+			}
+			if (fp8_e5m2_format::from_fp32(f) != fp8_e5m2_from_fp32_value(f, 0)) {
+				report("fp8_e5m2_format::from_fp32", w, fp8_e5m2_format::from_fp32(f), fp8_e5m2_from_fp32_value(f, 0));
+			}
+		}
+	}
+}
+
+/* Best of 5 runs, in ns per element */
+template <typename Convert>
+static double time_loop(const std::vector<float>& src, std::vector<uint16_t>& dst, Convert convert) {
+	double best = 1e30;
+	for (int run = 0; run < 5; run++) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < src.size(); i++) {
+			dst[i] = convert(src[i]);
+		}
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count() / (double) src.size());
+	}
+	return best;
+}
+
+static void bench() {
+	// Random signs and mantissas, exponents from 2**-32 to 2**31: subnormal, normal and overflowing results
+	std::vector<float> src(size_t(1) << 24);
+	std::vector<uint16_t> dst(src.size());
+	uint32_t state = 1;
+	for (float& f : src) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		f = fp32_from_bits((state & UINT32_C(0x807FFFFF)) | ((95 + (state >> 23) % 64) << 23));
+	}
+	const double reference = time_loop(src, dst, [](float f) { return fp16_ieee_from_fp32_value(f); });
+	const uint16_t check = dst[12345];
+	const double generic = time_loop(src, dst, [](float f) { return ieee_half_format::from_fp32(f); });
+	if (check != dst[12345]) {
+		report("bench", fp32_to_bits(src[12345]), dst[12345], check);
+	}
+	std::printf("fp16_ieee_from_fp32_value    %6.3f ns/element\n", reference);
+	std::printf("ieee_half_format::from_fp32  %6.3f ns/element (%+.1f%%)\n", generic,
+		(generic / reference - 1.0) * 100.0);
+}
+
+int main(int argc, char** argv) {
+	unsigned threads = std::thread::hardware_concurrency();
+	uint64_t first_bits = 0, last_bits = UINT32_MAX;
+	for (int a = 1; a < argc; a += 2) {
+		if (a + 1 == argc) {
+			argv[a] = const_cast<char*>("");
+		}
+		if (std::strcmp(argv[a], "-t") == 0) {
+			threads = (unsigned) std::strtoul(argv[a + 1], nullptr, 0);
+		} else if (std::strcmp(argv[a], "-b") == 0) {
+			first_bits = std::strtoull(argv[a + 1], nullptr, 0);
+		} else if (std::strcmp(argv[a], "-e") == 0) {
+			last_bits = std::strtoull(argv[a + 1], nullptr, 0);
+		} else {
+			std::fprintf(stderr, "usage: %s [-t threads] [-b first_bits] [-e last_bits]\n", argv[0]);
+			return 1;
+		}
+	}
+	threads = threads != 0 ? threads : 1;
+
+	check_decode();
+	std::atomic<uint64_t> next{first_bits};
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < threads; t++) {
+		workers.emplace_back(sweep, &next, last_bits + 1);
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	std::printf("0x%08llX..0x%08llX: %llu mismatches\n", (unsigned long long) first_bits,
+		(unsigned long long) last_bits, (unsigned long long) mismatches.load());
+
+	bench();
+	return mismatches.load() != 0;
+}
@@ -0,0 +1,454 @@
+#pragma once
+#ifndef FP16_FP8_H
+#define FP16_FP8_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cstddef>
+	#include <cstdint>
+#else
+	#include <stddef.h>
+	#include <stdint.h>
+#endif
+
+#include "fp16_array.h"
+
+/*
+ * 8-bit floating-point formats of the OCP 8-bit Floating Point Specification (OFP8):
+ *
+ * | format | layout     | bias | max   | min normal | min subnormal | Inf        | NaN                  |
+ * |--------|------------|------|-------|------------|---------------|------------|----------------------|
+ * | E4M3   | S EEEE MMM | 7    | 448   | 2**(-6)    | 2**(-9)       | none       | S 1111 111           |
+ * | E5M2   | S EEEEE MM | 15   | 57344 | 2**(-14)   | 2**(-16)      | S 11111 00 | S 11111 (01, 10, 11) |
+ *
+ * E5M2 is the upper byte of IEEE half precision, E4M3 trades Inf and most of the NaN encodings for one more exponent.
+ *
+ * Conversion to fp8 rounds to nearest even with the float addition trick of fp16_ieee_from_fp32_value (see README.md):
+ * a power of two whose unit in the last place is the fp8 quantum of the input is added to the absolute value, so the
+ * adder shifts the mantissa right and rounds it. The quantum is 2**(max(e, emin) - M) for an input exponent e, the fp8
+ * minimum normal exponent emin and M mantissa bits, so the same addition handles fp8 normal and subnormal results. The
+ * bits of the sum minus the bits of the power of two are the rounded significand in fp8 quanta, and adding the fp8
+ * exponent (max(e, emin) - emin) << M gives the encoding; a carry out of the mantissa moves into the exponent, as in
+ * the fp16 code. Like fp16_ieee_from_fp32_value this assumes the default rounding mode.
+ *
+ * Out of range inputs are caught before the addition. There are two modes:
+ * - saturate: finite values beyond the range and infinity become the largest finite value (448 or 57344) with the
+ *   sign of the input,
+ * - no saturation: they become NaN (E4M3) or infinity (E5M2).
+ * "Beyond the range" means rounding to nearest even would go past the largest value: above 464 for E4M3 (the tie
+ * rounds down to the even 448), at least 61440 for E5M2 (the tie rounds up, 57344 is odd). NaN becomes a NaN with the
+ * input sign in both modes: 0x7F for E4M3, 0x7E for E5M2 (the quiet NaN, like the 0x7E00 of fp16_ieee_from_fp32_value).
+ *
+ * Conversion from fp8 is exact. E5M2 goes through fp16_ieee_to_fp32_value, E4M3 through the normalized/denormalized
+ * construction of fp16_ieee_to_fp32_value with the E4M3 field widths.
+ */
+#define FP8_E4M3_MAX UINT8_C(0x7E)
+#define FP8_E4M3_NAN UINT8_C(0x7F)
+#define FP8_E5M2_MAX UINT8_C(0x7B)
+#define FP8_E5M2_INF UINT8_C(0x7C)
+#define FP8_E5M2_NAN UINT8_C(0x7E)
+
+/*
+ * Round the absolute value of a finite fp32 number, which is known not to overflow, to a fp8 format with the minimum
+ * normal biased fp32 exponent emin_bits (127 + emin) and mantissa_bits mantissa bits.
+ */
+static inline uint32_t fp8_round_from_fp32_nonsign(uint32_t nonsign, uint32_t emin_bits, uint32_t mantissa_bits) {
+	uint32_t exponent = nonsign & UINT32_C(0x7F800000);
+	if (exponent < (emin_bits << 23)) {
+		exponent = emin_bits << 23;
+	}
+	const uint32_t magic = exponent + ((23 - mantissa_bits) << 23);
+	const uint32_t quanta = fp32_to_bits(fp32_from_bits(nonsign) + fp32_from_bits(magic)) - magic;
+	return (((exponent >> 23) - emin_bits) << mantissa_bits) + quanta;
+}
+
+/*
+ * Convert a 32-bit floating-point number in IEEE single-precision format to an 8-bit floating-point number in OCP E4M3
+ * format, in bit representation. saturate selects the out of range behavior (see above).
+ *
+ * @note The implementation relies on IEEE-like (round to nearest even) floating-point addition and bitcasts between
+ * integer and floating-point variables.
+ */
+static inline uint8_t fp8_e4m3_from_fp32_value(float f, int saturate) {
+	const uint32_t w = fp32_to_bits(f);
+	const uint32_t sign = (w >> 24) & UINT32_C(0x80);
+	const uint32_t nonsign = w & UINT32_C(0x7FFFFFFF);
+	if (nonsign > UINT32_C(0x7F800000)) {
+		return (uint8_t) (sign | FP8_E4M3_NAN);
+	}
+	if (nonsign > UINT32_C(0x43E80000)) { /* 464 */
+		return (uint8_t) (sign | (saturate ? FP8_E4M3_MAX : FP8_E4M3_NAN));
+	}
+	return (uint8_t) (sign | fp8_round_from_fp32_nonsign(nonsign, 127 - 6, 3));
+}
+
+/*
+ * Convert a 32-bit floating-point number in IEEE single-precision format to an 8-bit floating-point number in OCP E5M2
+ * format, in bit representation. saturate selects the out of range behavior (see above).
+ *
+ * @note The implementation relies on IEEE-like (round to nearest even) floating-point addition and bitcasts between
+ * integer and floating-point variables.
+ */
+static inline uint8_t fp8_e5m2_from_fp32_value(float f, int saturate) {
+	const uint32_t w = fp32_to_bits(f);
+	const uint32_t sign = (w >> 24) & UINT32_C(0x80);
+	const uint32_t nonsign = w & UINT32_C(0x7FFFFFFF);
+	if (nonsign > UINT32_C(0x7F800000)) {
+		return (uint8_t) (sign | FP8_E5M2_NAN);
+	}
+	if (nonsign >= UINT32_C(0x47700000)) { /* 61440 */
+		return (uint8_t) (sign | (saturate ? FP8_E5M2_MAX : FP8_E5M2_INF));
+	}
+	return (uint8_t) (sign | fp8_round_from_fp32_nonsign(nonsign, 127 - 14, 2));
+}
+
+/*
+ * Convert an 8-bit floating-point number in OCP E4M3 format, in bit representation, to a 32-bit floating-point number
+ * in IEEE single-precision format.
+ *
+ * @note The conversion is exact. Both NaN encodings give the quiet NaN 0x7FC00000 with the input sign.
+ */
+static inline float fp8_e4m3_to_fp32_value(uint8_t b) {
+	const uint32_t w = (uint32_t) b << 24;
+	const uint32_t sign = w & UINT32_C(0x80000000);
+	/* Exponent in bits 28-31, mantissa in bits 25-27 */
+	const uint32_t two_w = w + w;
+	if ((two_w >> 25) == UINT32_C(0x7F)) {
+		return fp32_from_bits(sign | UINT32_C(0x7FC00000));
+	}
+
+	/* Normal: move the exponent and mantissa into place and add the difference of the biases, 127 - 7 */
+	const uint32_t normalized_value = (two_w >> 5) + (UINT32_C(120) << 23);
+
+	/*
+	 * Subnormal: mantissa * 2**(-9). With the mantissa in the low bits of a float whose exponent is 141, a unit of the
+	 * mantissa is worth 2**(141 - 127 - 23) = 2**(-9), and the implicit one is worth 2**14, which is subtracted.
+	 */
+	const float denormalized_value = fp32_from_bits((two_w >> 25) | (UINT32_C(141) << 23)) - 16384.0f;
+
+	const uint32_t denormalized_cutoff = UINT32_C(1) << 28;
+	return fp32_from_bits(sign | (two_w < denormalized_cutoff ? fp32_to_bits(denormalized_value) : normalized_value));
+}
+
+/*
+ * Convert an 8-bit floating-point number in OCP E5M2 format, in bit representation, to a 32-bit floating-point number
+ * in IEEE single-precision format.
+ *
+ * @note The conversion is exact; E5M2 is the upper byte of IEEE half precision.
+ */
+static inline float fp8_e5m2_to_fp32_value(uint8_t b) {
+	return fp16_ieee_to_fp32_value((uint16_t) ((uint32_t) b << 8));
+}
+
+/*
+ * Convert a 16-bit floating-point number in IEEE half-precision format, in bit representation, to an 8-bit
+ * floating-point number in OCP E4M3 format, in bit representation.
+ *
+ * @note Half to single precision is exact, so this rounds once, like fp8_e4m3_from_fp32_value.
+ */
+static inline uint8_t fp8_e4m3_from_fp16_ieee_value(uint16_t h, int saturate) {
+	return fp8_e4m3_from_fp32_value(fp16_ieee_to_fp32_value(h), saturate);
+}
+
+/*
+ * Convert a 16-bit floating-point number in IEEE half-precision format, in bit representation, to an 8-bit
+ * floating-point number in OCP E5M2 format, in bit representation.
+ *
+ * E5M2 has the exponent of half precision, so this only rounds the low 8 bits away, with the same add-and-shift as
+ * bf16_from_fp32_value. 0x7B80 is 61440, the first half-precision number that rounds past 57344.
+ *
+ * @note The implementation doesn't use any floating-point operations.
+ */
+static inline uint8_t fp8_e5m2_from_fp16_ieee_value(uint16_t h, int saturate) {
+	const uint32_t sign = ((uint32_t) h >> 8) & UINT32_C(0x80);
+	const uint32_t nonsign = (uint32_t) h & UINT32_C(0x7FFF);
+	if (nonsign > UINT32_C(0x7C00)) {
+		return (uint8_t) (sign | FP8_E5M2_NAN);
+	}
+	if (nonsign >= UINT32_C(0x7B80)) {
+		return (uint8_t) (sign | (saturate ? FP8_E5M2_MAX : FP8_E5M2_INF));
+	}
+	return (uint8_t) (sign | ((nonsign + UINT32_C(0x7F) + ((nonsign >> 8) & 1)) >> 8));
+}
+
+/*
+ * Convert an 8-bit floating-point number in OCP E4M3 format to a 16-bit floating-point number in IEEE half-precision
+ * format, both in bit representation. Every E4M3 number is a half-precision number, so the conversion is exact.
+ */
+static inline uint16_t fp16_ieee_from_fp8_e4m3_value(uint8_t b) {
+	return fp16_ieee_from_fp32_value(fp8_e4m3_to_fp32_value(b));
+}
+
+/*
+ * Convert an 8-bit floating-point number in OCP E5M2 format to a 16-bit floating-point number in IEEE half-precision
+ * format, both in bit representation.
+ */
+static inline uint16_t fp16_ieee_from_fp8_e5m2_value(uint8_t b) {
+	return (uint16_t) ((uint32_t) b << 8);
+}
+
+#ifdef FP16_ARRAY_X86
+/*
+ * AVX2 versions, 32 elements per iteration, bit-identical to the scalar functions. The fp32 -> fp8 kernels are lane by
+ * lane ports of fp8_round_from_fp32_nonsign with the range checks as blends; the E4M3 kernels from half precision
+ * widen with vcvtph2ps first, and the E5M2 kernel from half precision rounds the 16-bit lanes directly. E5M2 -> fp32
+ * shifts into half precision and uses vcvtph2ps, E4M3 -> fp32 is a port of fp8_e4m3_to_fp32_value.
+ */
+FP16_X86_TARGET("avx2,f16c")
+static inline __m256i fp8_from_fp32_avx2_x8(__m256 f, uint32_t emin_bits, uint32_t mantissa_bits,
+	uint32_t overflow_bits, uint32_t overflow_code, uint32_t nan_code)
+{
+	const __m256i w = _mm256_castps_si256(f);
+	const __m256i sign = _mm256_and_si256(_mm256_srli_epi32(w, 24), _mm256_set1_epi32(0x80));
+	const __m256i nonsign = _mm256_and_si256(w, _mm256_set1_epi32(0x7FFFFFFF));
+
+	const __m256i exponent = _mm256_max_epi32(_mm256_and_si256(nonsign, _mm256_set1_epi32(0x7F800000)),
+		_mm256_set1_epi32((int) (emin_bits << 23)));
+	const __m256i magic = _mm256_add_epi32(exponent, _mm256_set1_epi32((int) ((23 - mantissa_bits) << 23)));
+	const __m256i quanta = _mm256_sub_epi32(
+		_mm256_castps_si256(_mm256_add_ps(_mm256_castsi256_ps(nonsign), _mm256_castsi256_ps(magic))), magic);
+	const __m256i fp8_exponent = _mm256_sub_epi32(_mm256_srli_epi32(exponent, 23), _mm256_set1_epi32((int) emin_bits));
+	__m256i result = _mm256_add_epi32(_mm256_sll_epi32(fp8_exponent, _mm_cvtsi32_si128((int) mantissa_bits)), quanta);
+
+	const __m256i is_overflow = _mm256_cmpgt_epi32(nonsign, _mm256_set1_epi32((int) (overflow_bits - 1)));
+	result = _mm256_blendv_epi8(result, _mm256_set1_epi32((int) overflow_code), is_overflow);
+	const __m256i is_nan = _mm256_cmpgt_epi32(nonsign, _mm256_set1_epi32(0x7F800000));
+	result = _mm256_blendv_epi8(result, _mm256_set1_epi32((int) nan_code), is_nan);
+	return _mm256_or_si256(result, sign);
+}
+
+/* Pack 4 x 8 32-bit lanes, every one below 256, into 32 bytes in order */
+FP16_X86_TARGET("avx2")
+static inline __m256i fp8_pack_avx2(__m256i a, __m256i b, __m256i c, __m256i d) {
+	const __m256i bytes = _mm256_packus_epi16(_mm256_packus_epi32(a, b), _mm256_packus_epi32(c, d));
+	return _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t fp8_e4m3_from_fp32_avx2(const float* src, uint8_t* dst, size_t n, int saturate) {
+	const uint32_t overflow_code = saturate ? FP8_E4M3_MAX : FP8_E4M3_NAN;
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		__m256i lanes[4];
+		for (int k = 0; k < 4; k++) {
+			lanes[k] = fp8_from_fp32_avx2_x8(_mm256_loadu_ps(src + i + 8 * k), 127 - 6, 3,
+				UINT32_C(0x43E80001), overflow_code, FP8_E4M3_NAN);
+		}
+		_mm256_storeu_si256((__m256i*) (dst + i), fp8_pack_avx2(lanes[0], lanes[1], lanes[2], lanes[3]));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t fp8_e5m2_from_fp32_avx2(const float* src, uint8_t* dst, size_t n, int saturate) {
+	const uint32_t overflow_code = saturate ? FP8_E5M2_MAX : FP8_E5M2_INF;
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		__m256i lanes[4];
+		for (int k = 0; k < 4; k++) {
+			lanes[k] = fp8_from_fp32_avx2_x8(_mm256_loadu_ps(src + i + 8 * k), 127 - 14, 2,
+				UINT32_C(0x47700000), overflow_code, FP8_E5M2_NAN);
+		}
+		_mm256_storeu_si256((__m256i*) (dst + i), fp8_pack_avx2(lanes[0], lanes[1], lanes[2], lanes[3]));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t fp8_e4m3_from_fp16_ieee_avx2(const uint16_t* src, uint8_t* dst, size_t n, int saturate) {
+	const uint32_t overflow_code = saturate ? FP8_E4M3_MAX : FP8_E4M3_NAN;
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		__m256i lanes[4];
+		for (int k = 0; k < 4; k++) {
+			const __m256 f = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (src + i + 8 * k)));
+			lanes[k] = fp8_from_fp32_avx2_x8(f, 127 - 6, 3, UINT32_C(0x43E80001), overflow_code, FP8_E4M3_NAN);
+		}
+		_mm256_storeu_si256((__m256i*) (dst + i), fp8_pack_avx2(lanes[0], lanes[1], lanes[2], lanes[3]));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx2")
+static inline __m256i fp8_e5m2_from_fp16_ieee_avx2_x16(__m256i h, __m256i overflow_code) {
+	const __m256i sign = _mm256_and_si256(_mm256_srli_epi16(h, 8), _mm256_set1_epi16(0x80));
+	const __m256i nonsign = _mm256_and_si256(h, _mm256_set1_epi16(0x7FFF));
+	const __m256i lsb = _mm256_and_si256(_mm256_srli_epi16(nonsign, 8), _mm256_set1_epi16(1));
+	__m256i result = _mm256_srli_epi16(_mm256_add_epi16(nonsign, _mm256_add_epi16(lsb, _mm256_set1_epi16(0x7F))), 8);
+	result = _mm256_blendv_epi8(result, overflow_code, _mm256_cmpgt_epi16(nonsign, _mm256_set1_epi16(0x7B7F)));
+	result = _mm256_blendv_epi8(result, _mm256_set1_epi16(FP8_E5M2_NAN),
+		_mm256_cmpgt_epi16(nonsign, _mm256_set1_epi16(0x7C00)));
+	return _mm256_or_si256(result, sign);
+}
+
+FP16_X86_TARGET("avx2")
+static inline size_t fp8_e5m2_from_fp16_ieee_avx2(const uint16_t* src, uint8_t* dst, size_t n, int saturate) {
+	const __m256i overflow_code = _mm256_set1_epi16(saturate ? FP8_E5M2_MAX : FP8_E5M2_INF);
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		const __m256i lo = fp8_e5m2_from_fp16_ieee_avx2_x16(
+			_mm256_loadu_si256((const __m256i*) (src + i)), overflow_code);
+		const __m256i hi = fp8_e5m2_from_fp16_ieee_avx2_x16(
+			_mm256_loadu_si256((const __m256i*) (src + i + 16)), overflow_code);
+		_mm256_storeu_si256((__m256i*) (dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx2")
+static inline __m256 fp8_e4m3_to_fp32_avx2_x8(__m256i b) {
+	const __m256i sign = _mm256_slli_epi32(_mm256_and_si256(b, _mm256_set1_epi32(0x80)), 24);
+	const __m256i two_w = _mm256_slli_epi32(b, 25);
+	const __m256i normalized_value = _mm256_add_epi32(_mm256_srli_epi32(two_w, 5), _mm256_set1_epi32((127 - 7) << 23));
+	const __m256 denormalized_value = _mm256_sub_ps(
+		_mm256_castsi256_ps(_mm256_or_si256(_mm256_srli_epi32(two_w, 25), _mm256_set1_epi32(141 << 23))),
+		_mm256_set1_ps(16384.0f));
+	// two_w < 2**28 as unsigned is the same as (two_w >> 1) < 2**27 as signed
+	const __m256i is_denormalized = _mm256_cmpgt_epi32(_mm256_set1_epi32(1 << 27), _mm256_srli_epi32(two_w, 1));
+	__m256i result = _mm256_blendv_epi8(normalized_value, _mm256_castps_si256(denormalized_value), is_denormalized);
+	const __m256i is_nan = _mm256_cmpeq_epi32(_mm256_and_si256(b, _mm256_set1_epi32(0x7F)), _mm256_set1_epi32(0x7F));
+	result = _mm256_blendv_epi8(result, _mm256_set1_epi32(0x7FC00000), is_nan);
+	return _mm256_castsi256_ps(_mm256_or_si256(result, sign));
+}
+
+FP16_X86_TARGET("avx2")
+static inline size_t fp8_e4m3_to_fp32_avx2(const uint8_t* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		for (int k = 0; k < 4; k++) {
+			const __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (src + i + 8 * k)));
+			_mm256_storeu_ps(dst + i + 8 * k, fp8_e4m3_to_fp32_avx2_x8(b));
+		}
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t fp8_e5m2_to_fp32_avx2(const uint8_t* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		for (int k = 0; k < 4; k++) {
+			const __m128i h = _mm_slli_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*) (src + i + 8 * k))), 8);
+			_mm256_storeu_ps(dst + i + 8 * k, _mm256_cvtph_ps(h));
+		}
+	}
+	return i;
+}
+
+/*
+ * The fp8 kernels have a table of their own, ordered from the slowest to the fastest like those of fp16_x86.h, and
+ * fp16_x86_fp8_kernels is filled once at startup. The kernel pointers stay NULL without AVX2 and F16C, and the arrays
+ * then use the scalar functions throughout.
+ */
+typedef size_t (*fp8_from_fp32_kernel)(const float* src, uint8_t* dst, size_t n, int saturate);
+typedef size_t (*fp8_from_fp16_kernel)(const uint16_t* src, uint8_t* dst, size_t n, int saturate);
+typedef size_t (*fp8_to_fp32_kernel)(const uint8_t* src, float* dst, size_t n);
+
+struct fp16_x86_fp8_kernel {
+	const char* name;
+	int (*supported)(void);
+	fp8_from_fp32_kernel e4m3_from_fp32;
+	fp8_from_fp32_kernel e5m2_from_fp32;
+	fp8_from_fp16_kernel e4m3_from_fp16_ieee;
+	fp8_from_fp16_kernel e5m2_from_fp16_ieee;
+	fp8_to_fp32_kernel e4m3_to_fp32;
+	fp8_to_fp32_kernel e5m2_to_fp32;
+};
+
+static const struct fp16_x86_fp8_kernel fp16_x86_fp8_kernel_table[] = {
+	{ "f16c", fp16_x86_has_f16c, fp8_e4m3_from_fp32_avx2, fp8_e5m2_from_fp32_avx2, fp8_e4m3_from_fp16_ieee_avx2,
+		fp8_e5m2_from_fp16_ieee_avx2, fp8_e4m3_to_fp32_avx2, fp8_e5m2_to_fp32_avx2 },
+};
+
+#define FP16_X86_FP8_KERNEL_COUNT (sizeof(fp16_x86_fp8_kernel_table) / sizeof(fp16_x86_fp8_kernel_table[0]))
+
+static struct fp16_x86_fp8_kernel fp16_x86_fp8_kernels = { "scalar", NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+
+#if defined(__GNUC__)
+__attribute__((__constructor__, __unused__))
+#endif
+static void fp16_x86_fp8_init(void) {
+	for (size_t k = 0; k < FP16_X86_FP8_KERNEL_COUNT; k++) {
+		if (fp16_x86_fp8_kernel_table[k].supported()) {
+			fp16_x86_fp8_kernels = fp16_x86_fp8_kernel_table[k];
+		}
+	}
+}
+#endif
+
+/*
+ * Bulk conversions: the kernels of fp16_x86_fp8_kernels where the CPU has them, then the scalar functions for the
+ * rest. The results are bit-identical to calling the scalar function on every element. src and dst must not overlap.
+ */
+static inline void fp8_e4m3_from_fp32_array(const float* src, uint8_t* dst, size_t n, int saturate) {
+	size_t i = 0;
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_fp8_kernels.e4m3_from_fp32 != NULL) {
+		i = fp16_x86_fp8_kernels.e4m3_from_fp32(src, dst, n, saturate);
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i] = fp8_e4m3_from_fp32_value(src[i], saturate);
+	}
+}
+
+static inline void fp8_e5m2_from_fp32_array(const float* src, uint8_t* dst, size_t n, int saturate) {
+	size_t i = 0;
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_fp8_kernels.e5m2_from_fp32 != NULL) {
+		i = fp16_x86_fp8_kernels.e5m2_from_fp32(src, dst, n, saturate);
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i] = fp8_e5m2_from_fp32_value(src[i], saturate);
+	}
+}
+
+static inline void fp8_e4m3_from_fp16_ieee_array(const uint16_t* src, uint8_t* dst, size_t n, int saturate) {
+	size_t i = 0;
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_fp8_kernels.e4m3_from_fp16_ieee != NULL) {
+		i = fp16_x86_fp8_kernels.e4m3_from_fp16_ieee(src, dst, n, saturate);
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i] = fp8_e4m3_from_fp16_ieee_value(src[i], saturate);
+	}
+}
+
+static inline void fp8_e5m2_from_fp16_ieee_array(const uint16_t* src, uint8_t* dst, size_t n, int saturate) {
+	size_t i = 0;
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_fp8_kernels.e5m2_from_fp16_ieee != NULL) {
+		i = fp16_x86_fp8_kernels.e5m2_from_fp16_ieee(src, dst, n, saturate);
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i] = fp8_e5m2_from_fp16_ieee_value(src[i], saturate);
+	}
+}
+
+static inline void fp8_e4m3_to_fp32_array(const uint8_t* src, float* dst, size_t n) {
+	size_t i = 0;
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_fp8_kernels.e4m3_to_fp32 != NULL) {
+		i = fp16_x86_fp8_kernels.e4m3_to_fp32(src, dst, n);
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i] = fp8_e4m3_to_fp32_value(src[i]);
+	}
+}
+
+static inline void fp8_e5m2_to_fp32_array(const uint8_t* src, float* dst, size_t n) {
+	size_t i = 0;
+#ifdef FP16_ARRAY_X86
+	if (fp16_x86_fp8_kernels.e5m2_to_fp32 != NULL) {
+		i = fp16_x86_fp8_kernels.e5m2_to_fp32(src, dst, n);
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i] = fp8_e5m2_to_fp32_value(src[i]);
+	}
+}
+
+#endif /* FP16_FP8_H */
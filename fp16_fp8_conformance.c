@@ -0,0 +1,275 @@
+/*
+ * Exhaustive check of the FP8 conversions of fp16_fp8.h against a reference built from the definition of the formats:
+ * the value of every fp8 encoding is computed with ldexp, and an input is encoded by searching the sorted values for
+ * the nearest one (ties to the even encoding), then applying the out of range rules.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_fp8_conformance.c -o fp16_fp8_conformance -lm -pthread
+ *
+ * Usage: ./fp16_fp8_conformance [-t threads] [-b first_bits] [-e last_bits]
+ *
+ * The program checks
+ * - all 256 encodings of both formats through the scalar decoders, the array decoders and fp16_ieee_from_fp8_*,
+ * - all 65536 half-precision inputs through the scalar and array encoders, in both saturation modes,
+ * - the fp32 bit patterns first_bits..last_bits (by default all 2**32) through the scalar and array encoders, in both
+ *   saturation modes, split into blocks of 2**20 inputs that the threads take from a shared counter.
+ * It prints the first mismatches and exits with 1 if there is any.
+ */
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "fp16_fp8.h"
+
+#define BLOCK_SIZE ((uint64_t) 1 << 20)
+#define MAX_THREADS 256
+#define MAX_REPORTS 8
+
+enum format {
+	FORMAT_E4M3,
+	FORMAT_E5M2,
+	FORMAT_COUNT
+};
+
+static const char* const format_names[FORMAT_COUNT] = {"e4m3", "e5m2"};
+
+/* Largest finite positive encoding, and the value halfway between it and the next (unrepresentable) step */
+static const int max_code[FORMAT_COUNT] = {FP8_E4M3_MAX, FP8_E5M2_MAX};
+static const double overflow_threshold[FORMAT_COUNT] = {464.0, 61440.0};
+
+/* Value of the positive encodings 0..max_code, in increasing order */
+static double positive_values[FORMAT_COUNT][128];
+
+static double reference_decode(enum format format, int b) {
+	const int exponent_bits = format == FORMAT_E4M3 ? 4 : 5;
+	const int mantissa_bits = 7 - exponent_bits;
+	const int bias = (1 << (exponent_bits - 1)) - 1;
+	const int exponent = (b >> mantissa_bits) & ((1 << exponent_bits) - 1);
+	const int mantissa = b & ((1 << mantissa_bits) - 1);
+	double value;
+	if (format == FORMAT_E4M3 && exponent == 15 && mantissa == 7) {
+		value = NAN;
+	} else if (format == FORMAT_E5M2 && exponent == 31) {
+		value = mantissa != 0 ? NAN : INFINITY;
+	} else if (exponent == 0) {
+		value = ldexp(mantissa, 1 - bias - mantissa_bits);
+	} else {
+		value = ldexp(mantissa + (1 << mantissa_bits), exponent - bias - mantissa_bits);
+	}
+	return (b & 0x80) ? -value : value;
+}
+
+static int reference_encode(enum format format, double x, int saturate) {
+	const int sign = signbit(x) ? 0x80 : 0;
+	if (isnan(x)) {
+		return sign | (format == FORMAT_E4M3 ? FP8_E4M3_NAN : FP8_E5M2_NAN);
+	}
+	const double a = fabs(x);
+	const int top = max_code[format];
+	if (a > overflow_threshold[format] || (a == overflow_threshold[format] && (top & 1))) {
+		return sign | (saturate ? top : (format == FORMAT_E4M3 ? FP8_E4M3_NAN : FP8_E5M2_INF));
+	}
+	if (a >= positive_values[format][top]) {
+		return sign | top;
+	}
+	int lo = 0, hi = top;
+	while (hi - lo > 1) {
+		const int mid = (lo + hi) / 2;
+		if (positive_values[format][mid] <= a) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+	const double below = a - positive_values[format][lo];
+	const double above = positive_values[format][hi] - a;
+	const int code = below < above ? lo : above < below ? hi : (lo & 1) ? hi : lo;
+	return sign | code;
+}
+
+static uint64_t mismatches = 0;
+static pthread_mutex_t report_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void report(const char* what, enum format format, int saturate, uint32_t input, int actual, int expected) {
+	pthread_mutex_lock(&report_mutex);
+	if (mismatches++ < MAX_REPORTS) {
+		printf("%-24s %s saturate=%d input 0x%08X -> 0x%02X, reference 0x%02X\n",
+			what, format_names[format], saturate, input, actual, expected);
+	}
+	pthread_mutex_unlock(&report_mutex);
+}
+
+static int same_float(float a, double reference) {
+	if (isnan(reference)) {
+		return isnan(a) && !signbit(a) == !signbit(reference);
+	}
+	return (double) a == reference && !signbit(a) == !signbit(reference);
+}
+
+static void check_decode(void) {
+	uint8_t codes[256];
+	float e4m3[256], e5m2[256];
+	for (int b = 0; b < 256; b++) {
+		codes[b] = (uint8_t) b;
+	}
+	fp8_e4m3_to_fp32_array(codes, e4m3, 256);
+	fp8_e5m2_to_fp32_array(codes, e5m2, 256);
+	for (int b = 0; b < 256; b++) {
+		const double r4 = reference_decode(FORMAT_E4M3, b);
+		const double r5 = reference_decode(FORMAT_E5M2, b);
+		if (!same_float(fp8_e4m3_to_fp32_value((uint8_t) b), r4) || !same_float(e4m3[b], r4)) {
+			report("to_fp32", FORMAT_E4M3, 0, (uint32_t) b, 0, 0);
+		}
+		if (!same_float(fp8_e5m2_to_fp32_value((uint8_t) b), r5) || !same_float(e5m2[b], r5)) {
+			report("to_fp32", FORMAT_E5M2, 0, (uint32_t) b, 0, 0);
+		}
+		if (!same_float(fp16_ieee_to_fp32_value(fp16_ieee_from_fp8_e4m3_value((uint8_t) b)), r4)) {
+			report("fp16_ieee_from_fp8", FORMAT_E4M3, 0, (uint32_t) b, 0, 0);
+		}
+		if (!same_float(fp16_ieee_to_fp32_value(fp16_ieee_from_fp8_e5m2_value((uint8_t) b)), r5)) {
+			report("fp16_ieee_from_fp8", FORMAT_E5M2, 0, (uint32_t) b, 0, 0);
+		}
+	}
+}
+
+static void check_fp16(void) {
+	static uint16_t inputs[65536];
+	static uint8_t e4m3[65536], e5m2[65536];
+	for (uint32_t h = 0; h < 65536; h++) {
+		inputs[h] = (uint16_t) h;
+	}
+	for (int saturate = 0; saturate < 2; saturate++) {
+		fp8_e4m3_from_fp16_ieee_array(inputs, e4m3, 65536, saturate);
+		fp8_e5m2_from_fp16_ieee_array(inputs, e5m2, 65536, saturate);
+		for (uint32_t h = 0; h < 65536; h++) {
+			const double x = fp16_ieee_to_fp32_value((uint16_t) h);
+			const int r4 = reference_encode(FORMAT_E4M3, x, saturate);
+			const int r5 = reference_encode(FORMAT_E5M2, x, saturate);
+			const int s4 = fp8_e4m3_from_fp16_ieee_value((uint16_t) h, saturate);
+			const int s5 = fp8_e5m2_from_fp16_ieee_value((uint16_t) h, saturate);
+			if (s4 != r4) {
+				report("from_fp16_ieee_value", FORMAT_E4M3, saturate, h, s4, r4);
+			}
+			if (e4m3[h] != r4) {
+				report("from_fp16_ieee_array", FORMAT_E4M3, saturate, h, e4m3[h], r4);
+			}
+			if (s5 != r5) {
+				report("from_fp16_ieee_value", FORMAT_E5M2, saturate, h, s5, r5);
+			}
+			if (e5m2[h] != r5) {
+				report("from_fp16_ieee_array", FORMAT_E5M2, saturate, h, e5m2[h], r5);
+			}
+		}
+	}
+}
+
+struct sweep {
+	uint64_t end;
+	uint64_t next;
+};
+
+static void* worker_main(void* arg) {
+	struct sweep* sweep = (struct sweep*) arg;
+	float* inputs = (float*) malloc(BLOCK_SIZE * sizeof(float));
+	uint8_t* e4m3 = (uint8_t*) malloc(BLOCK_SIZE);
+	uint8_t* e5m2 = (uint8_t*) malloc(BLOCK_SIZE);
+	for (;;) {
+		const uint64_t first = __atomic_fetch_add(&sweep->next, BLOCK_SIZE, __ATOMIC_RELAXED);
+		if (first >= sweep->end) {
+			break;
+		}
+		const size_t n = (size_t) (sweep->end - first < BLOCK_SIZE ? sweep->end - first : BLOCK_SIZE);
+		for (size_t i = 0; i < n; i++) {
+			inputs[i] = fp32_from_bits((uint32_t) (first + i));
+		}
+		for (int saturate = 0; saturate < 2; saturate++) {
+			fp8_e4m3_from_fp32_array(inputs, e4m3, n, saturate);
+			fp8_e5m2_from_fp32_array(inputs, e5m2, n, saturate);
+			for (size_t i = 0; i < n; i++) {
+				const uint32_t x = (uint32_t) (first + i);
+				const int r4 = reference_encode(FORMAT_E4M3, inputs[i], saturate);
+				const int r5 = reference_encode(FORMAT_E5M2, inputs[i], saturate);
+				const int s4 = fp8_e4m3_from_fp32_value(inputs[i], saturate);
+				const int s5 = fp8_e5m2_from_fp32_value(inputs[i], saturate);
+				if (s4 != r4) {
+					report("from_fp32_value", FORMAT_E4M3, saturate, x, s4, r4);
+				}
+				if (e4m3[i] != r4) {
+					report("from_fp32_array", FORMAT_E4M3, saturate, x, e4m3[i], r4);
+				}
+				if (s5 != r5) {
+					report("from_fp32_value", FORMAT_E5M2, saturate, x, s5, r5);
+				}
+				if (e5m2[i] != r5) {
+					report("from_fp32_array", FORMAT_E5M2, saturate, x, e5m2[i], r5);
+				}
+			}
+		}
+	}
+	free(inputs);
+	free(e4m3);
+	free(e5m2);
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	const long online = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t threads = online > 0 ? (size_t) online : 1;
+	uint64_t first = 0;
+	uint64_t last = UINT32_MAX;
+
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+			threads = (size_t) strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-b") == 0 && a + 1 < argc) {
+			first = strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-e") == 0 && a + 1 < argc) {
+			last = strtoull(argv[++a], NULL, 0);
+		} else {
+			fprintf(stderr, "usage: %s [-t threads] [-b first_bits] [-e last_bits]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (threads == 0 || threads > MAX_THREADS || first > last || last > UINT32_MAX) {
+		fprintf(stderr, "invalid arguments\n");
+		return 1;
+	}
+
+	for (int format = 0; format < FORMAT_COUNT; format++) {
+		for (int b = 0; b <= max_code[format]; b++) {
+			positive_values[format][b] = reference_decode((enum format) format, b);
+		}
+	}
+
+	check_decode();
+	check_fp16();
+
+	struct sweep sweep;
+	sweep.end = last + 1;
+	sweep.next = first;
+
+	struct timespec start, stop;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_t thread_ids[MAX_THREADS];
+	for (size_t t = 0; t < threads; t++) {
+		pthread_create(&thread_ids[t], NULL, worker_main, &sweep);
+	}
+	for (size_t t = 0; t < threads; t++) {
+		pthread_join(thread_ids[t], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	printf("256 fp8 encodings, 65536 fp16 inputs, fp32 inputs 0x%08llX..0x%08llX, %zu threads, %.1f s: %llu mismatches\n",
+		(unsigned long long) first, (unsigned long long) last, threads,
+		(double) (stop.tv_sec - start.tv_sec) + (double) (stop.tv_nsec - start.tv_nsec) * 1e-9,
+		(unsigned long long) mismatches);
+	return mismatches != 0;
+}
@@ -0,0 +1,300 @@
+#pragma once
+#ifndef FP16_HALF_HPP
+#define FP16_HALF_HPP
+
+#if !defined(__cplusplus) || __cplusplus < 202002L
+	#error "fp16_half.hpp needs C++20 (std::bit_cast, std::span)"
+#endif
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+#include "fp16_array.h"
+
+/*
+ * C++ value types over the conversions of fp16_study.h.
+ *
+ * fp16::half holds an IEEE half-precision number, fp16::half_alt a number in the ARM alternative half-precision format
+ * (no Inf and NaN, the largest exponent is a normal one). Both are a single uint16_t: trivially copyable, standard
+ * layout, 2 bytes, so arrays of them can go straight into the bulk functions of fp16_array.h.
+ *
+ * Conversions are constexpr. In a constant expression they use the integer-only versions in fp16::detail below, which
+ * give the same bits as fp16_study.h; at run time they call fp16_study.h itself. A constant such as
+ *
+ *      constexpr fp16::half scale{0.125f};
+ *
+ * is therefore encoded by the compiler and costs nothing at run time.
+ *
+ * Arithmetic promotes to float: a half converts implicitly to float, so h1 * h2 is a float product, and the compound
+ * assignments round the float result back to half. Comparisons are float comparisons too (NaN is unordered, -0 == +0).
+ */
+namespace fp16 {
+
+enum class format {
+	ieee,
+	alt,
+};
+
+namespace detail {
+
+/*
+ * Round a 32-bit floating-point number in IEEE single-precision format to half precision with ties to even, using
+ * integer operations only. The 24-bit significand m (with the implicit bit) is shifted right by 13 for fp16 normal
+ * results and by more for fp16 subnormal results; the rounding adds shift-1 ones plus the lowest kept bit, and a carry
+ * out of the mantissa moves into the exponent.
+ */
+constexpr uint16_t round_fp32_to_fp16(uint32_t w, uint32_t max_exponent) {
+	const uint32_t sign = (w >> 16) & UINT32_C(0x8000);
+	const uint32_t e = (w >> 23) & UINT32_C(0xFF);
+	if (e < 102 || e > max_exponent) {
+		return (uint16_t) sign; /* below half of the smallest subnormal, the caller handles the top */
+	}
+	const uint32_t m = (w & UINT32_C(0x007FFFFF)) | UINT32_C(0x00800000);
+	const uint32_t shift = e >= 113 ? 13 : 126 - e;
+	const uint32_t base = e >= 113 ? (e - 113) << 10 : 0;
+	const uint32_t round = (UINT32_C(1) << (shift - 1)) - 1;
+	return (uint16_t) (sign | (base + ((m + round + ((m >> shift) & 1)) >> shift)));
+}
+
+/* Same bits as fp16_ieee_from_fp32_value: overflow gives Inf, NaN gives the quiet NaN 0x7E00 with the input sign */
+constexpr uint16_t ieee_from_fp32(float f) {
+	const uint32_t w = std::bit_cast<uint32_t>(f);
+	const uint32_t nonsign = w & UINT32_C(0x7FFFFFFF);
+	if (nonsign > UINT32_C(0x7F800000)) {
+		return (uint16_t) (((w >> 16) & UINT32_C(0x8000)) | UINT32_C(0x7E00));
+	}
+	if (nonsign >= UINT32_C(0x47800000)) {
+		return (uint16_t) (((w >> 16) & UINT32_C(0x8000)) | UINT32_C(0x7C00));
+	}
+	return round_fp32_to_fp16(w, 142);
+}
+
+/* Same bits as fp16_alt_from_fp32_value: everything above the largest value (including Inf and NaN) saturates */
+constexpr uint16_t alt_from_fp32(float f) {
+	const uint32_t w = std::bit_cast<uint32_t>(f);
+	if ((w & UINT32_C(0x7FFFFFFF)) > UINT32_C(0x47FFE000)) {
+		return (uint16_t) (((w >> 16) & UINT32_C(0x8000)) | UINT32_C(0x7FFF));
+	}
+	return round_fp32_to_fp16(w, 143);
+}
+
+/* fp16_ieee_to_fp32_bits and fp16_alt_to_fp32_bits with std::countl_zero in place of __builtin_clz */
+constexpr uint32_t half_to_fp32_bits(uint16_t h, bool inf_nan) {
+	const uint32_t w = (uint32_t) h << 16;
+	const uint32_t sign = w & UINT32_C(0x80000000);
+	const uint32_t nonsign = w & UINT32_C(0x7FFFFFFF);
+	if (nonsign == 0) {
+		return sign;
+	}
+	uint32_t renorm_shift = (uint32_t) std::countl_zero(nonsign);
+	renorm_shift = renorm_shift > 5 ? renorm_shift - 5 : 0;
+	const uint32_t inf_nan_mask =
+		inf_nan && nonsign >= UINT32_C(0x7C000000) ? UINT32_C(0x7F800000) : 0;
+	return sign | (((nonsign << renorm_shift >> 3) + ((0x70 - renorm_shift) << 23)) | inf_nan_mask);
+}
+
+/* Same bits as fp16_ieee_to_fp32_value, which quiets signaling NaN like the floating-point multiplication does */
+constexpr float ieee_to_fp32(uint16_t h) {
+	uint32_t bits = half_to_fp32_bits(h, true);
+	if ((h & UINT16_C(0x7C00)) == UINT16_C(0x7C00) && (h & UINT16_C(0x03FF)) != 0) {
+		bits |= UINT32_C(0x00400000);
+	}
+	return std::bit_cast<float>(bits);
+}
+
+constexpr float alt_to_fp32(uint16_t h) {
+	return std::bit_cast<float>(half_to_fp32_bits(h, false));
+}
+
+} // namespace detail
+
+template <format Format>
+class basic_half {
+public:
+	/* Trivial, like float: a default-initialized half has an indeterminate value */
+	basic_half() = default;
+
+	constexpr explicit basic_half(float f) : bits_(encode(f)) {}
+
+	static constexpr basic_half from_bits(uint16_t bits) {
+		basic_half h;
+		h.bits_ = bits;
+		return h;
+	}
+
+	constexpr uint16_t bits() const {
+		return bits_;
+	}
+
+	constexpr operator float() const {
+		if (std::is_constant_evaluated()) {
+			return Format == format::ieee ? detail::ieee_to_fp32(bits_) : detail::alt_to_fp32(bits_);
+		}
+		return Format == format::ieee ? fp16_ieee_to_fp32_value(bits_) : fp16_alt_to_fp32_value(bits_);
+	}
+
+	/* Negation only flips the sign bit, as in IEEE 754, so it is exact and keeps NaN a NaN */
+	constexpr basic_half operator-() const {
+		return from_bits((uint16_t) (bits_ ^ UINT16_C(0x8000)));
+	}
+
+	constexpr basic_half operator+() const {
+		return *this;
+	}
+
+	constexpr basic_half& operator+=(float f) {
+		return *this = basic_half(float(*this) + f);
+	}
+
+	constexpr basic_half& operator-=(float f) {
+		return *this = basic_half(float(*this) - f);
+	}
+
+	constexpr basic_half& operator*=(float f) {
+		return *this = basic_half(float(*this) * f);
+	}
+
+	constexpr basic_half& operator/=(float f) {
+		return *this = basic_half(float(*this) / f);
+	}
+
+private:
+	static constexpr uint16_t encode(float f) {
+		if (std::is_constant_evaluated()) {
+			return Format == format::ieee ? detail::ieee_from_fp32(f) : detail::alt_from_fp32(f);
+		}
+		return Format == format::ieee ? fp16_ieee_from_fp32_value(f) : fp16_alt_from_fp32_value(f);
+	}
+
+	uint16_t bits_;
+};
+
+using half = basic_half<format::ieee>;
+using half_alt = basic_half<format::alt>;
+
+static_assert(sizeof(half) == sizeof(uint16_t) && alignof(half) == alignof(uint16_t));
+static_assert(std::is_trivially_copyable_v<half> && std::is_standard_layout_v<half>);
+static_assert(sizeof(half_alt) == sizeof(uint16_t) && alignof(half_alt) == alignof(uint16_t));
+static_assert(std::is_trivially_copyable_v<half_alt> && std::is_standard_layout_v<half_alt>);
+
+/*
+ * Bulk conversions between spans, on top of fp16_array.h (and so on the SIMD kernels picked at startup). A
+ * std::vector<half> or std::array<half, N> converts to the span by itself. A half is pointer-interconvertible with its
+ * uint16_t member, so the spans are handed to the kernels as they are, without a copy.
+ *
+ * @note dst must have at least src.size() elements; src and dst must not overlap.
+ */
+inline void from_fp32(std::span<const float> src, std::span<half> dst) {
+	assert(dst.size() >= src.size());
+	fp16_ieee_from_fp32_array(src.data(), reinterpret_cast<uint16_t*>(dst.data()), src.size());
+}
+
+inline void from_fp32(std::span<const float> src, std::span<half_alt> dst) {
+	assert(dst.size() >= src.size());
+	fp16_alt_from_fp32_array(src.data(), reinterpret_cast<uint16_t*>(dst.data()), src.size());
+}
+
+inline void to_fp32(std::span<const half> src, std::span<float> dst) {
+	assert(dst.size() >= src.size());
+	fp16_ieee_to_fp32_array(reinterpret_cast<const uint16_t*>(src.data()), dst.data(), src.size());
+}
+
+inline void to_fp32(std::span<const half_alt> src, std::span<float> dst) {
+	assert(dst.size() >= src.size());
+	fp16_alt_to_fp32_array(reinterpret_cast<const uint16_t*>(src.data()), dst.data(), src.size());
+}
+
+namespace literals {
+
+/* 1.5_h is a compile-time half; the literal goes through float first, like fp16::half{1.5f} */
+consteval half operator""_h(long double value) {
+	return half(static_cast<float>(value));
+}
+
+consteval half operator""_h(unsigned long long value) {
+	return half(static_cast<float>(value));
+}
+
+} // namespace literals
+
+} // namespace fp16
+
+/*
+ * Only the ieee format has Inf and NaN. For half_alt, infinity() and the NaN functions return 0 as the standard asks
+ * for types without them, and max() is 131008 because the exponent 31 holds normal numbers.
+ */
+template <fp16::format Format>
+class std::numeric_limits<fp16::basic_half<Format>> {
+	using type = fp16::basic_half<Format>;
+	static constexpr bool ieee = Format == fp16::format::ieee;
+
+public:
+	static constexpr bool is_specialized = true;
+	static constexpr bool is_signed = true;
+	static constexpr bool is_integer = false;
+	static constexpr bool is_exact = false;
+	static constexpr bool has_infinity = ieee;
+	static constexpr bool has_quiet_NaN = ieee;
+	static constexpr bool has_signaling_NaN = ieee;
+	static constexpr std::float_denorm_style has_denorm = std::denorm_present;
+	static constexpr bool has_denorm_loss = false;
+	static constexpr std::float_round_style round_style = std::round_to_nearest;
+	static constexpr bool is_iec559 = ieee;
+	static constexpr bool is_bounded = true;
+	static constexpr bool is_modulo = false;
+	static constexpr int digits = 11;
+	static constexpr int digits10 = 3;
+	static constexpr int max_digits10 = 5;
+	static constexpr int radix = 2;
+	static constexpr int min_exponent = -13;
+	static constexpr int min_exponent10 = -4;
+	static constexpr int max_exponent = ieee ? 16 : 17;
+	static constexpr int max_exponent10 = ieee ? 4 : 5;
+	static constexpr bool traps = false;
+	static constexpr bool tinyness_before = false;
+
+	static constexpr type min() noexcept {
+		return type::from_bits(UINT16_C(0x0400));
+	}
+	static constexpr type lowest() noexcept {
+		return type::from_bits(ieee ? UINT16_C(0xFBFF) : UINT16_C(0xFFFF));
+	}
+	static constexpr type max() noexcept {
+		return type::from_bits(ieee ? UINT16_C(0x7BFF) : UINT16_C(0x7FFF));
+	}
+	static constexpr type epsilon() noexcept {
+		return type::from_bits(UINT16_C(0x1400));
+	}
+	static constexpr type round_error() noexcept {
+		return type::from_bits(UINT16_C(0x3800));
+	}
+	static constexpr type infinity() noexcept {
+		return type::from_bits(ieee ? UINT16_C(0x7C00) : 0);
+	}
+	static constexpr type quiet_NaN() noexcept {
+		return type::from_bits(ieee ? UINT16_C(0x7E00) : 0);
+	}
+	static constexpr type signaling_NaN() noexcept {
+		return type::from_bits(ieee ? UINT16_C(0x7D00) : 0);
+	}
+	static constexpr type denorm_min() noexcept {
+		return type::from_bits(UINT16_C(0x0001));
+	}
+};
+
+/* Equal values hash equally: -0 and +0 compare equal, so both hash as +0 */
+template <fp16::format Format>
+struct std::hash<fp16::basic_half<Format>> {
+	std::size_t operator()(fp16::basic_half<Format> h) const noexcept {
+		const uint16_t bits = h.bits();
+		return std::hash<uint16_t>()((bits & UINT16_C(0x7FFF)) == 0 ? 0 : bits);
+	}
+};
+
+#endif /* FP16_HALF_HPP */
@@ -0,0 +1,237 @@
+/*
+ * Check of the C++ half-precision types of fp16_half.hpp against fp16_study.h.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   c++ -std=c++20 -O2 -I<FP16>/include fp16_half_conformance.cpp -o fp16_half_conformance -pthread
+ *
+ * Usage: ./fp16_half_conformance [-t threads] [-b first_bits] [-e last_bits]
+ *
+ * The program checks
+ * - at compile time (static_assert), a few encodings and decodings evaluated as constant expressions, the
+ *   std::numeric_limits members and the _h literals,
+ * - the same inputs through the constant-expression path and the run-time path, which must give the same bits,
+ * - all 65536 half-precision inputs through detail::ieee_to_fp32 / alt_to_fp32 and the conversion to float,
+ * - the fp32 bit patterns first_bits..last_bits (by default all 2**32) through detail::ieee_from_fp32 /
+ *   alt_from_fp32 against fp16_ieee_from_fp32_value / fp16_alt_from_fp32_value, split into blocks of 2**20 inputs
+ *   that the threads take from a shared counter,
+ * - std::hash (equal for -0 and +0, and for equal bits otherwise), and the span from_fp32 / to_fp32 against the scalar
+ *   functions for lengths around the SIMD widths.
+ * It prints the first mismatches and exits with 1 if there is any.
+ */
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fp16_half.hpp"
+
+using fp16::half;
+using fp16::half_alt;
+using namespace fp16::literals;
+
+constexpr uint64_t block_size = uint64_t(1) << 20;
+constexpr uint64_t max_reports = 8;
+
+/* Inputs at the edges of the conversions: zeros, subnormal boundaries and ties, the overflow thresholds, Inf, NaN */
+constexpr std::array<uint32_t, 24> edge_inputs = {
+	0x00000000, 0x80000000, 0x00000001, 0x33000000, 0x33000001, 0x337FFFFF, 0x33800000, 0x387FC000,
+	0x387FE000, 0x38800000, 0x3F800000, 0x3F801000, 0x3F803000, 0xBF801001, 0x477FEFFF, 0x477FF000,
+	0x477FFFFF, 0x47800000, 0x47FFE000, 0x47FFF000, 0x7F800000, 0xFF800000, 0x7FC00000, 0xFF800001,
+};
+
+template <typename Half>
+constexpr std::array<uint16_t, edge_inputs.size()> encode_edges() {
+	std::array<uint16_t, edge_inputs.size()> bits{};
+	for (size_t i = 0; i < edge_inputs.size(); i++) {
+		bits[i] = Half(std::bit_cast<float>(edge_inputs[i])).bits();
+	}
+	return bits;
+}
+
+/* Evaluated by the compiler, with fp16::detail */
+constexpr auto ieee_edges = encode_edges<half>();
+constexpr auto alt_edges = encode_edges<half_alt>();
+
+static_assert(half(0.125f).bits() == 0x3000 && half(-2.0f).bits() == 0xC000);
+static_assert(half(65504.0f).bits() == 0x7BFF && half(65520.0f).bits() == 0x7C00);
+static_assert(half_alt(131008.0f).bits() == 0x7FFF && half_alt(1.0e9f).bits() == 0x7FFF);
+static_assert(half(std::bit_cast<float>(UINT32_C(0x33000001))).bits() == 0x0001);
+static_assert(half(std::bit_cast<float>(UINT32_C(0x33000000))).bits() == 0x0000);
+static_assert(float(half::from_bits(0x3C00)) == 1.0f && float(half::from_bits(0x0001)) == 0x1.0p-24f);
+static_assert(float(half_alt::from_bits(0x7FFF)) == 131008.0f);
+static_assert(std::bit_cast<uint32_t>(float(half::from_bits(0x7D00))) == 0x7FE00000);
+
+static_assert((1.5_h).bits() == 0x3E00 && (65504_h).bits() == 0x7BFF && (1e-8_h).bits() == 0x0000);
+static_assert((0.1_h).bits() == half(0.1f).bits() && (100000_h).bits() == 0x7C00);
+static_assert((-(2_h)).bits() == 0xC000);
+
+template <typename Half>
+using limits = std::numeric_limits<Half>;
+
+static_assert(limits<half>::min().bits() == 0x0400 && limits<half>::max().bits() == 0x7BFF);
+static_assert(limits<half>::lowest().bits() == 0xFBFF && limits<half>::epsilon().bits() == 0x1400);
+static_assert(limits<half>::denorm_min().bits() == 0x0001 && limits<half>::round_error().bits() == 0x3800);
+static_assert(limits<half>::infinity().bits() == 0x7C00 && limits<half>::quiet_NaN().bits() == 0x7E00);
+static_assert(limits<half>::signaling_NaN().bits() == 0x7D00 && limits<half>::is_iec559);
+static_assert(float(limits<half>::max()) == 65504.0f && float(limits<half>::min()) == 0x1.0p-14f);
+static_assert(float(limits<half>::epsilon()) == 0x1.0p-10f && float(limits<half>::denorm_min()) == 0x1.0p-24f);
+static_assert(limits<half_alt>::max().bits() == 0x7FFF && limits<half_alt>::lowest().bits() == 0xFFFF);
+static_assert(float(limits<half_alt>::max()) == 131008.0f && !limits<half_alt>::has_infinity);
+static_assert(limits<half_alt>::infinity().bits() == 0 && limits<half_alt>::quiet_NaN().bits() == 0);
+
+static std::atomic<uint64_t> mismatches{0};
+static std::mutex report_mutex;
+
+static void report(const char* what, uint32_t input, uint32_t actual, uint32_t expected) {
+	std::lock_guard<std::mutex> lock(report_mutex);
+	if (mismatches++ < max_reports) {
+		std::printf("%-24s input 0x%08X -> 0x%08X, expected 0x%08X\n", what, input, actual, expected);
+	}
+}
+
+static void check_edges() {
+	for (size_t i = 0; i < edge_inputs.size(); i++) {
+		const float f = fp32_from_bits(edge_inputs[i]);
+		if (ieee_edges[i] != half(f).bits() || ieee_edges[i] != fp16_ieee_from_fp32_value(f)) {
+			report("half constexpr", edge_inputs[i], ieee_edges[i], fp16_ieee_from_fp32_value(f));
+		}
+		if (alt_edges[i] != half_alt(f).bits() || alt_edges[i] != fp16_alt_from_fp32_value(f)) {
+			report("half_alt constexpr", edge_inputs[i], alt_edges[i], fp16_alt_from_fp32_value(f));
+		}
+	}
+}
+
+static void check_decode() {
+	for (uint32_t h = 0; h < 65536; h++) {
+		const uint32_t ieee = fp32_to_bits(fp16_ieee_to_fp32_value((uint16_t) h));
+		const uint32_t alt = fp32_to_bits(fp16_alt_to_fp32_value((uint16_t) h));
+		if (fp32_to_bits(fp16::detail::ieee_to_fp32((uint16_t) h)) != ieee) {
+			report("detail::ieee_to_fp32", h, fp32_to_bits(fp16::detail::ieee_to_fp32((uint16_t) h)), ieee);
+		}
+		if (fp32_to_bits(float(half::from_bits((uint16_t) h))) != ieee) {
+			report("half -> float", h, fp32_to_bits(float(half::from_bits((uint16_t) h))), ieee);
+		}
+		if (fp32_to_bits(fp16::detail::alt_to_fp32((uint16_t) h)) != alt) {
+			report("detail::alt_to_fp32", h, fp32_to_bits(fp16::detail::alt_to_fp32((uint16_t) h)), alt);
+		}
+		if (fp32_to_bits(float(half_alt::from_bits((uint16_t) h))) != alt) {
+			report("half_alt -> float", h, fp32_to_bits(float(half_alt::from_bits((uint16_t) h))), alt);
+		}
+	}
+}
+
+static void check_hash() {
+	const std::hash<half> hash;
+	const std::hash<half_alt> hash_alt;
+	if (hash(half(0.0f)) != hash(half(-0.0f)) || hash_alt(half_alt(0.0f)) != hash_alt(half_alt(-0.0f))) {
+		report("hash of -0", 0x8000, 0, 0);
+	}
+	/* Besides the zeros, equal values have equal bits (NaN is never equal), so the hash of the bits is right */
+	for (uint32_t h = 1; h < 65536; h++) {
+		if (h != 0x8000 && hash(half::from_bits((uint16_t) h)) != std::hash<uint16_t>()((uint16_t) h)) {
+			report("hash", h, 0, 0);
+		}
+	}
+	if (hash(half(1.0f)) == hash(half(-1.0f))) {
+		report("hash of -1", 0xBC00, 0, 0);
+	}
+}
+
+static void check_spans() {
+	uint32_t state = 1;
+	for (size_t n = 0; n <= 100; n++) {
+		std::vector<float> src(n), back(n), back_alt(n);
+		for (float& f : src) {
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			f = fp32_from_bits(state);
+		}
+		std::vector<half> dst(n);
+		std::vector<half_alt> dst_alt(n);
+		fp16::from_fp32(src, dst);
+		fp16::from_fp32(src, dst_alt);
+		fp16::to_fp32(dst, back);
+		fp16::to_fp32(dst_alt, back_alt);
+		for (size_t i = 0; i < n; i++) {
+			const uint32_t x = fp32_to_bits(src[i]);
+			if (dst[i].bits() != fp16_ieee_from_fp32_value(src[i])) {
+				report("from_fp32 span", x, dst[i].bits(), fp16_ieee_from_fp32_value(src[i]));
+			}
+			if (dst_alt[i].bits() != fp16_alt_from_fp32_value(src[i])) {
+				report("from_fp32 span alt", x, dst_alt[i].bits(), fp16_alt_from_fp32_value(src[i]));
+			}
+			if (fp32_to_bits(back[i]) != fp32_to_bits(fp16_ieee_to_fp32_value(dst[i].bits()))) {
+				report("to_fp32 span", dst[i].bits(), fp32_to_bits(back[i]), 0);
+			}
+			if (fp32_to_bits(back_alt[i]) != fp32_to_bits(fp16_alt_to_fp32_value(dst_alt[i].bits()))) {
+				report("to_fp32 span alt", dst_alt[i].bits(), fp32_to_bits(back_alt[i]), 0);
+			}
+		}
+	}
+}
+
+static void sweep(std::atomic<uint64_t>* next, uint64_t end) {
+	for (;;) {
+		const uint64_t first = next->fetch_add(block_size, std::memory_order_relaxed);
+		if (first >= end) {
+			break;
+		}
+		const uint64_t last = end - first < block_size ? end : first + block_size;
+		for (uint64_t x = first; x < last; x++) {
+			const float f = fp32_from_bits((uint32_t) x);
+			const uint16_t ieee = fp16_ieee_from_fp32_value(f);
+			const uint16_t alt = fp16_alt_from_fp32_value(f);
+			if (fp16::detail::ieee_from_fp32(f) != ieee) {
+				report("detail::ieee_from_fp32", (uint32_t) x, fp16::detail::ieee_from_fp32(f), ieee);
+			}
+			if (fp16::detail::alt_from_fp32(f) != alt) {
+				report("detail::alt_from_fp32", (uint32_t) x, fp16::detail::alt_from_fp32(f), alt);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	unsigned threads = std::thread::hardware_concurrency();
+	uint64_t first_bits = 0, last_bits = UINT32_MAX;
+	for (int a = 1; a < argc; a += 2) {
+		if (a + 1 == argc) {
+			argv[a] = const_cast<char*>("");
+		}
+		if (std::strcmp(argv[a], "-t") == 0) {
+			threads = (unsigned) std::strtoul(argv[a + 1], nullptr, 0);
+		} else if (std::strcmp(argv[a], "-b") == 0) {
+			first_bits = std::strtoull(argv[a + 1], nullptr, 0);
+		} else if (std::strcmp(argv[a], "-e") == 0) {
+			last_bits = std::strtoull(argv[a + 1], nullptr, 0);
+		} else {
+			std::fprintf(stderr, "usage: %s [-t threads] [-b first_bits] [-e last_bits]\n", argv[0]);
+			return 1;
+		}
+	}
+	threads = threads != 0 ? threads : 1;
+
+	check_edges();
+	check_decode();
+	check_hash();
+	check_spans();
+
+	std::atomic<uint64_t> next{first_bits};
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < threads; t++) {
+		workers.emplace_back(sweep, &next, last_bits + 1);
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	std::printf("0x%08llX..0x%08llX: %llu mismatches\n", (unsigned long long) first_bits,
+		(unsigned long long) last_bits, (unsigned long long) mismatches.load());
+	return mismatches.load() != 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#ifndef FP16_IMPLS_H
+#define FP16_IMPLS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fp16_study.h"
+#include "fp16_table.h"
+
+/*
+ * The five fp32 -> fp16 implementations studied in this repo, compiled into one translation unit so that they can be
+ * benchmarked and compared against each other.
+ *
+ * The study files are included as they are. Two of them need a little help:
+ * - fp16_ieee_from_fp32_value.c defines a fp16_ieee_from_fp32_value(uint32_t), which clashes with the
+ *   fp16_ieee_from_fp32_value(float) of fp16_study.h, so it is renamed to corsix_fp16_ieee_from_fp32_value,
+ * - numpy_floatbits_to_halfbits.py is C code despite its extension, the preprocessor does not mind.
+ *
+ * Every implementation is wrapped into the same signature: fp32 bits in, fp16 bits out. The fp16 -> fp32 direction has
+ * a table of its own, with the arithmetic decoders and the table decoders of fp16_table.h.
+ */
+#define fp16_ieee_from_fp32_value corsix_fp16_ieee_from_fp32_value
+#include "fp16_ieee_from_fp32_value.c"
+#undef fp16_ieee_from_fp32_value
+
+#include "float_to_half_fast3_rtne.c"
+#include "numpy_floatbits_to_halfbits.py"
+#include "mldev_utils_scalar.c"
+
+typedef uint16_t (*fp16_impl_fn)(uint32_t x);
+
+static inline uint16_t fp16_impl_fp16_study(uint32_t x) {
+	return fp16_ieee_from_fp32_value(fp32_from_bits(x));
+}
+
+static inline uint16_t fp16_impl_table_encoder(uint32_t x) {
+	return fp16_ieee_from_fp32_table(fp32_from_bits(x));
+}
+
+static inline uint16_t fp16_impl_mldev(uint32_t x) {
+	return __float32_to_float16_scalar_rtn(fp32_from_bits(x));
+}
+
+struct fp16_impl {
+	const char* name;
+	fp16_impl_fn from_fp32_bits;
+};
+
+/*
+ * fp16_ieee_from_fp32_value of fp16_study.h is first, it is the reference of the conformance checks. The table encoder
+ * of fp16_table.h is last, it needs fp16_encode_table_init to be called first.
+ */
+static const struct fp16_impl fp16_impl_table[] = {
+	{ "fp16_ieee_from_fp32_value", fp16_impl_fp16_study },
+	{ "corsix_fp16_ieee_from_fp32_value", corsix_fp16_ieee_from_fp32_value },
+	{ "float_to_half_fast3_rtne", float_to_half_fast3_rtne },
+	{ "tursa_floatbits_to_halfbits", tursa_floatbits_to_halfbits },
+	{ "numpy_floatbits_to_halfbits", numpy_floatbits_to_halfbits },
+	{ "__float32_to_float16_scalar_rtn", fp16_impl_mldev },
+	{ "fp16_ieee_from_fp32_table", fp16_impl_table_encoder },
+};
+
+#define FP16_IMPL_COUNT (sizeof(fp16_impl_table) / sizeof(fp16_impl_table[0]))
+
+typedef uint32_t (*fp16_decode_impl_fn)(uint16_t h);
+
+static inline uint32_t fp16_decode_impl_fp16_study(uint16_t h) {
+	return fp32_to_bits(fp16_ieee_to_fp32_value(h));
+}
+
+static inline uint32_t fp16_decode_impl_mldev(uint16_t h) {
+	return fp32_to_bits(__float16_to_float32_scalar_rtx(h));
+}
+
+static inline uint32_t fp16_decode_impl_full_table(uint16_t h) {
+	return fp32_to_bits(fp16_ieee_to_fp32_full_table(h));
+}
+
+static inline uint32_t fp16_decode_impl_compact_table(uint16_t h) {
+	return fp32_to_bits(fp16_ieee_to_fp32_compact_table(h));
+}
+
+struct fp16_decode_impl {
+	const char* name;
+	fp16_decode_impl_fn to_fp32_bits;
+};
+
+/* The table decoders need fp16_table_init to be called first */
+static const struct fp16_decode_impl fp16_decode_impl_table[] = {
+	{ "fp16_ieee_to_fp32_value", fp16_decode_impl_fp16_study },
+	{ "fp16_ieee_to_fp32_bits", fp16_ieee_to_fp32_bits },
+	{ "__float16_to_float32_scalar_rtx", fp16_decode_impl_mldev },
+	{ "fp16_ieee_to_fp32_full_table", fp16_decode_impl_full_table },
+	{ "fp16_ieee_to_fp32_compact_table", fp16_decode_impl_compact_table },
+};
+
+#define FP16_DECODE_IMPL_COUNT (sizeof(fp16_decode_impl_table) / sizeof(fp16_decode_impl_table[0]))
+
+#endif /* FP16_IMPLS_H */
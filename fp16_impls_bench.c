@@ -0,0 +1,374 @@
+/*
+ * Benchmark of the five fp32 -> fp16 implementations of fp16_impls.h over different input distributions, and of the
+ * fp16 -> fp32 decoders (arithmetic and table based) over the same inputs after conversion to fp16.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_impls_bench.c -o fp16_impls_bench -lm
+ *
+ * Usage: ./fp16_impls_bench [-n elements] [-r repetitions] [-w weights.f32]...
+ *
+ * -w adds a distribution read from a raw file of little-endian fp32 values, e.g. a weight tensor dumped with
+ * numpy's tofile(). It can be given several times.
+ *
+ * Every implementation is run in two ways:
+ * - scalar: one call per element through a function pointer, as a caller of a non-inline library function would,
+ * - batched: a loop over the whole array with the implementation inlined, so the compiler is free to unroll and
+ *   vectorize it. fp16_ieee_from_fp32_value is also run through fp16_ieee_from_fp32_array, which adds the SIMD kernels.
+ *
+ * Reported: ns/element, GB/s (bytes read plus bytes written), and branch misses per element from the hardware
+ * counters (perf_event_open, Linux only). The counters are often not available in containers and virtual machines;
+ * the column then shows n/a.
+ */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+	#include <linux/perf_event.h>
+	#include <sys/ioctl.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+#include "fp16_array.h"
+#include "fp16_impls.h"
+
+#define MAX_DISTRIBUTIONS 16
+
+struct distribution {
+	char name[64];
+	float* values;
+	size_t n;
+};
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+/* Random sign and mantissa, biased exponent uniform in [e_min, e_max] */
+static uint32_t random_bits(uint32_t* state, uint32_t e_min, uint32_t e_max) {
+	const uint32_t r = next_random(state);
+	const uint32_t e = e_min + next_random(state) % (e_max - e_min + 1);
+	return (r & UINT32_C(0x80000000)) | (e << 23) | (r & UINT32_C(0x007FFFFF));
+}
+
+/*
+ * Synthetic distributions, by the fp32 biased exponent:
+ * - normal: [113, 142], fp16 normal results,
+ * - subnormal: [102, 112] fp16 subnormal results, with one in eight inputs an fp32 subnormal,
+ * - overflow: three in four inputs in [143, 254], the rest normal,
+ * - nan_inf: normal, with one in eight inputs NaN or Inf.
+ */
+static void fill_distribution(struct distribution* d, const char* name, size_t n) {
+	uint32_t state = UINT32_C(0x9E3779B9);
+	snprintf(d->name, sizeof(d->name), "%s", name);
+	d->n = n;
+	d->values = (float*) malloc(n * sizeof(float));
+	for (size_t i = 0; i < n; i++) {
+		uint32_t bits;
+		const uint32_t pick = next_random(&state) & 7;
+		if (strcmp(name, "normal") == 0) {
+			bits = random_bits(&state, 113, 142);
+		} else if (strcmp(name, "subnormal") == 0) {
+			bits = pick == 0 ? next_random(&state) & UINT32_C(0x807FFFFF) : random_bits(&state, 102, 112);
+		} else if (strcmp(name, "overflow") == 0) {
+			bits = pick < 6 ? random_bits(&state, 143, 254) : random_bits(&state, 113, 142);
+		} else {
+			bits = random_bits(&state, 113, 142);
+			if (pick == 0) {
+				/* Half of them Inf, half NaN with a random payload */
+				const uint32_t r = next_random(&state);
+				bits = (r & UINT32_C(0x80000000)) | UINT32_C(0x7F800000) | ((r & 1) ? (r & UINT32_C(0x007FFFFF)) | 1 : 0);
+			}
+		}
+		d->values[i] = fp32_from_bits(bits);
+	}
+}
+
+static int load_distribution(struct distribution* d, const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		return -1;
+	}
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	d->n = size > 0 ? (size_t) size / sizeof(float) : 0;
+	d->values = (float*) malloc(d->n * sizeof(float) + 1);
+	if (d->values == NULL || fread(d->values, sizeof(float), d->n, file) != d->n) {
+		fclose(file);
+		return -1;
+	}
+	fclose(file);
+	const char* base = strrchr(path, '/');
+	snprintf(d->name, sizeof(d->name), "%s", base != NULL ? base + 1 : path);
+	return 0;
+}
+
+/*
+ * Branch miss counter of the calling thread, -1 if not available.
+ */
+static int open_branch_misses(void) {
+#if defined(__linux__)
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+	return -1;
+#endif
+}
+
+static void counter_start(int fd) {
+#if defined(__linux__)
+	if (fd >= 0) {
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#else
+	(void) fd;
+#endif
+}
+
+static long long counter_stop(int fd) {
+	long long count = -1;
+#if defined(__linux__)
+	if (fd >= 0) {
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(fd, &count, sizeof(count)) != (ssize_t) sizeof(count)) {
+			count = -1;
+		}
+	}
+#else
+	(void) fd;
+#endif
+	return count;
+}
+
+/*
+ * Batched loops: one per implementation, with the implementation inlined.
+ */
+#define BATCHED_LOOP(name, convert) \
+	static void batched_##name(const float* src, uint16_t* dst, size_t n) { \
+		const uint32_t* bits = (const uint32_t*) src; \
+		for (size_t i = 0; i < n; i++) { \
+			dst[i] = convert(bits[i]); \
+		} \
+	}
+
+BATCHED_LOOP(fp16_study, fp16_impl_fp16_study)
+BATCHED_LOOP(corsix, corsix_fp16_ieee_from_fp32_value)
+BATCHED_LOOP(fast3, float_to_half_fast3_rtne)
+BATCHED_LOOP(tursa, tursa_floatbits_to_halfbits)
+BATCHED_LOOP(numpy, numpy_floatbits_to_halfbits)
+BATCHED_LOOP(mldev, fp16_impl_mldev)
+BATCHED_LOOP(table_encoder, fp16_impl_table_encoder)
+
+#define BATCHED_DECODE_LOOP(name, convert) \
+	static void batched_decode_##name(const uint16_t* src, float* dst, size_t n) { \
+		uint32_t* bits = (uint32_t*) dst; \
+		for (size_t i = 0; i < n; i++) { \
+			bits[i] = convert(src[i]); \
+		} \
+	}
+
+BATCHED_DECODE_LOOP(fp16_study, fp16_decode_impl_fp16_study)
+BATCHED_DECODE_LOOP(fp16_bits, fp16_ieee_to_fp32_bits)
+BATCHED_DECODE_LOOP(mldev, fp16_decode_impl_mldev)
+BATCHED_DECODE_LOOP(full_table, fp16_decode_impl_full_table)
+BATCHED_DECODE_LOOP(compact_table, fp16_decode_impl_compact_table)
+
+typedef void (*batched_decode_fn)(const uint16_t* src, float* dst, size_t n);
+
+/* In the order of fp16_decode_impl_table */
+static const batched_decode_fn batched_decode_table[FP16_DECODE_IMPL_COUNT] = {
+	batched_decode_fp16_study, batched_decode_fp16_bits, batched_decode_mldev, batched_decode_full_table,
+	batched_decode_compact_table,
+};
+
+static void batched_fp16_study_array(const float* src, uint16_t* dst, size_t n) {
+	fp16_ieee_from_fp32_array(src, dst, n);
+}
+
+typedef void (*batched_fn)(const float* src, uint16_t* dst, size_t n);
+
+/* In the order of fp16_impl_table */
+static const batched_fn batched_table[FP16_IMPL_COUNT] = {
+	batched_fp16_study, batched_corsix, batched_fast3, batched_tursa, batched_numpy, batched_mldev,
+	batched_table_encoder,
+};
+
+/* volatile, so that the scalar loop can not inline the call */
+static void scalar_loop(volatile fp16_impl_fn convert, const float* src, uint16_t* dst, size_t n) {
+	const uint32_t* bits = (const uint32_t*) src;
+	for (size_t i = 0; i < n; i++) {
+		dst[i] = convert(bits[i]);
+	}
+}
+
+static void scalar_decode_loop(volatile fp16_decode_impl_fn convert, const uint16_t* src, float* dst, size_t n) {
+	uint32_t* bits = (uint32_t*) dst;
+	for (size_t i = 0; i < n; i++) {
+		bits[i] = convert(src[i]);
+	}
+}
+
+static void report(const char* impl, const char* mode, const struct distribution* d, int reps, double seconds,
+	long long misses)
+{
+	const double per_call = seconds / reps;
+	const double bytes = (double) d->n * (sizeof(float) + sizeof(uint16_t));
+	char miss_text[32];
+	if (misses >= 0) {
+		snprintf(miss_text, sizeof(miss_text), "%8.4f", (double) misses / reps / (double) d->n);
+	} else {
+		snprintf(miss_text, sizeof(miss_text), "%8s", "n/a");
+	}
+	printf("%-12s %-34s %-8s %8.3f %8.2f %s\n", d->name, impl, mode, per_call * 1e9 / (double) d->n,
+		bytes / per_call * 1e-9, miss_text);
+}
+
+int main(int argc, char** argv) {
+	size_t n = (size_t) 1 << 22;
+	int reps = 10;
+	struct distribution distributions[MAX_DISTRIBUTIONS];
+	size_t count = 0;
+	const char* weight_files[MAX_DISTRIBUTIONS];
+	size_t weight_count = 0;
+
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "-n") == 0 && a + 1 < argc) {
+			n = (size_t) strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-r") == 0 && a + 1 < argc) {
+			reps = atoi(argv[++a]);
+		} else if (strcmp(argv[a], "-w") == 0 && a + 1 < argc && weight_count < MAX_DISTRIBUTIONS - 4) {
+			weight_files[weight_count++] = argv[++a];
+		} else {
+			fprintf(stderr, "usage: %s [-n elements] [-r repetitions] [-w weights.f32]...\n", argv[0]);
+			return 1;
+		}
+	}
+
+	fill_distribution(&distributions[count++], "normal", n);
+	fill_distribution(&distributions[count++], "subnormal", n);
+	fill_distribution(&distributions[count++], "overflow", n);
+	fill_distribution(&distributions[count++], "nan_inf", n);
+	for (size_t w = 0; w < weight_count; w++) {
+		if (load_distribution(&distributions[count], weight_files[w]) != 0) {
+			fprintf(stderr, "can not read %s\n", weight_files[w]);
+			return 1;
+		}
+		count++;
+	}
+
+	fp16_table_init();
+	fp16_encode_table_init();
+	const int misses_fd = open_branch_misses();
+	printf("%-12s %-34s %-8s %8s %8s %8s\n", "input", "implementation", "loop", "ns/elem", "GB/s", "miss/el");
+	for (size_t d = 0; d < count; d++) {
+		const struct distribution* dist = &distributions[d];
+		uint16_t* out = (uint16_t*) malloc(dist->n * sizeof(uint16_t) + 1);
+		for (size_t k = 0; k < FP16_IMPL_COUNT; k++) {
+			double start = now_seconds();
+			counter_start(misses_fd);
+			for (int r = 0; r < reps; r++) {
+				scalar_loop(fp16_impl_table[k].from_fp32_bits, dist->values, out, dist->n);
+			}
+			long long misses = counter_stop(misses_fd);
+			report(fp16_impl_table[k].name, "scalar", dist, reps, now_seconds() - start, misses);
+
+			start = now_seconds();
+			counter_start(misses_fd);
+			for (int r = 0; r < reps; r++) {
+				batched_table[k](dist->values, out, dist->n);
+			}
+			misses = counter_stop(misses_fd);
+			report(fp16_impl_table[k].name, "batched", dist, reps, now_seconds() - start, misses);
+		}
+
+		double start = now_seconds();
+		counter_start(misses_fd);
+		for (int r = 0; r < reps; r++) {
+			batched_fp16_study_array(dist->values, out, dist->n);
+		}
+		long long misses = counter_stop(misses_fd);
+		report("fp16_ieee_from_fp32_array", "array", dist, reps, now_seconds() - start, misses);
+#ifdef FP16_TABLE_X86
+		if (__builtin_cpu_supports("avx2")) {
+			start = now_seconds();
+			for (int r = 0; r < reps; r++) {
+				fp16_ieee_from_fp32_table_avx2(dist->values, out, dist->n);
+			}
+			report("fp16_ieee_from_fp32_table_avx2", "gather", dist, reps, now_seconds() - start, -1);
+		}
+#endif
+
+		/* Decoders, on the fp16 version of the same input */
+		float* back = (float*) malloc(dist->n * sizeof(float) + 1);
+		fp16_ieee_from_fp32_array(dist->values, out, dist->n);
+		for (size_t k = 0; k < FP16_DECODE_IMPL_COUNT; k++) {
+			start = now_seconds();
+			counter_start(misses_fd);
+			for (int r = 0; r < reps; r++) {
+				scalar_decode_loop(fp16_decode_impl_table[k].to_fp32_bits, out, back, dist->n);
+			}
+			misses = counter_stop(misses_fd);
+			report(fp16_decode_impl_table[k].name, "scalar", dist, reps, now_seconds() - start, misses);
+
+			start = now_seconds();
+			counter_start(misses_fd);
+			for (int r = 0; r < reps; r++) {
+				batched_decode_table[k](out, back, dist->n);
+			}
+			misses = counter_stop(misses_fd);
+			report(fp16_decode_impl_table[k].name, "batched", dist, reps, now_seconds() - start, misses);
+		}
+#ifdef FP16_TABLE_X86
+		if (__builtin_cpu_supports("avx2")) {
+			start = now_seconds();
+			for (int r = 0; r < reps; r++) {
+				fp16_ieee_to_fp32_full_table_avx2(out, back, dist->n);
+			}
+			report("fp16_ieee_to_fp32_full_table_avx2", "gather", dist, reps, now_seconds() - start, -1);
+
+			start = now_seconds();
+			for (int r = 0; r < reps; r++) {
+				fp16_ieee_to_fp32_compact_table_avx2(out, back, dist->n);
+			}
+			report("fp16_ieee_to_fp32_compact_table_avx2", "gather", dist, reps, now_seconds() - start, -1);
+		}
+#endif
+		start = now_seconds();
+		for (int r = 0; r < reps; r++) {
+			fp16_ieee_to_fp32_array(out, back, dist->n);
+		}
+		report("fp16_ieee_to_fp32_array", "array", dist, reps, now_seconds() - start, -1);
+		free(back);
+		free(out);
+	}
+
+	for (size_t d = 0; d < count; d++) {
+		free(distributions[d].values);
+	}
+	return 0;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef FP16_INPLACE_H
+#define FP16_INPLACE_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cstddef>
+	#include <cstdint>
+	#include <cstring>
+#else
+	#include <stddef.h>
+	#include <stdint.h>
+	#include <string.h>
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+#include "fp16_array.h"
+
+/*
+ * In-place conversion between a buffer of n fp32 values and the n fp16 values at its start.
+ *
+ * fp32 -> fp16 writes element i to byte 2i and reads it from byte 4i, so going forward never overwrites a value that
+ * has not been read yet. The buffer is converted in chunks that do not overlap their own output: a chunk of L elements
+ * starting at element i reads bytes [4i, 4i + 4L) and writes bytes [2i, 2i + 2L), which are disjoint as long as L <= i.
+ * The first element is converted on its own, then the chunks double in size (1, 1, 2, 4, ...) up to
+ * FP16_INPLACE_CHUNK. Every chunk is an ordinary fp16_ieee_from_fp32_array call, with the SIMD kernels, and the
+ * no-overlap requirement of the array functions holds.
+ *
+ * fp16 -> fp32 is the mirror image: it goes backwards from the end of a buffer of 4n bytes, with chunks of at most half
+ * of the elements that are left.
+ */
+#ifndef FP16_INPLACE_CHUNK
+	#define FP16_INPLACE_CHUNK ((size_t) 65536)
+#endif
+
+/*
+ * Give the whole pages in [begin, end) back to the OS. Their contents are lost: anonymous memory reads as zeros when
+ * it is touched again. Returns where the next release has to start: end rounded down to a page if there was a whole
+ * page to release, else begin, so that the page end falls in is released with the next range.
+ */
+static inline char* fp16_inplace_release(char* begin, char* end) {
+#if (defined(__linux__) || defined(__APPLE__)) && defined(MADV_DONTNEED)
+	const uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+	const uintptr_t first = ((uintptr_t) begin + page - 1) & ~(page - 1);
+	const uintptr_t last = (uintptr_t) end & ~(page - 1);
+	if (first < last) {
+		madvise((void*) first, (size_t) (last - first), MADV_DONTNEED);
+		return begin + (last - (uintptr_t) begin);
+	}
+	return begin;
+#else
+	(void) begin;
+	return end;
+#endif
+}
+
+/*
+ * Convert the n 32-bit floating-point numbers in IEEE single-precision format in buf to 16-bit floating-point numbers
+ * in IEEE half-precision format, in bit representation, stored in the first 2n bytes of buf.
+ *
+ * If release_tail is nonzero, the pages in the second half of the buffer (bytes [2n, 4n)) are returned to the OS with
+ * madvise(MADV_DONTNEED) as soon as their input is converted, so that peak memory falls during the conversion instead
+ * of after it. The second half is then undefined; release it only in private memory (anonymous or the heap), not in a
+ * shared mapping of a file.
+ *
+ * @note The result is bit-identical to fp16_ieee_from_fp32_array from a separate buffer.
+ * @note buf must be 4-byte aligned.
+ */
+static inline void fp16_ieee_from_fp32_inplace(void* buf, size_t n, int release_tail) {
+	if (n == 0) {
+		return;
+	}
+	char* bytes = (char*) buf;
+	float first;
+	memcpy(&first, bytes, sizeof(first));
+	const uint16_t h = fp16_ieee_from_fp32_bits(fp32_to_bits(first));
+	memcpy(bytes, &h, sizeof(h));
+
+	// Bytes [2n, released) have been given back
+	size_t released = 2 * n;
+	size_t i = 1;
+	while (i < n) {
+		size_t chunk = i < FP16_INPLACE_CHUNK ? i : FP16_INPLACE_CHUNK;
+		chunk = chunk < n - i ? chunk : n - i;
+		fp16_ieee_from_fp32_array((const float*) (bytes + 4 * i), (uint16_t*) (bytes + 2 * i), chunk);
+		i += chunk;
+		// Everything below byte 4i has been read
+		if (release_tail && 4 * i >= released + FP16_INPLACE_CHUNK * sizeof(float)) {
+			released = (size_t) (fp16_inplace_release(bytes + released, bytes + 4 * i) - bytes);
+		}
+	}
+	if (release_tail) {
+		fp16_inplace_release(bytes + released, bytes + 4 * n);
+	}
+}
+
+/*
+ * Convert the n 16-bit floating-point numbers in IEEE half-precision format, in bit representation, in the first 2n
+ * bytes of buf to 32-bit floating-point numbers in IEEE single-precision format, filling all 4n bytes of buf.
+ *
+ * @note The result is bit-identical to fp16_ieee_to_fp32_array from a separate buffer.
+ * @note buf must be 4-byte aligned and 4n bytes long.
+ */
+static inline void fp16_ieee_to_fp32_inplace(void* buf, size_t n) {
+	char* bytes = (char*) buf;
+	size_t left = n;
+	while (left > 1) {
+		// Chunk [j, left) reads bytes [2j, 2 left) and writes [4j, 4 left): disjoint if left - j <= j
+		size_t chunk = left / 2;
+		chunk = chunk < FP16_INPLACE_CHUNK ? chunk : FP16_INPLACE_CHUNK;
+		const size_t j = left - chunk;
+		fp16_ieee_to_fp32_array((const uint16_t*) (bytes + 2 * j), (float*) (bytes + 4 * j), chunk);
+		left = j;
+	}
+	if (left == 1) {
+		uint16_t h;
+		memcpy(&h, bytes, sizeof(h));
+		const float f = fp16_ieee_to_fp32_value(h);
+		memcpy(bytes, &f, sizeof(f));
+	}
+}
+
+#endif /* FP16_INPLACE_H */
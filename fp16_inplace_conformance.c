@@ -0,0 +1,136 @@
+/*
+ * Check of the in-place conversions of fp16_inplace.h against the array functions with separate buffers.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_inplace_conformance.c -o fp16_inplace_conformance -lm
+ * Add -DFP16_INPLACE_CHUNK=16 (or another small size) to check many full-size chunks with little memory.
+ *
+ * Usage: ./fp16_inplace_conformance
+ *
+ * For n = 0, 1, 2, 3, odd sizes, FP16_INPLACE_CHUNK and the sizes around it, and several times FP16_INPLACE_CHUNK,
+ * the program fills a buffer of 4n bytes with random fp32 bit patterns (NaN, Inf and subnormals included), converts it
+ * with fp16_ieee_from_fp32_inplace, with and without release_tail, and compares the first 2n bytes with
+ * fp16_ieee_from_fp32_array of a copy. It then expands the result with fp16_ieee_to_fp32_inplace and compares it with
+ * fp16_ieee_to_fp32_array. The buffers are anonymous mappings at a page offset of 0 and of 4 bytes, so that
+ * release_tail really releases pages and does it for both page alignments; with release_tail, the whole pages past
+ * byte 2n must read as zeros afterwards, and no byte before 2n may change. It prints the first mismatches and exits
+ * with 1 if there is any.
+ */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "fp16_inplace.h"
+
+#define MAX_REPORTS 8
+
+static uint64_t mismatches = 0;
+
+static void report(const char* what, size_t n, size_t offset, int release_tail, size_t index, uint32_t actual,
+	uint32_t expected)
+{
+	if (mismatches++ < MAX_REPORTS) {
+		printf("%s, n = %zu, page offset %zu, release_tail %d: element %zu is 0x%08X, expected 0x%08X\n", what, n,
+			offset, release_tail, index, actual, expected);
+	}
+}
+
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static void check(size_t n, size_t offset, int release_tail, uint32_t* state) {
+	const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	const size_t size = (offset + 4 * n + page - 1) / page * page;
+	char* mapping = size == 0 ? NULL : (char*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+		-1, 0);
+	if (mapping == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	char* buf = mapping == NULL ? NULL : mapping + offset;
+	float* src = (float*) malloc(n * sizeof(float) + 1);
+	uint16_t* half = (uint16_t*) malloc(n * sizeof(uint16_t) + 1);
+	float* full = (float*) malloc(n * sizeof(float) + 1);
+	for (size_t i = 0; i < n; i++) {
+		src[i] = fp32_from_bits(next_random(state));
+	}
+	if (n != 0) {
+		memcpy(buf, src, n * sizeof(float));
+	}
+	fp16_ieee_from_fp32_array(src, half, n);
+	fp16_ieee_to_fp32_array(half, full, n);
+
+	fp16_ieee_from_fp32_inplace(buf, n, release_tail);
+	for (size_t i = 0; i < n; i++) {
+		uint16_t h;
+		memcpy(&h, buf + 2 * i, sizeof(h));
+		if (h != half[i]) {
+			report("fp16_ieee_from_fp32_inplace", n, offset, release_tail, i, h, half[i]);
+		}
+	}
+	if (release_tail) {
+		/* The whole pages of [2n, 4n) are released, and read as zeros in an anonymous mapping */
+		const uintptr_t first = ((uintptr_t) (buf + 2 * n) + page - 1) & ~(uintptr_t) (page - 1);
+		const uintptr_t last = (uintptr_t) (buf + 4 * n) & ~(uintptr_t) (page - 1);
+		for (uintptr_t p = first; p < last; p += sizeof(uint32_t)) {
+			uint32_t word;
+			memcpy(&word, (const void*) p, sizeof(word));
+			if (word != 0) {
+				report("released page", n, offset, release_tail, (size_t) (p - (uintptr_t) buf) / 4, word, 0);
+				break;
+			}
+		}
+	}
+
+	fp16_ieee_to_fp32_inplace(buf, n);
+	for (size_t i = 0; i < n; i++) {
+		uint32_t w;
+		memcpy(&w, buf + 4 * i, sizeof(w));
+		if (w != fp32_to_bits(full[i])) {
+			report("fp16_ieee_to_fp32_inplace", n, offset, release_tail, i, w, fp32_to_bits(full[i]));
+		}
+	}
+
+	free(src);
+	free(half);
+	free(full);
+	if (mapping != NULL) {
+		munmap(mapping, size);
+	}
+}
+
+int main(int argc, char** argv) {
+	if (argc != 1) {
+		fprintf(stderr, "usage: %s\n", argv[0]);
+		return 1;
+	}
+	const size_t chunk = FP16_INPLACE_CHUNK;
+	const size_t sizes[] = {
+		0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 1001, 4095, 4097, chunk - 1, chunk, chunk + 1, 2 * chunk - 1, 2 * chunk,
+		2 * chunk + 1, 3 * chunk + 5, 7 * chunk + 1234567 % chunk, (size_t) 1 << 22 | 1,
+	};
+	uint32_t state = 1;
+	size_t runs = 0;
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		for (size_t offset = 0; offset <= 4; offset += 4) {
+			for (int release_tail = 0; release_tail < 2; release_tail++) {
+				check(sizes[s], offset, release_tail, &state);
+				runs++;
+			}
+		}
+	}
+	printf("FP16_INPLACE_CHUNK %zu, %zu runs: %llu mismatches\n", chunk, runs, (unsigned long long) mismatches);
+	return mismatches != 0;
+}
@@ -0,0 +1,352 @@
+/*
+ * Layout-changing conversions of fp16_layout.h against the two ways of doing the same without it: a plain loop that
+ * converts one element at a time while it walks the output, and two passes, a tiled fp32 transpose into a temporary
+ * buffer followed by fp16_ieee_from_fp32_array (or the other way round for fp16 -> fp32).
+ *
+ * First fp16_ieee_from_fp32_strided and fp16_ieee_to_fp32_strided are compared with an element-by-element reference on
+ * random shapes of up to 5 dimensions, with permuted, padded and negative strides, and the NCHWc functions with a
+ * reference that includes the zero padding. The program exits with 1 on a mismatch.
+ *
+ * Then the timing, in ns per element:
+ * - NCHW -> NHWC, fp32 -> fp16, and NHWC -> NCHW, fp16 -> fp32, of a 1 x C x H x W activation,
+ * - NCHW -> NCHWc16, fp32 -> fp16,
+ * - a row-major to column-major transpose of a square matrix, fp32 -> fp16.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_layout_bench.c -o fp16_layout_bench -lm
+ *
+ * Usage: ./fp16_layout_bench [channels] [height and width] [matrix size] [repetitions]
+ *
+ * The defaults are C = 256, H = W = 56 (a ResNet stage, 1.6 MB of fp32) and a 4096 x 4096 matrix (64 MB of fp32).
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fp16_layout.h"
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* xorshift32, only used to fill the inputs */
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static void* checked_malloc(size_t size) {
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	return p;
+}
+
+/* Random strides for shape: the dimensions in a random order, sometimes with a gap, sometimes reversed */
+static ptrdiff_t random_strides(const size_t* shape, size_t dims, ptrdiff_t* strides, ptrdiff_t* base,
+	uint32_t* state)
+{
+	size_t order[FP16_LAYOUT_MAX_DIMS];
+	for (size_t d = 0; d < dims; d++) {
+		order[d] = d;
+	}
+	if (next_random(state) % 3 != 0) {
+		for (size_t d = dims; d > 1; d--) {
+			const size_t j = next_random(state) % d;
+			const size_t t = order[d - 1];
+			order[d - 1] = order[j];
+			order[j] = t;
+		}
+	}
+	ptrdiff_t stride = next_random(state) % 5 == 0 ? 2 : 1;
+	for (size_t k = dims; k-- > 0;) {
+		strides[order[k]] = stride;
+		stride *= (ptrdiff_t) shape[order[k]] + (next_random(state) % 6 == 0);
+	}
+	// Reverse one dimension: the first element is then at the end of it
+	*base = 0;
+	if (next_random(state) % 4 == 0) {
+		const size_t d = next_random(state) % dims;
+		*base = strides[d] * ((ptrdiff_t) shape[d] - 1);
+		strides[d] = -strides[d];
+	}
+	return stride;
+}
+
+static int check_strided(void) {
+	uint32_t state = 1;
+	int errors = 0;
+	for (int t = 0; t < 5000; t++) {
+		const size_t dims = 1 + next_random(&state) % 5;
+		size_t shape[FP16_LAYOUT_MAX_DIMS];
+		size_t total = 1;
+		for (size_t d = 0; d < dims; d++) {
+			shape[d] = next_random(&state) % 4 == 0 ? 1 : 1 + next_random(&state) % (t % 3 == 0 ? 40 : 9);
+			total *= shape[d];
+		}
+		if (total > 100000) {
+			continue;
+		}
+		ptrdiff_t src_strides[FP16_LAYOUT_MAX_DIMS], dst_strides[FP16_LAYOUT_MAX_DIMS];
+		ptrdiff_t src_base, dst_base;
+		const size_t src_size = (size_t) random_strides(shape, dims, src_strides, &src_base, &state);
+		const size_t dst_size = (size_t) random_strides(shape, dims, dst_strides, &dst_base, &state);
+
+		float* x = checked_malloc(src_size * sizeof(float));
+		uint16_t* h = checked_malloc(src_size * sizeof(uint16_t));
+		uint16_t* h_out = checked_malloc(dst_size * sizeof(uint16_t));
+		uint16_t* h_ref = checked_malloc(dst_size * sizeof(uint16_t));
+		float* x_out = checked_malloc(dst_size * sizeof(float));
+		float* x_ref = checked_malloc(dst_size * sizeof(float));
+		for (size_t i = 0; i < src_size; i++) {
+			x[i] = fp32_from_bits(next_random(&state));
+			h[i] = (uint16_t) next_random(&state);
+		}
+		memset(h_out, 0xA5, dst_size * sizeof(uint16_t));
+		memset(h_ref, 0xA5, dst_size * sizeof(uint16_t));
+		memset(x_out, 0xA5, dst_size * sizeof(float));
+		memset(x_ref, 0xA5, dst_size * sizeof(float));
+
+		fp16_ieee_from_fp32_strided(x + src_base, src_strides, h_out + dst_base, dst_strides, shape, dims);
+		fp16_ieee_to_fp32_strided(h + src_base, src_strides, x_out + dst_base, dst_strides, shape, dims);
+		size_t index[FP16_LAYOUT_MAX_DIMS] = { 0 };
+		for (size_t i = 0; i < total; i++) {
+			ptrdiff_t s = src_base, d = dst_base;
+			for (size_t k = 0; k < dims; k++) {
+				s += (ptrdiff_t) index[k] * src_strides[k];
+				d += (ptrdiff_t) index[k] * dst_strides[k];
+			}
+			h_ref[d] = fp16_ieee_from_fp32_value(x[s]);
+			x_ref[d] = fp16_ieee_to_fp32_value(h[s]);
+			for (size_t k = dims; k-- > 0;) {
+				if (++index[k] < shape[k]) {
+					break;
+				}
+				index[k] = 0;
+			}
+		}
+		if (memcmp(h_out, h_ref, dst_size * sizeof(uint16_t)) != 0 ||
+			memcmp(x_out, x_ref, dst_size * sizeof(float)) != 0)
+		{
+			if (errors++ < 4) {
+				printf("mismatch, shape / src stride / dst stride:");
+				for (size_t d = 0; d < dims; d++) {
+					printf(" %zu/%td/%td", shape[d], src_strides[d], dst_strides[d]);
+				}
+				printf("\n");
+			}
+		}
+		free(x);
+		free(h);
+		free(h_out);
+		free(h_ref);
+		free(x_out);
+		free(x_ref);
+	}
+	return errors;
+}
+
+static int check_nchwc(void) {
+	uint32_t state = 2;
+	int errors = 0;
+	for (int t = 0; t < 500; t++) {
+		const size_t n = 1 + next_random(&state) % 3;
+		const size_t c = 1 + next_random(&state) % 40;
+		const size_t hw = 1 + next_random(&state) % 80;
+		const size_t block = next_random(&state) % 2 == 0 ? 8 : 16;
+		const size_t groups = (c + block - 1) / block;
+		float* x = checked_malloc(n * c * hw * sizeof(float));
+		float* x_out = checked_malloc(n * c * hw * sizeof(float));
+		uint16_t* h = checked_malloc(n * groups * hw * block * sizeof(uint16_t));
+		uint16_t* h_ref = checked_malloc(n * groups * hw * block * sizeof(uint16_t));
+		for (size_t i = 0; i < n * c * hw; i++) {
+			x[i] = fp32_from_bits(next_random(&state));
+		}
+		memset(h, 0xA5, n * groups * hw * block * sizeof(uint16_t));
+		memset(h_ref, 0, n * groups * hw * block * sizeof(uint16_t));
+		for (size_t i = 0; i < n; i++) {
+			for (size_t k = 0; k < c; k++) {
+				for (size_t p = 0; p < hw; p++) {
+					h_ref[((i * groups + k / block) * hw + p) * block + k % block] =
+						fp16_ieee_from_fp32_value(x[(i * c + k) * hw + p]);
+				}
+			}
+		}
+		fp16_ieee_from_fp32_nchw_to_nchwc(x, h, n, c, hw, 1, block);
+		fp16_ieee_to_fp32_nchwc_to_nchw(h_ref, x_out, n, c, 1, hw, block);
+		int wrong = memcmp(h, h_ref, n * groups * hw * block * sizeof(uint16_t)) != 0;
+		for (size_t i = 0; i < n; i++) {
+			for (size_t k = 0; k < c; k++) {
+				for (size_t p = 0; p < hw; p++) {
+					const size_t blocked = ((i * groups + k / block) * hw + p) * block + k % block;
+					const float expected = fp16_ieee_to_fp32_value(h_ref[blocked]);
+					wrong |= fp32_to_bits(x_out[(i * c + k) * hw + p]) != fp32_to_bits(expected);
+				}
+			}
+		}
+		if (wrong && errors++ < 4) {
+			printf("NCHWc mismatch: n %zu c %zu hw %zu block %zu\n", n, c, hw, block);
+		}
+		free(x);
+		free(x_out);
+		free(h);
+		free(h_ref);
+	}
+	return errors;
+}
+
+/* dst[c * rows + r] = src[r * cols + c], FP16_LAYOUT_TILE x FP16_LAYOUT_TILE tiles of fp32 */
+#if defined(__GNUC__)
+__attribute__((__noinline__))
+#endif
+static void transpose_fp32(const float* src, float* dst, size_t rows, size_t cols) {
+	for (size_t r0 = 0; r0 < rows; r0 += FP16_LAYOUT_TILE) {
+		const size_t r1 = rows - r0 < FP16_LAYOUT_TILE ? rows : r0 + FP16_LAYOUT_TILE;
+		for (size_t c0 = 0; c0 < cols; c0 += FP16_LAYOUT_TILE) {
+			const size_t c1 = cols - c0 < FP16_LAYOUT_TILE ? cols : c0 + FP16_LAYOUT_TILE;
+			for (size_t r = r0; r < r1; r++) {
+				for (size_t c = c0; c < c1; c++) {
+					dst[c * rows + r] = src[r * cols + c];
+				}
+			}
+		}
+	}
+}
+
+#if defined(__GNUC__)
+__attribute__((__noinline__))
+#endif
+static void transpose_naive_from_fp32(const float* src, uint16_t* dst, size_t rows, size_t cols) {
+	for (size_t c = 0; c < cols; c++) {
+		for (size_t r = 0; r < rows; r++) {
+			dst[c * rows + r] = fp16_ieee_from_fp32_value(src[r * cols + c]);
+		}
+	}
+}
+
+#if defined(__GNUC__)
+__attribute__((__noinline__))
+#endif
+static void transpose_naive_to_fp32(const uint16_t* src, float* dst, size_t rows, size_t cols) {
+	for (size_t c = 0; c < cols; c++) {
+		for (size_t r = 0; r < rows; r++) {
+			dst[c * rows + r] = fp16_ieee_to_fp32_value(src[r * cols + c]);
+		}
+	}
+}
+
+#if defined(__GNUC__)
+__attribute__((__noinline__))
+#endif
+static void nchwc_naive(const float* src, uint16_t* dst, size_t c, size_t hw, size_t block) {
+	const size_t groups = (c + block - 1) / block;
+	for (size_t g = 0; g < groups; g++) {
+		for (size_t p = 0; p < hw; p++) {
+			for (size_t k = 0; k < block; k++) {
+				const size_t channel = g * block + k;
+				dst[(g * hw + p) * block + k] = channel < c ? fp16_ieee_from_fp32_value(src[channel * hw + p]) : 0;
+			}
+		}
+	}
+}
+
+static void report(const char* test, const char* name, size_t n, size_t repetitions, double seconds) {
+	const double elements = (double) n * (double) repetitions;
+	printf("%-30s %-10s %8.3f ns/element\n", test, name, seconds * 1e9 / elements);
+}
+
+/* The three ways of an fp32 -> fp16 transpose of a rows x cols matrix */
+static void bench_from_fp32(const char* test, const float* x, float* tmp, uint16_t* h, size_t rows, size_t cols,
+	size_t repetitions)
+{
+	double start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		transpose_naive_from_fp32(x, h, rows, cols);
+	}
+	report(test, "naive", rows * cols, repetitions, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		transpose_fp32(x, tmp, rows, cols);
+		fp16_ieee_from_fp32_array(tmp, h, rows * cols);
+	}
+	report(test, "two-pass", rows * cols, repetitions, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ieee_from_fp32_transpose(x, (ptrdiff_t) cols, h, (ptrdiff_t) rows, rows, cols);
+	}
+	report(test, "fused", rows * cols, repetitions, now_seconds() - start);
+}
+
+int main(int argc, char** argv) {
+	const size_t c = argc > 1 ? (size_t) strtoull(argv[1], NULL, 0) : 256;
+	const size_t hw = argc > 2 ? (size_t) strtoull(argv[2], NULL, 0) : 56;
+	const size_t m = argc > 3 ? (size_t) strtoull(argv[3], NULL, 0) : 4096;
+	const size_t repetitions = argc > 4 ? (size_t) strtoull(argv[4], NULL, 0) : 20;
+
+	const int strided_errors = check_strided();
+	const int nchwc_errors = check_nchwc();
+	printf("strided: %s, NCHWc: %s\n\n", strided_errors == 0 ? "ok" : "FAILED", nchwc_errors == 0 ? "ok" : "FAILED");
+
+	const size_t pixels = hw * hw;
+	const size_t n = (c * pixels > m * m ? c * pixels : m * m) + 16 * pixels;
+	float* x = checked_malloc(n * sizeof(float));
+	float* tmp = checked_malloc(n * sizeof(float));
+	uint16_t* h = checked_malloc(n * sizeof(uint16_t));
+	uint32_t state = 1;
+	for (size_t i = 0; i < n; i++) {
+		x[i] = (float) ((int32_t) next_random(&state) >> 8) * 0x1.0p-16f;
+	}
+
+	char test[64];
+	snprintf(test, sizeof(test), "NCHW->NHWC %zux%zux%zu", c, hw, hw);
+	bench_from_fp32(test, x, tmp, h, c, pixels, repetitions * 10);
+
+	snprintf(test, sizeof(test), "NHWC->NCHW %zux%zux%zu to fp32", c, hw, hw);
+	fp16_ieee_from_fp32_array(x, h, c * pixels);
+	double start = now_seconds();
+	for (size_t r = 0; r < repetitions * 10; r++) {
+		transpose_naive_to_fp32(h, x, pixels, c);
+	}
+	report(test, "naive", c * pixels, repetitions * 10, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions * 10; r++) {
+		fp16_ieee_to_fp32_array(h, tmp, c * pixels);
+		transpose_fp32(tmp, x, pixels, c);
+	}
+	report(test, "two-pass", c * pixels, repetitions * 10, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions * 10; r++) {
+		fp16_ieee_to_fp32_nhwc_to_nchw(h, x, 1, c, hw, hw);
+	}
+	report(test, "fused", c * pixels, repetitions * 10, now_seconds() - start);
+
+	snprintf(test, sizeof(test), "NCHW->NCHWc16 %zux%zux%zu", c, hw, hw);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions * 10; r++) {
+		nchwc_naive(x, h, c, pixels, 16);
+	}
+	report(test, "naive", c * pixels, repetitions * 10, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions * 10; r++) {
+		fp16_ieee_from_fp32_nchw_to_nchwc(x, h, 1, c, hw, hw, 16);
+	}
+	report(test, "fused", c * pixels, repetitions * 10, now_seconds() - start);
+
+	snprintf(test, sizeof(test), "transpose %zux%zu", m, m);
+	bench_from_fp32(test, x, tmp, h, m, m, repetitions);
+
+	free(x);
+	free(tmp);
+	free(h);
+	return strided_errors != 0 || nchwc_errors != 0;
+}
@@ -0,0 +1,517 @@
+#pragma once
+#ifndef FP16_ML_IO_H
+#define FP16_ML_IO_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cerrno>
+	#include <cstddef>
+	#include <cstdint>
+#else
+	#include <errno.h>
+	#include <stddef.h>
+	#include <stdint.h>
+#endif
+
+#include "fp16_array.h"
+
+/*
+ * Burst conversions for ML device input and output, in the style of the DPDK mldev utilities that
+ * mldev_utils_scalar.c comes from: fp32 to and from int8, uint8, int16, uint16 (quantization) and IEEE half precision.
+ *
+ * | function                                                                  | per element                         |
+ * |---------------------------------------------------------------------------|-------------------------------------|
+ * | fp16_ml_io_float32_to_<type>(scale, zero_point, nb_elements, in, out)     | clamp(round(x * scale) + zero_point)|
+ * | fp16_ml_io_<type>_to_float32(scale, zero_point, nb_elements, in, out)     | scale * (q - zero_point)            |
+ * | fp16_ml_io_float32_to_float16(nb_elements, in, out)                       | fp16_ieee_from_fp32_value           |
+ * | fp16_ml_io_float16_to_float32(nb_elements, in, out)                       | fp16_ieee_to_fp32_value             |
+ *
+ * As in DPDK, the quantization multiplies by scale (the reciprocal of the step), the dequantization multiplies by
+ * scale (the step), and the functions return 0, or -EINVAL if scale is 0, nb_elements is 0 or a pointer is NULL.
+ *
+ * Rounding is to nearest with ties to even, whatever the current rounding mode (DPDK uses round(), ties away from
+ * zero). Values out of range saturate to the minimum / maximum of the type, Inf included, and NaN quantizes like 0, to
+ * zero_point. The clamp happens before the rounding, on integer bounds, which gives the same result as clamping
+ * after it. The float16 pair is fp16_ieee_from_fp32_array / fp16_ieee_to_fp32_array: unlike
+ * __float32_to_float16_scalar_rtn, NaNs become the canonical 0x7E00 / 0xFE00.
+ *
+ * | kernel | ISA         | quantize                                           | dequantize                       |
+ * |--------|-------------|----------------------------------------------------|----------------------------------|
+ * | scalar | any         | integer round to even                              | int -> float, multiply           |
+ * | avx2   | AVX2        | vroundps + vcvttps2dq, vpack(u)s + vpermd, 32 lanes| vpmovsx/zx + vcvtdq2ps, 32 lanes |
+ * | neon   | AArch64     | FCVTNS, SQXTN / SQXTUN, 16 lanes                   | SXTL / UXTL + SCVTF, 16 lanes    |
+ *
+ * Every kernel gives the same bits; fp16_ml_io_bench.c checks that, and times each type.
+ */
+enum fp16_ml_io_type {
+	FP16_ML_IO_INT8,
+	FP16_ML_IO_UINT8,
+	FP16_ML_IO_INT16,
+	FP16_ML_IO_UINT16,
+	FP16_ML_IO_TYPE_COUNT
+};
+
+typedef void (*fp16_ml_io_quantize_kernel)(const float* input, void* output, size_t n, float scale,
+	int32_t zero_point);
+typedef void (*fp16_ml_io_dequantize_kernel)(const void* input, float* output, size_t n, float scale,
+	int32_t zero_point);
+
+struct fp16_ml_io_kernel {
+	const char* name;
+	int (*supported)(void);
+	fp16_ml_io_quantize_kernel quantize[FP16_ML_IO_TYPE_COUNT];
+	fp16_ml_io_dequantize_kernel dequantize[FP16_ML_IO_TYPE_COUNT];
+};
+
+/*
+ * Round to nearest, ties to even, independent of the rounding mode: the truncation and the difference are exact for
+ * |x| < 2^31.
+ */
+static inline int32_t fp16_ml_io_round_even(float x) {
+	const int32_t t = (int32_t) x;
+	const float d = x - (float) t;
+	const int32_t odd = t & 1;
+	return t + (d > 0.5f) - (d < -0.5f) + ((d == 0.5f) & odd) - ((d == -0.5f) & odd);
+}
+
+/* round(x * scale) + zero_point, clamped to [min, max]; lo = min - zero_point, hi = max - zero_point */
+static inline int32_t fp16_ml_io_quantize_value(float x, float scale, float lo, float hi, int32_t zero_point) {
+	float v = x * scale;
+	v = v == v ? v : 0.0f;
+	v = v > lo ? v : lo;
+	v = v < hi ? v : hi;
+	return fp16_ml_io_round_even(v) + zero_point;
+}
+
+#define FP16_ML_IO_SCALAR_KERNELS(type, ctype, min, max) \
+	static inline void fp16_ml_io_quantize_##type##_scalar(const float* input, void* output, size_t n, float scale, \
+		int32_t zero_point) \
+	{ \
+		ctype* out = (ctype*) output; \
+		const float lo = (float) ((min) - zero_point); \
+		const float hi = (float) ((max) - zero_point); \
+		for (size_t i = 0; i < n; i++) { \
+			out[i] = (ctype) fp16_ml_io_quantize_value(input[i], scale, lo, hi, zero_point); \
+		} \
+	} \
+	\
+	static inline void fp16_ml_io_dequantize_##type##_scalar(const void* input, float* output, size_t n, float scale, \
+		int32_t zero_point) \
+	{ \
+		const ctype* in = (const ctype*) input; \
+		for (size_t i = 0; i < n; i++) { \
+			output[i] = scale * (float) ((int32_t) in[i] - zero_point); \
+		} \
+	}
+
+FP16_ML_IO_SCALAR_KERNELS(int8, int8_t, INT8_MIN, INT8_MAX)
+FP16_ML_IO_SCALAR_KERNELS(uint8, uint8_t, 0, UINT8_MAX)
+FP16_ML_IO_SCALAR_KERNELS(int16, int16_t, INT16_MIN, INT16_MAX)
+FP16_ML_IO_SCALAR_KERNELS(uint16, uint16_t, 0, UINT16_MAX)
+
+#undef FP16_ML_IO_SCALAR_KERNELS
+
+static inline int fp16_ml_io_has_scalar(void) {
+	return 1;
+}
+
+#ifdef FP16_ARRAY_X86
+/* 8 quantized values in 32-bit lanes, before the narrowing */
+FP16_X86_TARGET("avx2")
+static inline __m256i fp16_ml_io_quantize_x8_avx2(const float* p, __m256 scale, __m256 lo, __m256 hi,
+	__m256i zero_point)
+{
+	__m256 v = _mm256_mul_ps(_mm256_loadu_ps(p), scale);
+	v = _mm256_and_ps(v, _mm256_cmp_ps(v, v, _CMP_ORD_Q));
+	v = _mm256_min_ps(_mm256_max_ps(v, lo), hi);
+	v = _mm256_round_ps(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	return _mm256_add_epi32(_mm256_cvttps_epi32(v), zero_point);
+}
+
+/*
+ * The packs work within 128-bit halves. The 8-bit results of q0..q3 come out as the dwords q0 lo, q1 lo, q2 lo, q3 lo,
+ * q0 hi, q1 hi, q2 hi, q3 hi, and the 16-bit results of q0, q1 as the qwords q0 lo, q1 lo, q0 hi, q1 hi; vpermd with
+ * 0, 4, 1, 5, 2, 6, 3, 7 and vpermq with 0, 2, 1, 3 put them back in order.
+ */
+#define FP16_ML_IO_AVX2_QUANTIZE8(type, ctype, min, max, pack8) \
+	FP16_X86_TARGET("avx2") \
+	static inline void fp16_ml_io_quantize_##type##_avx2(const float* input, void* output, size_t n, float scale, \
+		int32_t zero_point) \
+	{ \
+		ctype* out = (ctype*) output; \
+		const __m256 scale_v = _mm256_set1_ps(scale); \
+		const __m256 lo = _mm256_set1_ps((float) ((min) - zero_point)); \
+		const __m256 hi = _mm256_set1_ps((float) ((max) - zero_point)); \
+		const __m256i zero_point_v = _mm256_set1_epi32(zero_point); \
+		const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7); \
+		size_t i = 0; \
+		for (; n - i >= 32; i += 32) { \
+			const __m256i q0 = fp16_ml_io_quantize_x8_avx2(input + i, scale_v, lo, hi, zero_point_v); \
+			const __m256i q1 = fp16_ml_io_quantize_x8_avx2(input + i + 8, scale_v, lo, hi, zero_point_v); \
+			const __m256i q2 = fp16_ml_io_quantize_x8_avx2(input + i + 16, scale_v, lo, hi, zero_point_v); \
+			const __m256i q3 = fp16_ml_io_quantize_x8_avx2(input + i + 24, scale_v, lo, hi, zero_point_v); \
+			const __m256i q = pack8(_mm256_packs_epi32(q0, q1), _mm256_packs_epi32(q2, q3)); \
+			_mm256_storeu_si256((__m256i*) (out + i), _mm256_permutevar8x32_epi32(q, order)); \
+		} \
+		fp16_ml_io_quantize_##type##_scalar(input + i, out + i, n - i, scale, zero_point); \
+	}
+
+#define FP16_ML_IO_AVX2_QUANTIZE16(type, ctype, min, max, pack16) \
+	FP16_X86_TARGET("avx2") \
+	static inline void fp16_ml_io_quantize_##type##_avx2(const float* input, void* output, size_t n, float scale, \
+		int32_t zero_point) \
+	{ \
+		ctype* out = (ctype*) output; \
+		const __m256 scale_v = _mm256_set1_ps(scale); \
+		const __m256 lo = _mm256_set1_ps((float) ((min) - zero_point)); \
+		const __m256 hi = _mm256_set1_ps((float) ((max) - zero_point)); \
+		const __m256i zero_point_v = _mm256_set1_epi32(zero_point); \
+		size_t i = 0; \
+		for (; n - i >= 32; i += 32) { \
+			const __m256i q0 = fp16_ml_io_quantize_x8_avx2(input + i, scale_v, lo, hi, zero_point_v); \
+			const __m256i q1 = fp16_ml_io_quantize_x8_avx2(input + i + 8, scale_v, lo, hi, zero_point_v); \
+			const __m256i q2 = fp16_ml_io_quantize_x8_avx2(input + i + 16, scale_v, lo, hi, zero_point_v); \
+			const __m256i q3 = fp16_ml_io_quantize_x8_avx2(input + i + 24, scale_v, lo, hi, zero_point_v); \
+			_mm256_storeu_si256((__m256i*) (out + i), _mm256_permute4x64_epi64(pack16(q0, q1), 0xD8)); \
+			_mm256_storeu_si256((__m256i*) (out + i + 16), _mm256_permute4x64_epi64(pack16(q2, q3), 0xD8)); \
+		} \
+		fp16_ml_io_quantize_##type##_scalar(input + i, out + i, n - i, scale, zero_point); \
+	}
+
+/* The values are clamped already, so the saturating packs never saturate */
+FP16_ML_IO_AVX2_QUANTIZE8(int8, int8_t, INT8_MIN, INT8_MAX, _mm256_packs_epi16)
+FP16_ML_IO_AVX2_QUANTIZE8(uint8, uint8_t, 0, UINT8_MAX, _mm256_packus_epi16)
+FP16_ML_IO_AVX2_QUANTIZE16(int16, int16_t, INT16_MIN, INT16_MAX, _mm256_packs_epi32)
+FP16_ML_IO_AVX2_QUANTIZE16(uint16, uint16_t, 0, UINT16_MAX, _mm256_packus_epi32)
+
+#undef FP16_ML_IO_AVX2_QUANTIZE8
+#undef FP16_ML_IO_AVX2_QUANTIZE16
+
+/* widen loads 8 values of ctype (8 or 16 bytes) into 32-bit lanes */
+#define FP16_ML_IO_AVX2_DEQUANTIZE(type, ctype, load8, widen) \
+	FP16_X86_TARGET("avx2") \
+	static inline void fp16_ml_io_dequantize_##type##_avx2(const void* input, float* output, size_t n, float scale, \
+		int32_t zero_point) \
+	{ \
+		const ctype* in = (const ctype*) input; \
+		const __m256 scale_v = _mm256_set1_ps(scale); \
+		const __m256i zero_point_v = _mm256_set1_epi32(zero_point); \
+		size_t i = 0; \
+		for (; n - i >= 32; i += 32) { \
+			for (size_t j = 0; j < 32; j += 8) { \
+				const __m256i q = _mm256_sub_epi32(widen(load8((const __m128i*) (in + i + j))), zero_point_v); \
+				_mm256_storeu_ps(output + i + j, _mm256_mul_ps(scale_v, _mm256_cvtepi32_ps(q))); \
+			} \
+		} \
+		fp16_ml_io_dequantize_##type##_scalar(in + i, output + i, n - i, scale, zero_point); \
+	}
+
+FP16_ML_IO_AVX2_DEQUANTIZE(int8, int8_t, _mm_loadl_epi64, _mm256_cvtepi8_epi32)
+FP16_ML_IO_AVX2_DEQUANTIZE(uint8, uint8_t, _mm_loadl_epi64, _mm256_cvtepu8_epi32)
+FP16_ML_IO_AVX2_DEQUANTIZE(int16, int16_t, _mm_loadu_si128, _mm256_cvtepi16_epi32)
+FP16_ML_IO_AVX2_DEQUANTIZE(uint16, uint16_t, _mm_loadu_si128, _mm256_cvtepu16_epi32)
+
+#undef FP16_ML_IO_AVX2_DEQUANTIZE
+
+static inline int fp16_ml_io_has_avx2(void) {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#ifdef FP16_ARRAY_ARM
+/* 4 quantized values in 32-bit lanes, before the narrowing; FCVTNS rounds to nearest even regardless of FPCR */
+static inline int32x4_t fp16_ml_io_quantize_x4_neon(const float* p, float scale, float32x4_t lo, float32x4_t hi,
+	int32x4_t zero_point)
+{
+	float32x4_t v = vmulq_n_f32(vld1q_f32(p), scale);
+	v = vbslq_f32(vceqq_f32(v, v), v, vdupq_n_f32(0.0f));
+	v = vminq_f32(vmaxq_f32(v, lo), hi);
+	return vaddq_s32(vcvtnq_s32_f32(v), zero_point);
+}
+
+#define FP16_ML_IO_NEON_QUANTIZE_SETUP(min, max) \
+	const float32x4_t lo = vdupq_n_f32((float) ((min) - zero_point)); \
+	const float32x4_t hi = vdupq_n_f32((float) ((max) - zero_point)); \
+	const int32x4_t zero_point_v = vdupq_n_s32(zero_point); \
+	int32x4_t q[4]; \
+	size_t i = 0;
+
+#define FP16_ML_IO_NEON_QUANTIZE_LOAD() \
+	for (int k = 0; k < 4; k++) { \
+		q[k] = fp16_ml_io_quantize_x4_neon(input + i + 4 * k, scale, lo, hi, zero_point_v); \
+	}
+
+static inline void fp16_ml_io_quantize_int8_neon(const float* input, void* output, size_t n, float scale,
+	int32_t zero_point)
+{
+	int8_t* out = (int8_t*) output;
+	FP16_ML_IO_NEON_QUANTIZE_SETUP(INT8_MIN, INT8_MAX)
+	for (; n - i >= 16; i += 16) {
+		FP16_ML_IO_NEON_QUANTIZE_LOAD()
+		const int16x8_t q01 = vcombine_s16(vqmovn_s32(q[0]), vqmovn_s32(q[1]));
+		const int16x8_t q23 = vcombine_s16(vqmovn_s32(q[2]), vqmovn_s32(q[3]));
+		vst1q_s8(out + i, vcombine_s8(vqmovn_s16(q01), vqmovn_s16(q23)));
+	}
+	fp16_ml_io_quantize_int8_scalar(input + i, out + i, n - i, scale, zero_point);
+}
+
+static inline void fp16_ml_io_quantize_uint8_neon(const float* input, void* output, size_t n, float scale,
+	int32_t zero_point)
+{
+	uint8_t* out = (uint8_t*) output;
+	FP16_ML_IO_NEON_QUANTIZE_SETUP(0, UINT8_MAX)
+	for (; n - i >= 16; i += 16) {
+		FP16_ML_IO_NEON_QUANTIZE_LOAD()
+		const uint16x8_t q01 = vcombine_u16(vqmovun_s32(q[0]), vqmovun_s32(q[1]));
+		const uint16x8_t q23 = vcombine_u16(vqmovun_s32(q[2]), vqmovun_s32(q[3]));
+		vst1q_u8(out + i, vcombine_u8(vqmovn_u16(q01), vqmovn_u16(q23)));
+	}
+	fp16_ml_io_quantize_uint8_scalar(input + i, out + i, n - i, scale, zero_point);
+}
+
+static inline void fp16_ml_io_quantize_int16_neon(const float* input, void* output, size_t n, float scale,
+	int32_t zero_point)
+{
+	int16_t* out = (int16_t*) output;
+	FP16_ML_IO_NEON_QUANTIZE_SETUP(INT16_MIN, INT16_MAX)
+	for (; n - i >= 16; i += 16) {
+		FP16_ML_IO_NEON_QUANTIZE_LOAD()
+		vst1q_s16(out + i, vcombine_s16(vqmovn_s32(q[0]), vqmovn_s32(q[1])));
+		vst1q_s16(out + i + 8, vcombine_s16(vqmovn_s32(q[2]), vqmovn_s32(q[3])));
+	}
+	fp16_ml_io_quantize_int16_scalar(input + i, out + i, n - i, scale, zero_point);
+}
+
+static inline void fp16_ml_io_quantize_uint16_neon(const float* input, void* output, size_t n, float scale,
+	int32_t zero_point)
+{
+	uint16_t* out = (uint16_t*) output;
+	FP16_ML_IO_NEON_QUANTIZE_SETUP(0, UINT16_MAX)
+	for (; n - i >= 16; i += 16) {
+		FP16_ML_IO_NEON_QUANTIZE_LOAD()
+		vst1q_u16(out + i, vcombine_u16(vqmovun_s32(q[0]), vqmovun_s32(q[1])));
+		vst1q_u16(out + i + 8, vcombine_u16(vqmovun_s32(q[2]), vqmovun_s32(q[3])));
+	}
+	fp16_ml_io_quantize_uint16_scalar(input + i, out + i, n - i, scale, zero_point);
+}
+
+#undef FP16_ML_IO_NEON_QUANTIZE_SETUP
+#undef FP16_ML_IO_NEON_QUANTIZE_LOAD
+
+/* scale * (q - zero_point) for 4 values in 32-bit lanes */
+static inline void fp16_ml_io_dequantize_x4_neon(float* p, int32x4_t q, float scale, int32x4_t zero_point) {
+	vst1q_f32(p, vmulq_n_f32(vcvtq_f32_s32(vsubq_s32(q, zero_point)), scale));
+}
+
+static inline void fp16_ml_io_dequantize_int8_neon(const void* input, float* output, size_t n, float scale,
+	int32_t zero_point)
+{
+	const int8_t* in = (const int8_t*) input;
+	const int32x4_t zero_point_v = vdupq_n_s32(zero_point);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const int8x16_t q = vld1q_s8(in + i);
+		const int16x8_t q_lo = vmovl_s8(vget_low_s8(q));
+		const int16x8_t q_hi = vmovl_s8(vget_high_s8(q));
+		fp16_ml_io_dequantize_x4_neon(output + i, vmovl_s16(vget_low_s16(q_lo)), scale, zero_point_v);
+		fp16_ml_io_dequantize_x4_neon(output + i + 4, vmovl_s16(vget_high_s16(q_lo)), scale, zero_point_v);
+		fp16_ml_io_dequantize_x4_neon(output + i + 8, vmovl_s16(vget_low_s16(q_hi)), scale, zero_point_v);
+		fp16_ml_io_dequantize_x4_neon(output + i + 12, vmovl_s16(vget_high_s16(q_hi)), scale, zero_point_v);
+	}
+	fp16_ml_io_dequantize_int8_scalar(in + i, output + i, n - i, scale, zero_point);
+}
+
+static inline void fp16_ml_io_dequantize_uint8_neon(const void* input, float* output, size_t n, float scale,
+	int32_t zero_point)
+{
+	const uint8_t* in = (const uint8_t*) input;
+	const int32x4_t zero_point_v = vdupq_n_s32(zero_point);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const uint8x16_t q = vld1q_u8(in + i);
+		const uint16x8_t q_lo = vmovl_u8(vget_low_u8(q));
+		const uint16x8_t q_hi = vmovl_u8(vget_high_u8(q));
+		fp16_ml_io_dequantize_x4_neon(output + i, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(q_lo))),
+			scale, zero_point_v);
+		fp16_ml_io_dequantize_x4_neon(output + i + 4, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(q_lo))),
+			scale, zero_point_v);
+		fp16_ml_io_dequantize_x4_neon(output + i + 8, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(q_hi))),
+			scale, zero_point_v);
+		fp16_ml_io_dequantize_x4_neon(output + i + 12, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(q_hi))),
+			scale, zero_point_v);
+	}
+	fp16_ml_io_dequantize_uint8_scalar(in + i, output + i, n - i, scale, zero_point);
+}
+
+static inline void fp16_ml_io_dequantize_int16_neon(const void* input, float* output, size_t n, float scale,
+	int32_t zero_point)
+{
+	const int16_t* in = (const int16_t*) input;
+	const int32x4_t zero_point_v = vdupq_n_s32(zero_point);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const int16x8_t q = vld1q_s16(in + i);
+		fp16_ml_io_dequantize_x4_neon(output + i, vmovl_s16(vget_low_s16(q)), scale, zero_point_v);
+		fp16_ml_io_dequantize_x4_neon(output + i + 4, vmovl_s16(vget_high_s16(q)), scale, zero_point_v);
+	}
+	fp16_ml_io_dequantize_int16_scalar(in + i, output + i, n - i, scale, zero_point);
+}
+
+static inline void fp16_ml_io_dequantize_uint16_neon(const void* input, float* output, size_t n, float scale,
+	int32_t zero_point)
+{
+	const uint16_t* in = (const uint16_t*) input;
+	const int32x4_t zero_point_v = vdupq_n_s32(zero_point);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const uint16x8_t q = vld1q_u16(in + i);
+		fp16_ml_io_dequantize_x4_neon(output + i, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(q))),
+			scale, zero_point_v);
+		fp16_ml_io_dequantize_x4_neon(output + i + 4, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(q))),
+			scale, zero_point_v);
+	}
+	fp16_ml_io_dequantize_uint16_scalar(in + i, output + i, n - i, scale, zero_point);
+}
+#endif
+
+/*
+ * Runtime dispatch, the same scheme as fp16_blas.h: the best entry of fp16_ml_io_kernel_table the CPU supports is
+ * copied to fp16_ml_io_kernels at startup.
+ */
+static const struct fp16_ml_io_kernel fp16_ml_io_kernel_table[] = {
+	{ "scalar", fp16_ml_io_has_scalar,
+		{ fp16_ml_io_quantize_int8_scalar, fp16_ml_io_quantize_uint8_scalar,
+			fp16_ml_io_quantize_int16_scalar, fp16_ml_io_quantize_uint16_scalar },
+		{ fp16_ml_io_dequantize_int8_scalar, fp16_ml_io_dequantize_uint8_scalar,
+			fp16_ml_io_dequantize_int16_scalar, fp16_ml_io_dequantize_uint16_scalar } },
+#ifdef FP16_ARRAY_X86
+	{ "avx2", fp16_ml_io_has_avx2,
+		{ fp16_ml_io_quantize_int8_avx2, fp16_ml_io_quantize_uint8_avx2,
+			fp16_ml_io_quantize_int16_avx2, fp16_ml_io_quantize_uint16_avx2 },
+		{ fp16_ml_io_dequantize_int8_avx2, fp16_ml_io_dequantize_uint8_avx2,
+			fp16_ml_io_dequantize_int16_avx2, fp16_ml_io_dequantize_uint16_avx2 } },
+#endif
+#ifdef FP16_ARRAY_ARM
+	{ "neon", fp16_arm_has_neon,
+		{ fp16_ml_io_quantize_int8_neon, fp16_ml_io_quantize_uint8_neon,
+			fp16_ml_io_quantize_int16_neon, fp16_ml_io_quantize_uint16_neon },
+		{ fp16_ml_io_dequantize_int8_neon, fp16_ml_io_dequantize_uint8_neon,
+			fp16_ml_io_dequantize_int16_neon, fp16_ml_io_dequantize_uint16_neon } },
+#endif
+};
+
+#define FP16_ML_IO_KERNEL_COUNT (sizeof(fp16_ml_io_kernel_table) / sizeof(fp16_ml_io_kernel_table[0]))
+
+static struct fp16_ml_io_kernel fp16_ml_io_kernels = {
+	"scalar", fp16_ml_io_has_scalar,
+	{ fp16_ml_io_quantize_int8_scalar, fp16_ml_io_quantize_uint8_scalar,
+		fp16_ml_io_quantize_int16_scalar, fp16_ml_io_quantize_uint16_scalar },
+	{ fp16_ml_io_dequantize_int8_scalar, fp16_ml_io_dequantize_uint8_scalar,
+		fp16_ml_io_dequantize_int16_scalar, fp16_ml_io_dequantize_uint16_scalar }
+};
+
+#if defined(__GNUC__)
+__attribute__((__constructor__, __unused__))
+#endif
+static void fp16_ml_io_init(void) {
+	for (size_t k = 0; k < FP16_ML_IO_KERNEL_COUNT; k++) {
+		if (fp16_ml_io_kernel_table[k].supported()) {
+			fp16_ml_io_kernels = fp16_ml_io_kernel_table[k];
+		}
+	}
+}
+
+static inline int fp16_ml_io_quantize(enum fp16_ml_io_type type, float scale, int32_t zero_point,
+	uint64_t nb_elements, const void* input, void* output)
+{
+	if (scale == 0.0f || nb_elements == 0 || input == NULL || output == NULL) {
+		return -EINVAL;
+	}
+	fp16_ml_io_kernels.quantize[type]((const float*) input, output, (size_t) nb_elements, scale, zero_point);
+	return 0;
+}
+
+static inline int fp16_ml_io_dequantize(enum fp16_ml_io_type type, float scale, int32_t zero_point,
+	uint64_t nb_elements, const void* input, void* output)
+{
+	if (scale == 0.0f || nb_elements == 0 || input == NULL || output == NULL) {
+		return -EINVAL;
+	}
+	fp16_ml_io_kernels.dequantize[type](input, (float*) output, (size_t) nb_elements, scale, zero_point);
+	return 0;
+}
+
+/*
+ * Quantize nb_elements fp32 values: out[i] = clamp(round_even(in[i] * scale) + zero_point) in the range of the type.
+ */
+static inline int fp16_ml_io_float32_to_int8(float scale, int8_t zero_point, uint64_t nb_elements,
+	const void* input, void* output)
+{
+	return fp16_ml_io_quantize(FP16_ML_IO_INT8, scale, zero_point, nb_elements, input, output);
+}
+
+static inline int fp16_ml_io_float32_to_uint8(float scale, uint8_t zero_point, uint64_t nb_elements,
+	const void* input, void* output)
+{
+	return fp16_ml_io_quantize(FP16_ML_IO_UINT8, scale, zero_point, nb_elements, input, output);
+}
+
+static inline int fp16_ml_io_float32_to_int16(float scale, int16_t zero_point, uint64_t nb_elements,
+	const void* input, void* output)
+{
+	return fp16_ml_io_quantize(FP16_ML_IO_INT16, scale, zero_point, nb_elements, input, output);
+}
+
+static inline int fp16_ml_io_float32_to_uint16(float scale, uint16_t zero_point, uint64_t nb_elements,
+	const void* input, void* output)
+{
+	return fp16_ml_io_quantize(FP16_ML_IO_UINT16, scale, zero_point, nb_elements, input, output);
+}
+
+/*
+ * Dequantize nb_elements values to fp32: out[i] = scale * (in[i] - zero_point).
+ */
+static inline int fp16_ml_io_int8_to_float32(float scale, int8_t zero_point, uint64_t nb_elements,
+	const void* input, void* output)
+{
+	return fp16_ml_io_dequantize(FP16_ML_IO_INT8, scale, zero_point, nb_elements, input, output);
+}
+
+static inline int fp16_ml_io_uint8_to_float32(float scale, uint8_t zero_point, uint64_t nb_elements,
+	const void* input, void* output)
+{
+	return fp16_ml_io_dequantize(FP16_ML_IO_UINT8, scale, zero_point, nb_elements, input, output);
+}
+
+static inline int fp16_ml_io_int16_to_float32(float scale, int16_t zero_point, uint64_t nb_elements,
+	const void* input, void* output)
+{
+	return fp16_ml_io_dequantize(FP16_ML_IO_INT16, scale, zero_point, nb_elements, input, output);
+}
+
+static inline int fp16_ml_io_uint16_to_float32(float scale, uint16_t zero_point, uint64_t nb_elements,
+	const void* input, void* output)
+{
+	return fp16_ml_io_dequantize(FP16_ML_IO_UINT16, scale, zero_point, nb_elements, input, output);
+}
+
+/*
+ * Convert nb_elements fp32 values to IEEE half precision, and back.
+ */
+static inline int fp16_ml_io_float32_to_float16(uint64_t nb_elements, const void* input, void* output) {
+	if (nb_elements == 0 || input == NULL || output == NULL) {
+		return -EINVAL;
+	}
+	fp16_ieee_from_fp32_array((const float*) input, (uint16_t*) output, (size_t) nb_elements);
+	return 0;
+}
+
+static inline int fp16_ml_io_float16_to_float32(uint64_t nb_elements, const void* input, void* output) {
+	if (nb_elements == 0 || input == NULL || output == NULL) {
+		return -EINVAL;
+	}
+	fp16_ieee_to_fp32_array((const uint16_t*) input, (float*) output, (size_t) nb_elements);
+	return 0;
+}
+
+#endif /* FP16_ML_IO_H */
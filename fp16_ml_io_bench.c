@@ -0,0 +1,223 @@
+/*
+ * Checks and throughput of the quantize / dequantize burst functions of fp16_ml_io.h.
+ *
+ * Every kernel the CPU supports is compared with the scalar kernel first, bit for bit, on inputs that hit the corner
+ * cases: halfway values, values just inside and outside the range of each type, +-0, +-Inf and NaN. The program exits
+ * with 1 on any difference.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_ml_io_bench.c -o fp16_ml_io_bench -lm
+ *
+ * Usage: ./fp16_ml_io_bench [elements] [repetitions]
+ *
+ * The timing runs every type through the scalar kernel and the dispatched one, on buffers of the given size
+ * (1M elements by default, so that they stay in L2/L3), and prints million elements per second and the GB/s of the
+ * fp32 side.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fp16_ml_io.h"
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* xorshift32, only used to fill the inputs */
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static const char* const type_names[FP16_ML_IO_TYPE_COUNT] = { "int8", "uint8", "int16", "uint16" };
+static const size_t type_sizes[FP16_ML_IO_TYPE_COUNT] = { 1, 1, 2, 2 };
+static const int32_t type_min[FP16_ML_IO_TYPE_COUNT] = { INT8_MIN, 0, INT16_MIN, 0 };
+static const int32_t type_max[FP16_ML_IO_TYPE_COUNT] = { INT8_MAX, UINT8_MAX, INT16_MAX, UINT16_MAX };
+
+/*
+ * Inputs for scale 1: mostly halves and quarters around the whole range of the type and a bit beyond, so that the
+ * ties and the saturation are exercised, with some special values and random bit patterns in between.
+ */
+static void fill_quantize_input(float* x, size_t n, enum fp16_ml_io_type type, uint32_t* state) {
+	const int32_t span = type_max[type] - type_min[type] + 16;
+	for (size_t i = 0; i < n; i++) {
+		const uint32_t r = next_random(state);
+		switch (r % 16) {
+			case 0:
+				x[i] = fp32_from_bits(next_random(state));
+				break;
+			case 1: {
+				static const float specials[] = { 0.0f, -0.0f, INFINITY, -INFINITY, NAN, -NAN, 0.5f, -0.5f };
+				x[i] = specials[next_random(state) % 8];
+				break;
+			}
+			default:
+				x[i] = (float) ((int32_t) (next_random(state) % (uint32_t) span) + type_min[type] - 8) +
+					(float) (r % 4) * 0.25f;
+				break;
+		}
+	}
+}
+
+static int check_kernel(const struct fp16_ml_io_kernel* kernel) {
+	static const size_t sizes[] = { 0, 1, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 1000, 4099 };
+	const size_t max_size = 4099;
+	const struct fp16_ml_io_kernel* scalar = &fp16_ml_io_kernel_table[0];
+	float* x = malloc(max_size * sizeof(float));
+	float* y = malloc(max_size * sizeof(float));
+	float* y_ref = malloc(max_size * sizeof(float));
+	uint16_t* q = malloc(max_size * sizeof(uint16_t));
+	uint16_t* q_ref = malloc(max_size * sizeof(uint16_t));
+	if (x == NULL || y == NULL || y_ref == NULL || q == NULL || q_ref == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	uint32_t state = 12345;
+	int errors = 0;
+	for (int type = 0; type < FP16_ML_IO_TYPE_COUNT; type++) {
+		const int32_t zero_points[] = { 0, type_min[type] / 2 + type_max[type] / 2 + 1, type_max[type] };
+		const float scales[] = { 1.0f, 0.5f, 3.0f, 1.0f / 3.0f };
+		for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+			for (size_t z = 0; z < 3; z++) {
+				for (size_t c = 0; c < 4; c++) {
+					const size_t n = sizes[s];
+					fill_quantize_input(x, n, (enum fp16_ml_io_type) type, &state);
+					kernel->quantize[type](x, q, n, scales[c], zero_points[z]);
+					scalar->quantize[type](x, q_ref, n, scales[c], zero_points[z]);
+					if (memcmp(q, q_ref, n * type_sizes[type]) != 0) {
+						printf("%s quantize %s, n = %zu, scale %g, zero point %d: differs from scalar\n",
+							kernel->name, type_names[type], n, scales[c], zero_points[z]);
+						errors++;
+					}
+					kernel->dequantize[type](q_ref, y, n, scales[c], zero_points[z]);
+					scalar->dequantize[type](q_ref, y_ref, n, scales[c], zero_points[z]);
+					if (memcmp(y, y_ref, n * sizeof(float)) != 0) {
+						printf("%s dequantize %s, n = %zu, scale %g, zero point %d: differs from scalar\n",
+							kernel->name, type_names[type], n, scales[c], zero_points[z]);
+						errors++;
+					}
+				}
+			}
+		}
+	}
+	free(x);
+	free(y);
+	free(y_ref);
+	free(q);
+	free(q_ref);
+	return errors;
+}
+
+/* Spot checks of the scalar kernel against the definition: rounding, saturation and NaN */
+static int check_scalar(void) {
+	static const struct {
+		float x;
+		int32_t expected;
+	} cases[] = {
+		{ 0.5f, 0 }, { 1.5f, 2 }, { 2.5f, 2 }, { -0.5f, 0 }, { -1.5f, -2 }, { -2.5f, -2 }, { 2.4999998f, 2 },
+		{ 126.5f, 126 }, { 127.5f, 127 }, { 1e9f, 127 }, { -128.5f, -128 }, { -1e9f, -128 },
+		{ INFINITY, 127 }, { -INFINITY, -128 }, { NAN, 0 },
+	};
+	int errors = 0;
+	for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+		int8_t q;
+		fp16_ml_io_quantize_int8_scalar(&cases[k].x, &q, 1, 1.0f, 0);
+		if (q != cases[k].expected) {
+			printf("scalar quantize int8 of %g: %d, expected %d\n", cases[k].x, q, cases[k].expected);
+			errors++;
+		}
+	}
+	return errors;
+}
+
+/* The kernel that fp16_ieee_from_fp32_array / fp16_ieee_to_fp32_array use for the float16 pair */
+static const char* array_kernel_name(void) {
+#if defined(FP16_ARRAY_X86)
+	return fp16_x86_kernels.name;
+#elif defined(FP16_ARRAY_ARM)
+	return fp16_arm_kernels.name;
+#else
+	return "scalar";
+#endif
+}
+
+static void report(const char* what, const char* kernel, size_t n, size_t repetitions, double seconds) {
+	const double elements = (double) n * (double) repetitions;
+	printf("%-20s %-10s %9.1f Melem/s %7.2f GB/s fp32\n", what, kernel, elements / seconds * 1e-6,
+		elements * sizeof(float) / seconds * 1e-9);
+}
+
+int main(int argc, char** argv) {
+	const size_t n = argc > 1 ? strtoull(argv[1], NULL, 0) : (size_t) 1 << 20;
+	const size_t repetitions = argc > 2 ? strtoull(argv[2], NULL, 0) : 100;
+
+	int errors = check_scalar();
+	for (size_t k = 1; k < FP16_ML_IO_KERNEL_COUNT; k++) {
+		if (fp16_ml_io_kernel_table[k].supported()) {
+			errors += check_kernel(&fp16_ml_io_kernel_table[k]);
+		}
+	}
+	printf("kernels checked against scalar: %s\n", errors == 0 ? "ok" : "FAILED");
+	printf("dispatched kernel: %s\n", fp16_ml_io_kernels.name);
+
+	float* x = malloc(n * sizeof(float));
+	float* y = malloc(n * sizeof(float));
+	uint16_t* q = malloc(n * sizeof(uint16_t));
+	if (x == NULL || y == NULL || q == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	uint32_t state = 1;
+	for (size_t i = 0; i < n; i++) {
+		x[i] = (float) ((int32_t) next_random(&state)) * 0x1.0p-31f;
+	}
+
+	const struct fp16_ml_io_kernel* kernels[2] = { &fp16_ml_io_kernel_table[0], &fp16_ml_io_kernels };
+	for (int type = 0; type < FP16_ML_IO_TYPE_COUNT; type++) {
+		/* [-1, 1) onto the whole range of the type */
+		const float scale = (float) (type_max[type] - type_min[type]) * 0.5f;
+		const int32_t zero_point = type_min[type] / 2 + type_max[type] / 2 + 1;
+		char what[32];
+		for (int k = 0; k < 2; k++) {
+			double start = now_seconds();
+			for (size_t r = 0; r < repetitions; r++) {
+				kernels[k]->quantize[type](x, q, n, scale, zero_point);
+			}
+			snprintf(what, sizeof(what), "float32_to_%s", type_names[type]);
+			report(what, kernels[k]->name, n, repetitions, now_seconds() - start);
+
+			start = now_seconds();
+			for (size_t r = 0; r < repetitions; r++) {
+				kernels[k]->dequantize[type](q, y, n, 1.0f / scale, zero_point);
+			}
+			snprintf(what, sizeof(what), "%s_to_float32", type_names[type]);
+			report(what, kernels[k]->name, n, repetitions, now_seconds() - start);
+		}
+	}
+
+	double start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ml_io_float32_to_float16(n, x, q);
+	}
+	report("float32_to_float16", array_kernel_name(), n, repetitions, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ml_io_float16_to_float32(n, q, y);
+	}
+	report("float16_to_float32", array_kernel_name(), n, repetitions, now_seconds() - start);
+
+	free(x);
+	free(y);
+	free(q);
+	return errors != 0;
+}
@@ -0,0 +1,1229 @@
+#pragma once
+#ifndef FP16_OPS_H
+#define FP16_OPS_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cmath>
+	#include <cstddef>
+	#include <cstdint>
+#else
+	#include <math.h>
+	#include <stddef.h>
+	#include <stdint.h>
+#endif
+
+#include "fp16_blas.h"
+
+/*
+ * Elementwise operations and reductions on IEEE half-precision arrays, without an expanded fp32 copy.
+ *
+ * Post-processing on fp16 tensors usually goes through fp16_ieee_to_fp32_array into a temporary buffer, an fp32 loop
+ * over the buffer, and fp16_ieee_from_fp32_array back. The kernels below widen the half-precision numbers in registers
+ * with the decoders of fp16_blas.h, compute in fp32 and narrow the results with the round-to-nearest-even encoders of
+ * fp16_x86.h / fp16_arm.h, so every input is read as 2 bytes and every output written as 2 bytes.
+ *
+ * | kernel  | ISA                 | widening / narrowing                        | max, clamp         |
+ * |---------|---------------------|---------------------------------------------|--------------------|
+ * | scalar  | any                 | fp16_ieee_to_fp32_value / _from_fp32_value  | scalar             |
+ * | sse2    | SSE2                | magic bias (fp16_x86.h)                     | pmaxsw, 8 lanes    |
+ * | f16c    | AVX2 + F16C + FMA   | vcvtph2ps / vcvtps2ph ymm                   | vpmaxsw, 16 lanes  |
+ * | avx512f | AVX-512F/BW (+ FMA) | vcvtph2ps / vcvtps2ph zmm                   | vpmaxsw, 32 lanes  |
+ * | neon    | AArch64             | FCVTL / FCVTN                               | SMAX, 8 lanes      |
+ *
+ * Elementwise, out may be one of the inputs:
+ * - fp16_ieee_add(a, b, out, n), fp16_ieee_mul(a, b, out, n): a + b and a * b. fp32 has more than twice the precision
+ *   of fp16 plus 2 bits, so rounding to fp32 and then to fp16 gives the correctly rounded fp16 result.
+ * - fp16_ieee_fma(a, b, c, out, n): a * b + c, correctly rounded to fp16 as well. a * b is exact in fp32, and the sum
+ *   is rounded to odd in fp32 (the error of the fp32 addition from TwoSum decides the last bit) before it is rounded to
+ *   fp16, which avoids the double rounding of a plain fp32 sum.
+ * - fp16_ieee_clamp(x, out, n, lo, hi): minimum(maximum(x, lo), hi) in the IEEE 754-2019 sense, -0 < +0 and NaN in,
+ *   NaN out. lo and hi are rounded to fp16 first; since rounding is monotonic, that does not change the results.
+ *
+ * Reductions, accumulated in fp32 with several partial sums per kernel, so the last bits depend on the kernel:
+ * - fp16_ieee_sum(x, n), fp16_ieee_sum_kahan(x, n): the second one with a compensated (Kahan) sum per lane.
+ * - fp16_ieee_max(x, n): -Inf for n = 0, NaN if there is a NaN.
+ * - fp16_ieee_norm2(x, n): the L2 norm. Squares of fp16 numbers are exact in fp32 and their sum can not overflow.
+ * - fp16_ieee_mean_var(x, n, &mean, &var): the mean and the population variance, in two passes over x.
+ *
+ * Fused:
+ * - fp16_ieee_softmax(x, out, n): exp(x[i] - max) / sum of exp(x[j] - max), in three passes over x and none over a
+ *   temporary. A NaN or an infinity in x makes every output NaN.
+ * - fp16_ieee_layernorm(x, out, n, gamma, beta, eps): (x[i] - mean) / sqrt(var + eps) * gamma[i] + beta[i], gamma and
+ *   beta in single precision.
+ *
+ * max and clamp never convert: a half-precision number with the magnitude bits flipped when it is negative orders like
+ * a 16-bit signed integer, so they use the integer max / min instructions on 8 to 32 numbers at a time.
+ *
+ * The exponential of softmax is a polynomial after the reduction by multiples of ln(2) (the expf of Cephes), within 1
+ * fp32 ulp, shared by all kernels. Like any fp32 code, the arithmetic follows the rounding mode of MXCSR / FPCR; the
+ * results above hold for the default mode. A NaN result is the canonical NaN, with the sign the hardware gives it
+ * (for two NaN operands that depends on their order, which can differ between kernels).
+ */
+typedef void (*fp16_ops_binary_kernel)(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n);
+typedef void (*fp16_ops_fma_kernel)(const uint16_t* a, const uint16_t* b, const uint16_t* c, uint16_t* out, size_t n);
+/* lo and hi are the fp16 bounds, already ordered like signed integers (see fp16_ops_order) */
+typedef void (*fp16_ops_clamp_kernel)(const uint16_t* x, uint16_t* out, size_t n, int16_t lo, int16_t hi);
+/* The maximum, 0x7E00 if there is a NaN */
+typedef uint16_t (*fp16_ops_max_kernel)(const uint16_t* x, size_t n);
+typedef float (*fp16_ops_sum_kernel)(const uint16_t* x, size_t n);
+/* Sum of (x[i] - center)**2 */
+typedef float (*fp16_ops_ssd_kernel)(const uint16_t* x, size_t n, float center);
+/* Sum of exp(x[i] - shift) */
+typedef float (*fp16_ops_exp_sum_kernel)(const uint16_t* x, size_t n, float shift);
+/* out[i] = exp(x[i] - shift) * scale */
+typedef void (*fp16_ops_exp_scale_kernel)(const uint16_t* x, uint16_t* out, size_t n, float shift, float scale);
+/* out[i] = (x[i] - mean) * rstd * gamma[i] + beta[i] */
+typedef void (*fp16_ops_normalize_kernel)(const uint16_t* x, uint16_t* out, size_t n, float mean, float rstd,
+	const float* gamma, const float* beta);
+
+struct fp16_ops_kernel {
+	const char* name;
+	int (*supported)(void);
+	fp16_ops_binary_kernel add;
+	fp16_ops_binary_kernel mul;
+	fp16_ops_fma_kernel fma;
+	fp16_ops_clamp_kernel clamp;
+	fp16_ops_max_kernel max;
+	fp16_ops_sum_kernel sum;
+	fp16_ops_sum_kernel sum_kahan;
+	fp16_ops_ssd_kernel ssd;
+	fp16_ops_exp_sum_kernel exp_sum;
+	fp16_ops_exp_scale_kernel exp_scale;
+	fp16_ops_normalize_kernel normalize;
+};
+
+/*
+ * The bits of a half-precision number with the magnitude flipped when the sign is set. As int16_t these order like
+ * the numbers, with -0 < +0, from -Inf (0x83FF) to +Inf (0x7C00); NaNs end up outside that range. The mapping is its
+ * own inverse.
+ */
+static inline uint16_t fp16_ops_order(uint16_t h) {
+	return h & UINT16_C(0x8000) ? h ^ UINT16_C(0x7FFF) : h;
+}
+
+#define FP16_OPS_ORDER_NEG_INF ((int16_t) -31745)
+
+static inline int fp16_ops_is_nan(uint16_t h) {
+	return (h & UINT16_C(0x7FFF)) > UINT16_C(0x7C00);
+}
+
+/*
+ * p + c rounded to odd: if the fp32 sum is inexact and its last bit is even, it moves one ulp toward the exact sum.
+ * e is the exact error of the sum (TwoSum); it is NaN for infinite inputs, which are then left alone.
+ */
+static inline float fp16_ops_add_odd(float p, float c) {
+	const float s = p + c;
+	const float bb = s - p;
+	const float e = (p - (s - bb)) + (c - bb);
+	uint32_t bits = fp32_to_bits(s);
+	if ((e < 0.0f || e > 0.0f) && (bits & 1) == 0) {
+		bits += (bits ^ fp32_to_bits(e)) & UINT32_C(0x80000000) ? UINT32_C(0xFFFFFFFF) : 1;
+	}
+	return fp32_from_bits(bits);
+}
+
+/*
+ * Constants of the exponential: the clamp keeps 2**k a normal number and the result above FLT_MIN, the rounding to
+ * an integer adds 1.5 * 2**23, ln(2) is split in two parts so that k * ln(2) is exact to 32 bits, and the polynomial
+ * approximates (exp(r) - 1 - r) / r**2 on [-ln(2) / 2, ln(2) / 2].
+ */
+#define FP16_OPS_EXP_MIN (-87.0f)
+#define FP16_OPS_EXP_MAX 88.0f
+#define FP16_OPS_EXP_LOG2E 1.44269504088896341f
+#define FP16_OPS_EXP_MAGIC 12582912.0f
+#define FP16_OPS_EXP_LN2_HI 0.693359375f
+#define FP16_OPS_EXP_LN2_LO (-2.12194440e-4f)
+#define FP16_OPS_EXP_P0 1.9875691500e-4f
+#define FP16_OPS_EXP_P1 1.3981999507e-3f
+#define FP16_OPS_EXP_P2 8.3334519073e-3f
+#define FP16_OPS_EXP_P3 4.1665795894e-2f
+#define FP16_OPS_EXP_P4 1.6666665459e-1f
+#define FP16_OPS_EXP_P5 5.0000001201e-1f
+
+static inline float fp16_ops_exp_scalar(float x) {
+	x = x < FP16_OPS_EXP_MIN ? FP16_OPS_EXP_MIN : x;
+	x = x > FP16_OPS_EXP_MAX ? FP16_OPS_EXP_MAX : x;
+	const float t = x * FP16_OPS_EXP_LOG2E + FP16_OPS_EXP_MAGIC;
+	const float k = t - FP16_OPS_EXP_MAGIC;
+	const float r = (x - k * FP16_OPS_EXP_LN2_HI) - k * FP16_OPS_EXP_LN2_LO;
+	float p = FP16_OPS_EXP_P0;
+	p = p * r + FP16_OPS_EXP_P1;
+	p = p * r + FP16_OPS_EXP_P2;
+	p = p * r + FP16_OPS_EXP_P3;
+	p = p * r + FP16_OPS_EXP_P4;
+	p = p * r + FP16_OPS_EXP_P5;
+	p = p * r * r + r + 1.0f;
+	// The low bits of t are k: add it to the exponent
+	return fp32_from_bits(fp32_to_bits(p) + (fp32_to_bits(t) << 23));
+}
+
+static inline void fp16_ops_add_scalar(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		out[i] = fp16_ieee_from_fp32_value(fp16_ieee_to_fp32_value(a[i]) + fp16_ieee_to_fp32_value(b[i]));
+	}
+}
+
+static inline void fp16_ops_mul_scalar(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		out[i] = fp16_ieee_from_fp32_value(fp16_ieee_to_fp32_value(a[i]) * fp16_ieee_to_fp32_value(b[i]));
+	}
+}
+
+static inline void fp16_ops_fma_scalar(const uint16_t* a, const uint16_t* b, const uint16_t* c, uint16_t* out,
+	size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		const float p = fp16_ieee_to_fp32_value(a[i]) * fp16_ieee_to_fp32_value(b[i]);
+		out[i] = fp16_ieee_from_fp32_value(fp16_ops_add_odd(p, fp16_ieee_to_fp32_value(c[i])));
+	}
+}
+
+static inline void fp16_ops_clamp_scalar(const uint16_t* x, uint16_t* out, size_t n, int16_t lo, int16_t hi) {
+	for (size_t i = 0; i < n; i++) {
+		const uint16_t h = x[i];
+		int16_t key = (int16_t) fp16_ops_order(h);
+		key = key < lo ? lo : key;
+		key = key > hi ? hi : key;
+		out[i] = fp16_ops_is_nan(h) ? (h & UINT16_C(0x8000)) | UINT16_C(0x7E00) : fp16_ops_order((uint16_t) key);
+	}
+}
+
+/* The maximum of x[0..n-1], best (ordered) and nan included: the tail of the SIMD kernels */
+static inline uint16_t fp16_ops_max_finish(const uint16_t* x, size_t n, int16_t best, int nan) {
+	for (size_t i = 0; i < n; i++) {
+		const int16_t key = (int16_t) fp16_ops_order(x[i]);
+		best = key > best ? key : best;
+		nan |= fp16_ops_is_nan(x[i]);
+	}
+	return nan ? UINT16_C(0x7E00) : fp16_ops_order((uint16_t) best);
+}
+
+static inline uint16_t fp16_ops_max_scalar(const uint16_t* x, size_t n) {
+	return fp16_ops_max_finish(x, n, FP16_OPS_ORDER_NEG_INF, 0);
+}
+
+static inline float fp16_ops_sum_scalar(const uint16_t* x, size_t n) {
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		sum += fp16_ieee_to_fp32_value(x[i]);
+	}
+	return sum;
+}
+
+/* One step of a compensated sum: comp holds the rounding error of sum, negated */
+static inline void fp16_ops_kahan_add(float* sum, float* comp, float value) {
+	const float y = value - *comp;
+	const float t = *sum + y;
+	*comp = (t - *sum) - y;
+	*sum = t;
+}
+
+static inline float fp16_ops_sum_kahan_scalar(const uint16_t* x, size_t n) {
+	float sum = 0.0f, comp = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		fp16_ops_kahan_add(&sum, &comp, fp16_ieee_to_fp32_value(x[i]));
+	}
+	return sum;
+}
+
+/* Sum of lanes partial sums and their compensations, then of x[0..n-1]: the end of the SIMD Kahan kernels */
+static inline float fp16_ops_sum_kahan_finish(const float* sums, const float* comps, size_t lanes, const uint16_t* x,
+	size_t n)
+{
+	float sum = 0.0f, comp = 0.0f;
+	for (size_t l = 0; l < lanes; l++) {
+		fp16_ops_kahan_add(&sum, &comp, sums[l]);
+		fp16_ops_kahan_add(&sum, &comp, -comps[l]);
+	}
+	for (size_t i = 0; i < n; i++) {
+		fp16_ops_kahan_add(&sum, &comp, fp16_ieee_to_fp32_value(x[i]));
+	}
+	return sum;
+}
+
+static inline float fp16_ops_ssd_scalar(const uint16_t* x, size_t n, float center) {
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		const float d = fp16_ieee_to_fp32_value(x[i]) - center;
+		sum += d * d;
+	}
+	return sum;
+}
+
+static inline float fp16_ops_exp_sum_scalar(const uint16_t* x, size_t n, float shift) {
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		sum += fp16_ops_exp_scalar(fp16_ieee_to_fp32_value(x[i]) - shift);
+	}
+	return sum;
+}
+
+static inline void fp16_ops_exp_scale_scalar(const uint16_t* x, uint16_t* out, size_t n, float shift, float scale) {
+	for (size_t i = 0; i < n; i++) {
+		out[i] = fp16_ieee_from_fp32_value(fp16_ops_exp_scalar(fp16_ieee_to_fp32_value(x[i]) - shift) * scale);
+	}
+}
+
+static inline void fp16_ops_normalize_scalar(const uint16_t* x, uint16_t* out, size_t n, float mean, float rstd,
+	const float* gamma, const float* beta)
+{
+	for (size_t i = 0; i < n; i++) {
+		out[i] = fp16_ieee_from_fp32_value((fp16_ieee_to_fp32_value(x[i]) - mean) * rstd * gamma[i] + beta[i]);
+	}
+}
+
+#ifdef FP16_ARRAY_X86
+FP16_X86_TARGET("sse2")
+static inline void fp16_ops_store8_sse2(uint16_t* p, __m128 lo, __m128 hi) {
+	_mm_storeu_si128((__m128i*) p, _mm_packs_epi32(fp16_ieee_from_fp32_sse2_x4(lo), fp16_ieee_from_fp32_sse2_x4(hi)));
+}
+
+FP16_X86_TARGET("sse2")
+static inline __m128 fp16_ops_add_odd_sse2(__m128 p, __m128 c) {
+	const __m128 s = _mm_add_ps(p, c);
+	const __m128 bb = _mm_sub_ps(s, p);
+	const __m128 e = _mm_add_ps(_mm_sub_ps(p, _mm_sub_ps(s, bb)), _mm_sub_ps(c, bb));
+	const __m128i bits = _mm_castps_si128(s);
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128 inexact = _mm_or_ps(_mm_cmplt_ps(e, _mm_setzero_ps()), _mm_cmpgt_ps(e, _mm_setzero_ps()));
+	const __m128i even = _mm_cmpeq_epi32(_mm_and_si128(bits, one), _mm_setzero_si128());
+	// +1 if e has the sign of s (away from zero), -1 otherwise
+	const __m128i step = _mm_or_si128(_mm_srai_epi32(_mm_xor_si128(bits, _mm_castps_si128(e)), 31), one);
+	const __m128i adjust = _mm_and_si128(_mm_and_si128(_mm_castps_si128(inexact), even), step);
+	return _mm_castsi128_ps(_mm_add_epi32(bits, adjust));
+}
+
+FP16_X86_TARGET("sse2")
+static inline __m128 fp16_ops_exp_sse2(__m128 x) {
+	x = _mm_max_ps(_mm_set1_ps(FP16_OPS_EXP_MIN), x);
+	x = _mm_min_ps(_mm_set1_ps(FP16_OPS_EXP_MAX), x);
+	const __m128 t = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(FP16_OPS_EXP_LOG2E)), _mm_set1_ps(FP16_OPS_EXP_MAGIC));
+	const __m128 k = _mm_sub_ps(t, _mm_set1_ps(FP16_OPS_EXP_MAGIC));
+	const __m128 r = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(FP16_OPS_EXP_LN2_HI))),
+		_mm_mul_ps(k, _mm_set1_ps(FP16_OPS_EXP_LN2_LO)));
+	__m128 p = _mm_set1_ps(FP16_OPS_EXP_P0);
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(FP16_OPS_EXP_P1));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(FP16_OPS_EXP_P2));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(FP16_OPS_EXP_P3));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(FP16_OPS_EXP_P4));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(FP16_OPS_EXP_P5));
+	p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, r), r), r), _mm_set1_ps(1.0f));
+	return _mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(p), _mm_slli_epi32(_mm_castps_si128(t), 23)));
+}
+
+/* The bits of 8 half-precision numbers, ordered like signed integers */
+FP16_X86_TARGET("sse2")
+static inline __m128i fp16_ops_order_sse2(__m128i h) {
+	return _mm_xor_si128(h, _mm_and_si128(_mm_srai_epi16(h, 15), _mm_set1_epi16(0x7FFF)));
+}
+
+FP16_X86_TARGET("sse2")
+static inline __m128i fp16_ops_is_nan_sse2(__m128i h) {
+	return _mm_cmpgt_epi16(_mm_and_si128(h, _mm_set1_epi16(0x7FFF)), _mm_set1_epi16(0x7C00));
+}
+
+FP16_X86_TARGET("sse2")
+static inline void fp16_ops_add_sse2(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		__m128 a_lo, a_hi, b_lo, b_hi;
+		fp16_blas_load8_sse2(a + i, &a_lo, &a_hi);
+		fp16_blas_load8_sse2(b + i, &b_lo, &b_hi);
+		fp16_ops_store8_sse2(out + i, _mm_add_ps(a_lo, b_lo), _mm_add_ps(a_hi, b_hi));
+	}
+	fp16_ops_add_scalar(a + i, b + i, out + i, n - i);
+}
+
+FP16_X86_TARGET("sse2")
+static inline void fp16_ops_mul_sse2(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		__m128 a_lo, a_hi, b_lo, b_hi;
+		fp16_blas_load8_sse2(a + i, &a_lo, &a_hi);
+		fp16_blas_load8_sse2(b + i, &b_lo, &b_hi);
+		fp16_ops_store8_sse2(out + i, _mm_mul_ps(a_lo, b_lo), _mm_mul_ps(a_hi, b_hi));
+	}
+	fp16_ops_mul_scalar(a + i, b + i, out + i, n - i);
+}
+
+FP16_X86_TARGET("sse2")
+static inline void fp16_ops_fma_sse2(const uint16_t* a, const uint16_t* b, const uint16_t* c, uint16_t* out,
+	size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		__m128 a_lo, a_hi, b_lo, b_hi, c_lo, c_hi;
+		fp16_blas_load8_sse2(a + i, &a_lo, &a_hi);
+		fp16_blas_load8_sse2(b + i, &b_lo, &b_hi);
+		fp16_blas_load8_sse2(c + i, &c_lo, &c_hi);
+		fp16_ops_store8_sse2(out + i,
+			fp16_ops_add_odd_sse2(_mm_mul_ps(a_lo, b_lo), c_lo), fp16_ops_add_odd_sse2(_mm_mul_ps(a_hi, b_hi), c_hi));
+	}
+	fp16_ops_fma_scalar(a + i, b + i, c + i, out + i, n - i);
+}
+
+FP16_X86_TARGET("sse2")
+static inline void fp16_ops_clamp_sse2(const uint16_t* x, uint16_t* out, size_t n, int16_t lo, int16_t hi) {
+	const __m128i lo_v = _mm_set1_epi16(lo);
+	const __m128i hi_v = _mm_set1_epi16(hi);
+	const __m128i nan_bits = _mm_set1_epi16(0x7E00);
+	const __m128i sign_mask = _mm_set1_epi16((short) 0x8000);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m128i h = _mm_loadu_si128((const __m128i*) (x + i));
+		const __m128i key = _mm_min_epi16(_mm_max_epi16(fp16_ops_order_sse2(h), lo_v), hi_v);
+		const __m128i is_nan = fp16_ops_is_nan_sse2(h);
+		const __m128i canonical = _mm_or_si128(_mm_and_si128(h, sign_mask), nan_bits);
+		const __m128i result = _mm_or_si128(_mm_and_si128(is_nan, canonical),
+			_mm_andnot_si128(is_nan, fp16_ops_order_sse2(key)));
+		_mm_storeu_si128((__m128i*) (out + i), result);
+	}
+	fp16_ops_clamp_scalar(x + i, out + i, n - i, lo, hi);
+}
+
+FP16_X86_TARGET("sse2")
+static inline uint16_t fp16_ops_max_sse2(const uint16_t* x, size_t n) {
+	__m128i best = _mm_set1_epi16(FP16_OPS_ORDER_NEG_INF);
+	__m128i nan = _mm_setzero_si128();
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m128i h = _mm_loadu_si128((const __m128i*) (x + i));
+		best = _mm_max_epi16(best, fp16_ops_order_sse2(h));
+		nan = _mm_or_si128(nan, fp16_ops_is_nan_sse2(h));
+	}
+	best = _mm_max_epi16(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(1, 0, 3, 2)));
+	best = _mm_max_epi16(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(2, 3, 0, 1)));
+	best = _mm_max_epi16(best, _mm_srli_epi32(best, 16));
+	return fp16_ops_max_finish(x + i, n - i, (int16_t) _mm_cvtsi128_si32(best), _mm_movemask_epi8(nan) != 0);
+}
+
+FP16_X86_TARGET("sse2")
+static inline float fp16_ops_sum_sse2(const uint16_t* x, size_t n) {
+	__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		__m128 lo, hi;
+		fp16_blas_load8_sse2(x + i, &lo, &hi);
+		acc0 = _mm_add_ps(acc0, lo);
+		acc1 = _mm_add_ps(acc1, hi);
+	}
+	return fp16_blas_hsum_sse2(_mm_add_ps(acc0, acc1)) + fp16_ops_sum_scalar(x + i, n - i);
+}
+
+FP16_X86_TARGET("sse2")
+static inline float fp16_ops_sum_kahan_sse2(const uint16_t* x, size_t n) {
+	__m128 sum[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+	__m128 comp[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		__m128 v[2];
+		fp16_blas_load8_sse2(x + i, &v[0], &v[1]);
+		for (int j = 0; j < 2; j++) {
+			const __m128 y = _mm_sub_ps(v[j], comp[j]);
+			const __m128 t = _mm_add_ps(sum[j], y);
+			comp[j] = _mm_sub_ps(_mm_sub_ps(t, sum[j]), y);
+			sum[j] = t;
+		}
+	}
+	float sums[8], comps[8];
+	for (int j = 0; j < 2; j++) {
+		_mm_storeu_ps(sums + 4 * j, sum[j]);
+		_mm_storeu_ps(comps + 4 * j, comp[j]);
+	}
+	return fp16_ops_sum_kahan_finish(sums, comps, 8, x + i, n - i);
+}
+
+FP16_X86_TARGET("sse2")
+static inline float fp16_ops_ssd_sse2(const uint16_t* x, size_t n, float center) {
+	const __m128 center_v = _mm_set1_ps(center);
+	__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		__m128 lo, hi;
+		fp16_blas_load8_sse2(x + i, &lo, &hi);
+		lo = _mm_sub_ps(lo, center_v);
+		hi = _mm_sub_ps(hi, center_v);
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(lo, lo));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(hi, hi));
+	}
+	return fp16_blas_hsum_sse2(_mm_add_ps(acc0, acc1)) + fp16_ops_ssd_scalar(x + i, n - i, center);
+}
+
+FP16_X86_TARGET("sse2")
+static inline float fp16_ops_exp_sum_sse2(const uint16_t* x, size_t n, float shift) {
+	const __m128 shift_v = _mm_set1_ps(shift);
+	__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		__m128 lo, hi;
+		fp16_blas_load8_sse2(x + i, &lo, &hi);
+		acc0 = _mm_add_ps(acc0, fp16_ops_exp_sse2(_mm_sub_ps(lo, shift_v)));
+		acc1 = _mm_add_ps(acc1, fp16_ops_exp_sse2(_mm_sub_ps(hi, shift_v)));
+	}
+	return fp16_blas_hsum_sse2(_mm_add_ps(acc0, acc1)) + fp16_ops_exp_sum_scalar(x + i, n - i, shift);
+}
+
+FP16_X86_TARGET("sse2")
+static inline void fp16_ops_exp_scale_sse2(const uint16_t* x, uint16_t* out, size_t n, float shift, float scale) {
+	const __m128 shift_v = _mm_set1_ps(shift);
+	const __m128 scale_v = _mm_set1_ps(scale);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		__m128 lo, hi;
+		fp16_blas_load8_sse2(x + i, &lo, &hi);
+		fp16_ops_store8_sse2(out + i, _mm_mul_ps(fp16_ops_exp_sse2(_mm_sub_ps(lo, shift_v)), scale_v),
+			_mm_mul_ps(fp16_ops_exp_sse2(_mm_sub_ps(hi, shift_v)), scale_v));
+	}
+	fp16_ops_exp_scale_scalar(x + i, out + i, n - i, shift, scale);
+}
+
+FP16_X86_TARGET("sse2")
+static inline void fp16_ops_normalize_sse2(const uint16_t* x, uint16_t* out, size_t n, float mean, float rstd,
+	const float* gamma, const float* beta)
+{
+	const __m128 mean_v = _mm_set1_ps(mean);
+	const __m128 rstd_v = _mm_set1_ps(rstd);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		__m128 lo, hi;
+		fp16_blas_load8_sse2(x + i, &lo, &hi);
+		lo = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(lo, mean_v), rstd_v), _mm_loadu_ps(gamma + i));
+		hi = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(hi, mean_v), rstd_v), _mm_loadu_ps(gamma + i + 4));
+		fp16_ops_store8_sse2(out + i,
+			_mm_add_ps(lo, _mm_loadu_ps(beta + i)), _mm_add_ps(hi, _mm_loadu_ps(beta + i + 4)));
+	}
+	fp16_ops_normalize_scalar(x + i, out + i, n - i, mean, rstd, gamma + i, beta + i);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline void fp16_ops_store8_f16c(uint16_t* p, __m256 f) {
+	_mm_storeu_si128((__m128i*) p, fp16_ieee_from_fp32_f16c_x8(f));
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline __m256 fp16_ops_add_odd_f16c(__m256 p, __m256 c) {
+	const __m256 s = _mm256_add_ps(p, c);
+	const __m256 bb = _mm256_sub_ps(s, p);
+	const __m256 e = _mm256_add_ps(_mm256_sub_ps(p, _mm256_sub_ps(s, bb)), _mm256_sub_ps(c, bb));
+	const __m256i bits = _mm256_castps_si256(s);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256 inexact = _mm256_cmp_ps(e, _mm256_setzero_ps(), _CMP_NEQ_OQ);
+	const __m256i even = _mm256_cmpeq_epi32(_mm256_and_si256(bits, one), _mm256_setzero_si256());
+	const __m256i step = _mm256_or_si256(_mm256_srai_epi32(_mm256_xor_si256(bits, _mm256_castps_si256(e)), 31), one);
+	const __m256i adjust = _mm256_and_si256(_mm256_and_si256(_mm256_castps_si256(inexact), even), step);
+	return _mm256_castsi256_ps(_mm256_add_epi32(bits, adjust));
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline __m256 fp16_ops_exp_f16c(__m256 x) {
+	x = _mm256_max_ps(_mm256_set1_ps(FP16_OPS_EXP_MIN), x);
+	x = _mm256_min_ps(_mm256_set1_ps(FP16_OPS_EXP_MAX), x);
+	const __m256 t = _mm256_fmadd_ps(x, _mm256_set1_ps(FP16_OPS_EXP_LOG2E), _mm256_set1_ps(FP16_OPS_EXP_MAGIC));
+	const __m256 k = _mm256_sub_ps(t, _mm256_set1_ps(FP16_OPS_EXP_MAGIC));
+	const __m256 r = _mm256_fnmadd_ps(k, _mm256_set1_ps(FP16_OPS_EXP_LN2_LO),
+		_mm256_fnmadd_ps(k, _mm256_set1_ps(FP16_OPS_EXP_LN2_HI), x));
+	__m256 p = _mm256_set1_ps(FP16_OPS_EXP_P0);
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(FP16_OPS_EXP_P1));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(FP16_OPS_EXP_P2));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(FP16_OPS_EXP_P3));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(FP16_OPS_EXP_P4));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(FP16_OPS_EXP_P5));
+	p = _mm256_add_ps(_mm256_fmadd_ps(_mm256_mul_ps(p, r), r, r), _mm256_set1_ps(1.0f));
+	return _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(p), _mm256_slli_epi32(_mm256_castps_si256(t), 23)));
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline __m256i fp16_ops_order_f16c(__m256i h) {
+	return _mm256_xor_si256(h, _mm256_and_si256(_mm256_srai_epi16(h, 15), _mm256_set1_epi16(0x7FFF)));
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline __m256i fp16_ops_is_nan_f16c(__m256i h) {
+	return _mm256_cmpgt_epi16(_mm256_and_si256(h, _mm256_set1_epi16(0x7FFF)), _mm256_set1_epi16(0x7C00));
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline void fp16_ops_add_f16c(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		fp16_ops_store8_f16c(out + i, _mm256_add_ps(fp16_blas_load8_f16c(a + i), fp16_blas_load8_f16c(b + i)));
+	}
+	fp16_ops_add_scalar(a + i, b + i, out + i, n - i);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline void fp16_ops_mul_f16c(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		fp16_ops_store8_f16c(out + i, _mm256_mul_ps(fp16_blas_load8_f16c(a + i), fp16_blas_load8_f16c(b + i)));
+	}
+	fp16_ops_mul_scalar(a + i, b + i, out + i, n - i);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline void fp16_ops_fma_f16c(const uint16_t* a, const uint16_t* b, const uint16_t* c, uint16_t* out,
+	size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256 p = _mm256_mul_ps(fp16_blas_load8_f16c(a + i), fp16_blas_load8_f16c(b + i));
+		fp16_ops_store8_f16c(out + i, fp16_ops_add_odd_f16c(p, fp16_blas_load8_f16c(c + i)));
+	}
+	fp16_ops_fma_scalar(a + i, b + i, c + i, out + i, n - i);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline void fp16_ops_clamp_f16c(const uint16_t* x, uint16_t* out, size_t n, int16_t lo, int16_t hi) {
+	const __m256i lo_v = _mm256_set1_epi16(lo);
+	const __m256i hi_v = _mm256_set1_epi16(hi);
+	const __m256i nan_bits = _mm256_set1_epi16(0x7E00);
+	const __m256i sign_mask = _mm256_set1_epi16((short) 0x8000);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m256i h = _mm256_loadu_si256((const __m256i*) (x + i));
+		const __m256i key = _mm256_min_epi16(_mm256_max_epi16(fp16_ops_order_f16c(h), lo_v), hi_v);
+		const __m256i canonical = _mm256_or_si256(_mm256_and_si256(h, sign_mask), nan_bits);
+		const __m256i result = _mm256_blendv_epi8(fp16_ops_order_f16c(key), canonical, fp16_ops_is_nan_f16c(h));
+		_mm256_storeu_si256((__m256i*) (out + i), result);
+	}
+	fp16_ops_clamp_scalar(x + i, out + i, n - i, lo, hi);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline uint16_t fp16_ops_max_f16c(const uint16_t* x, size_t n) {
+	__m256i best = _mm256_set1_epi16(FP16_OPS_ORDER_NEG_INF);
+	__m256i nan = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m256i h = _mm256_loadu_si256((const __m256i*) (x + i));
+		best = _mm256_max_epi16(best, fp16_ops_order_f16c(h));
+		nan = _mm256_or_si256(nan, fp16_ops_is_nan_f16c(h));
+	}
+	__m128i best128 = _mm_max_epi16(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+	best128 = _mm_max_epi16(best128, _mm_shuffle_epi32(best128, _MM_SHUFFLE(1, 0, 3, 2)));
+	best128 = _mm_max_epi16(best128, _mm_shuffle_epi32(best128, _MM_SHUFFLE(2, 3, 0, 1)));
+	best128 = _mm_max_epi16(best128, _mm_srli_epi32(best128, 16));
+	return fp16_ops_max_finish(x + i, n - i, (int16_t) _mm_cvtsi128_si32(best128), !_mm256_testz_si256(nan, nan));
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline float fp16_ops_sum_f16c(const uint16_t* x, size_t n) {
+	__m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		acc0 = _mm256_add_ps(acc0, fp16_blas_load8_f16c(x + i));
+		acc1 = _mm256_add_ps(acc1, fp16_blas_load8_f16c(x + i + 8));
+	}
+	return fp16_blas_hsum_avx(_mm256_add_ps(acc0, acc1)) + fp16_ops_sum_scalar(x + i, n - i);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline float fp16_ops_sum_kahan_f16c(const uint16_t* x, size_t n) {
+	__m256 sum[2] = { _mm256_setzero_ps(), _mm256_setzero_ps() };
+	__m256 comp[2] = { _mm256_setzero_ps(), _mm256_setzero_ps() };
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		for (int j = 0; j < 2; j++) {
+			const __m256 y = _mm256_sub_ps(fp16_blas_load8_f16c(x + i + 8 * j), comp[j]);
+			const __m256 t = _mm256_add_ps(sum[j], y);
+			comp[j] = _mm256_sub_ps(_mm256_sub_ps(t, sum[j]), y);
+			sum[j] = t;
+		}
+	}
+	float sums[16], comps[16];
+	for (int j = 0; j < 2; j++) {
+		_mm256_storeu_ps(sums + 8 * j, sum[j]);
+		_mm256_storeu_ps(comps + 8 * j, comp[j]);
+	}
+	return fp16_ops_sum_kahan_finish(sums, comps, 16, x + i, n - i);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline float fp16_ops_ssd_f16c(const uint16_t* x, size_t n, float center) {
+	const __m256 center_v = _mm256_set1_ps(center);
+	__m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m256 d0 = _mm256_sub_ps(fp16_blas_load8_f16c(x + i), center_v);
+		const __m256 d1 = _mm256_sub_ps(fp16_blas_load8_f16c(x + i + 8), center_v);
+		acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+		acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+	}
+	return fp16_blas_hsum_avx(_mm256_add_ps(acc0, acc1)) + fp16_ops_ssd_scalar(x + i, n - i, center);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline float fp16_ops_exp_sum_f16c(const uint16_t* x, size_t n, float shift) {
+	const __m256 shift_v = _mm256_set1_ps(shift);
+	__m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		acc0 = _mm256_add_ps(acc0, fp16_ops_exp_f16c(_mm256_sub_ps(fp16_blas_load8_f16c(x + i), shift_v)));
+		acc1 = _mm256_add_ps(acc1, fp16_ops_exp_f16c(_mm256_sub_ps(fp16_blas_load8_f16c(x + i + 8), shift_v)));
+	}
+	return fp16_blas_hsum_avx(_mm256_add_ps(acc0, acc1)) + fp16_ops_exp_sum_scalar(x + i, n - i, shift);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline void fp16_ops_exp_scale_f16c(const uint16_t* x, uint16_t* out, size_t n, float shift, float scale) {
+	const __m256 shift_v = _mm256_set1_ps(shift);
+	const __m256 scale_v = _mm256_set1_ps(scale);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256 e = fp16_ops_exp_f16c(_mm256_sub_ps(fp16_blas_load8_f16c(x + i), shift_v));
+		fp16_ops_store8_f16c(out + i, _mm256_mul_ps(e, scale_v));
+	}
+	fp16_ops_exp_scale_scalar(x + i, out + i, n - i, shift, scale);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline void fp16_ops_normalize_f16c(const uint16_t* x, uint16_t* out, size_t n, float mean, float rstd,
+	const float* gamma, const float* beta)
+{
+	const __m256 mean_v = _mm256_set1_ps(mean);
+	const __m256 rstd_v = _mm256_set1_ps(rstd);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256 y = _mm256_mul_ps(_mm256_sub_ps(fp16_blas_load8_f16c(x + i), mean_v), rstd_v);
+		fp16_ops_store8_f16c(out + i, _mm256_fmadd_ps(y, _mm256_loadu_ps(gamma + i), _mm256_loadu_ps(beta + i)));
+	}
+	fp16_ops_normalize_scalar(x + i, out + i, n - i, mean, rstd, gamma + i, beta + i);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline void fp16_ops_store16_avx512f(uint16_t* p, __m512 f) {
+	const __m256i h = _mm512_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	const __mmask16 is_nan = _mm512_cmp_ps_mask(f, f, _CMP_UNORD_Q);
+	const __m256i canonical = _mm256_or_si256(_mm256_and_si256(h, _mm256_set1_epi16((short) 0x8000)),
+		_mm256_set1_epi16(0x7E00));
+	_mm256_storeu_si256((__m256i*) p, _mm256_mask_blend_epi16(is_nan, h, canonical));
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline __m512 fp16_ops_add_odd_avx512f(__m512 p, __m512 c) {
+	const __m512 s = _mm512_add_ps(p, c);
+	const __m512 bb = _mm512_sub_ps(s, p);
+	const __m512 e = _mm512_add_ps(_mm512_sub_ps(p, _mm512_sub_ps(s, bb)), _mm512_sub_ps(c, bb));
+	const __m512i bits = _mm512_castps_si512(s);
+	const __m512i one = _mm512_set1_epi32(1);
+	const __mmask16 inexact = _mm512_cmp_ps_mask(e, _mm512_setzero_ps(), _CMP_NEQ_OQ);
+	const __mmask16 even = _mm512_testn_epi32_mask(bits, one);
+	const __m512i step = _mm512_or_si512(_mm512_srai_epi32(_mm512_xor_si512(bits, _mm512_castps_si512(e)), 31), one);
+	return _mm512_castsi512_ps(_mm512_mask_add_epi32(bits, inexact & even, bits, step));
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline __m512 fp16_ops_exp_avx512f(__m512 x) {
+	x = _mm512_max_ps(_mm512_set1_ps(FP16_OPS_EXP_MIN), x);
+	x = _mm512_min_ps(_mm512_set1_ps(FP16_OPS_EXP_MAX), x);
+	const __m512 t = _mm512_fmadd_ps(x, _mm512_set1_ps(FP16_OPS_EXP_LOG2E), _mm512_set1_ps(FP16_OPS_EXP_MAGIC));
+	const __m512 k = _mm512_sub_ps(t, _mm512_set1_ps(FP16_OPS_EXP_MAGIC));
+	const __m512 r = _mm512_fnmadd_ps(k, _mm512_set1_ps(FP16_OPS_EXP_LN2_LO),
+		_mm512_fnmadd_ps(k, _mm512_set1_ps(FP16_OPS_EXP_LN2_HI), x));
+	__m512 p = _mm512_set1_ps(FP16_OPS_EXP_P0);
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(FP16_OPS_EXP_P1));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(FP16_OPS_EXP_P2));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(FP16_OPS_EXP_P3));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(FP16_OPS_EXP_P4));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(FP16_OPS_EXP_P5));
+	p = _mm512_add_ps(_mm512_fmadd_ps(_mm512_mul_ps(p, r), r, r), _mm512_set1_ps(1.0f));
+	return _mm512_castsi512_ps(_mm512_add_epi32(_mm512_castps_si512(p), _mm512_slli_epi32(_mm512_castps_si512(t), 23)));
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline __m512i fp16_ops_order_avx512f(__m512i h) {
+	return _mm512_xor_si512(h, _mm512_and_si512(_mm512_srai_epi16(h, 15), _mm512_set1_epi16(0x7FFF)));
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline __mmask32 fp16_ops_is_nan_avx512f(__m512i h) {
+	return _mm512_cmpgt_epi16_mask(_mm512_and_si512(h, _mm512_set1_epi16(0x7FFF)), _mm512_set1_epi16(0x7C00));
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline void fp16_ops_add_avx512f(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m512 sum = _mm512_add_ps(fp16_blas_load16_avx512f(a + i), fp16_blas_load16_avx512f(b + i));
+		fp16_ops_store16_avx512f(out + i, sum);
+	}
+	fp16_ops_add_scalar(a + i, b + i, out + i, n - i);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline void fp16_ops_mul_avx512f(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m512 product = _mm512_mul_ps(fp16_blas_load16_avx512f(a + i), fp16_blas_load16_avx512f(b + i));
+		fp16_ops_store16_avx512f(out + i, product);
+	}
+	fp16_ops_mul_scalar(a + i, b + i, out + i, n - i);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline void fp16_ops_fma_avx512f(const uint16_t* a, const uint16_t* b, const uint16_t* c, uint16_t* out,
+	size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m512 p = _mm512_mul_ps(fp16_blas_load16_avx512f(a + i), fp16_blas_load16_avx512f(b + i));
+		fp16_ops_store16_avx512f(out + i, fp16_ops_add_odd_avx512f(p, fp16_blas_load16_avx512f(c + i)));
+	}
+	fp16_ops_fma_scalar(a + i, b + i, c + i, out + i, n - i);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline void fp16_ops_clamp_avx512f(const uint16_t* x, uint16_t* out, size_t n, int16_t lo, int16_t hi) {
+	const __m512i lo_v = _mm512_set1_epi16(lo);
+	const __m512i hi_v = _mm512_set1_epi16(hi);
+	const __m512i nan_bits = _mm512_set1_epi16(0x7E00);
+	const __m512i sign_mask = _mm512_set1_epi16((short) 0x8000);
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		const __m512i h = _mm512_loadu_si512((const void*) (x + i));
+		const __m512i key = _mm512_min_epi16(_mm512_max_epi16(fp16_ops_order_avx512f(h), lo_v), hi_v);
+		const __m512i canonical = _mm512_or_si512(_mm512_and_si512(h, sign_mask), nan_bits);
+		const __m512i result =
+			_mm512_mask_blend_epi16(fp16_ops_is_nan_avx512f(h), fp16_ops_order_avx512f(key), canonical);
+		_mm512_storeu_si512((void*) (out + i), result);
+	}
+	fp16_ops_clamp_scalar(x + i, out + i, n - i, lo, hi);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline uint16_t fp16_ops_max_avx512f(const uint16_t* x, size_t n) {
+	__m512i best = _mm512_set1_epi16(FP16_OPS_ORDER_NEG_INF);
+	__mmask32 nan = 0;
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		const __m512i h = _mm512_loadu_si512((const void*) (x + i));
+		best = _mm512_max_epi16(best, fp16_ops_order_avx512f(h));
+		nan |= fp16_ops_is_nan_avx512f(h);
+	}
+	const __m256i best256 = _mm256_max_epi16(_mm512_castsi512_si256(best), _mm512_extracti64x4_epi64(best, 1));
+	__m128i best128 = _mm_max_epi16(_mm256_castsi256_si128(best256), _mm256_extracti128_si256(best256, 1));
+	best128 = _mm_max_epi16(best128, _mm_shuffle_epi32(best128, _MM_SHUFFLE(1, 0, 3, 2)));
+	best128 = _mm_max_epi16(best128, _mm_shuffle_epi32(best128, _MM_SHUFFLE(2, 3, 0, 1)));
+	best128 = _mm_max_epi16(best128, _mm_srli_epi32(best128, 16));
+	return fp16_ops_max_finish(x + i, n - i, (int16_t) _mm_cvtsi128_si32(best128), nan != 0);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline float fp16_ops_sum_avx512f(const uint16_t* x, size_t n) {
+	__m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		acc0 = _mm512_add_ps(acc0, fp16_blas_load16_avx512f(x + i));
+		acc1 = _mm512_add_ps(acc1, fp16_blas_load16_avx512f(x + i + 16));
+	}
+	return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1)) + fp16_ops_sum_scalar(x + i, n - i);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline float fp16_ops_sum_kahan_avx512f(const uint16_t* x, size_t n) {
+	__m512 sum[2] = { _mm512_setzero_ps(), _mm512_setzero_ps() };
+	__m512 comp[2] = { _mm512_setzero_ps(), _mm512_setzero_ps() };
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		for (int j = 0; j < 2; j++) {
+			const __m512 y = _mm512_sub_ps(fp16_blas_load16_avx512f(x + i + 16 * j), comp[j]);
+			const __m512 t = _mm512_add_ps(sum[j], y);
+			comp[j] = _mm512_sub_ps(_mm512_sub_ps(t, sum[j]), y);
+			sum[j] = t;
+		}
+	}
+	float sums[32], comps[32];
+	for (int j = 0; j < 2; j++) {
+		_mm512_storeu_ps(sums + 16 * j, sum[j]);
+		_mm512_storeu_ps(comps + 16 * j, comp[j]);
+	}
+	return fp16_ops_sum_kahan_finish(sums, comps, 32, x + i, n - i);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline float fp16_ops_ssd_avx512f(const uint16_t* x, size_t n, float center) {
+	const __m512 center_v = _mm512_set1_ps(center);
+	__m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		const __m512 d0 = _mm512_sub_ps(fp16_blas_load16_avx512f(x + i), center_v);
+		const __m512 d1 = _mm512_sub_ps(fp16_blas_load16_avx512f(x + i + 16), center_v);
+		acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+		acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+	}
+	return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1)) + fp16_ops_ssd_scalar(x + i, n - i, center);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline float fp16_ops_exp_sum_avx512f(const uint16_t* x, size_t n, float shift) {
+	const __m512 shift_v = _mm512_set1_ps(shift);
+	__m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		acc0 = _mm512_add_ps(acc0, fp16_ops_exp_avx512f(_mm512_sub_ps(fp16_blas_load16_avx512f(x + i), shift_v)));
+		acc1 = _mm512_add_ps(acc1, fp16_ops_exp_avx512f(_mm512_sub_ps(fp16_blas_load16_avx512f(x + i + 16), shift_v)));
+	}
+	return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1)) + fp16_ops_exp_sum_scalar(x + i, n - i, shift);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline void fp16_ops_exp_scale_avx512f(const uint16_t* x, uint16_t* out, size_t n, float shift, float scale) {
+	const __m512 shift_v = _mm512_set1_ps(shift);
+	const __m512 scale_v = _mm512_set1_ps(scale);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m512 e = fp16_ops_exp_avx512f(_mm512_sub_ps(fp16_blas_load16_avx512f(x + i), shift_v));
+		fp16_ops_store16_avx512f(out + i, _mm512_mul_ps(e, scale_v));
+	}
+	fp16_ops_exp_scale_scalar(x + i, out + i, n - i, shift, scale);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,fma")
+static inline void fp16_ops_normalize_avx512f(const uint16_t* x, uint16_t* out, size_t n, float mean, float rstd,
+	const float* gamma, const float* beta)
+{
+	const __m512 mean_v = _mm512_set1_ps(mean);
+	const __m512 rstd_v = _mm512_set1_ps(rstd);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m512 y = _mm512_mul_ps(_mm512_sub_ps(fp16_blas_load16_avx512f(x + i), mean_v), rstd_v);
+		fp16_ops_store16_avx512f(out + i, _mm512_fmadd_ps(y, _mm512_loadu_ps(gamma + i), _mm512_loadu_ps(beta + i)));
+	}
+	fp16_ops_normalize_scalar(x + i, out + i, n - i, mean, rstd, gamma + i, beta + i);
+}
+#endif
+
+#ifdef FP16_ARRAY_ARM
+static inline float32x4_t fp16_ops_add_odd_neon(float32x4_t p, float32x4_t c) {
+	const float32x4_t s = vaddq_f32(p, c);
+	const float32x4_t bb = vsubq_f32(s, p);
+	const float32x4_t e = vaddq_f32(vsubq_f32(p, vsubq_f32(s, bb)), vsubq_f32(c, bb));
+	const uint32x4_t bits = vreinterpretq_u32_f32(s);
+	const uint32x4_t inexact = vorrq_u32(vcltzq_f32(e), vcgtzq_f32(e));
+	const uint32x4_t even = vceqzq_u32(vandq_u32(bits, vdupq_n_u32(1)));
+	// +1 if e has the sign of s (away from zero), -1 otherwise
+	const int32x4_t step = vorrq_s32(vshrq_n_s32(vreinterpretq_s32_u32(veorq_u32(bits, vreinterpretq_u32_f32(e))), 31),
+		vdupq_n_s32(1));
+	const uint32x4_t adjust = vandq_u32(vandq_u32(inexact, even), vreinterpretq_u32_s32(step));
+	return vreinterpretq_f32_u32(vaddq_u32(bits, adjust));
+}
+
+static inline float32x4_t fp16_ops_exp_neon(float32x4_t x) {
+	x = vmaxq_f32(x, vdupq_n_f32(FP16_OPS_EXP_MIN));
+	x = vminq_f32(x, vdupq_n_f32(FP16_OPS_EXP_MAX));
+	const float32x4_t t = vfmaq_f32(vdupq_n_f32(FP16_OPS_EXP_MAGIC), x, vdupq_n_f32(FP16_OPS_EXP_LOG2E));
+	const float32x4_t k = vsubq_f32(t, vdupq_n_f32(FP16_OPS_EXP_MAGIC));
+	const float32x4_t r =
+		vfmsq_f32(vfmsq_f32(x, k, vdupq_n_f32(FP16_OPS_EXP_LN2_HI)), k, vdupq_n_f32(FP16_OPS_EXP_LN2_LO));
+	float32x4_t p = vdupq_n_f32(FP16_OPS_EXP_P0);
+	p = vfmaq_f32(vdupq_n_f32(FP16_OPS_EXP_P1), p, r);
+	p = vfmaq_f32(vdupq_n_f32(FP16_OPS_EXP_P2), p, r);
+	p = vfmaq_f32(vdupq_n_f32(FP16_OPS_EXP_P3), p, r);
+	p = vfmaq_f32(vdupq_n_f32(FP16_OPS_EXP_P4), p, r);
+	p = vfmaq_f32(vdupq_n_f32(FP16_OPS_EXP_P5), p, r);
+	p = vaddq_f32(vfmaq_f32(r, vmulq_f32(p, r), r), vdupq_n_f32(1.0f));
+	return vreinterpretq_f32_u32(vaddq_u32(vreinterpretq_u32_f32(p), vshlq_n_u32(vreinterpretq_u32_f32(t), 23)));
+}
+
+static inline int16x8_t fp16_ops_order_neon(uint16x8_t h) {
+	const uint16x8_t flip = vandq_u16(vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(h), 15)),
+		vdupq_n_u16(UINT16_C(0x7FFF)));
+	return vreinterpretq_s16_u16(veorq_u16(h, flip));
+}
+
+static inline uint16x8_t fp16_ops_is_nan_neon(uint16x8_t h) {
+	return vcgtq_u16(vandq_u16(h, vdupq_n_u16(UINT16_C(0x7FFF))), vdupq_n_u16(UINT16_C(0x7C00)));
+}
+
+static inline void fp16_ops_add_neon(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const float32x4_t lo = vaddq_f32(fp16_blas_load4_neon(a + i), fp16_blas_load4_neon(b + i));
+		const float32x4_t hi = vaddq_f32(fp16_blas_load4_neon(a + i + 4), fp16_blas_load4_neon(b + i + 4));
+		vst1q_u16(out + i, fp16_ieee_from_fp32_neon_x8(lo, hi));
+	}
+	fp16_ops_add_scalar(a + i, b + i, out + i, n - i);
+}
+
+static inline void fp16_ops_mul_neon(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const float32x4_t lo = vmulq_f32(fp16_blas_load4_neon(a + i), fp16_blas_load4_neon(b + i));
+		const float32x4_t hi = vmulq_f32(fp16_blas_load4_neon(a + i + 4), fp16_blas_load4_neon(b + i + 4));
+		vst1q_u16(out + i, fp16_ieee_from_fp32_neon_x8(lo, hi));
+	}
+	fp16_ops_mul_scalar(a + i, b + i, out + i, n - i);
+}
+
+static inline void fp16_ops_fma_neon(const uint16_t* a, const uint16_t* b, const uint16_t* c, uint16_t* out,
+	size_t n)
+{
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const float32x4_t p_lo = vmulq_f32(fp16_blas_load4_neon(a + i), fp16_blas_load4_neon(b + i));
+		const float32x4_t p_hi = vmulq_f32(fp16_blas_load4_neon(a + i + 4), fp16_blas_load4_neon(b + i + 4));
+		vst1q_u16(out + i, fp16_ieee_from_fp32_neon_x8(fp16_ops_add_odd_neon(p_lo, fp16_blas_load4_neon(c + i)),
+			fp16_ops_add_odd_neon(p_hi, fp16_blas_load4_neon(c + i + 4))));
+	}
+	fp16_ops_fma_scalar(a + i, b + i, c + i, out + i, n - i);
+}
+
+static inline void fp16_ops_clamp_neon(const uint16_t* x, uint16_t* out, size_t n, int16_t lo, int16_t hi) {
+	const int16x8_t lo_v = vdupq_n_s16(lo);
+	const int16x8_t hi_v = vdupq_n_s16(hi);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const uint16x8_t h = vld1q_u16(x + i);
+		const int16x8_t key = vminq_s16(vmaxq_s16(fp16_ops_order_neon(h), lo_v), hi_v);
+		const uint16x8_t canonical =
+			vorrq_u16(vandq_u16(h, vdupq_n_u16(UINT16_C(0x8000))), vdupq_n_u16(UINT16_C(0x7E00)));
+		const uint16x8_t result = vbslq_u16(fp16_ops_is_nan_neon(h), canonical,
+			vreinterpretq_u16_s16(fp16_ops_order_neon(vreinterpretq_u16_s16(key))));
+		vst1q_u16(out + i, result);
+	}
+	fp16_ops_clamp_scalar(x + i, out + i, n - i, lo, hi);
+}
+
+static inline uint16_t fp16_ops_max_neon(const uint16_t* x, size_t n) {
+	int16x8_t best = vdupq_n_s16(FP16_OPS_ORDER_NEG_INF);
+	uint16x8_t nan = vdupq_n_u16(0);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const uint16x8_t h = vld1q_u16(x + i);
+		best = vmaxq_s16(best, fp16_ops_order_neon(h));
+		nan = vorrq_u16(nan, fp16_ops_is_nan_neon(h));
+	}
+	return fp16_ops_max_finish(x + i, n - i, vmaxvq_s16(best), vmaxvq_u16(nan) != 0);
+}
+
+static inline float fp16_ops_sum_neon(const uint16_t* x, size_t n) {
+	float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		acc0 = vaddq_f32(acc0, fp16_blas_load4_neon(x + i));
+		acc1 = vaddq_f32(acc1, fp16_blas_load4_neon(x + i + 4));
+	}
+	return vaddvq_f32(vaddq_f32(acc0, acc1)) + fp16_ops_sum_scalar(x + i, n - i);
+}
+
+static inline float fp16_ops_sum_kahan_neon(const uint16_t* x, size_t n) {
+	float32x4_t sum[2] = { vdupq_n_f32(0.0f), vdupq_n_f32(0.0f) };
+	float32x4_t comp[2] = { vdupq_n_f32(0.0f), vdupq_n_f32(0.0f) };
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		for (int j = 0; j < 2; j++) {
+			const float32x4_t y = vsubq_f32(fp16_blas_load4_neon(x + i + 4 * j), comp[j]);
+			const float32x4_t t = vaddq_f32(sum[j], y);
+			comp[j] = vsubq_f32(vsubq_f32(t, sum[j]), y);
+			sum[j] = t;
+		}
+	}
+	float sums[8], comps[8];
+	for (int j = 0; j < 2; j++) {
+		vst1q_f32(sums + 4 * j, sum[j]);
+		vst1q_f32(comps + 4 * j, comp[j]);
+	}
+	return fp16_ops_sum_kahan_finish(sums, comps, 8, x + i, n - i);
+}
+
+static inline float fp16_ops_ssd_neon(const uint16_t* x, size_t n, float center) {
+	const float32x4_t center_v = vdupq_n_f32(center);
+	float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const float32x4_t d0 = vsubq_f32(fp16_blas_load4_neon(x + i), center_v);
+		const float32x4_t d1 = vsubq_f32(fp16_blas_load4_neon(x + i + 4), center_v);
+		acc0 = vfmaq_f32(acc0, d0, d0);
+		acc1 = vfmaq_f32(acc1, d1, d1);
+	}
+	return vaddvq_f32(vaddq_f32(acc0, acc1)) + fp16_ops_ssd_scalar(x + i, n - i, center);
+}
+
+static inline float fp16_ops_exp_sum_neon(const uint16_t* x, size_t n, float shift) {
+	const float32x4_t shift_v = vdupq_n_f32(shift);
+	float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		acc0 = vaddq_f32(acc0, fp16_ops_exp_neon(vsubq_f32(fp16_blas_load4_neon(x + i), shift_v)));
+		acc1 = vaddq_f32(acc1, fp16_ops_exp_neon(vsubq_f32(fp16_blas_load4_neon(x + i + 4), shift_v)));
+	}
+	return vaddvq_f32(vaddq_f32(acc0, acc1)) + fp16_ops_exp_sum_scalar(x + i, n - i, shift);
+}
+
+static inline void fp16_ops_exp_scale_neon(const uint16_t* x, uint16_t* out, size_t n, float shift, float scale) {
+	const float32x4_t shift_v = vdupq_n_f32(shift);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const float32x4_t lo = fp16_ops_exp_neon(vsubq_f32(fp16_blas_load4_neon(x + i), shift_v));
+		const float32x4_t hi = fp16_ops_exp_neon(vsubq_f32(fp16_blas_load4_neon(x + i + 4), shift_v));
+		vst1q_u16(out + i, fp16_ieee_from_fp32_neon_x8(vmulq_n_f32(lo, scale), vmulq_n_f32(hi, scale)));
+	}
+	fp16_ops_exp_scale_scalar(x + i, out + i, n - i, shift, scale);
+}
+
+static inline void fp16_ops_normalize_neon(const uint16_t* x, uint16_t* out, size_t n, float mean, float rstd,
+	const float* gamma, const float* beta)
+{
+	const float32x4_t mean_v = vdupq_n_f32(mean);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const float32x4_t y_lo = vmulq_n_f32(vsubq_f32(fp16_blas_load4_neon(x + i), mean_v), rstd);
+		const float32x4_t y_hi = vmulq_n_f32(vsubq_f32(fp16_blas_load4_neon(x + i + 4), mean_v), rstd);
+		vst1q_u16(out + i, fp16_ieee_from_fp32_neon_x8(vfmaq_f32(vld1q_f32(beta + i), y_lo, vld1q_f32(gamma + i)),
+			vfmaq_f32(vld1q_f32(beta + i + 4), y_hi, vld1q_f32(gamma + i + 4))));
+	}
+	fp16_ops_normalize_scalar(x + i, out + i, n - i, mean, rstd, gamma + i, beta + i);
+}
+#endif
+
+/*
+ * Runtime dispatch, the same scheme as fp16_blas.h.
+ */
+static const struct fp16_ops_kernel fp16_ops_kernel_table[] = {
+	{ "scalar", fp16_blas_has_scalar,
+		fp16_ops_add_scalar, fp16_ops_mul_scalar, fp16_ops_fma_scalar, fp16_ops_clamp_scalar, fp16_ops_max_scalar,
+		fp16_ops_sum_scalar, fp16_ops_sum_kahan_scalar, fp16_ops_ssd_scalar, fp16_ops_exp_sum_scalar,
+		fp16_ops_exp_scale_scalar, fp16_ops_normalize_scalar },
+#ifdef FP16_ARRAY_X86
+	{ "sse2", fp16_x86_has_sse2,
+		fp16_ops_add_sse2, fp16_ops_mul_sse2, fp16_ops_fma_sse2, fp16_ops_clamp_sse2, fp16_ops_max_sse2,
+		fp16_ops_sum_sse2, fp16_ops_sum_kahan_sse2, fp16_ops_ssd_sse2, fp16_ops_exp_sum_sse2,
+		fp16_ops_exp_scale_sse2, fp16_ops_normalize_sse2 },
+	{ "f16c", fp16_x86_has_fma,
+		fp16_ops_add_f16c, fp16_ops_mul_f16c, fp16_ops_fma_f16c, fp16_ops_clamp_f16c, fp16_ops_max_f16c,
+		fp16_ops_sum_f16c, fp16_ops_sum_kahan_f16c, fp16_ops_ssd_f16c, fp16_ops_exp_sum_f16c,
+		fp16_ops_exp_scale_f16c, fp16_ops_normalize_f16c },
+	{ "avx512f", fp16_x86_has_avx512f_fma,
+		fp16_ops_add_avx512f, fp16_ops_mul_avx512f, fp16_ops_fma_avx512f, fp16_ops_clamp_avx512f, fp16_ops_max_avx512f,
+		fp16_ops_sum_avx512f, fp16_ops_sum_kahan_avx512f, fp16_ops_ssd_avx512f, fp16_ops_exp_sum_avx512f,
+		fp16_ops_exp_scale_avx512f, fp16_ops_normalize_avx512f },
+#endif
+#ifdef FP16_ARRAY_ARM
+	{ "neon", fp16_arm_has_neon,
+		fp16_ops_add_neon, fp16_ops_mul_neon, fp16_ops_fma_neon, fp16_ops_clamp_neon, fp16_ops_max_neon,
+		fp16_ops_sum_neon, fp16_ops_sum_kahan_neon, fp16_ops_ssd_neon, fp16_ops_exp_sum_neon,
+		fp16_ops_exp_scale_neon, fp16_ops_normalize_neon },
+#endif
+};
+
+#define FP16_OPS_KERNEL_COUNT (sizeof(fp16_ops_kernel_table) / sizeof(fp16_ops_kernel_table[0]))
+
+static struct fp16_ops_kernel fp16_ops_kernels = {
+	"scalar", fp16_blas_has_scalar,
+	fp16_ops_add_scalar, fp16_ops_mul_scalar, fp16_ops_fma_scalar, fp16_ops_clamp_scalar, fp16_ops_max_scalar,
+	fp16_ops_sum_scalar, fp16_ops_sum_kahan_scalar, fp16_ops_ssd_scalar, fp16_ops_exp_sum_scalar,
+	fp16_ops_exp_scale_scalar, fp16_ops_normalize_scalar
+};
+
+#if defined(__GNUC__)
+__attribute__((__constructor__, __unused__))
+#endif
+static void fp16_ops_init(void) {
+	for (size_t k = 0; k < FP16_OPS_KERNEL_COUNT; k++) {
+		if (fp16_ops_kernel_table[k].supported()) {
+			fp16_ops_kernels = fp16_ops_kernel_table[k];
+		}
+	}
+}
+
+/*
+ * out[i] = a[i] + b[i], all in IEEE half precision (bit representation), correctly rounded.
+ */
+static inline void fp16_ieee_add(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	fp16_ops_kernels.add(a, b, out, n);
+}
+
+/*
+ * out[i] = a[i] * b[i], correctly rounded.
+ */
+static inline void fp16_ieee_mul(const uint16_t* a, const uint16_t* b, uint16_t* out, size_t n) {
+	fp16_ops_kernels.mul(a, b, out, n);
+}
+
+/*
+ * out[i] = a[i] * b[i] + c[i] with a single rounding, like an fp16 fused multiply-add.
+ */
+static inline void fp16_ieee_fma(const uint16_t* a, const uint16_t* b, const uint16_t* c, uint16_t* out, size_t n) {
+	fp16_ops_kernels.fma(a, b, c, out, n);
+}
+
+/*
+ * out[i] = x[i] limited to [lo, hi]. NaNs stay NaN; lo and hi must not be NaN, and lo <= hi.
+ */
+static inline void fp16_ieee_clamp(const uint16_t* x, uint16_t* out, size_t n, float lo, float hi) {
+	const int16_t lo_key = (int16_t) fp16_ops_order(fp16_ieee_from_fp32_value(lo));
+	const int16_t hi_key = (int16_t) fp16_ops_order(fp16_ieee_from_fp32_value(hi));
+	fp16_ops_kernels.clamp(x, out, n, lo_key, hi_key);
+}
+
+/*
+ * Sum of x[i], accumulated in fp32.
+ */
+static inline float fp16_ieee_sum(const uint16_t* x, size_t n) {
+	return fp16_ops_kernels.sum(x, n);
+}
+
+/*
+ * Sum of x[i], accumulated in fp32 with compensation: the error does not grow with n like that of fp16_ieee_sum.
+ */
+static inline float fp16_ieee_sum_kahan(const uint16_t* x, size_t n) {
+	return fp16_ops_kernels.sum_kahan(x, n);
+}
+
+/*
+ * The largest x[i]: -Inf if n is 0, NaN if any x[i] is NaN.
+ */
+static inline float fp16_ieee_max(const uint16_t* x, size_t n) {
+	return fp16_ieee_to_fp32_value(fp16_ops_kernels.max(x, n));
+}
+
+/*
+ * Square root of the sum of x[i]**2.
+ */
+static inline float fp16_ieee_norm2(const uint16_t* x, size_t n) {
+	return sqrtf(fp16_ops_kernels.ssd(x, n, 0.0f));
+}
+
+/*
+ * Mean and population variance (divided by n) of x[i]. The variance is the mean of (x[i] - mean)**2, from a second
+ * pass over x, so it does not suffer the cancellation of the one-pass formula.
+ */
+static inline void fp16_ieee_mean_var(const uint16_t* x, size_t n, float* mean, float* var) {
+	const float m = fp16_ops_kernels.sum(x, n) / (float) n;
+	*mean = m;
+	*var = fp16_ops_kernels.ssd(x, n, m) / (float) n;
+}
+
+/*
+ * out[i] = exp(x[i]) / sum of exp(x[j]), computed as exp(x[i] - max) / sum of exp(x[j] - max). x is read three times
+ * (maximum, sum, output); out may be x.
+ */
+static inline void fp16_ieee_softmax(const uint16_t* x, uint16_t* out, size_t n) {
+	if (n == 0) {
+		return;
+	}
+	const float max = fp16_ieee_max(x, n);
+	if (!(fabsf(max) <= 65504.0f)) {
+		// NaN or Inf in x (or all -Inf)
+		for (size_t i = 0; i < n; i++) {
+			out[i] = UINT16_C(0x7E00);
+		}
+		return;
+	}
+	const float sum = fp16_ops_kernels.exp_sum(x, n, max);
+	fp16_ops_kernels.exp_scale(x, out, n, max, 1.0f / sum);
+}
+
+/*
+ * out[i] = (x[i] - mean) / sqrt(var + eps) * gamma[i] + beta[i], mean and var as in fp16_ieee_mean_var; gamma and
+ * beta in single precision. x is read three times; out may be x.
+ */
+static inline void fp16_ieee_layernorm(const uint16_t* x, uint16_t* out, size_t n, const float* gamma,
+	const float* beta, float eps)
+{
+	float mean, var;
+	fp16_ieee_mean_var(x, n, &mean, &var);
+	fp16_ops_kernels.normalize(x, out, n, mean, 1.0f / sqrtf(var + eps), gamma, beta);
+}
+
+#endif /* FP16_OPS_H */
@@ -0,0 +1,455 @@
+/*
+ * Checks and throughput of the half-precision elementwise, reduction and fused kernels of fp16_ops.h.
+ *
+ * Every kernel the CPU supports is checked first:
+ * - add, mul and fma must be the correctly rounded fp16 result of the exact operation. For add and mul the exact result
+ *   fits a double; for fma the check is that the distance to the exact a * b + c, computed as the double product minus
+ *   the error of the double sum, is at most that of the two neighbours, with ties to even.
+ * - clamp and max are compared with the definitions of fp16_ops.h on decoded numbers.
+ * - sum, the L2 norm, softmax and layernorm are compared with double-precision references: the sums within
+ *   n * 2^-24 * sum |x[i]| (sum_kahan within 2^-23), the fp16 outputs within 0.5 ulp plus the same
+ *   n * 2^-24 relative error of the fp32 reductions behind them.
+ * The program exits with 1 on any failure.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_ops_bench.c -o fp16_ops_bench -lm
+ *
+ * Usage: ./fp16_ops_bench [elements] [repetitions]
+ *
+ * The timing compares each function with the two-pass way: fp16_ieee_to_fp32_array into fp32 buffers, a plain fp32
+ * loop, and fp16_ieee_from_fp32_array back when the result is an array. GB/s counts the bytes of the half-precision
+ * inputs and outputs only. The default of 16M elements is far larger than the caches.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fp16_ops.h"
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* xorshift32, only used to fill the inputs */
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static void* checked_malloc(size_t size) {
+	void* p = malloc(size);
+	if (p == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	return p;
+}
+
+/* Distance of the exact value hi + lo to the half-precision number h; h must be finite */
+static double distance(double hi, double lo, uint16_t h) {
+	return fabs((hi - (double) fp16_ieee_to_fp32_value(h)) + lo);
+}
+
+/*
+ * Whether h is hi + lo (exact, |lo| much smaller than ulp(hi)) rounded to nearest even in fp16. NaN results are only
+ * checked for being NaN.
+ */
+static int is_rounded(double hi, double lo, uint16_t h) {
+	if (hi != hi) {
+		return fp16_ops_is_nan(h);
+	}
+	if (fabs(hi) >= 65520.0) {
+		return h == (hi > 0.0 ? UINT16_C(0x7C00) : UINT16_C(0xFC00));
+	}
+	if ((h & UINT16_C(0x7C00)) == UINT16_C(0x7C00)) {
+		return 0;
+	}
+	const double d = distance(hi, lo, h);
+	// The neighbours, toward +Inf and toward -Inf (skipping the zero of the other sign)
+	const uint16_t up = h == UINT16_C(0x8000) ? 1 : h & UINT16_C(0x8000) ? h - 1 : h + 1;
+	const uint16_t down = h == 0 ? UINT16_C(0x8001) : h & UINT16_C(0x8000) ? h + 1 : h - 1;
+	const uint16_t neighbours[2] = { up, down };
+	for (int k = 0; k < 2; k++) {
+		if ((neighbours[k] & UINT16_C(0x7C00)) == UINT16_C(0x7C00)) {
+			continue;
+		}
+		const double d_k = distance(hi, lo, neighbours[k]);
+		if (d_k < d || (d_k == d && (h & 1) != 0)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static uint16_t random_half(uint32_t* state) {
+	const uint32_t r = next_random(state);
+	// One in 64 an infinity or a NaN
+	if (r % 64 == 0) {
+		return (uint16_t) ((r >> 16 & 0x8000) | 0x7C00 | (r >> 8 & 1 ? 0 : r >> 20 & 0x3FF));
+	}
+	return (uint16_t) (r >> 8);
+}
+
+static int check_kernel(const struct fp16_ops_kernel* kernel) {
+	const size_t n = 100003;
+	uint16_t* a = checked_malloc(n * sizeof(uint16_t));
+	uint16_t* b = checked_malloc(n * sizeof(uint16_t));
+	uint16_t* c = checked_malloc(n * sizeof(uint16_t));
+	uint16_t* out = checked_malloc(n * sizeof(uint16_t));
+	float* gamma = checked_malloc(n * sizeof(float));
+	float* beta = checked_malloc(n * sizeof(float));
+	uint32_t state = 1;
+	size_t errors[8] = { 0 };
+	for (int round = 0; round < 8; round++) {
+		for (size_t i = 0; i < n; i++) {
+			a[i] = random_half(&state);
+			b[i] = random_half(&state);
+			c[i] = random_half(&state);
+			if (round % 2 == 1) {
+				// c close to -a * b, where the fma result is small and the rounding of a plain fp32 sum goes wrong
+				const float p = fp16_ieee_to_fp32_value(a[i]) * fp16_ieee_to_fp32_value(b[i]);
+				c[i] = fp16_ieee_from_fp32_value(-p) ^ (uint16_t) (next_random(&state) & 1);
+			}
+		}
+
+		kernel->add(a, b, out, n);
+		for (size_t i = 0; i < n; i++) {
+			const double exact = (double) fp16_ieee_to_fp32_value(a[i]) + fp16_ieee_to_fp32_value(b[i]);
+			errors[0] += !is_rounded(exact, 0.0, out[i]);
+		}
+		kernel->mul(a, b, out, n);
+		for (size_t i = 0; i < n; i++) {
+			const double exact = (double) fp16_ieee_to_fp32_value(a[i]) * fp16_ieee_to_fp32_value(b[i]);
+			errors[1] += !is_rounded(exact, 0.0, out[i]);
+		}
+		kernel->fma(a, b, c, out, n);
+		for (size_t i = 0; i < n; i++) {
+			// The product is exact in double; TwoSum gives the sum as hi + lo exactly
+			const double p = (double) fp16_ieee_to_fp32_value(a[i]) * fp16_ieee_to_fp32_value(b[i]);
+			const double q = fp16_ieee_to_fp32_value(c[i]);
+			const double hi = p + q;
+			const double bb = hi - p;
+			const double lo = (p - (hi - bb)) + (q - bb);
+			errors[2] += !is_rounded(hi, lo == lo ? lo : 0.0, out[i]);
+		}
+
+		const float lo = -fp16_ieee_to_fp32_value((uint16_t) (next_random(&state) % 0x7C00));
+		const float hi = fp16_ieee_to_fp32_value((uint16_t) (next_random(&state) % 0x7C00));
+		const int16_t lo_key = (int16_t) fp16_ops_order(fp16_ieee_from_fp32_value(lo));
+		const int16_t hi_key = (int16_t) fp16_ops_order(fp16_ieee_from_fp32_value(hi));
+		kernel->clamp(a, out, n, lo_key, hi_key);
+		for (size_t i = 0; i < n; i++) {
+			const float x = fp16_ieee_to_fp32_value(a[i]);
+			uint16_t expected;
+			if (x != x) {
+				expected = (a[i] & UINT16_C(0x8000)) | UINT16_C(0x7E00);
+			} else if (x < lo || (x == lo && signbit(x) && !signbit(lo))) {
+				expected = fp16_ieee_from_fp32_value(lo);
+			} else if (x > hi || (x == hi && !signbit(x) && signbit(hi))) {
+				expected = fp16_ieee_from_fp32_value(hi);
+			} else {
+				expected = a[i];
+			}
+			errors[3] += out[i] != expected;
+		}
+
+		// Without NaNs, then with one
+		for (size_t i = 0; i < n; i++) {
+			a[i] = fp16_ops_is_nan(a[i]) ? UINT16_C(0xFC00) : a[i];
+		}
+		float max = -INFINITY;
+		for (size_t i = 0; i < n; i++) {
+			const float x = fp16_ieee_to_fp32_value(a[i]);
+			max = x > max || (x == max && !signbit(x)) ? x : max;
+		}
+		errors[4] += fp32_to_bits(fp16_ieee_to_fp32_value(kernel->max(a, n))) != fp32_to_bits(max);
+		errors[4] += kernel->max(a, 0) != UINT16_C(0xFC00);
+		const size_t nan_index = next_random(&state) % n;
+		const uint16_t saved = a[nan_index];
+		a[nan_index] = UINT16_C(0x7D01);
+		errors[4] += kernel->max(a, n) != UINT16_C(0x7E00);
+		a[nan_index] = saved;
+
+		// Finite inputs for the rest
+		for (size_t i = 0; i < n; i++) {
+			a[i] = (a[i] & UINT16_C(0x7C00)) == UINT16_C(0x7C00) ? a[i] & UINT16_C(0xBFFF) : a[i];
+		}
+		double sum = 0.0, magnitude = 0.0, squares = 0.0;
+		for (size_t i = 0; i < n; i++) {
+			const double x = fp16_ieee_to_fp32_value(a[i]);
+			sum += x;
+			magnitude += fabs(x);
+			squares += x * x;
+		}
+		errors[5] += fabs(kernel->sum(a, n) - sum) > (double) n * 0x1.0p-24 * magnitude;
+		errors[5] += fabs(kernel->sum_kahan(a, n) - sum) > 0x1.0p-23 * magnitude;
+		errors[5] += fabs(kernel->ssd(a, n, 0.0f) - squares) > (double) n * 0x1.0p-24 * squares;
+
+		// softmax and layernorm on values in [-8, 8], the usual range of logits and activations
+		for (size_t i = 0; i < n; i++) {
+			a[i] = fp16_ieee_from_fp32_value((float) ((int32_t) (next_random(&state) % 16001) - 8000) * 1e-3f);
+			gamma[i] = 0.5f + (float) (next_random(&state) % 1000) * 1e-3f;
+			beta[i] = (float) ((int32_t) (next_random(&state) % 1001) - 500) * 1e-3f;
+		}
+		const struct fp16_ops_kernel saved_kernels = fp16_ops_kernels;
+		fp16_ops_kernels = *kernel;
+		double max_x = -INFINITY, exp_sum = 0.0, mean = 0.0, var = 0.0;
+		for (size_t i = 0; i < n; i++) {
+			max_x = fmax(max_x, fp16_ieee_to_fp32_value(a[i]));
+			mean += fp16_ieee_to_fp32_value(a[i]);
+		}
+		mean /= (double) n;
+		for (size_t i = 0; i < n; i++) {
+			exp_sum += exp(fp16_ieee_to_fp32_value(a[i]) - max_x);
+			var += (fp16_ieee_to_fp32_value(a[i]) - mean) * (fp16_ieee_to_fp32_value(a[i]) - mean);
+		}
+		var /= (double) n;
+		// The fp32 reductions behind both are only good to n * 2^-24 relative in the worst case
+		const double sum_error = (double) n * 0x1.0p-24;
+		fp16_ieee_softmax(a, out, n);
+		for (size_t i = 0; i < n; i++) {
+			const double expected = exp(fp16_ieee_to_fp32_value(a[i]) - max_x) / exp_sum;
+			const double ulp = expected < 0x1.0p-14 ? 0x1.0p-24 : ldexp(1.0, ilogb(expected) - 10);
+			errors[6] += fabs(fp16_ieee_to_fp32_value(out[i]) - expected) > 0.5 * ulp + sum_error * expected;
+		}
+		fp16_ieee_layernorm(a, out, n, gamma, beta, 1e-5f);
+		for (size_t i = 0; i < n; i++) {
+			const double y = (fp16_ieee_to_fp32_value(a[i]) - mean) / sqrt(var + 1e-5) * gamma[i];
+			const double expected = y + beta[i];
+			const double scale = fmax(fabs(expected), fmax(fabs(y), fabs(beta[i])));
+			const double ulp = scale < 0x1.0p-14 ? 0x1.0p-24 : ldexp(1.0, ilogb(scale) - 10);
+			errors[7] += fabs(fp16_ieee_to_fp32_value(out[i]) - expected) > 0.5 * ulp + sum_error * scale;
+		}
+		fp16_ops_kernels = saved_kernels;
+	}
+
+	static const char* const names[8] = { "add", "mul", "fma", "clamp", "max", "sums", "softmax", "layernorm" };
+	size_t total = 0;
+	printf("%-8s", kernel->name);
+	for (int k = 0; k < 8; k++) {
+		printf(" %s %s", names[k], errors[k] == 0 ? "ok" : "FAILED");
+		total += errors[k];
+	}
+	printf("\n");
+	free(a);
+	free(b);
+	free(c);
+	free(out);
+	free(gamma);
+	free(beta);
+	return total != 0;
+}
+
+/* The fp32 halves of the two-pass baselines, out of line so that the repetitions are not merged */
+#if defined(__GNUC__)
+__attribute__((__noinline__))
+#endif
+static void add_fp32(const float* a, const float* b, float* out, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		out[i] = a[i] + b[i];
+	}
+}
+
+#if defined(__GNUC__)
+__attribute__((__noinline__))
+#endif
+static void fma_fp32(const float* a, const float* b, const float* c, float* out, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		out[i] = a[i] * b[i] + c[i];
+	}
+}
+
+#if defined(__GNUC__)
+__attribute__((__noinline__))
+#endif
+static float sum_fp32(const float* x, size_t n) {
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		sum += x[i];
+	}
+	return sum;
+}
+
+#if defined(__GNUC__)
+__attribute__((__noinline__))
+#endif
+static void softmax_fp32(float* x, size_t n) {
+	float max = -INFINITY;
+	for (size_t i = 0; i < n; i++) {
+		max = x[i] > max ? x[i] : max;
+	}
+	float sum = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		x[i] = expf(x[i] - max);
+		sum += x[i];
+	}
+	const float scale = 1.0f / sum;
+	for (size_t i = 0; i < n; i++) {
+		x[i] *= scale;
+	}
+}
+
+#if defined(__GNUC__)
+__attribute__((__noinline__))
+#endif
+static void layernorm_fp32(float* x, size_t n, const float* gamma, const float* beta) {
+	float mean = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		mean += x[i];
+	}
+	mean /= (float) n;
+	float var = 0.0f;
+	for (size_t i = 0; i < n; i++) {
+		var += (x[i] - mean) * (x[i] - mean);
+	}
+	const float rstd = 1.0f / sqrtf(var / (float) n + 1e-5f);
+	for (size_t i = 0; i < n; i++) {
+		x[i] = (x[i] - mean) * rstd * gamma[i] + beta[i];
+	}
+}
+
+static volatile float sink;
+
+static void report(const char* test, const char* name, size_t bytes, size_t repetitions, double seconds) {
+	printf("%-10s %-20s %8.3f ms %8.2f GB/s\n", test, name, seconds * 1e3 / (double) repetitions,
+		(double) bytes * (double) repetitions / seconds * 1e-9);
+}
+
+int main(int argc, char** argv) {
+	const size_t n = argc > 1 ? (size_t) strtoull(argv[1], NULL, 0) : (size_t) 1 << 24;
+	const size_t repetitions = argc > 2 ? (size_t) strtoull(argv[2], NULL, 0) : 10;
+
+	int failures = 0;
+	for (size_t k = 0; k < FP16_OPS_KERNEL_COUNT; k++) {
+		if (fp16_ops_kernel_table[k].supported()) {
+			failures += check_kernel(&fp16_ops_kernel_table[k]);
+		}
+	}
+	printf("using %s\n\n", fp16_ops_kernels.name);
+
+	uint16_t* a = checked_malloc(n * sizeof(uint16_t));
+	uint16_t* b = checked_malloc(n * sizeof(uint16_t));
+	uint16_t* c = checked_malloc(n * sizeof(uint16_t));
+	uint16_t* out = checked_malloc(n * sizeof(uint16_t));
+	float* fa = checked_malloc(n * sizeof(float));
+	float* fb = checked_malloc(n * sizeof(float));
+	float* fc = checked_malloc(n * sizeof(float));
+	float* gamma = checked_malloc(n * sizeof(float));
+	float* beta = checked_malloc(n * sizeof(float));
+	uint32_t state = 1;
+	for (size_t i = 0; i < n; i++) {
+		a[i] = fp16_ieee_from_fp32_value((float) ((int32_t) (next_random(&state) % 16001) - 8000) * 1e-3f);
+		b[i] = fp16_ieee_from_fp32_value((float) ((int32_t) (next_random(&state) % 16001) - 8000) * 1e-3f);
+		c[i] = fp16_ieee_from_fp32_value((float) ((int32_t) (next_random(&state) % 16001) - 8000) * 1e-3f);
+		gamma[i] = 1.0f;
+		beta[i] = 0.0f;
+	}
+
+	double start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ieee_to_fp32_array(a, fa, n);
+		fp16_ieee_to_fp32_array(b, fb, n);
+		add_fp32(fa, fb, fc, n);
+		fp16_ieee_from_fp32_array(fc, out, n);
+	}
+	report("add", "expand + fp32", 6 * n, repetitions, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ieee_add(a, b, out, n);
+	}
+	report("add", "fused", 6 * n, repetitions, now_seconds() - start);
+
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ieee_to_fp32_array(a, fa, n);
+		fp16_ieee_to_fp32_array(b, fb, n);
+		fp16_ieee_to_fp32_array(c, fc, n);
+		fma_fp32(fa, fb, fc, fc, n);
+		fp16_ieee_from_fp32_array(fc, out, n);
+	}
+	report("fma", "expand + fp32", 8 * n, repetitions, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ieee_fma(a, b, c, out, n);
+	}
+	report("fma", "fused", 8 * n, repetitions, now_seconds() - start);
+
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ieee_clamp(a, out, n, -1.0f, 1.0f);
+	}
+	report("clamp", "fused", 4 * n, repetitions, now_seconds() - start);
+
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ieee_to_fp32_array(a, fa, n);
+		sink = sum_fp32(fa, n);
+	}
+	report("sum", "expand + fp32", 2 * n, repetitions, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		sink = fp16_ieee_sum(a, n);
+	}
+	report("sum", "fused", 2 * n, repetitions, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		sink = fp16_ieee_sum_kahan(a, n);
+	}
+	report("sum", "fused, Kahan", 2 * n, repetitions, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		sink = fp16_ieee_max(a, n);
+	}
+	report("max", "fused", 2 * n, repetitions, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		sink = fp16_ieee_norm2(a, n);
+	}
+	report("norm2", "fused", 2 * n, repetitions, now_seconds() - start);
+
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ieee_to_fp32_array(a, fa, n);
+		softmax_fp32(fa, n);
+		fp16_ieee_from_fp32_array(fa, out, n);
+	}
+	report("softmax", "expand + fp32", 4 * n, repetitions, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ieee_softmax(a, out, n);
+	}
+	report("softmax", "fused", 4 * n, repetitions, now_seconds() - start);
+
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ieee_to_fp32_array(a, fa, n);
+		layernorm_fp32(fa, n, gamma, beta);
+		fp16_ieee_from_fp32_array(fa, out, n);
+	}
+	report("layernorm", "expand + fp32", 4 * n, repetitions, now_seconds() - start);
+	start = now_seconds();
+	for (size_t r = 0; r < repetitions; r++) {
+		fp16_ieee_layernorm(a, out, n, gamma, beta, 1e-5f);
+	}
+	report("layernorm", "fused", 4 * n, repetitions, now_seconds() - start);
+
+	free(a);
+	free(b);
+	free(c);
+	free(out);
+	free(fa);
+	free(fb);
+	free(fc);
+	free(gamma);
+	free(beta);
+	return failures != 0;
+}
@@ -0,0 +1,983 @@
+#pragma once
+#ifndef FP16_PACK_H
+#define FP16_PACK_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cerrno>
+	#include <cstddef>
+	#include <cstdint>
+	#include <cstdlib>
+	#include <cstring>
+#else
+	#include <errno.h>
+	#include <stddef.h>
+	#include <stdint.h>
+	#include <stdlib.h>
+	#include <string.h>
+#endif
+
+#include "fp16_array.h"
+#include "fp16_parallel.h"
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#elif defined(__aarch64__)
+	#include <arm_neon.h>
+#endif
+
+/*
+ * Lossless compression of half-precision tensors, for checkpoints and KV-cache snapshots on disk or on the wire.
+ *
+ * The high byte of an fp16 number is the sign, the 5 exponent bits and the top 2 mantissa bits. In weights and
+ * activations it takes a few dozen values, while the low byte (the other 8 mantissa bits) is close to uniform. Mixed
+ * in one byte stream the two hide each other from a byte-oriented coder, so the numbers are first split into a plane
+ * of low bytes and a plane of high bytes (the byte shuffle of Blosc and HDF5), and each plane is coded on its own.
+ *
+ * fp16_ieee_from_fp32_planes / fp16_ieee_to_fp32_planes fuse the shuffle with the conversion: FP16_PACK_CHUNK
+ * elements at a time go through fp16_ieee_from_fp32_array into a buffer that stays in L1, and the buffer is split into
+ * the two planes with SSE2 (PAND / PSRLW + PACKUSWB) or NEON (LD2), 16 numbers per step. The results are bit-identical
+ * to the array functions.
+ *
+ * The container, all integers little-endian:
+ *
+ *      +--------+---------+---------+-----+-------------+-------+
+ *      | header | block 0 | block 1 | ... | block B - 1 | index |
+ *      +--------+---------+---------+-----+-------------+-------+
+ *
+ * - header, FP16_PACK_HEADER_SIZE bytes: "FP16PACK", version (u32), elements per block (u32), elements (u64), offset
+ *   of the index (u64).
+ * - block: FP16_PACK_BLOCK elements (the last one can be shorter), as the plane of low bytes followed by the plane of
+ *   high bytes. A plane starts with its mode byte:
+ *   - FP16_PACK_STORED: the bytes as they are,
+ *   - FP16_PACK_CONSTANT: one byte, repeated for the whole plane,
+ *   - FP16_PACK_HUFFMAN: 128 bytes with the 4-bit code lengths of the 256 byte values (value 2k in the low nibble of
+ *     byte k), the sizes of 4 bit streams (u32), and the streams. The code is a canonical Huffman code of at most
+ *     FP16_PACK_HUFFMAN_BITS bits built for this plane, written least significant bit first. Stream k holds bytes
+ *     k * (n / 4) to (k + 1) * (n / 4) of the plane, the last stream the rest. The decoder reads the 4 streams in
+ *     lockstep, so that 4 table lookups are in flight instead of one chain (as in the Huffman stage of zstd).
+ *   The encoder picks the smallest mode, so a block is never more than 2 bytes larger than its fp16 data.
+ * - index: B + 1 offsets (u64) from the start of the container, where block b starts and, last, where the index starts.
+ *
+ * The blocks do not depend on each other. fp16_pack_fp32 and fp16_unpack_fp32 (and their fp16 versions) process them
+ * on the threads of a fp16_parallel_pool, or on the calling thread when the pool is NULL. Compression writes every
+ * block at its worst-case position in dst and then moves the blocks down to close the gaps, one memmove per block on
+ * the calling thread, so it needs no memory besides dst and 2 * FP16_PACK_BLOCK bytes per block in flight.
+ * fp16_unpack_range_fp32 / _fp16 decode only the blocks of the requested elements, found through the index.
+ *
+ * The functions return 0, -EINVAL for bad arguments or a container that is not valid, -ENOSPC if dst is too small, or
+ * -ENOMEM. Every length and offset read from the container is checked before it is used, so a corrupt container gives
+ * -EINVAL (or wrong numbers, there is no checksum) but no access outside of it.
+ *
+ * The Huffman stage is order 0: a byte is coded without looking at its neighbours. On normally distributed weights,
+ * the low bytes come out stored and the high bytes take about 5.5 bits, so the container is about 15% smaller than
+ * the fp16 data (8% without the shuffle). A tensor with fewer distinct values, e.g. converted from bfloat16 or from
+ * int8, has a low byte plane with fewer values too and shrinks more.
+ */
+#define FP16_PACK_MAGIC "FP16PACK"
+#define FP16_PACK_VERSION 1
+#define FP16_PACK_HEADER_SIZE ((size_t) 32)
+
+/* 128 KB of fp16 data per block, the size of a chunk of fp16_parallel.h */
+#ifndef FP16_PACK_BLOCK
+	#define FP16_PACK_BLOCK ((size_t) 65536)
+#endif
+
+/* Elements per conversion + shuffle step, 4 KB of fp32 */
+#define FP16_PACK_CHUNK ((size_t) 1024)
+
+/* The longest code: the decoder looks the next 11 bits up in a table of 2048 entries, which stays in L1 */
+#define FP16_PACK_HUFFMAN_BITS 11
+
+#define FP16_PACK_STORED 0
+#define FP16_PACK_CONSTANT 1
+#define FP16_PACK_HUFFMAN 2
+
+/* A Huffman plane is coded as 4 streams, one per quarter, which the decoder reads in lockstep */
+#define FP16_PACK_STREAMS 4
+
+/* Mode byte, code lengths and stream sizes of a Huffman plane */
+#define FP16_PACK_HUFFMAN_HEADER_SIZE ((size_t) (1 + 128 + 4 * FP16_PACK_STREAMS))
+
+static inline void fp16_pack_store_le32(uint8_t* p, uint32_t w) {
+	p[0] = (uint8_t) w;
+	p[1] = (uint8_t) (w >> 8);
+	p[2] = (uint8_t) (w >> 16);
+	p[3] = (uint8_t) (w >> 24);
+}
+
+static inline void fp16_pack_store_le64(uint8_t* p, uint64_t w) {
+	fp16_pack_store_le32(p, (uint32_t) w);
+	fp16_pack_store_le32(p + 4, (uint32_t) (w >> 32));
+}
+
+static inline uint32_t fp16_pack_load_le32(const uint8_t* p) {
+	return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static inline uint64_t fp16_pack_load_le64(const uint8_t* p) {
+	uint64_t w;
+	memcpy(&w, p, sizeof(w));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	w = __builtin_bswap64(w);
+#endif
+	return w;
+}
+
+/*
+ * Split n 16-bit numbers into a plane of low bytes and a plane of high bytes.
+ */
+static inline void fp16_pack_split(const uint16_t* src, uint8_t* lo, uint8_t* hi, size_t n) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	for (; n - i >= 16; i += 16) {
+		const __m128i a = _mm_loadu_si128((const __m128i*) (src + i));
+		const __m128i b = _mm_loadu_si128((const __m128i*) (src + i + 8));
+		_mm_storeu_si128((__m128i*) (lo + i), _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+		_mm_storeu_si128((__m128i*) (hi + i), _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+	}
+#elif defined(__aarch64__) && !defined(__AARCH64EB__)
+	for (; n - i >= 16; i += 16) {
+		// LD2 deinterleaves the even (low) and odd (high) bytes
+		const uint8x16x2_t planes = vld2q_u8((const uint8_t*) (src + i));
+		vst1q_u8(lo + i, planes.val[0]);
+		vst1q_u8(hi + i, planes.val[1]);
+	}
+#endif
+	for (; i < n; i++) {
+		lo[i] = (uint8_t) src[i];
+		hi[i] = (uint8_t) (src[i] >> 8);
+	}
+}
+
+/*
+ * Interleave a plane of low bytes and a plane of high bytes back into n 16-bit numbers.
+ */
+static inline void fp16_pack_merge(const uint8_t* lo, const uint8_t* hi, uint16_t* dst, size_t n) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	for (; n - i >= 16; i += 16) {
+		const __m128i l = _mm_loadu_si128((const __m128i*) (lo + i));
+		const __m128i h = _mm_loadu_si128((const __m128i*) (hi + i));
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_unpacklo_epi8(l, h));
+		_mm_storeu_si128((__m128i*) (dst + i + 8), _mm_unpackhi_epi8(l, h));
+	}
+#elif defined(__aarch64__) && !defined(__AARCH64EB__)
+	for (; n - i >= 16; i += 16) {
+		uint8x16x2_t planes;
+		planes.val[0] = vld1q_u8(lo + i);
+		planes.val[1] = vld1q_u8(hi + i);
+		vst2q_u8((uint8_t*) (dst + i), planes);
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i] = (uint16_t) (lo[i] | hi[i] << 8);
+	}
+}
+
+/*
+ * Convert n fp32 numbers to IEEE half precision and write the low and the high byte of every result to separate
+ * planes: lo[i] = fp16(src[i]) & 0xFF, hi[i] = fp16(src[i]) >> 8.
+ *
+ * @note The numbers are bit-identical to fp16_ieee_from_fp32_array.
+ * @note src, lo and hi must not overlap.
+ */
+static inline void fp16_ieee_from_fp32_planes(const float* src, uint8_t* lo, uint8_t* hi, size_t n) {
+#if defined(__GNUC__)
+	__attribute__((__aligned__(64)))
+#endif
+	uint16_t buffer[FP16_PACK_CHUNK];
+	for (size_t i = 0; i < n; i += FP16_PACK_CHUNK) {
+		const size_t count = n - i < FP16_PACK_CHUNK ? n - i : FP16_PACK_CHUNK;
+		fp16_ieee_from_fp32_array(src + i, buffer, count);
+		fp16_pack_split(buffer, lo + i, hi + i, count);
+	}
+}
+
+/*
+ * Join the planes of fp16_ieee_from_fp32_planes and convert the numbers to fp32.
+ *
+ * @note The result is bit-identical to fp16_ieee_to_fp32_array.
+ * @note lo, hi and dst must not overlap.
+ */
+static inline void fp16_ieee_to_fp32_planes(const uint8_t* lo, const uint8_t* hi, float* dst, size_t n) {
+#if defined(__GNUC__)
+	__attribute__((__aligned__(64)))
+#endif
+	uint16_t buffer[FP16_PACK_CHUNK];
+	for (size_t i = 0; i < n; i += FP16_PACK_CHUNK) {
+		const size_t count = n - i < FP16_PACK_CHUNK ? n - i : FP16_PACK_CHUNK;
+		fp16_pack_merge(lo + i, hi + i, buffer, count);
+		fp16_ieee_to_fp32_array(buffer, dst + i, count);
+	}
+}
+
+/*
+ * Code lengths of a Huffman code for the byte frequencies in freq, at most FP16_PACK_HUFFMAN_BITS: 0 for the values
+ * that do not occur. At least two values must occur, lengths is left as it is otherwise.
+ *
+ * The tree is built with the two-queue method on the leaves sorted by weight. When it is too deep, the weights are
+ * halved (a nonzero weight stays nonzero) and the tree built again; with all weights at 1 it is 8 levels deep, so this
+ * ends. The code gets a little worse than an optimal length-limited one, which only matters for very skewed planes.
+ */
+static inline void fp16_pack_huffman_lengths(const uint32_t* freq, uint8_t* lengths) {
+	uint32_t weight[256];
+	memcpy(weight, freq, sizeof(weight));
+	for (;;) {
+		uint16_t leaf[256];
+		size_t leaves = 0;
+		for (size_t s = 0; s < 256; s++) {
+			if (weight[s] != 0) {
+				size_t k = leaves++;
+				for (; k != 0 && weight[leaf[k - 1]] > weight[s]; k--) {
+					leaf[k] = leaf[k - 1];
+				}
+				leaf[k] = (uint16_t) s;
+			}
+		}
+		if (leaves < 2) {
+			return;
+		}
+
+		// Nodes 0 to leaves - 1 are the leaves in order of weight, the internal nodes follow in the order they are made
+		uint32_t node_weight[511];
+		uint16_t parent[511];
+		uint8_t depth[511];
+		for (size_t k = 0; k < leaves; k++) {
+			node_weight[k] = weight[leaf[k]];
+		}
+		size_t next_leaf = 0, next_node = leaves, nodes = leaves;
+		for (size_t k = 1; k < leaves; k++) {
+			size_t pair[2];
+			for (size_t j = 0; j < 2; j++) {
+				if (next_leaf < leaves && (next_node == nodes || node_weight[next_leaf] <= node_weight[next_node])) {
+					pair[j] = next_leaf++;
+				} else {
+					pair[j] = next_node++;
+				}
+			}
+			node_weight[nodes] = node_weight[pair[0]] + node_weight[pair[1]];
+			parent[pair[0]] = parent[pair[1]] = (uint16_t) nodes;
+			nodes++;
+		}
+
+		// A parent comes after its children, so one pass from the root down gives the depths
+		uint8_t max_depth = 0;
+		depth[nodes - 1] = 0;
+		for (size_t k = nodes - 1; k-- != 0;) {
+			depth[k] = (uint8_t) (depth[parent[k]] + 1);
+			max_depth = depth[k] > max_depth ? depth[k] : max_depth;
+		}
+		if (max_depth <= FP16_PACK_HUFFMAN_BITS) {
+			memset(lengths, 0, 256);
+			for (size_t k = 0; k < leaves; k++) {
+				lengths[leaf[k]] = depth[k];
+			}
+			return;
+		}
+		for (size_t s = 0; s < 256; s++) {
+			weight[s] = weight[s] != 0 ? (weight[s] >> 1) | 1 : 0;
+		}
+	}
+}
+
+/*
+ * Canonical codes for lengths, as in DEFLATE: shorter codes first, values in increasing order within a length. The
+ * codes are bit-reversed, so that the first bit of a code is the least significant one.
+ */
+static inline void fp16_pack_huffman_codes(const uint8_t* lengths, uint16_t* codes) {
+	uint32_t count[FP16_PACK_HUFFMAN_BITS + 1] = { 0 };
+	for (size_t s = 0; s < 256; s++) {
+		count[lengths[s]]++;
+	}
+	count[0] = 0;
+	uint32_t next[FP16_PACK_HUFFMAN_BITS + 1];
+	uint32_t code = 0;
+	for (size_t len = 1; len <= FP16_PACK_HUFFMAN_BITS; len++) {
+		code = (code + count[len - 1]) << 1;
+		next[len] = code;
+	}
+	for (size_t s = 0; s < 256; s++) {
+		const uint32_t len = lengths[s];
+		codes[s] = 0;
+		if (len != 0) {
+			const uint32_t c = next[len]++;
+			uint32_t reversed = 0;
+			for (uint32_t b = 0; b < len; b++) {
+				reversed |= (c >> b & 1) << (len - 1 - b);
+			}
+			codes[s] = (uint16_t) reversed;
+		}
+	}
+}
+
+/*
+ * Count the byte values of each of the FP16_PACK_STREAMS quarters of a plane, the last quarter with the rest of the
+ * plane. The four tables also keep repeated values from waiting on each other.
+ */
+static inline void fp16_pack_histogram(const uint8_t* plane, size_t n, uint32_t counts[FP16_PACK_STREAMS][256]) {
+	memset(counts, 0, FP16_PACK_STREAMS * 256 * sizeof(uint32_t));
+	const size_t quarter = n / FP16_PACK_STREAMS;
+	for (size_t i = 0; i < quarter; i++) {
+		counts[0][plane[i]]++;
+		counts[1][plane[quarter + i]]++;
+		counts[2][plane[2 * quarter + i]]++;
+		counts[3][plane[3 * quarter + i]]++;
+	}
+	for (size_t i = 4 * quarter; i < n; i++) {
+		counts[3][plane[i]]++;
+	}
+}
+
+/*
+ * One stream of a Huffman plane being written, least significant bit first. Fewer than 32 bits wait in the buffer
+ * after a flush, so two codes of at most 11 bits can go in before the next one.
+ */
+struct fp16_pack_writer {
+	uint8_t* out;
+	uint64_t buffer;
+	uint32_t bits;
+};
+
+static inline void fp16_pack_writer_init(struct fp16_pack_writer* writer, uint8_t* out) {
+	writer->out = out;
+	writer->buffer = 0;
+	writer->bits = 0;
+}
+
+static inline void fp16_pack_writer_put(struct fp16_pack_writer* writer, uint32_t code, uint32_t length) {
+	writer->buffer |= (uint64_t) code << writer->bits;
+	writer->bits += length;
+}
+
+static inline void fp16_pack_writer_flush(struct fp16_pack_writer* writer) {
+	if (writer->bits >= 32) {
+		fp16_pack_store_le32(writer->out, (uint32_t) writer->buffer);
+		writer->out += 4;
+		writer->buffer >>= 32;
+		writer->bits -= 32;
+	}
+}
+
+/*
+ * Write the bits left, the last byte padded with zeros.
+ */
+static inline void fp16_pack_writer_finish(struct fp16_pack_writer* writer) {
+	for (; writer->bits != 0; writer->bits = writer->bits > 8 ? writer->bits - 8 : 0) {
+		*writer->out++ = (uint8_t) writer->buffer;
+		writer->buffer >>= 8;
+	}
+}
+
+/*
+ * Code a plane of n bytes into dst, which must have room for 1 + n bytes. Returns the number of bytes written.
+ */
+static inline size_t fp16_pack_encode_plane(const uint8_t* plane, size_t n, uint8_t* dst) {
+	uint32_t counts[FP16_PACK_STREAMS][256];
+	fp16_pack_histogram(plane, n, counts);
+	uint32_t freq[256];
+	size_t values = 0;
+	for (size_t s = 0; s < 256; s++) {
+		freq[s] = counts[0][s] + counts[1][s] + counts[2][s] + counts[3][s];
+		values += freq[s] != 0;
+	}
+	if (values == 1) {
+		dst[0] = FP16_PACK_CONSTANT;
+		dst[1] = plane[0];
+		return 2;
+	}
+
+	// The streams end at a byte boundary, and their sizes are known before they are written
+	uint8_t lengths[256];
+	size_t offsets[FP16_PACK_STREAMS + 1];
+	offsets[0] = FP16_PACK_HUFFMAN_HEADER_SIZE;
+	if (values != 0) {
+		fp16_pack_huffman_lengths(freq, lengths);
+		for (size_t k = 0; k < FP16_PACK_STREAMS; k++) {
+			uint64_t bits = 0;
+			for (size_t s = 0; s < 256; s++) {
+				bits += (uint64_t) counts[k][s] * lengths[s];
+			}
+			offsets[k + 1] = offsets[k] + (size_t) ((bits + 7) / 8);
+		}
+	}
+	if (values == 0 || offsets[FP16_PACK_STREAMS] >= 1 + n) {
+		dst[0] = FP16_PACK_STORED;
+		memcpy(dst + 1, plane, n);
+		return 1 + n;
+	}
+
+	dst[0] = FP16_PACK_HUFFMAN;
+	for (size_t k = 0; k < 128; k++) {
+		dst[1 + k] = (uint8_t) (lengths[2 * k] | lengths[2 * k + 1] << 4);
+	}
+	for (size_t k = 0; k < FP16_PACK_STREAMS; k++) {
+		fp16_pack_store_le32(dst + 129 + 4 * k, (uint32_t) (offsets[k + 1] - offsets[k]));
+	}
+	uint16_t codes[256];
+	fp16_pack_huffman_codes(lengths, codes);
+
+	// The four quarters in lockstep, as in the decoder, then the rest of the last one
+	struct fp16_pack_writer writers[FP16_PACK_STREAMS];
+	fp16_pack_writer_init(&writers[0], dst + offsets[0]);
+	fp16_pack_writer_init(&writers[1], dst + offsets[1]);
+	fp16_pack_writer_init(&writers[2], dst + offsets[2]);
+	fp16_pack_writer_init(&writers[3], dst + offsets[3]);
+	const size_t quarter = n / FP16_PACK_STREAMS;
+	const uint8_t* in0 = plane;
+	const uint8_t* in1 = plane + quarter;
+	const uint8_t* in2 = plane + 2 * quarter;
+	const uint8_t* in3 = plane + 3 * quarter;
+	size_t i = 0;
+	for (; quarter - i >= 2; i += 2) {
+		fp16_pack_writer_put(&writers[0], codes[in0[i]], lengths[in0[i]]);
+		fp16_pack_writer_put(&writers[1], codes[in1[i]], lengths[in1[i]]);
+		fp16_pack_writer_put(&writers[2], codes[in2[i]], lengths[in2[i]]);
+		fp16_pack_writer_put(&writers[3], codes[in3[i]], lengths[in3[i]]);
+		fp16_pack_writer_put(&writers[0], codes[in0[i + 1]], lengths[in0[i + 1]]);
+		fp16_pack_writer_put(&writers[1], codes[in1[i + 1]], lengths[in1[i + 1]]);
+		fp16_pack_writer_put(&writers[2], codes[in2[i + 1]], lengths[in2[i + 1]]);
+		fp16_pack_writer_put(&writers[3], codes[in3[i + 1]], lengths[in3[i + 1]]);
+		fp16_pack_writer_flush(&writers[0]);
+		fp16_pack_writer_flush(&writers[1]);
+		fp16_pack_writer_flush(&writers[2]);
+		fp16_pack_writer_flush(&writers[3]);
+	}
+	for (; i < quarter; i++) {
+		fp16_pack_writer_put(&writers[0], codes[in0[i]], lengths[in0[i]]);
+		fp16_pack_writer_put(&writers[1], codes[in1[i]], lengths[in1[i]]);
+		fp16_pack_writer_put(&writers[2], codes[in2[i]], lengths[in2[i]]);
+		fp16_pack_writer_put(&writers[3], codes[in3[i]], lengths[in3[i]]);
+	}
+	for (i = 4 * quarter; i < n; i++) {
+		fp16_pack_writer_flush(&writers[3]);
+		fp16_pack_writer_put(&writers[3], codes[plane[i]], lengths[plane[i]]);
+	}
+	fp16_pack_writer_finish(&writers[0]);
+	fp16_pack_writer_finish(&writers[1]);
+	fp16_pack_writer_finish(&writers[2]);
+	fp16_pack_writer_finish(&writers[3]);
+	return offsets[FP16_PACK_STREAMS];
+}
+
+/*
+ * One stream of a Huffman plane being decoded. Past the end of the stream the buffer fills with zero bits, which are
+ * counted in padding, so that a stream that is too short is caught at the end.
+ */
+struct fp16_pack_reader {
+	const uint8_t* stream;
+	size_t size;
+	size_t position;
+	size_t padding;
+	uint64_t buffer;
+	uint32_t bits;
+};
+
+static inline void fp16_pack_reader_init(struct fp16_pack_reader* reader, const uint8_t* src, size_t begin,
+	size_t end)
+{
+	reader->stream = src + begin;
+	reader->size = end - begin;
+	reader->position = 0;
+	reader->padding = 0;
+	reader->buffer = 0;
+	reader->bits = 0;
+}
+
+static inline int fp16_pack_reader_near_end(const struct fp16_pack_reader* reader) {
+	return reader->size - reader->position < 8;
+}
+
+/*
+ * Make at least 56 bits available, for 5 codes, when the stream has 8 more bytes. Whole bytes are counted; the bits of
+ * the next, partial byte are or-ed in again by the next refill.
+ */
+static inline void fp16_pack_reader_refill_fast(struct fp16_pack_reader* reader) {
+	reader->buffer |= fp16_pack_load_le64(reader->stream + reader->position) << reader->bits;
+	reader->position += (63 - reader->bits) >> 3;
+	reader->bits |= 56;
+}
+
+/*
+ * Make at least 56 bits available, anywhere in the stream.
+ */
+static inline void fp16_pack_reader_refill(struct fp16_pack_reader* reader) {
+	if (!fp16_pack_reader_near_end(reader)) {
+		fp16_pack_reader_refill_fast(reader);
+	} else {
+		for (; reader->bits <= 56; reader->bits += 8) {
+			if (reader->position < reader->size) {
+				reader->buffer |= (uint64_t) reader->stream[reader->position++] << reader->bits;
+			} else {
+				reader->padding += 8;
+			}
+		}
+	}
+}
+
+static inline uint8_t fp16_pack_reader_decode(struct fp16_pack_reader* reader, const uint16_t* table) {
+	const uint32_t entry = table[reader->buffer & ((UINT32_C(1) << FP16_PACK_HUFFMAN_BITS) - 1)];
+	reader->buffer >>= entry & 0xF;
+	reader->bits -= entry & 0xF;
+	return (uint8_t) (entry >> 4);
+}
+
+/*
+ * Whether the codes read did not go past the end of the stream.
+ */
+static inline int fp16_pack_reader_valid(const struct fp16_pack_reader* reader) {
+	return 8 * reader->position + reader->padding - reader->bits <= 8 * reader->size;
+}
+
+/*
+ * Decode the plane of n bytes at src, which has size bytes left in its block. Stored planes are not copied: *plane
+ * points into src for them, into scratch (n bytes) otherwise. Returns the size of the plane in src, or 0 if it is not
+ * valid.
+ */
+static inline size_t fp16_pack_decode_plane(const uint8_t* src, size_t size, size_t n, uint8_t* scratch,
+	const uint8_t** plane)
+{
+	if (size == 0) {
+		return 0;
+	}
+	switch (src[0]) {
+		case FP16_PACK_STORED:
+			if (size - 1 < n) {
+				return 0;
+			}
+			*plane = src + 1;
+			return 1 + n;
+		case FP16_PACK_CONSTANT:
+			if (size < 2) {
+				return 0;
+			}
+			memset(scratch, src[1], n);
+			*plane = scratch;
+			return 2;
+		case FP16_PACK_HUFFMAN:
+			break;
+		default:
+			return 0;
+	}
+	if (size < FP16_PACK_HUFFMAN_HEADER_SIZE) {
+		return 0;
+	}
+	size_t offsets[FP16_PACK_STREAMS + 1];
+	offsets[0] = FP16_PACK_HUFFMAN_HEADER_SIZE;
+	for (size_t k = 0; k < FP16_PACK_STREAMS; k++) {
+		const size_t stream_size = fp16_pack_load_le32(src + 129 + 4 * k);
+		if (size - offsets[k] < stream_size) {
+			return 0;
+		}
+		offsets[k + 1] = offsets[k] + stream_size;
+	}
+
+	// Every entry is (value << 4) | length; the lengths must make a complete code, so every entry gets filled
+	uint16_t table[1 << FP16_PACK_HUFFMAN_BITS];
+	uint8_t lengths[256];
+	uint32_t kraft = 0;
+	for (size_t s = 0; s < 256; s++) {
+		lengths[s] = (uint8_t) (src[1 + s / 2] >> (s % 2 * 4) & 0xF);
+		if (lengths[s] > FP16_PACK_HUFFMAN_BITS) {
+			return 0;
+		}
+		kraft += lengths[s] != 0 ? UINT32_C(1) << (FP16_PACK_HUFFMAN_BITS - lengths[s]) : 0;
+	}
+	if (kraft != UINT32_C(1) << FP16_PACK_HUFFMAN_BITS) {
+		return 0;
+	}
+	uint16_t codes[256];
+	fp16_pack_huffman_codes(lengths, codes);
+	for (size_t s = 0; s < 256; s++) {
+		if (lengths[s] != 0) {
+			for (size_t k = codes[s]; k < ((size_t) 1 << FP16_PACK_HUFFMAN_BITS); k += (size_t) 1 << lengths[s]) {
+				table[k] = (uint16_t) (s << 4 | lengths[s]);
+			}
+		}
+	}
+
+	// The four streams in lockstep, so that their table lookups overlap, then the rest of the last one. The readers
+	// are only indexed with constants, so that they can live in registers.
+	struct fp16_pack_reader readers[FP16_PACK_STREAMS];
+	fp16_pack_reader_init(&readers[0], src, offsets[0], offsets[1]);
+	fp16_pack_reader_init(&readers[1], src, offsets[1], offsets[2]);
+	fp16_pack_reader_init(&readers[2], src, offsets[2], offsets[3]);
+	fp16_pack_reader_init(&readers[3], src, offsets[3], offsets[4]);
+	const size_t quarter = n / FP16_PACK_STREAMS;
+	uint8_t* out0 = scratch;
+	uint8_t* out1 = scratch + quarter;
+	uint8_t* out2 = scratch + 2 * quarter;
+	uint8_t* out3 = scratch + 3 * quarter;
+	size_t i = 0;
+	for (; quarter - i >= 5 && fp16_pack_reader_near_end(&readers[0]) + fp16_pack_reader_near_end(&readers[1]) +
+		fp16_pack_reader_near_end(&readers[2]) + fp16_pack_reader_near_end(&readers[3]) == 0; i += 5)
+	{
+		fp16_pack_reader_refill_fast(&readers[0]);
+		fp16_pack_reader_refill_fast(&readers[1]);
+		fp16_pack_reader_refill_fast(&readers[2]);
+		fp16_pack_reader_refill_fast(&readers[3]);
+		for (size_t k = 0; k < 5; k++) {
+			out0[i + k] = fp16_pack_reader_decode(&readers[0], table);
+			out1[i + k] = fp16_pack_reader_decode(&readers[1], table);
+			out2[i + k] = fp16_pack_reader_decode(&readers[2], table);
+			out3[i + k] = fp16_pack_reader_decode(&readers[3], table);
+		}
+	}
+	while (i < quarter) {
+		fp16_pack_reader_refill(&readers[0]);
+		fp16_pack_reader_refill(&readers[1]);
+		fp16_pack_reader_refill(&readers[2]);
+		fp16_pack_reader_refill(&readers[3]);
+		for (size_t k = quarter - i < 5 ? quarter - i : 5; k != 0; k--, i++) {
+			out0[i] = fp16_pack_reader_decode(&readers[0], table);
+			out1[i] = fp16_pack_reader_decode(&readers[1], table);
+			out2[i] = fp16_pack_reader_decode(&readers[2], table);
+			out3[i] = fp16_pack_reader_decode(&readers[3], table);
+		}
+	}
+	for (size_t i = 4 * quarter; i < n; i++) {
+		fp16_pack_reader_refill(&readers[3]);
+		scratch[i] = fp16_pack_reader_decode(&readers[3], table);
+	}
+	if (!fp16_pack_reader_valid(&readers[0]) || !fp16_pack_reader_valid(&readers[1]) ||
+		!fp16_pack_reader_valid(&readers[2]) || !fp16_pack_reader_valid(&readers[3]))
+	{
+		return 0;
+	}
+	*plane = scratch;
+	return offsets[FP16_PACK_STREAMS];
+}
+
+/*
+ * Shuffle and code a block of n numbers, from src32 (converted on the way) or src16, into dst, which must have room
+ * for 2 * (1 + n) bytes. scratch holds the two planes, 2 * n bytes. Returns the size of the block.
+ */
+static inline size_t fp16_pack_encode_block(const float* src32, const uint16_t* src16, size_t n, uint8_t* scratch,
+	uint8_t* dst)
+{
+	if (src32 != NULL) {
+		fp16_ieee_from_fp32_planes(src32, scratch, scratch + n, n);
+	} else {
+		fp16_pack_split(src16, scratch, scratch + n, n);
+	}
+	const size_t size = fp16_pack_encode_plane(scratch, n, dst);
+	return size + fp16_pack_encode_plane(scratch + n, n, dst + size);
+}
+
+/*
+ * Decode numbers begin to end of a block of n numbers into dst32 or dst16 (at element 0). scratch is 2 * n bytes.
+ */
+static inline int fp16_pack_decode_block(const uint8_t* src, size_t size, size_t n, size_t begin, size_t end,
+	float* dst32, uint16_t* dst16, uint8_t* scratch)
+{
+	const uint8_t* lo = NULL;
+	const uint8_t* hi = NULL;
+	const size_t lo_size = fp16_pack_decode_plane(src, size, n, scratch, &lo);
+	if (lo_size == 0) {
+		return -EINVAL;
+	}
+	const size_t hi_size = fp16_pack_decode_plane(src + lo_size, size - lo_size, n, scratch + n, &hi);
+	if (hi_size == 0 || hi_size != size - lo_size) {
+		return -EINVAL;
+	}
+	if (dst32 != NULL) {
+		fp16_ieee_to_fp32_planes(lo + begin, hi + begin, dst32, end - begin);
+	} else {
+		fp16_pack_merge(lo + begin, hi + begin, dst16, end - begin);
+	}
+	return 0;
+}
+
+/*
+ * The header and the index of a container, checked.
+ */
+struct fp16_pack_info {
+	size_t count;
+	size_t block;
+	size_t blocks;
+	/* Offset of the index, which is also the end of the last block */
+	size_t index;
+};
+
+/*
+ * Read and check the header and the index of the container src of size bytes.
+ */
+static inline int fp16_pack_read_info(const void* src, size_t size, struct fp16_pack_info* info) {
+	const uint8_t* p = (const uint8_t*) src;
+	if (p == NULL || info == NULL || size < FP16_PACK_HEADER_SIZE || memcmp(p, FP16_PACK_MAGIC, 8) != 0 ||
+		fp16_pack_load_le32(p + 8) != FP16_PACK_VERSION)
+	{
+		return -EINVAL;
+	}
+	const uint64_t block = fp16_pack_load_le32(p + 12);
+	const uint64_t count = fp16_pack_load_le64(p + 16);
+	const uint64_t index = fp16_pack_load_le64(p + 24);
+	if (block == 0 || index < FP16_PACK_HEADER_SIZE || index > size || count > SIZE_MAX) {
+		return -EINVAL;
+	}
+	const uint64_t blocks = count / block + (count % block != 0);
+	if ((size - index) / 8 != blocks + 1 || (size - index) % 8 != 0) {
+		return -EINVAL;
+	}
+	uint64_t previous = FP16_PACK_HEADER_SIZE;
+	for (uint64_t b = 0; b <= blocks; b++) {
+		const uint64_t offset = fp16_pack_load_le64(p + index + 8 * b);
+		if (offset < previous || offset > index || (b == 0 && offset != FP16_PACK_HEADER_SIZE) ||
+			(b == blocks && offset != index))
+		{
+			return -EINVAL;
+		}
+		previous = offset;
+	}
+	info->count = (size_t) count;
+	info->block = (size_t) block;
+	info->blocks = (size_t) blocks;
+	info->index = (size_t) index;
+	return 0;
+}
+
+/*
+ * Size of the largest container for n numbers: every plane stored.
+ */
+static inline size_t fp16_pack_bound(size_t n) {
+	const size_t blocks = n / FP16_PACK_BLOCK + (n % FP16_PACK_BLOCK != 0);
+	return FP16_PACK_HEADER_SIZE + 2 * n + 2 * blocks + 8 * (blocks + 1);
+}
+
+/*
+ * One block of a compression or a decompression, run by the parallel driver.
+ */
+struct fp16_pack_task {
+	const float* src32;
+	const uint16_t* src16;
+	float* dst32;
+	uint16_t* dst16;
+	const uint8_t* packed;
+	uint8_t* out;
+	size_t n;
+	size_t size;
+	int status;
+};
+
+static inline void fp16_pack_task_encode(const void* src, void* dst, size_t n) {
+	(void) src;
+	struct fp16_pack_task* task = (struct fp16_pack_task*) dst;
+	for (size_t t = 0; t < n; t++) {
+		uint8_t* scratch = (uint8_t*) malloc(2 * task[t].n);
+		if (scratch == NULL) {
+			task[t].status = -ENOMEM;
+			continue;
+		}
+		task[t].size = fp16_pack_encode_block(task[t].src32, task[t].src16, task[t].n, scratch, task[t].out);
+		task[t].status = 0;
+		free(scratch);
+	}
+}
+
+static inline void fp16_pack_task_decode(const void* src, void* dst, size_t n) {
+	(void) src;
+	struct fp16_pack_task* task = (struct fp16_pack_task*) dst;
+	for (size_t t = 0; t < n; t++) {
+		uint8_t* scratch = (uint8_t*) malloc(2 * task[t].n);
+		if (scratch == NULL) {
+			task[t].status = -ENOMEM;
+			continue;
+		}
+		task[t].status = fp16_pack_decode_block(task[t].packed, task[t].size, task[t].n, 0, task[t].n,
+			task[t].dst32, task[t].dst16, scratch);
+		free(scratch);
+	}
+}
+
+/*
+ * Run fn on every task, one task per chunk of the pool, or on the calling thread if pool is NULL.
+ */
+static inline void fp16_pack_run(struct fp16_parallel_pool* pool, fp16_parallel_fn fn, struct fp16_pack_task* tasks,
+	size_t count)
+{
+	if (pool == NULL) {
+		fn(tasks, tasks, count);
+		return;
+	}
+	const struct fp16_parallel_job job = {
+		fn, (const char*) tasks, (char*) tasks, sizeof(struct fp16_pack_task), sizeof(struct fp16_pack_task), count, 1
+	};
+	fp16_parallel_pool_run(pool, &job);
+}
+
+static inline int fp16_pack(struct fp16_parallel_pool* pool, const float* src32, const uint16_t* src16, size_t n,
+	void* dst, size_t capacity, size_t* size)
+{
+	uint8_t* out = (uint8_t*) dst;
+	if (out == NULL || size == NULL || (n != 0 && src32 == NULL && src16 == NULL) || n > SIZE_MAX / 4) {
+		return -EINVAL;
+	}
+	if (capacity < fp16_pack_bound(n)) {
+		return -ENOSPC;
+	}
+	const size_t blocks = n / FP16_PACK_BLOCK + (n % FP16_PACK_BLOCK != 0);
+	struct fp16_pack_task* tasks = (struct fp16_pack_task*) calloc(blocks + 1, sizeof(struct fp16_pack_task));
+	if (tasks == NULL) {
+		return -ENOMEM;
+	}
+	for (size_t b = 0; b < blocks; b++) {
+		const size_t begin = b * FP16_PACK_BLOCK;
+		tasks[b].src32 = src32 != NULL ? src32 + begin : NULL;
+		tasks[b].src16 = src32 == NULL ? src16 + begin : NULL;
+		tasks[b].n = n - begin < FP16_PACK_BLOCK ? n - begin : FP16_PACK_BLOCK;
+		tasks[b].out = out + FP16_PACK_HEADER_SIZE + 2 * (begin + b);
+	}
+	fp16_pack_run(pool, fp16_pack_task_encode, tasks, blocks);
+
+	// Close the gaps, in order: a block only moves down, over the free end of its predecessor's slot
+	size_t offset = FP16_PACK_HEADER_SIZE;
+	int status = 0;
+	for (size_t b = 0; b < blocks; b++) {
+		if (tasks[b].status != 0) {
+			status = tasks[b].status;
+			break;
+		}
+		memmove(out + offset, tasks[b].out, tasks[b].size);
+		tasks[b].out = out + offset;
+		offset += tasks[b].size;
+	}
+	if (status == 0) {
+		for (size_t b = 0; b < blocks; b++) {
+			fp16_pack_store_le64(out + offset + 8 * b, (uint64_t) (tasks[b].out - out));
+		}
+		fp16_pack_store_le64(out + offset + 8 * blocks, (uint64_t) offset);
+		memcpy(out, FP16_PACK_MAGIC, 8);
+		fp16_pack_store_le32(out + 8, FP16_PACK_VERSION);
+		fp16_pack_store_le32(out + 12, (uint32_t) FP16_PACK_BLOCK);
+		fp16_pack_store_le64(out + 16, (uint64_t) n);
+		fp16_pack_store_le64(out + 24, (uint64_t) offset);
+		*size = offset + 8 * (blocks + 1);
+	}
+	free(tasks);
+	return status;
+}
+
+/*
+ * Convert n fp32 numbers to IEEE half precision and compress them into the container dst, of capacity bytes. The size
+ * of the container goes to *size.
+ *
+ * @note capacity must be at least fp16_pack_bound(n), even if the result is smaller.
+ * @note The numbers are the ones of fp16_ieee_from_fp32_array.
+ */
+static inline int fp16_pack_fp32(struct fp16_parallel_pool* pool, const float* src, size_t n, void* dst,
+	size_t capacity, size_t* size)
+{
+	return fp16_pack(pool, src, NULL, n, dst, capacity, size);
+}
+
+/*
+ * Compress n IEEE half-precision numbers into the container dst, as fp16_pack_fp32.
+ */
+static inline int fp16_pack_fp16(struct fp16_parallel_pool* pool, const uint16_t* src, size_t n, void* dst,
+	size_t capacity, size_t* size)
+{
+	return fp16_pack(pool, NULL, src, n, dst, capacity, size);
+}
+
+static inline int fp16_unpack(struct fp16_parallel_pool* pool, const void* src, size_t size, float* dst32,
+	uint16_t* dst16, size_t n)
+{
+	struct fp16_pack_info info;
+	const int status = fp16_pack_read_info(src, size, &info);
+	if (status != 0 || (dst32 == NULL && dst16 == NULL)) {
+		return status != 0 ? status : -EINVAL;
+	}
+	if (n < info.count) {
+		return -ENOSPC;
+	}
+	struct fp16_pack_task* tasks = (struct fp16_pack_task*) calloc(info.blocks + 1, sizeof(struct fp16_pack_task));
+	if (tasks == NULL) {
+		return -ENOMEM;
+	}
+	const uint8_t* packed = (const uint8_t*) src;
+	for (size_t b = 0; b < info.blocks; b++) {
+		const size_t begin = b * info.block;
+		const size_t offset = (size_t) fp16_pack_load_le64(packed + info.index + 8 * b);
+		tasks[b].packed = packed + offset;
+		tasks[b].size = (size_t) fp16_pack_load_le64(packed + info.index + 8 * (b + 1)) - offset;
+		tasks[b].n = info.count - begin < info.block ? info.count - begin : info.block;
+		tasks[b].dst32 = dst32 != NULL ? dst32 + begin : NULL;
+		tasks[b].dst16 = dst32 == NULL ? dst16 + begin : NULL;
+	}
+	fp16_pack_run(pool, fp16_pack_task_decode, tasks, info.blocks);
+	int result = 0;
+	for (size_t b = 0; b < info.blocks && result == 0; b++) {
+		result = tasks[b].status;
+	}
+	free(tasks);
+	return result;
+}
+
+/*
+ * Decompress the container src of size bytes to fp32, into dst, which has room for n numbers (fp16_pack_read_info
+ * gives the count).
+ *
+ * @note The numbers are the ones of fp16_ieee_to_fp32_array.
+ */
+static inline int fp16_unpack_fp32(struct fp16_parallel_pool* pool, const void* src, size_t size, float* dst,
+	size_t n)
+{
+	return fp16_unpack(pool, src, size, dst, NULL, n);
+}
+
+/*
+ * Decompress the container src of size bytes to IEEE half precision, as fp16_unpack_fp32.
+ */
+static inline int fp16_unpack_fp16(struct fp16_parallel_pool* pool, const void* src, size_t size, uint16_t* dst,
+	size_t n)
+{
+	return fp16_unpack(pool, src, size, NULL, dst, n);
+}
+
+static inline int fp16_unpack_range(const void* src, size_t size, size_t first, size_t count, float* dst32,
+	uint16_t* dst16)
+{
+	struct fp16_pack_info info;
+	const int status = fp16_pack_read_info(src, size, &info);
+	if (status != 0 || (dst32 == NULL && dst16 == NULL) || first > info.count || count > info.count - first) {
+		return status != 0 ? status : -EINVAL;
+	}
+	if (count == 0) {
+		return 0;
+	}
+	uint8_t* scratch = (uint8_t*) malloc(2 * info.block);
+	if (scratch == NULL) {
+		return -ENOMEM;
+	}
+	const uint8_t* packed = (const uint8_t*) src;
+	int result = 0;
+	for (size_t b = first / info.block; result == 0 && b * info.block < first + count; b++) {
+		const size_t begin = b * info.block;
+		const size_t n = info.count - begin < info.block ? info.count - begin : info.block;
+		const size_t lo = first > begin ? first - begin : 0;
+		const size_t hi = first + count - begin < n ? first + count - begin : n;
+		const size_t offset = (size_t) fp16_pack_load_le64(packed + info.index + 8 * b);
+		const size_t block_size = (size_t) fp16_pack_load_le64(packed + info.index + 8 * (b + 1)) - offset;
+		result = fp16_pack_decode_block(packed + offset, block_size, n, lo, hi,
+			dst32 != NULL ? dst32 + (begin + lo - first) : NULL, dst32 == NULL ? dst16 + (begin + lo - first) : NULL,
+			scratch);
+	}
+	free(scratch);
+	return result;
+}
+
+/*
+ * Decompress count numbers from number first on, to fp32. Only the blocks that hold them are decoded.
+ */
+static inline int fp16_unpack_range_fp32(const void* src, size_t size, size_t first, size_t count, float* dst) {
+	return fp16_unpack_range(src, size, first, count, dst, NULL);
+}
+
+/*
+ * Decompress count numbers from number first on, to IEEE half precision, as fp16_unpack_range_fp32.
+ */
+static inline int fp16_unpack_range_fp16(const void* src, size_t size, size_t first, size_t count, uint16_t* dst) {
+	return fp16_unpack_range(src, size, first, count, NULL, dst);
+}
+
+#endif /* FP16_PACK_H */
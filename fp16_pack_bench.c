@@ -0,0 +1,330 @@
+/*
+ * Compression of half-precision tensors with fp16_pack.h: the compression ratio, and the throughput of compression and
+ * decompression.
+ *
+ * First the container is checked on generated inputs of several sizes and kinds (weights, constants, random bits,
+ * a few distinct values): fp32 -> container -> fp16 / fp32 must give the numbers of fp16_ieee_from_fp32_array, and
+ * random ranges read through the index the same numbers. Then the containers are corrupted (bit flips, truncation),
+ * which must not crash. The program exits with 1 on a mismatch.
+ *
+ * Then, on the input:
+ * - the size of the fp16 data and of the container, the ratio, and the ratio of the same Huffman coder on the fp16
+ *   bytes as they are, without the shuffle, for comparison; how many planes were stored, constant and Huffman coded,
+ * - GB/s for the conversion alone (fp16_ieee_from_fp32_parallel), fp32 -> container, fp16 -> container,
+ *   container -> fp16 and container -> fp32, for 1, 2, 4, ... threads. GB/s counts the fp16 data, 2 bytes per number,
+ *   whatever the direction,
+ * - the time to read 1 and 4096 numbers at random positions with fp16_unpack_range_fp16.
+ *
+ * The input is a raw file of little-endian fp32 numbers, or fp16 numbers with -h: the output of fp16conv, or the data
+ * of a checkpoint after skipping its header with -o. Without a file, 16M numbers drawn from N(0, 0.02^2), the usual
+ * initialization of transformer weights.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_pack_bench.c -o fp16_pack_bench -lm -pthread
+ *
+ * Usage: ./fp16_pack_bench [-h] [-o offset in bytes] [-t maximum number of threads] [-r repetitions] [file]
+ */
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fp16_pack.h"
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* xorshift32, only used to fill the inputs */
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+/* Box-Muller */
+static float next_weight(uint32_t* state) {
+	const double u = ((double) next_random(state) + 1.0) * 0x1.0p-32;
+	const double v = (double) next_random(state) * 0x1.0p-32;
+	return (float) (0.02 * sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v));
+}
+
+static void* checked_malloc(size_t size) {
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	return p;
+}
+
+static int check(void) {
+	static const size_t sizes[] = { 0, 1, 15, 16, 17, 1000, FP16_PACK_BLOCK, FP16_PACK_BLOCK + 1, 200000, 1000003 };
+	struct fp16_parallel_pool* pool = fp16_parallel_pool_create(4, 0);
+	uint32_t state = 1;
+	int failures = 0;
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		const size_t n = sizes[s];
+		float* f32 = checked_malloc(n * sizeof(float));
+		float* f32_back = checked_malloc(n * sizeof(float));
+		uint16_t* f16 = checked_malloc(n * sizeof(uint16_t));
+		uint16_t* f16_back = checked_malloc(n * sizeof(uint16_t));
+		const size_t capacity = fp16_pack_bound(n);
+		uint8_t* packed = checked_malloc(capacity);
+		uint8_t* corrupt = checked_malloc(capacity);
+		for (int kind = 0; kind < 4; kind++) {
+			for (size_t i = 0; i < n; i++) {
+				const uint32_t r = next_random(&state);
+				f32[i] = kind == 0 ? next_weight(&state) : kind == 1 ? 1.0f : kind == 2 ? fp32_from_bits(r) :
+					(float) ((int32_t) (r % 255) - 127) * 0.25f;
+			}
+			fp16_ieee_from_fp32_array(f32, f16, n);
+
+			size_t size = 0, size16 = 0;
+			int errors = fp16_pack_fp32(kind % 2 == 0 ? pool : NULL, f32, n, packed, capacity, &size) != 0;
+			errors += fp16_pack_fp16(pool, f16, n, corrupt, capacity, &size16) != 0;
+			errors += size16 != size || memcmp(packed, corrupt, size) != 0;
+			errors += fp16_unpack_fp16(pool, packed, size, f16_back, n) != 0;
+			errors += memcmp(f16, f16_back, n * sizeof(uint16_t)) != 0;
+			errors += fp16_unpack_fp32(NULL, packed, size, f32_back, n) != 0;
+			for (size_t i = 0; i < n; i++) {
+				errors += fp32_to_bits(f32_back[i]) != fp32_to_bits(fp16_ieee_to_fp32_value(f16[i]));
+			}
+			for (int t = 0; t < 16 && n != 0; t++) {
+				const size_t first = next_random(&state) % n;
+				const size_t count = next_random(&state) % (n - first + 1);
+				errors += fp16_unpack_range_fp16(packed, size, first, count, f16_back) != 0;
+				errors += memcmp(f16 + first, f16_back, count * sizeof(uint16_t)) != 0;
+				errors += fp16_unpack_range_fp32(packed, size, first, count, f32_back) != 0;
+				for (size_t i = 0; i < count; i++) {
+					errors += fp32_to_bits(f32_back[i]) != fp32_to_bits(fp16_ieee_to_fp32_value(f16[first + i]));
+				}
+			}
+			errors += fp16_unpack_range_fp16(packed, size, n, 1, f16_back) != -EINVAL;
+			errors += n != 0 && fp16_unpack_fp16(NULL, packed, size, f16_back, n - 1) != -ENOSPC;
+			if (errors != 0) {
+				fprintf(stderr, "round trip of %zu numbers of kind %d failed\n", n, kind);
+				failures++;
+			}
+
+			// Only for the sanitizers and the return codes: the results are not checked
+			for (int t = 0; t < 64; t++) {
+				memcpy(corrupt, packed, size);
+				for (int k = 0; k < 4; k++) {
+					corrupt[next_random(&state) % size] ^= (uint8_t) (1 << next_random(&state) % 8);
+				}
+				const size_t corrupt_size = t % 4 == 0 ? next_random(&state) % (size + 1) : size;
+				fp16_unpack_fp16(NULL, corrupt, corrupt_size, f16_back, n);
+				fp16_unpack_range_fp32(corrupt, corrupt_size, 0, n / 2, f32_back);
+			}
+		}
+		free(f32);
+		free(f32_back);
+		free(f16);
+		free(f16_back);
+		free(packed);
+		free(corrupt);
+	}
+	fp16_parallel_pool_destroy(pool);
+	return failures;
+}
+
+static void report(const char* name, size_t n, int repetitions, double seconds) {
+	printf("%-32s %8.3f ms %8.2f GB/s\n", name, seconds * 1e3 / repetitions,
+		(double) n * sizeof(uint16_t) * repetitions / seconds * 1e-9);
+}
+
+/* Size of a plane of n numbers, as fp16_pack_decode_plane finds it */
+static size_t plane_size(const uint8_t* plane, size_t n) {
+	if (plane[0] != FP16_PACK_HUFFMAN) {
+		return plane[0] == FP16_PACK_STORED ? 1 + n : 2;
+	}
+	size_t size = FP16_PACK_HUFFMAN_HEADER_SIZE;
+	for (size_t k = 0; k < FP16_PACK_STREAMS; k++) {
+		size += fp16_pack_load_le32(plane + 129 + 4 * k);
+	}
+	return size;
+}
+
+int main(int argc, char** argv) {
+	int half_input = 0, repetitions = 5;
+	size_t offset = 0;
+	const long online = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t max_threads = online > 0 ? (size_t) online : 1;
+	const char* path = NULL;
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "-h") == 0) {
+			half_input = 1;
+		} else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+			offset = (size_t) strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+			max_threads = (size_t) strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-r") == 0 && a + 1 < argc) {
+			repetitions = atoi(argv[++a]);
+		} else if (argv[a][0] != '-' && path == NULL) {
+			path = argv[a];
+		} else {
+			fprintf(stderr, "usage: %s [-h] [-o offset] [-t threads] [-r repetitions] [file]\n", argv[0]);
+			return 1;
+		}
+	}
+	max_threads = max_threads != 0 ? max_threads : 1;
+	repetitions = repetitions > 0 ? repetitions : 1;
+
+	if (check() != 0) {
+		return 1;
+	}
+	printf("round trips ok\n\n");
+
+	// The input, as fp32 (widened if the file is fp16) and fp16
+	size_t n = (size_t) 1 << 24;
+	float* f32 = NULL;
+	uint16_t* f16 = NULL;
+	if (path != NULL) {
+		FILE* file = fopen(path, "rb");
+		if (file == NULL || fseek(file, 0, SEEK_END) != 0) {
+			perror(path);
+			return 1;
+		}
+		const long file_size = ftell(file);
+		if (file_size < 0 || (size_t) file_size < offset || fseek(file, (long) offset, SEEK_SET) != 0) {
+			fprintf(stderr, "%s: no data after offset %zu\n", path, offset);
+			return 1;
+		}
+		n = ((size_t) file_size - offset) / (half_input ? sizeof(uint16_t) : sizeof(float));
+		f32 = checked_malloc(n * sizeof(float));
+		f16 = checked_malloc(n * sizeof(uint16_t));
+		const size_t read = half_input ? fread(f16, sizeof(uint16_t), n, file) : fread(f32, sizeof(float), n, file);
+		fclose(file);
+		if (read != n) {
+			fprintf(stderr, "%s: short read\n", path);
+			return 1;
+		}
+		if (half_input) {
+			fp16_ieee_to_fp32_array(f16, f32, n);
+		}
+	} else {
+		f32 = checked_malloc(n * sizeof(float));
+		f16 = checked_malloc(n * sizeof(uint16_t));
+		uint32_t state = 7;
+		for (size_t i = 0; i < n; i++) {
+			f32[i] = next_weight(&state);
+		}
+	}
+	if (!half_input) {
+		fp16_ieee_from_fp32_array(f32, f16, n);
+	}
+	printf("%s: %zu numbers, %s\n\n", path != NULL ? path : "N(0, 0.02^2)", n, half_input ? "fp16" : "fp32");
+
+	const size_t capacity = fp16_pack_bound(n);
+	uint8_t* packed = checked_malloc(capacity);
+	uint16_t* f16_back = checked_malloc(n * sizeof(uint16_t));
+	float* f32_back = checked_malloc(n * sizeof(float));
+	size_t size = 0;
+	if (fp16_pack_fp16(NULL, f16, n, packed, capacity, &size) != 0 ||
+		fp16_unpack_fp16(NULL, packed, size, f16_back, n) != 0 ||
+		memcmp(f16, f16_back, n * sizeof(uint16_t)) != 0)
+	{
+		fprintf(stderr, "round trip of the input failed\n");
+		return 1;
+	}
+
+	// The planes of every block, and the same coder on the unshuffled bytes
+	struct fp16_pack_info info;
+	fp16_pack_read_info(packed, size, &info);
+	size_t modes[3] = { 0 };
+	size_t unshuffled = FP16_PACK_HEADER_SIZE + 8 * (info.blocks + 1);
+	uint8_t* scratch = checked_malloc(2 * FP16_PACK_BLOCK + 1);
+	for (size_t b = 0; b < info.blocks; b++) {
+		const size_t count = n - b * info.block < info.block ? n - b * info.block : info.block;
+		const uint8_t* block = packed + fp16_pack_load_le64(packed + info.index + 8 * b);
+		modes[block[0]]++;
+		modes[block[plane_size(block, count)]]++;
+		unshuffled += fp16_pack_encode_plane((const uint8_t*) (f16 + b * info.block), 2 * count, scratch);
+	}
+	free(scratch);
+	printf("fp16 data            %12zu bytes\n", n * sizeof(uint16_t));
+	printf("container            %12zu bytes, ratio %.3f\n", size, (double) (n * sizeof(uint16_t)) / (double) size);
+	printf("without the shuffle  %12zu bytes, ratio %.3f\n", unshuffled,
+		(double) (n * sizeof(uint16_t)) / (double) unshuffled);
+	printf("planes: %zu stored, %zu constant, %zu Huffman\n\n", modes[FP16_PACK_STORED], modes[FP16_PACK_CONSTANT],
+		modes[FP16_PACK_HUFFMAN]);
+
+	for (size_t threads = 1;; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+		char name[64];
+		struct fp16_parallel_pool* pool = fp16_parallel_pool_create(threads, 1);
+		if (pool == NULL) {
+			fprintf(stderr, "can not create a pool of %zu threads\n", threads);
+			return 1;
+		}
+
+		snprintf(name, sizeof(name), "x%zu fp32 -> fp16", threads);
+		double start = now_seconds();
+		for (int r = 0; r < repetitions; r++) {
+			fp16_ieee_from_fp32_parallel(pool, f32, f16_back, n);
+		}
+		report(name, n, repetitions, now_seconds() - start);
+
+		snprintf(name, sizeof(name), "x%zu fp32 -> container", threads);
+		start = now_seconds();
+		for (int r = 0; r < repetitions; r++) {
+			fp16_pack_fp32(pool, f32, n, packed, capacity, &size);
+		}
+		report(name, n, repetitions, now_seconds() - start);
+
+		snprintf(name, sizeof(name), "x%zu fp16 -> container", threads);
+		start = now_seconds();
+		for (int r = 0; r < repetitions; r++) {
+			fp16_pack_fp16(pool, f16, n, packed, capacity, &size);
+		}
+		report(name, n, repetitions, now_seconds() - start);
+
+		snprintf(name, sizeof(name), "x%zu container -> fp16", threads);
+		start = now_seconds();
+		for (int r = 0; r < repetitions; r++) {
+			fp16_unpack_fp16(pool, packed, size, f16_back, n);
+		}
+		report(name, n, repetitions, now_seconds() - start);
+
+		snprintf(name, sizeof(name), "x%zu container -> fp32", threads);
+		start = now_seconds();
+		for (int r = 0; r < repetitions; r++) {
+			fp16_unpack_fp32(pool, packed, size, f32_back, n);
+		}
+		report(name, n, repetitions, now_seconds() - start);
+
+		fp16_parallel_pool_destroy(pool);
+		if (threads >= max_threads) {
+			break;
+		}
+	}
+
+	const size_t counts[2] = { 1, 4096 };
+	for (size_t c = 0; c < 2; c++) {
+		const size_t count = counts[c] < n ? counts[c] : n;
+		const int reads = 1000;
+		uint32_t state = 11;
+		const double start = now_seconds();
+		for (int r = 0; r < reads; r++) {
+			fp16_unpack_range_fp16(packed, size, next_random(&state) % (n - count + 1), count, f16_back);
+		}
+		printf("random read of %4zu numbers     %8.2f us\n", count, (now_seconds() - start) * 1e6 / reads);
+	}
+
+	free(f32);
+	free(f32_back);
+	free(f16);
+	free(f16_back);
+	free(packed);
+	return 0;
+}
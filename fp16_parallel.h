@@ -0,0 +1,429 @@
+#pragma once
+#ifndef FP16_PARALLEL_H
+#define FP16_PARALLEL_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cstddef>
+	#include <cstdint>
+	#include <cstdio>
+	#include <cstdlib>
+#else
+	#include <stddef.h>
+	#include <stdint.h>
+	#include <stdio.h>
+	#include <stdlib.h>
+#endif
+
+#if defined(FP16_PARALLEL_OPENMP)
+	#include <omp.h>
+#else
+	#include <pthread.h>
+	#include <sched.h>
+	#include <unistd.h>
+#endif
+
+#include "fp16_array.h"
+
+/*
+ * Multithreaded driver around the array conversions of fp16_array.h.
+ *
+ * The input is cut into chunks of FP16_PARALLEL_CHUNK elements. A chunk of fp32 plus its fp16 counterpart is
+ * 64K * (4 + 2) bytes = 384 KB, which stays in the L2 cache of current server cores while it is converted. Every thread
+ * converts straight from the caller's input into the caller's output buffer, there are no intermediate copies.
+ *
+ * Two back ends, chosen when the file is compiled:
+ * - default: a pthread pool with work stealing. Every thread owns a contiguous range of chunks, so in the common case
+ *   thread t touches the same part of the buffers on every call (good for NUMA first-touch placement). A thread that is
+ *   done with its range takes chunks from the ranges of the other threads. Taking a chunk is one atomic fetch-add on the
+ *   range's cursor, by the owner and the thieves alike.
+ * - -DFP16_PARALLEL_OPENMP: an OpenMP parallel loop with dynamic scheduling. Thread placement is then controlled with
+ *   the usual OMP_PLACES / OMP_PROC_BIND environment variables.
+ *
+ * With the pthread back end, fp16_parallel_pool_create can pin the worker threads to the NUMA nodes listed in
+ * /sys/devices/system/node, round-robin, each to all the CPUs of its node so that the scheduler still balances them
+ * within the node (Linux, and only when the including file defines _GNU_SOURCE for pthread_setaffinity_np). The calling
+ * thread takes part in the work as thread 0 and is not pinned.
+ */
+#ifndef FP16_PARALLEL_CHUNK
+	#define FP16_PARALLEL_CHUNK ((size_t) 65536)
+#endif
+
+#define FP16_PARALLEL_MAX_THREADS 256
+
+/*
+ * One conversion of n elements, from src to dst. The parallel driver calls it on every chunk, with src and dst
+ * advanced by the chunk offset times src_size and dst_size.
+ */
+typedef void (*fp16_parallel_fn)(const void* src, void* dst, size_t n);
+
+struct fp16_parallel_job {
+	fp16_parallel_fn convert;
+	const char* src;
+	char* dst;
+	size_t src_size;
+	size_t dst_size;
+	size_t n;
+	size_t chunk;
+};
+
+static inline void fp16_parallel_run_chunk(const struct fp16_parallel_job* job, size_t c) {
+	const size_t begin = c * job->chunk;
+	const size_t count = job->n - begin < job->chunk ? job->n - begin : job->chunk;
+	job->convert(job->src + begin * job->src_size, job->dst + begin * job->dst_size, count);
+}
+
+#if defined(FP16_PARALLEL_OPENMP)
+
+struct fp16_parallel_pool {
+	size_t threads;
+};
+
+static inline struct fp16_parallel_pool* fp16_parallel_pool_create(size_t threads, int pin_numa) {
+	(void) pin_numa;
+	struct fp16_parallel_pool* pool = (struct fp16_parallel_pool*) malloc(sizeof(struct fp16_parallel_pool));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->threads = threads != 0 ? threads : (size_t) omp_get_max_threads();
+	return pool;
+}
+
+static inline void fp16_parallel_pool_destroy(struct fp16_parallel_pool* pool) {
+	free(pool);
+}
+
+static inline void fp16_parallel_pool_run(struct fp16_parallel_pool* pool, const struct fp16_parallel_job* job) {
+	const long chunks = (long) ((job->n + job->chunk - 1) / job->chunk);
+	#pragma omp parallel for schedule(dynamic, 1) num_threads((int) pool->threads)
+	for (long c = 0; c < chunks; c++) {
+		fp16_parallel_run_chunk(job, (size_t) c);
+	}
+}
+
+#else
+
+/* The chunk range owned by one thread. Padded so that the cursors of different threads are in different cache lines. */
+struct fp16_parallel_range {
+	size_t next;
+	size_t end;
+	char padding[64 - 2 * sizeof(size_t)];
+};
+
+struct fp16_parallel_pool {
+	size_t threads;
+	pthread_t workers[FP16_PARALLEL_MAX_THREADS];
+	pthread_mutex_t mutex;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	/* Incremented for every job, workers wait for it to change. */
+	unsigned long generation;
+	size_t running;
+	int shutdown;
+	const struct fp16_parallel_job* job;
+	struct fp16_parallel_range ranges[FP16_PARALLEL_MAX_THREADS];
+};
+
+struct fp16_parallel_worker {
+	struct fp16_parallel_pool* pool;
+	size_t index;
+};
+
+/*
+ * Convert the chunks of thread `self`, then steal from the other threads, starting with the next one so that the
+ * thieves spread out over the victims.
+ */
+static inline void fp16_parallel_work(struct fp16_parallel_pool* pool, size_t self) {
+	const struct fp16_parallel_job* job = pool->job;
+	for (size_t k = 0; k < pool->threads; k++) {
+		struct fp16_parallel_range* range = &pool->ranges[(self + k) % pool->threads];
+		for (;;) {
+			const size_t c = __atomic_fetch_add(&range->next, 1, __ATOMIC_RELAXED);
+			if (c >= range->end) {
+				break;
+			}
+			fp16_parallel_run_chunk(job, c);
+		}
+	}
+}
+
+static void* fp16_parallel_worker_main(void* arg) {
+	struct fp16_parallel_worker* worker = (struct fp16_parallel_worker*) arg;
+	struct fp16_parallel_pool* pool = worker->pool;
+	const size_t index = worker->index;
+	free(worker);
+
+	unsigned long seen = 0;
+	pthread_mutex_lock(&pool->mutex);
+	for (;;) {
+		while (pool->generation == seen && !pool->shutdown) {
+			pthread_cond_wait(&pool->start, &pool->mutex);
+		}
+		if (pool->shutdown) {
+			break;
+		}
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->mutex);
+
+		fp16_parallel_work(pool, index);
+
+		pthread_mutex_lock(&pool->mutex);
+		if (--pool->running == 0) {
+			pthread_cond_signal(&pool->done);
+		}
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+#if defined(__linux__) && defined(_GNU_SOURCE)
+
+/* Nodes looked up in /sys/devices/system/node */
+#define FP16_PARALLEL_MAX_NODES 64
+
+/*
+ * Parse a sysfs cpulist such as "0-3,8-11" into cpus, and return the number of CPUs listed.
+ */
+static inline size_t fp16_parallel_parse_cpulist(const char* list, cpu_set_t* cpus) {
+	size_t count = 0;
+	CPU_ZERO(cpus);
+	while (*list != '\0' && *list != '\n') {
+		char* end;
+		const long first = strtol(list, &end, 10);
+		long last = first;
+		if (end == list) {
+			break;
+		}
+		if (*end == '-') {
+			list = end + 1;
+			last = strtol(list, &end, 10);
+		}
+		for (long cpu = first < 0 ? 0 : first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+			CPU_SET((int) cpu, cpus);
+			count++;
+		}
+		list = *end == ',' ? end + 1 : end;
+	}
+	return count;
+}
+
+/*
+ * Read the CPUs of every NUMA node with at least one CPU into node_cpus, and return the number of such nodes: 0 when
+ * the NUMA topology is not available.
+ */
+static inline size_t fp16_parallel_numa_nodes(cpu_set_t node_cpus[FP16_PARALLEL_MAX_NODES]) {
+	size_t nodes = 0;
+	for (int node = 0; node < FP16_PARALLEL_MAX_NODES; node++) {
+		char path[64];
+		char list[1024];
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+		FILE* file = fopen(path, "r");
+		if (file == NULL) {
+			continue;
+		}
+		if (fgets(list, sizeof(list), file) != NULL && fp16_parallel_parse_cpulist(list, &node_cpus[nodes]) != 0) {
+			nodes++;
+		}
+		fclose(file);
+	}
+	return nodes;
+}
+
+#endif
+
+/*
+ * Create a pool of `threads` threads (0: one per online CPU), including the calling thread. If pin_numa is non-zero,
+ * the worker threads are spread round-robin over the NUMA nodes, and each one may run on any CPU of its node.
+ */
+static inline struct fp16_parallel_pool* fp16_parallel_pool_create(size_t threads, int pin_numa) {
+	if (threads == 0) {
+		const long online = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = online > 0 ? (size_t) online : 1;
+	}
+	if (threads > FP16_PARALLEL_MAX_THREADS) {
+		threads = FP16_PARALLEL_MAX_THREADS;
+	}
+
+	struct fp16_parallel_pool* pool = (struct fp16_parallel_pool*) calloc(1, sizeof(struct fp16_parallel_pool));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->threads = threads;
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+#if defined(__linux__) && defined(_GNU_SOURCE)
+	/* The node cpulists are read once, not per worker */
+	cpu_set_t node_cpus[FP16_PARALLEL_MAX_NODES];
+	const size_t nodes = pin_numa && threads > 1 ? fp16_parallel_numa_nodes(node_cpus) : 0;
+#else
+	(void) pin_numa;
+#endif
+
+	for (size_t t = 1; t < threads; t++) {
+		struct fp16_parallel_worker* worker = (struct fp16_parallel_worker*) malloc(sizeof(struct fp16_parallel_worker));
+		if (worker == NULL) {
+			pool->threads = t;
+			break;
+		}
+		worker->pool = pool;
+		worker->index = t;
+		if (pthread_create(&pool->workers[t], NULL, fp16_parallel_worker_main, worker) != 0) {
+			free(worker);
+			pool->threads = t;
+			break;
+		}
+#if defined(__linux__) && defined(_GNU_SOURCE)
+		if (nodes != 0) {
+			pthread_setaffinity_np(pool->workers[t], sizeof(cpu_set_t), &node_cpus[t % nodes]);
+		}
+#endif
+	}
+	return pool;
+}
+
+static inline void fp16_parallel_pool_destroy(struct fp16_parallel_pool* pool) {
+	if (pool == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&pool->mutex);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->mutex);
+	for (size_t t = 1; t < pool->threads; t++) {
+		pthread_join(pool->workers[t], NULL);
+	}
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->done);
+	pthread_mutex_destroy(&pool->mutex);
+	free(pool);
+}
+
+static inline void fp16_parallel_pool_run(struct fp16_parallel_pool* pool, const struct fp16_parallel_job* job) {
+	const size_t chunks = (job->n + job->chunk - 1) / job->chunk;
+	if (pool->threads == 1 || chunks <= 1) {
+		for (size_t c = 0; c < chunks; c++) {
+			fp16_parallel_run_chunk(job, c);
+		}
+		return;
+	}
+
+	/* Split the chunks into contiguous ranges, the first chunks % threads ranges get one chunk more */
+	size_t begin = 0;
+	for (size_t t = 0; t < pool->threads; t++) {
+		const size_t count = chunks / pool->threads + (t < chunks % pool->threads);
+		pool->ranges[t].next = begin;
+		pool->ranges[t].end = begin + count;
+		begin += count;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->job = job;
+	pool->running = pool->threads - 1;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->mutex);
+
+	fp16_parallel_work(pool, 0);
+
+	pthread_mutex_lock(&pool->mutex);
+	while (pool->running != 0) {
+		pthread_cond_wait(&pool->done, &pool->mutex);
+	}
+	pool->job = NULL;
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+#endif /* FP16_PARALLEL_OPENMP */
+
+static inline void fp16_parallel_ieee_from_fp32_chunk(const void* src, void* dst, size_t n) {
+	fp16_ieee_from_fp32_array((const float*) src, (uint16_t*) dst, n);
+}
+
+static inline void fp16_parallel_ieee_to_fp32_chunk(const void* src, void* dst, size_t n) {
+	fp16_ieee_to_fp32_array((const uint16_t*) src, (float*) dst, n);
+}
+
+/*
+ * Parallel fp16_ieee_from_fp32_array. dst is the caller's buffer of n uint16_t, src and dst must not overlap.
+ */
+static inline void fp16_ieee_from_fp32_parallel(struct fp16_parallel_pool* pool, const float* src, uint16_t* dst, size_t n) {
+	const struct fp16_parallel_job job = {
+		fp16_parallel_ieee_from_fp32_chunk, (const char*) src, (char*) dst, sizeof(float), sizeof(uint16_t), n,
+		FP16_PARALLEL_CHUNK
+	};
+	fp16_parallel_pool_run(pool, &job);
+}
+
+/*
+ * Parallel fp16_ieee_to_fp32_array. dst is the caller's buffer of n floats, src and dst must not overlap.
+ */
+static inline void fp16_ieee_to_fp32_parallel(struct fp16_parallel_pool* pool, const uint16_t* src, float* dst, size_t n) {
+	const struct fp16_parallel_job job = {
+		fp16_parallel_ieee_to_fp32_chunk, (const char*) src, (char*) dst, sizeof(uint16_t), sizeof(float), n,
+		FP16_PARALLEL_CHUNK
+	};
+	fp16_parallel_pool_run(pool, &job);
+}
+
+static inline void fp16_parallel_bf16_from_fp32_chunk(const void* src, void* dst, size_t n) {
+	bf16_from_fp32_array((const float*) src, (uint16_t*) dst, n);
+}
+
+static inline void fp16_parallel_bf16_to_fp32_chunk(const void* src, void* dst, size_t n) {
+	bf16_to_fp32_array((const uint16_t*) src, (float*) dst, n);
+}
+
+/*
+ * Parallel bf16_from_fp32_array. dst is the caller's buffer of n uint16_t, src and dst must not overlap.
+ */
+static inline void bf16_from_fp32_parallel(struct fp16_parallel_pool* pool, const float* src, uint16_t* dst, size_t n) {
+	const struct fp16_parallel_job job = {
+		fp16_parallel_bf16_from_fp32_chunk, (const char*) src, (char*) dst, sizeof(float), sizeof(uint16_t), n,
+		FP16_PARALLEL_CHUNK
+	};
+	fp16_parallel_pool_run(pool, &job);
+}
+
+/*
+ * Parallel bf16_to_fp32_array. dst is the caller's buffer of n floats, src and dst must not overlap.
+ */
+static inline void bf16_to_fp32_parallel(struct fp16_parallel_pool* pool, const uint16_t* src, float* dst, size_t n) {
+	const struct fp16_parallel_job job = {
+		fp16_parallel_bf16_to_fp32_chunk, (const char*) src, (char*) dst, sizeof(uint16_t), sizeof(float), n,
+		FP16_PARALLEL_CHUNK
+	};
+	fp16_parallel_pool_run(pool, &job);
+}
+
+static inline void fp16_parallel_bf16_from_fp16_ieee_chunk(const void* src, void* dst, size_t n) {
+	bf16_from_fp16_ieee_array((const uint16_t*) src, (uint16_t*) dst, n);
+}
+
+static inline void fp16_parallel_fp16_ieee_from_bf16_chunk(const void* src, void* dst, size_t n) {
+	fp16_ieee_from_bf16_array((const uint16_t*) src, (uint16_t*) dst, n);
+}
+
+/*
+ * Parallel bf16_from_fp16_ieee_array. src and dst are n uint16_t each and must not overlap.
+ */
+static inline void bf16_from_fp16_ieee_parallel(struct fp16_parallel_pool* pool, const uint16_t* src, uint16_t* dst, size_t n) {
+	const struct fp16_parallel_job job = {
+		fp16_parallel_bf16_from_fp16_ieee_chunk, (const char*) src, (char*) dst, sizeof(uint16_t), sizeof(uint16_t), n,
+		FP16_PARALLEL_CHUNK
+	};
+	fp16_parallel_pool_run(pool, &job);
+}
+
+/*
+ * Parallel fp16_ieee_from_bf16_array. src and dst are n uint16_t each and must not overlap.
+ */
+static inline void fp16_ieee_from_bf16_parallel(struct fp16_parallel_pool* pool, const uint16_t* src, uint16_t* dst, size_t n) {
+	const struct fp16_parallel_job job = {
+		fp16_parallel_fp16_ieee_from_bf16_chunk, (const char*) src, (char*) dst, sizeof(uint16_t), sizeof(uint16_t), n,
+		FP16_PARALLEL_CHUNK
+	};
+	fp16_parallel_pool_run(pool, &job);
+}
+
+#endif /* FP16_PARALLEL_H */
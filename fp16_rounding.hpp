@@ -0,0 +1,450 @@
+#pragma once
+#ifndef FP16_ROUNDING_HPP
+#define FP16_ROUNDING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "fp16_half.hpp"
+
+/*
+ * fp32 -> IEEE half-precision conversion with a rounding mode chosen at compile time:
+ *
+ *      fp16::half h = fp16::from_fp32<fp16::rounding::toward_zero>(x);
+ *      fp16::from_fp32<fp16::rounding::stochastic>(gradients, packed);
+ *
+ * All modes share one integer-only rounding step. The 24-bit significand m (with the implicit bit) is shifted right by
+ * 13 for fp16 normal results, and by 126 - exponent for fp16 subnormal results; before the shift a mode dependent bias
+ * is added, and a carry out of the mantissa moves into the exponent:
+ *
+ * | mode             | bias added before the shift                 | finite overflow         |
+ * |------------------|---------------------------------------------|-------------------------|
+ * | to_nearest_even  | 2**(shift-1) - 1 + lowest kept bit          | Inf                     |
+ * | toward_zero      | 0                                           | largest finite (65504)  |
+ * | upward           | 2**shift - 1 if positive, else 0            | +Inf / -65504           |
+ * | downward         | 2**shift - 1 if negative, else 0            | +65504 / -Inf           |
+ * | stochastic       | top shift bits of a 32-bit random number    | Inf                     |
+ *
+ * The mode is a template parameter, so the bias is a compile-time choice and every mode costs one add on top of the
+ * shift. to_nearest_even gives exactly the bits of fp16_ieee_from_fp32_value. In every mode Inf stays Inf, and NaN
+ * becomes the quiet NaN 0x7E00 with the input sign.
+ *
+ * Stochastic rounding rounds up with probability (dropped bits) / 2**shift, so the result is unbiased: its expected
+ * value is the input. The random numbers come from a xorshift32 generator, by default one per thread
+ * (fp16::thread_random). Inputs below 2**-32 only keep a sticky bit, so they round up with a probability of 2**-31
+ * rather than their exact (smaller) one.
+ *
+ * The bulk versions use fp16_ieee_from_fp32_array for to_nearest_even. On x86, the directed modes go through F16C
+ * vcvtps2ph with the rounding mode in its immediate, and stochastic rounding through an AVX2 version of the integer
+ * rounding with 8 xorshift32 generators, one per lane, 2**29 steps apart on the cycle. The kernels are picked once at
+ * startup from detail::rounding_kernel_table, like fp16_x86_kernels. vcvtps2ph reads fp32 subnormal inputs as zero when
+ * MXCSR.DAZ is set, which changes the result of upward and downward, so the kernel fixes those lanes with integer
+ * operations. Every bulk version therefore gives the same bits as the scalar one whatever MXCSR holds (for stochastic
+ * rounding, given the same random numbers). On AArch64, the directed modes go through NEON FCVTN with FPCR.RMode set
+ * for the call, and stochastic rounding through a NEON port of the AVX2 kernel, with USHL for the per-lane shifts; they
+ * too give the bits of the scalar version whatever FPCR holds.
+ */
+namespace fp16 {
+
+enum class rounding {
+	to_nearest_even,
+	toward_zero,
+	upward,
+	downward,
+	stochastic,
+};
+
+/* Marsaglia's xorshift32 (13, 17, 5): period 2**32 - 1, the state must not be zero */
+class xorshift32 {
+public:
+	constexpr explicit xorshift32(uint32_t seed) : state_(seed != 0 ? seed : UINT32_C(0x9E3779B9)) {}
+
+	constexpr uint32_t operator()() {
+		uint32_t x = state_;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		return state_ = x;
+	}
+
+private:
+	uint32_t state_;
+};
+
+/* The generator of the calling thread, seeded differently for every thread */
+inline xorshift32& thread_random() {
+	static std::atomic<uint32_t> threads{0};
+	thread_local xorshift32 random((threads.fetch_add(1, std::memory_order_relaxed) + 1) * UINT32_C(0x9E3779B9));
+	return random;
+}
+
+namespace detail {
+
+template <rounding Mode>
+constexpr uint16_t round_from_fp32_bits(uint32_t w, uint32_t random) {
+	const uint32_t sign = (w >> 16) & UINT32_C(0x8000);
+	const uint32_t nonsign = w & UINT32_C(0x7FFFFFFF);
+	if (nonsign > UINT32_C(0x7F800000)) {
+		return (uint16_t) (sign | UINT32_C(0x7E00));
+	}
+	if (nonsign >= UINT32_C(0x47800000)) {
+		/* Inf, or finite but at least 65536 */
+		const bool to_inf = nonsign == UINT32_C(0x7F800000) || Mode == rounding::to_nearest_even ||
+			Mode == rounding::stochastic || (Mode == rounding::upward && sign == 0) ||
+			(Mode == rounding::downward && sign != 0);
+		return (uint16_t) (sign | (to_inf ? UINT32_C(0x7C00) : UINT32_C(0x7BFF)));
+	}
+
+	const uint32_t e = nonsign >> 23;
+	uint32_t m = (nonsign & UINT32_C(0x007FFFFF)) | UINT32_C(0x00800000);
+	uint32_t shift = 13;
+	uint32_t base = 0;
+	if (e >= 113) {
+		base = (e - 113) << 10;
+	} else if (e >= 95) {
+		shift = 126 - e;
+	} else {
+		/* Only whether the input is zero matters from here on */
+		m = nonsign != 0;
+		shift = 31;
+	}
+
+	uint32_t bias = 0;
+	switch (Mode) {
+		case rounding::to_nearest_even:
+			bias = (UINT32_C(1) << (shift - 1)) - 1 + ((m >> shift) & 1);
+			break;
+		case rounding::toward_zero:
+			break;
+		case rounding::upward:
+			bias = sign == 0 ? (UINT32_C(1) << shift) - 1 : 0;
+			break;
+		case rounding::downward:
+			bias = sign != 0 ? (UINT32_C(1) << shift) - 1 : 0;
+			break;
+		case rounding::stochastic:
+			bias = random >> (32 - shift);
+			break;
+	}
+	return (uint16_t) (sign | (base + ((m + bias) >> shift)));
+}
+
+/*
+ * The xorshift32 step as a 32x32 matrix over GF(2), one column per input bit, raised to the power 2**29 by squaring:
+ * applying it to a state jumps 2**29 steps ahead.
+ */
+struct xorshift32_jump {
+	uint32_t columns[32];
+
+	static constexpr uint32_t apply(const uint32_t (&columns)[32], uint32_t x) {
+		uint32_t result = 0;
+		for (int b = 0; b < 32; b++) {
+			result ^= columns[b] & (UINT32_C(0) - ((x >> b) & 1));
+		}
+		return result;
+	}
+
+	constexpr xorshift32_jump() : columns() {
+		for (int b = 0; b < 32; b++) {
+			xorshift32 step(UINT32_C(1) << b);
+			columns[b] = step();
+		}
+		for (int square = 0; square < 29; square++) {
+			uint32_t squared[32] = {};
+			for (int b = 0; b < 32; b++) {
+				squared[b] = apply(columns, columns[b]);
+			}
+			for (int b = 0; b < 32; b++) {
+				columns[b] = squared[b];
+			}
+		}
+	}
+};
+
+inline constexpr xorshift32_jump xorshift32_jump_2_29{};
+
+/*
+ * Seeds of the 8 lane generators of a stochastic kernel, drawing one number from random. Lane 0 starts at the
+ * number passed through the murmur3 finalizer, a bijection, so the lanes do not continue the stream of random that the
+ * scalar tail and the next call use. Lane k starts 2**29 steps after lane k - 1: the 8 lanes run disjoint parts of the
+ * xorshift32 cycle for any call of less than 2**32 elements, so no random number is used twice, and nearby elements
+ * round independently. Seeding the lanes with consecutive numbers of one generator would make lane k repeat lane
+ * k + 1 one step later, and every number would round 8 elements in a row the same way.
+ */
+inline void stochastic_lane_seeds(xorshift32& random, uint32_t seeds[8]) {
+	uint32_t x = random();
+	x = (x ^ (x >> 16)) * UINT32_C(0x85EBCA6B);
+	x = (x ^ (x >> 13)) * UINT32_C(0xC2B2AE35);
+	x ^= x >> 16;
+	seeds[0] = x != 0 ? x : UINT32_C(0x9E3779B9);
+	for (int lane = 1; lane < 8; lane++) {
+		seeds[lane] = xorshift32_jump::apply(xorshift32_jump_2_29.columns, seeds[lane - 1]);
+	}
+}
+
+#ifdef FP16_ARRAY_X86
+/*
+ * The directed modes in hardware: the rounding of vcvtps2ph comes from its immediate, not from MXCSR. With DAZ set it
+ * reads an fp32 subnormal input as a zero of the same sign, which rounds to that zero, while upward rounds a positive
+ * subnormal to 0x0001 and downward a negative one to 0x8001. Those lanes get the low bit set from the integer bits of
+ * the input; without DAZ it is already set.
+ */
+template <int Imm>
+FP16_X86_TARGET("avx2,f16c")
+inline size_t from_fp32_f16c(const float* src, uint16_t* dst, size_t n) {
+	const __m128i nan_bits = _mm_set1_epi16(0x7E00);
+	const __m256i nonsign_mask = _mm256_set1_epi32(0x7FFFFFFF);
+	const __m256i min_normal = _mm256_set1_epi32(0x00800000);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256 f = _mm256_loadu_ps(src + i);
+		__m128i h = _mm256_cvtps_ph(f, Imm | _MM_FROUND_NO_EXC);
+		if constexpr (Imm != _MM_FROUND_TO_ZERO) {
+			const __m256i w = _mm256_castps_si256(f);
+			const __m256i nonsign = _mm256_and_si256(w, nonsign_mask);
+			const __m256i is_subnormal = _mm256_and_si256(_mm256_cmpgt_epi32(nonsign, _mm256_setzero_si256()),
+				_mm256_cmpgt_epi32(min_normal, nonsign));
+			// upward: the positive lanes, downward: the negative lanes
+			const __m256i is_negative = _mm256_srai_epi32(w, 31);
+			const __m256i away32 = Imm == _MM_FROUND_TO_POS_INF ? _mm256_andnot_si256(is_negative, is_subnormal) :
+				_mm256_and_si256(is_negative, is_subnormal);
+			const __m128i away = _mm_packs_epi32(_mm256_castsi256_si128(away32), _mm256_extracti128_si256(away32, 1));
+			h = _mm_or_si128(h, _mm_and_si128(away, _mm_set1_epi16(1)));
+		}
+		// Canonical NaN, as in fp16_ieee_from_fp32_f16c
+		const __m256i is_nan32 = _mm256_castps_si256(_mm256_cmp_ps(f, f, _CMP_UNORD_Q));
+		const __m128i is_nan = _mm_packs_epi32(_mm256_castsi256_si128(is_nan32), _mm256_extracti128_si256(is_nan32, 1));
+		const __m128i canonical = _mm_or_si128(_mm_and_si128(h, _mm_set1_epi16((short) 0x8000)), nan_bits);
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_blendv_epi8(h, canonical, is_nan));
+	}
+	return i;
+}
+
+/*
+ * Stochastic rounding, 8 at a time: round_from_fp32_bits<rounding::stochastic> with a xorshift32 generator per lane,
+ * seeded by stochastic_lane_seeds.
+ */
+FP16_X86_TARGET("avx2")
+inline size_t from_fp32_stochastic_avx2(const float* src, uint16_t* dst, size_t n, xorshift32& random) {
+	uint32_t seeds[8];
+	stochastic_lane_seeds(random, seeds);
+	__m256i state = _mm256_loadu_si256((const __m256i*) seeds);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i nonsign_mask = _mm256_set1_epi32(0x7FFFFFFF);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 13));
+		state = _mm256_xor_si256(state, _mm256_srli_epi32(state, 17));
+		state = _mm256_xor_si256(state, _mm256_slli_epi32(state, 5));
+
+		const __m256i w = _mm256_loadu_si256((const __m256i*) (src + i));
+		const __m256i nonsign = _mm256_and_si256(w, nonsign_mask);
+		const __m256i sign = _mm256_and_si256(_mm256_srli_epi32(w, 16), _mm256_set1_epi32(0x8000));
+		const __m256i e = _mm256_srli_epi32(nonsign, 23);
+
+		// Normal results: shift 13, base (e - 113) << 10. Subnormal results: shift 126 - e, base 0.
+		const __m256i is_normal = _mm256_cmpgt_epi32(e, _mm256_set1_epi32(112));
+		const __m256i is_tiny = _mm256_cmpgt_epi32(_mm256_set1_epi32(95), e);
+		__m256i shift = _mm256_blendv_epi8(_mm256_sub_epi32(_mm256_set1_epi32(126), e), _mm256_set1_epi32(13), is_normal);
+		shift = _mm256_blendv_epi8(shift, _mm256_set1_epi32(31), is_tiny);
+		const __m256i base = _mm256_and_si256(_mm256_slli_epi32(_mm256_sub_epi32(e, _mm256_set1_epi32(113)), 10), is_normal);
+		__m256i m = _mm256_or_si256(_mm256_and_si256(nonsign, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x00800000));
+		const __m256i is_zero = _mm256_cmpeq_epi32(nonsign, _mm256_setzero_si256());
+		m = _mm256_blendv_epi8(m, _mm256_andnot_si256(is_zero, one), is_tiny);
+
+		const __m256i bias = _mm256_srlv_epi32(state, _mm256_sub_epi32(_mm256_set1_epi32(32), shift));
+		__m256i h = _mm256_add_epi32(base, _mm256_srlv_epi32(_mm256_add_epi32(m, bias), shift));
+
+		// Inf and overflow to Inf, then NaN
+		const __m256i is_overflow = _mm256_cmpgt_epi32(nonsign, _mm256_set1_epi32(0x477FFFFF));
+		h = _mm256_blendv_epi8(h, _mm256_set1_epi32(0x7C00), is_overflow);
+		const __m256i is_nan = _mm256_cmpgt_epi32(nonsign, _mm256_set1_epi32(0x7F800000));
+		h = _mm256_blendv_epi8(h, _mm256_set1_epi32(0x7E00), is_nan);
+		h = _mm256_or_si256(h, sign);
+
+		const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(h, h), 0x08);
+		_mm_storeu_si128((__m128i*) (dst + i), _mm256_castsi256_si128(packed));
+	}
+	return i;
+}
+#endif
+
+#ifdef FP16_ARRAY_ARM
+/*
+ * The directed modes in hardware: FCVTN takes the rounding mode from FPCR.RMode, so the kernel sets FPCR to the mode
+ * alone for the loop and restores it afterwards. The other fields of that FPCR are zero: no flush to zero (an fp32
+ * subnormal input must round upward or downward to the smallest fp16 subnormal), IEEE half precision and no default
+ * NaN, so fp16_ieee_from_fp32_neon_x8 can fix the NaN lanes. FPSR is restored too, so that the kernel raises no
+ * exception flags, like the scalar functions and _MM_FROUND_NO_EXC on x86. RMode is 1 for upward, 2 for downward and 3
+ * for toward zero.
+ */
+template <uint64_t RMode>
+inline size_t from_fp32_fcvtn(const float* src, uint16_t* dst, size_t n) {
+	if (n < 8) {
+		return 0;
+	}
+	uint64_t fpcr, fpsr;
+	__asm__ volatile("mrs %0, fpcr" : "=r"(fpcr));
+	__asm__ volatile("mrs %0, fpsr" : "=r"(fpsr));
+	__asm__ volatile("msr fpcr, %0" : : "r"(RMode << 22) : "memory");
+	const size_t i = fp16_ieee_from_fp32_neon(src, dst, n);
+	__asm__ volatile("msr fpcr, %0" : : "r"(fpcr) : "memory");
+	__asm__ volatile("msr fpsr, %0" : : "r"(fpsr) : "memory");
+	return i;
+}
+
+/*
+ * round_from_fp32_bits<rounding::stochastic>, 4 lanes, with the random numbers in state. As in the neonint kernel of
+ * fp16_arm.h, USHL with a negative count shifts every lane right by its own amount.
+ */
+inline uint32x4_t from_fp32_stochastic_neon_x4(uint32x4_t w, uint32x4_t state) {
+	const uint32x4_t nonsign = vandq_u32(w, vdupq_n_u32(UINT32_C(0x7FFFFFFF)));
+	const uint32x4_t sign = vandq_u32(vshrq_n_u32(w, 16), vdupq_n_u32(UINT32_C(0x8000)));
+	const uint32x4_t e = vshrq_n_u32(nonsign, 23);
+
+	// Normal results: shift 13, base (e - 113) << 10. Subnormal results: shift 126 - e, base 0.
+	const uint32x4_t is_normal = vcgtq_u32(e, vdupq_n_u32(112));
+	const uint32x4_t is_tiny = vcltq_u32(e, vdupq_n_u32(95));
+	int32x4_t shift = vbslq_s32(is_normal, vdupq_n_s32(13), vsubq_s32(vdupq_n_s32(126), vreinterpretq_s32_u32(e)));
+	shift = vbslq_s32(is_tiny, vdupq_n_s32(31), shift);
+	const uint32x4_t base = vandq_u32(vshlq_n_u32(vsubq_u32(e, vdupq_n_u32(113)), 10), is_normal);
+	uint32x4_t m = vorrq_u32(vandq_u32(nonsign, vdupq_n_u32(UINT32_C(0x007FFFFF))), vdupq_n_u32(UINT32_C(0x00800000)));
+	m = vbslq_u32(is_tiny, vminq_u32(nonsign, vdupq_n_u32(1)), m);
+
+	const uint32x4_t bias = vshlq_u32(state, vsubq_s32(shift, vdupq_n_s32(32)));
+	uint32x4_t h = vaddq_u32(base, vshlq_u32(vaddq_u32(m, bias), vnegq_s32(shift)));
+
+	// Inf and overflow to Inf, then NaN
+	h = vbslq_u32(vcgtq_u32(nonsign, vdupq_n_u32(UINT32_C(0x477FFFFF))), vdupq_n_u32(UINT32_C(0x7C00)), h);
+	h = vbslq_u32(vcgtq_u32(nonsign, vdupq_n_u32(UINT32_C(0x7F800000))), vdupq_n_u32(UINT32_C(0x7E00)), h);
+	return vorrq_u32(h, sign);
+}
+
+/*
+ * Stochastic rounding, 8 at a time: two vectors of 4 xorshift32 generators, seeded by stochastic_lane_seeds, so lane k
+ * rounds element i + k with the same random numbers as lane k of the AVX2 kernel. The integer rounding does not depend
+ * on FPCR.
+ */
+inline size_t from_fp32_stochastic_neon(const float* src, uint16_t* dst, size_t n, xorshift32& random) {
+	uint32_t seeds[8];
+	stochastic_lane_seeds(random, seeds);
+	uint32x4_t state_lo = vld1q_u32(seeds);
+	uint32x4_t state_hi = vld1q_u32(seeds + 4);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		state_lo = veorq_u32(state_lo, vshlq_n_u32(state_lo, 13));
+		state_lo = veorq_u32(state_lo, vshrq_n_u32(state_lo, 17));
+		state_lo = veorq_u32(state_lo, vshlq_n_u32(state_lo, 5));
+		state_hi = veorq_u32(state_hi, vshlq_n_u32(state_hi, 13));
+		state_hi = veorq_u32(state_hi, vshrq_n_u32(state_hi, 17));
+		state_hi = veorq_u32(state_hi, vshlq_n_u32(state_hi, 5));
+
+		const uint32x4_t lo = from_fp32_stochastic_neon_x4(vreinterpretq_u32_f32(vld1q_f32(src + i)), state_lo);
+		const uint32x4_t hi = from_fp32_stochastic_neon_x4(vreinterpretq_u32_f32(vld1q_f32(src + i + 4)), state_hi);
+		vst1q_u16(dst + i, vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+	}
+	return i;
+}
+#endif
+
+/*
+ * Runtime dispatch of the bulk versions, as in fp16_x86.h: rounding_kernel_table lists the kernels from the slowest
+ * to the fastest with the CPU feature check, and rounding_kernels is the best supported entry, picked once at startup
+ * by init_rounding_kernels. A kernel converts the multiple of its width and returns the count, the caller converts the
+ * rest with the scalar function; the pointers stay NULL when there is no kernel (an x86 CPU without AVX2, or a target
+ * that is neither x86 nor AArch64).
+ */
+typedef size_t (*directed_kernel)(const float* src, uint16_t* dst, size_t n);
+typedef size_t (*stochastic_kernel)(const float* src, uint16_t* dst, size_t n, xorshift32& random);
+
+struct rounding_kernel {
+	const char* name;
+	int (*supported)(void);
+	directed_kernel toward_zero;
+	directed_kernel upward;
+	directed_kernel downward;
+	stochastic_kernel stochastic;
+};
+
+#ifdef FP16_ARRAY_X86
+static const rounding_kernel rounding_kernel_table[] = {
+	{ "f16c", fp16_x86_has_f16c, from_fp32_f16c<_MM_FROUND_TO_ZERO>, from_fp32_f16c<_MM_FROUND_TO_POS_INF>,
+		from_fp32_f16c<_MM_FROUND_TO_NEG_INF>, from_fp32_stochastic_avx2 },
+};
+#elif defined(FP16_ARRAY_ARM)
+static const rounding_kernel rounding_kernel_table[] = {
+	{ "neon", fp16_arm_has_neon, from_fp32_fcvtn<3>, from_fp32_fcvtn<1>, from_fp32_fcvtn<2>,
+		from_fp32_stochastic_neon },
+};
+#endif
+
+static rounding_kernel rounding_kernels = { "scalar", nullptr, nullptr, nullptr, nullptr, nullptr };
+
+#if defined(__GNUC__)
+__attribute__((__constructor__, __unused__))
+#endif
+static void init_rounding_kernels() {
+#if defined(FP16_ARRAY_X86) || defined(FP16_ARRAY_ARM)
+	for (const rounding_kernel& kernel : rounding_kernel_table) {
+		if (kernel.supported()) {
+			rounding_kernels = kernel;
+		}
+	}
+#endif
+}
+
+} // namespace detail
+
+template <rounding Mode>
+constexpr half from_fp32(float f, xorshift32& random) {
+	const uint32_t bits = Mode == rounding::stochastic ? random() : 0;
+	return half::from_bits(detail::round_from_fp32_bits<Mode>(std::bit_cast<uint32_t>(f), bits));
+}
+
+/* Stochastic rounding draws from thread_random(), so only the other modes work in constant expressions */
+template <rounding Mode>
+constexpr half from_fp32(float f) {
+	if constexpr (Mode == rounding::stochastic) {
+		return from_fp32<Mode>(f, thread_random());
+	} else {
+		return half::from_bits(detail::round_from_fp32_bits<Mode>(std::bit_cast<uint32_t>(f), 0));
+	}
+}
+
+/* @note dst must have at least src.size() elements; src and dst must not overlap. */
+template <rounding Mode>
+inline void from_fp32(std::span<const float> src, std::span<half> dst, xorshift32& random) {
+	assert(dst.size() >= src.size());
+	if constexpr (Mode == rounding::to_nearest_even) {
+		from_fp32(src, dst);
+		return;
+	}
+	const float* input = src.data();
+	uint16_t* output = reinterpret_cast<uint16_t*>(dst.data());
+	const size_t n = src.size();
+	const detail::rounding_kernel& kernels = detail::rounding_kernels;
+	size_t i = 0;
+	if constexpr (Mode == rounding::toward_zero) {
+		i = kernels.toward_zero != nullptr ? kernels.toward_zero(input, output, n) : 0;
+	} else if constexpr (Mode == rounding::upward) {
+		i = kernels.upward != nullptr ? kernels.upward(input, output, n) : 0;
+	} else if constexpr (Mode == rounding::downward) {
+		i = kernels.downward != nullptr ? kernels.downward(input, output, n) : 0;
+	} else {
+		i = kernels.stochastic != nullptr ? kernels.stochastic(input, output, n, random) : 0;
+	}
+	for (; i < n; i++) {
+		output[i] = from_fp32<Mode>(input[i], random).bits();
+	}
+}
+
+template <rounding Mode>
+inline void from_fp32(std::span<const float> src, std::span<half> dst) {
+	from_fp32<Mode>(src, dst, thread_random());
+}
+
+} // namespace fp16
+
+#endif /* FP16_ROUNDING_HPP */
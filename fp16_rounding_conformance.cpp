@@ -0,0 +1,243 @@
+/*
+ * Check of the bulk rounding-mode conversions of fp16_rounding.hpp against the scalar ones.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   c++ -std=c++20 -O2 -I<FP16>/include fp16_rounding_conformance.cpp -o fp16_rounding_conformance -pthread
+ *
+ * Usage: ./fp16_rounding_conformance [-t threads] [-b first_bits] [-e last_bits]
+ *
+ * The fp32 bit patterns first_bits..last_bits (by default all 2**32) are split into blocks of 2**20 inputs that the
+ * threads take from a shared counter. Every block goes through the span from_fp32<Mode> for toward_zero, upward,
+ * downward and stochastic rounding, and through the scalar from_fp32<Mode>, which must give the same bits. For
+ * stochastic rounding the scalar version gets the random numbers the kernel uses: one xorshift32 per lane seeded by
+ * detail::stochastic_lane_seeds, and the generator itself for the tail. The scalar to_nearest_even is compared with
+ * fp16_ieee_from_fp32_value.
+ *
+ * Bit equality does not show whether the random numbers are independent, so before the sweep the span version
+ * rounds 2**16 copies of 1 + 2**-11 (up with probability 1/2) and of 1 + 2**-12 (1/4). The fraction of results
+ * rounded up, the fraction of pairs i, i + lag (lag 1 to 16) that round the same way, and the fraction of equal results
+ * at the same index of two consecutive calls must be within 0.01 of their values for independent rounding.
+ *
+ * On x86 the blocks are converted twice, once with the default MXCSR and once with DAZ, FTZ and round toward zero,
+ * which must not change any result. On AArch64 the second pass sets FZ and round toward zero in FPCR instead, and FPCR
+ * must hold the same value after the conversions. It prints the first mismatches and exits with 1 if there is any.
+ */
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "fp16_rounding.hpp"
+
+using fp16::rounding;
+
+constexpr uint64_t block_size = uint64_t(1) << 20;
+constexpr uint64_t max_reports = 8;
+
+static std::atomic<uint64_t> mismatches{0};
+static std::mutex report_mutex;
+
+static void report(const char* what, unsigned csr, uint32_t input, unsigned actual, unsigned expected) {
+	std::lock_guard<std::mutex> lock(report_mutex);
+	if (mismatches++ < max_reports) {
+		std::printf("%-16s csr 0x%04X input 0x%08X -> 0x%04X, scalar 0x%04X\n", what, csr, input, actual, expected);
+	}
+}
+
+/* Spans of this many inputs, not a multiple of 8, so that the scalar tail after the kernels is checked too */
+constexpr size_t span_size = 4099;
+
+template <rounding Mode>
+static void check_directed(const char* name, unsigned csr, std::span<const float> src, std::span<fp16::half> dst) {
+	fp16::from_fp32<Mode>(src, dst);
+	for (size_t i = 0; i < src.size(); i++) {
+		const uint16_t expected = fp16::from_fp32<Mode>(src[i]).bits();
+		if (dst[i].bits() != expected) {
+			report(name, csr, fp32_to_bits(src[i]), dst[i].bits(), expected);
+		}
+	}
+}
+
+static void check_stochastic(unsigned csr, uint32_t seed, std::span<const float> src, std::span<fp16::half> dst) {
+	fp16::xorshift32 random(seed);
+	fp16::from_fp32<rounding::stochastic>(src, dst, random);
+
+	fp16::xorshift32 reference(seed);
+	std::vector<fp16::xorshift32> lanes;
+	size_t body = 0;
+	if (fp16::detail::rounding_kernels.stochastic != nullptr) {
+		uint32_t seeds[8];
+		fp16::detail::stochastic_lane_seeds(reference, seeds);
+		for (int lane = 0; lane < 8; lane++) {
+			lanes.emplace_back(seeds[lane]);
+		}
+		body = src.size() / 8 * 8;
+	}
+	for (size_t i = 0; i < src.size(); i++) {
+		fp16::xorshift32& generator = i < body ? lanes[i % 8] : reference;
+		const uint16_t expected = fp16::from_fp32<rounding::stochastic>(src[i], generator).bits();
+		if (dst[i].bits() != expected) {
+			report("stochastic", csr, fp32_to_bits(src[i]), dst[i].bits(), expected);
+		}
+	}
+}
+
+static void report_fraction(const char* what, float input, int lag, double fraction, double expected) {
+	std::lock_guard<std::mutex> lock(report_mutex);
+	if (mismatches++ < max_reports) {
+		std::printf("%-16s input %a lag %2d: %.4f, expected %.4f\n", what, input, lag, fraction, expected);
+	}
+}
+
+/* Rounding up must happen with the right probability, independently for nearby elements and for consecutive calls */
+static void check_independence() {
+	constexpr size_t n = size_t(1) << 16;
+	constexpr double tolerance = 0.01;
+	const float inputs[] = { 1.0f + 0x1.0p-11f, 1.0f + 0x1.0p-12f };
+	const double probabilities[] = { 0.5, 0.25 };
+	std::vector<float> src(n);
+	std::vector<fp16::half> first(n), second(n);
+	fp16::xorshift32 random(12345);
+	for (int k = 0; k < 2; k++) {
+		std::fill(src.begin(), src.end(), inputs[k]);
+		fp16::from_fp32<rounding::stochastic>(src, first, random);
+		fp16::from_fp32<rounding::stochastic>(src, second, random);
+		const uint16_t down = fp16::from_fp32<rounding::toward_zero>(inputs[k]).bits();
+		const double p = probabilities[k];
+		const double same = p * p + (1.0 - p) * (1.0 - p);
+
+		size_t up = 0, equal_calls = 0;
+		for (size_t i = 0; i < n; i++) {
+			up += first[i].bits() != down;
+			equal_calls += first[i].bits() == second[i].bits();
+		}
+		if (std::fabs((double) up / n - p) > tolerance) {
+			report_fraction("rounded up", inputs[k], 0, (double) up / n, p);
+		}
+		if (std::fabs((double) equal_calls / n - same) > tolerance) {
+			report_fraction("same as 2nd call", inputs[k], 0, (double) equal_calls / n, same);
+		}
+		for (int lag = 1; lag <= 16; lag++) {
+			size_t equal = 0;
+			for (size_t i = 0; i + lag < n; i++) {
+				equal += first[i].bits() == first[i + lag].bits();
+			}
+			const double fraction = (double) equal / (double) (n - lag);
+			if (std::fabs(fraction - same) > tolerance) {
+				report_fraction("same at lag", inputs[k], lag, fraction, same);
+			}
+		}
+	}
+}
+
+#ifdef FP16_ARRAY_ARM
+static uint64_t get_fpcr() {
+	uint64_t fpcr;
+	__asm__ volatile("mrs %0, fpcr" : "=r"(fpcr));
+	return fpcr;
+}
+
+static void set_fpcr(uint64_t fpcr) {
+	__asm__ volatile("msr fpcr, %0" : : "r"(fpcr));
+}
+#endif
+
+static void sweep(std::atomic<uint64_t>* next, uint64_t end) {
+#if defined(FP16_ARRAY_X86)
+	const unsigned csrs[] = {
+		_mm_getcsr(), _mm_getcsr() | _MM_DENORMALS_ZERO_ON | _MM_FLUSH_ZERO_ON | _MM_ROUND_TOWARD_ZERO
+	};
+#elif defined(FP16_ARRAY_ARM)
+	/* RMode 3 (toward zero) and FZ */
+	const unsigned csrs[] = { (unsigned) get_fpcr(), (unsigned) get_fpcr() | (3u << 22) | (1u << 24) };
+#else
+	const unsigned csrs[] = { 0 };
+#endif
+	std::vector<float> src(block_size);
+	std::vector<fp16::half> dst(block_size);
+	for (;;) {
+		const uint64_t first = next->fetch_add(block_size, std::memory_order_relaxed);
+		if (first >= end) {
+			break;
+		}
+		const size_t n = (size_t) (end - first < block_size ? end - first : block_size);
+		for (size_t i = 0; i < n; i++) {
+			src[i] = fp32_from_bits((uint32_t) (first + i));
+			const uint16_t nearest = fp16::from_fp32<rounding::to_nearest_even>(src[i]).bits();
+			if (nearest != fp16_ieee_from_fp32_value(src[i])) {
+				report("to_nearest_even", 0, (uint32_t) (first + i), nearest, fp16_ieee_from_fp32_value(src[i]));
+			}
+		}
+		for (const unsigned csr : csrs) {
+#if defined(FP16_ARRAY_X86)
+			const unsigned saved = _mm_getcsr();
+			_mm_setcsr(csr);
+#elif defined(FP16_ARRAY_ARM)
+			const uint64_t saved = get_fpcr();
+			set_fpcr(csr);
+#endif
+			for (size_t offset = 0; offset < n; offset += span_size) {
+				const size_t count = n - offset < span_size ? n - offset : span_size;
+				const std::span<const float> in(src.data() + offset, count);
+				const std::span<fp16::half> out(dst.data() + offset, count);
+				check_directed<rounding::toward_zero>("toward_zero", csr, in, out);
+				check_directed<rounding::upward>("upward", csr, in, out);
+				check_directed<rounding::downward>("downward", csr, in, out);
+				check_stochastic(csr, (uint32_t) (first + offset) | 1, in, out);
+			}
+#if defined(FP16_ARRAY_X86)
+			_mm_setcsr(saved);
+#elif defined(FP16_ARRAY_ARM)
+			/* The FCVTN kernels change FPCR for the loop and must put it back */
+			if (get_fpcr() != csr) {
+				report("fpcr restore", csr, 0, (unsigned) get_fpcr(), csr);
+			}
+			set_fpcr(saved);
+#endif
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	unsigned threads = std::thread::hardware_concurrency();
+	uint64_t first_bits = 0, last_bits = UINT32_MAX;
+	for (int a = 1; a < argc; a += 2) {
+		if (a + 1 == argc) {
+			argv[a] = const_cast<char*>("");
+		}
+		if (std::strcmp(argv[a], "-t") == 0) {
+			threads = (unsigned) std::strtoul(argv[a + 1], nullptr, 0);
+		} else if (std::strcmp(argv[a], "-b") == 0) {
+			first_bits = std::strtoull(argv[a + 1], nullptr, 0);
+		} else if (std::strcmp(argv[a], "-e") == 0) {
+			last_bits = std::strtoull(argv[a + 1], nullptr, 0);
+		} else {
+			std::fprintf(stderr, "usage: %s [-t threads] [-b first_bits] [-e last_bits]\n", argv[0]);
+			return 1;
+		}
+	}
+	threads = threads != 0 ? threads : 1;
+	std::printf("rounding kernels: %s\n", fp16::detail::rounding_kernels.name);
+	check_independence();
+	std::printf("stochastic independence: %llu failures\n", (unsigned long long) mismatches.load());
+
+	std::atomic<uint64_t> next{first_bits};
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < threads; t++) {
+		workers.emplace_back(sweep, &next, last_bits + 1);
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	std::printf("0x%08llX..0x%08llX: %llu mismatches\n", (unsigned long long) first_bits,
+		(unsigned long long) last_bits, (unsigned long long) mismatches.load());
+	return mismatches.load() != 0;
+}
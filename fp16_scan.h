@@ -0,0 +1,268 @@
+#pragma once
+#ifndef FP16_SCAN_H
+#define FP16_SCAN_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cstddef>
+	#include <cstdint>
+#else
+	#include <stddef.h>
+	#include <stdint.h>
+#endif
+
+#include "fp16_array.h"
+
+/*
+ * Range check of fp32 data before (or while) it is narrowed to IEEE half precision: does every value fit?
+ *
+ * All the predicates are comparisons of |x| in bit representation, like the ones in float_to_half_fast3_rtne:
+ *
+ * | field     | |x| (bits)                          | |x|                                  |
+ * |-----------|-------------------------------------|--------------------------------------|
+ * | nan       | > 0x7F800000                        | NaN                                  |
+ * | infinity  | == 0x7F800000                       | Inf                                  |
+ * | overflow  | >= 0x477FF000, < 0x7F800000         | finite, >= 65520: rounds to +-Inf    |
+ * | underflow | > 0, <= 0x33000000                  | nonzero, <= 2^-25: rounds to +-0     |
+ *
+ * float_to_half_fast3_rtne tests x >= 0x47800000 (65536) before rounding; 65520 is the smallest value that rounds to
+ * Inf under round to nearest even, so that is the threshold here. A value is invalid if it is a NaN, an Inf or an
+ * overflow, i.e. if |x| >= 0x477FF000, and first_invalid is the index of the first such value. Underflow loses the
+ * value, but is not invalid.
+ *
+ * min_exponent and max_exponent are the exponents of the smallest and the largest nonzero finite |x|: the exponent
+ * field minus 127, so the fp32 subnormals have -127. The data fits in the normal fp16 range if
+ * -14 <= min_exponent and max_exponent <= 15 (and max_abs < 65520). max_abs is the largest finite |x|, so
+ * 65504 / max_abs is the scale that makes it fit.
+ *
+ * The scans accumulate over calls: count is the number of elements scanned so far, and first_invalid counts from the
+ * first element of the first call.
+ */
+#define FP16_SCAN_BLOCK 4096
+
+struct fp16_range_scan {
+	uint64_t count;
+	uint64_t nan;
+	uint64_t infinity;
+	uint64_t overflow;
+	uint64_t underflow;
+	/* SIZE_MAX if there is none */
+	size_t first_invalid;
+	/* min_exponent > max_exponent if there is no nonzero finite value */
+	int min_exponent;
+	int max_exponent;
+	float max_abs;
+};
+
+static inline void fp16_range_scan_init(struct fp16_range_scan* scan) {
+	scan->count = 0;
+	scan->nan = 0;
+	scan->infinity = 0;
+	scan->overflow = 0;
+	scan->underflow = 0;
+	scan->first_invalid = SIZE_MAX;
+	scan->min_exponent = 128;
+	scan->max_exponent = -128;
+	scan->max_abs = 0.0f;
+}
+
+/*
+ * Nonzero if every value scanned so far converts to a finite half-precision number.
+ */
+static inline int fp16_range_scan_fits(const struct fp16_range_scan* scan) {
+	return scan->first_invalid == SIZE_MAX;
+}
+
+/*
+ * Append `other`, the scan of the elements right after the ones in `scan`, e.g. the next chunk of a parallel scan.
+ */
+static inline void fp16_range_scan_merge(struct fp16_range_scan* scan, const struct fp16_range_scan* other) {
+	if (scan->first_invalid == SIZE_MAX && other->first_invalid != SIZE_MAX) {
+		scan->first_invalid = (size_t) scan->count + other->first_invalid;
+	}
+	scan->count += other->count;
+	scan->nan += other->nan;
+	scan->infinity += other->infinity;
+	scan->overflow += other->overflow;
+	scan->underflow += other->underflow;
+	scan->min_exponent = other->min_exponent < scan->min_exponent ? other->min_exponent : scan->min_exponent;
+	scan->max_exponent = other->max_exponent > scan->max_exponent ? other->max_exponent : scan->max_exponent;
+	scan->max_abs = other->max_abs > scan->max_abs ? other->max_abs : scan->max_abs;
+}
+
+/*
+ * Add the counts of one block. min_bits and max_bits are the smallest nonzero and the largest |x| in bit
+ * representation, NaN and Inf included: a block with a NaN or an Inf is rare, and is searched again for its largest
+ * finite value. So is a block with an invalid value, for the first one, if the scan has none yet.
+ */
+static inline void fp16_range_scan_add(const float* src, size_t n, struct fp16_range_scan* scan,
+	uint32_t nan, uint32_t infinity, uint32_t invalid, uint32_t underflow, uint32_t min_bits, uint32_t max_bits)
+{
+	if (invalid != 0 && scan->first_invalid == SIZE_MAX) {
+		size_t i = 0;
+		while ((fp32_to_bits(src[i]) & UINT32_C(0x7FFFFFFF)) < UINT32_C(0x477FF000)) {
+			i++;
+		}
+		scan->first_invalid = (size_t) scan->count + i;
+	}
+	if (nan + infinity != 0) {
+		max_bits = 0;
+		for (size_t i = 0; i < n; i++) {
+			const uint32_t nonsign = fp32_to_bits(src[i]) & UINT32_C(0x7FFFFFFF);
+			if (nonsign < UINT32_C(0x7F800000) && nonsign > max_bits) {
+				max_bits = nonsign;
+			}
+		}
+	}
+	scan->count += n;
+	scan->nan += nan;
+	scan->infinity += infinity;
+	scan->overflow += invalid - nan - infinity;
+	scan->underflow += underflow;
+	/* Without a nonzero finite value, min_bits is meaningless */
+	if (max_bits != 0) {
+		const int min_exponent = (int) (min_bits >> 23) - 127;
+		const int max_exponent = (int) (max_bits >> 23) - 127;
+		const float max_abs = fp32_from_bits(max_bits);
+		scan->min_exponent = min_exponent < scan->min_exponent ? min_exponent : scan->min_exponent;
+		scan->max_exponent = max_exponent > scan->max_exponent ? max_exponent : scan->max_exponent;
+		scan->max_abs = max_abs > scan->max_abs ? max_abs : scan->max_abs;
+	}
+}
+
+/*
+ * Scan of one block, n <= FP16_SCAN_BLOCK. Branch-free, so that the compiler can vectorize it. The minimum is taken
+ * over |x| - 1, where the zeros wrap around to the largest value.
+ */
+static inline void fp16_range_scan_block(const float* src, size_t n, struct fp16_range_scan* scan) {
+	uint32_t nan = 0, infinity = 0, invalid = 0, underflow = 0;
+	uint32_t min_wrapped = UINT32_MAX, max_bits = 0;
+	for (size_t i = 0; i < n; i++) {
+		const uint32_t nonsign = fp32_to_bits(src[i]) & UINT32_C(0x7FFFFFFF);
+		const uint32_t wrapped = nonsign - 1;
+		nan += nonsign > UINT32_C(0x7F800000);
+		infinity += nonsign == UINT32_C(0x7F800000);
+		invalid += nonsign >= UINT32_C(0x477FF000);
+		underflow += wrapped < UINT32_C(0x33000000);
+		min_wrapped = wrapped < min_wrapped ? wrapped : min_wrapped;
+		max_bits = nonsign > max_bits ? nonsign : max_bits;
+	}
+	fp16_range_scan_add(src, n, scan, nan, infinity, invalid, underflow, min_wrapped + 1, max_bits);
+}
+
+#ifdef FP16_ARRAY_X86
+/*
+ * fp16_range_scan_block, 16 elements per iteration, and if dst is not NULL, the conversion in the same loop. The counts
+ * are kept in 32-bit lanes. AVX2 only has signed compares and minimum for 32 bits, so |x| - 1 is taken with the sign
+ * bit flipped, as |x| + 0x7FFFFFFF: signed on that is unsigned on |x| - 1.
+ * Returns the number of elements processed; the rest of the block goes to fp16_range_scan_block.
+ */
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t fp16_ieee_from_fp32_scan_avx2(const float* src, uint16_t* dst, size_t n,
+	struct fp16_range_scan* scan)
+{
+	const __m256i nonsign_mask = _mm256_set1_epi32(0x7FFFFFFF);
+	const __m256i infinity_bits = _mm256_set1_epi32(0x7F800000);
+	const __m256i below_invalid = _mm256_set1_epi32(0x477FEFFF);
+	const __m256i underflow_bound = _mm256_set1_epi32((int) 0xB3000000);
+	__m256i nan = _mm256_setzero_si256(), infinity = _mm256_setzero_si256();
+	__m256i invalid = _mm256_setzero_si256(), underflow = _mm256_setzero_si256();
+	__m256i min_wrapped = _mm256_set1_epi32(0x7FFFFFFF), max_bits = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m256 f0 = _mm256_loadu_ps(src + i);
+		const __m256 f1 = _mm256_loadu_ps(src + i + 8);
+		if (dst != NULL) {
+			_mm_storeu_si128((__m128i*) (dst + i), fp16_ieee_from_fp32_f16c_x8(f0));
+			_mm_storeu_si128((__m128i*) (dst + i + 8), fp16_ieee_from_fp32_f16c_x8(f1));
+		}
+		const __m256i x0 = _mm256_and_si256(_mm256_castps_si256(f0), nonsign_mask);
+		const __m256i x1 = _mm256_and_si256(_mm256_castps_si256(f1), nonsign_mask);
+		const __m256i wrapped0 = _mm256_add_epi32(x0, nonsign_mask);
+		const __m256i wrapped1 = _mm256_add_epi32(x1, nonsign_mask);
+		// Masks are -1, so subtracting them counts
+		nan = _mm256_sub_epi32(nan, _mm256_add_epi32(
+			_mm256_cmpgt_epi32(x0, infinity_bits), _mm256_cmpgt_epi32(x1, infinity_bits)));
+		infinity = _mm256_sub_epi32(infinity, _mm256_add_epi32(
+			_mm256_cmpeq_epi32(x0, infinity_bits), _mm256_cmpeq_epi32(x1, infinity_bits)));
+		invalid = _mm256_sub_epi32(invalid, _mm256_add_epi32(
+			_mm256_cmpgt_epi32(x0, below_invalid), _mm256_cmpgt_epi32(x1, below_invalid)));
+		underflow = _mm256_sub_epi32(underflow, _mm256_add_epi32(
+			_mm256_cmpgt_epi32(underflow_bound, wrapped0), _mm256_cmpgt_epi32(underflow_bound, wrapped1)));
+		min_wrapped = _mm256_min_epi32(min_wrapped, _mm256_min_epi32(wrapped0, wrapped1));
+		max_bits = _mm256_max_epi32(max_bits, _mm256_max_epi32(x0, x1));
+	}
+	if (i != 0) {
+		uint32_t lanes[6][8];
+		_mm256_storeu_si256((__m256i*) lanes[0], nan);
+		_mm256_storeu_si256((__m256i*) lanes[1], infinity);
+		_mm256_storeu_si256((__m256i*) lanes[2], invalid);
+		_mm256_storeu_si256((__m256i*) lanes[3], underflow);
+		_mm256_storeu_si256((__m256i*) lanes[4], min_wrapped);
+		_mm256_storeu_si256((__m256i*) lanes[5], max_bits);
+		uint32_t sums[4] = { 0 };
+		int32_t min_lane = INT32_MAX;
+		uint32_t max_lane = 0;
+		for (int l = 0; l < 8; l++) {
+			for (int k = 0; k < 4; k++) {
+				sums[k] += lanes[k][l];
+			}
+			min_lane = (int32_t) lanes[4][l] < min_lane ? (int32_t) lanes[4][l] : min_lane;
+			max_lane = lanes[5][l] > max_lane ? lanes[5][l] : max_lane;
+		}
+		fp16_range_scan_add(src, i, scan, sums[0], sums[1], sums[2], sums[3],
+			(uint32_t) min_lane - UINT32_C(0x7FFFFFFF), max_lane);
+	}
+	return i;
+}
+#endif
+
+/*
+ * Scan n 32-bit floating-point numbers in IEEE single-precision format for values that do not fit in IEEE half
+ * precision, and add the result to *scan.
+ *
+ * @note scan accumulates: initialize it once with fp16_range_scan_init, then call this for every chunk.
+ */
+static inline void fp16_range_scan_fp32(const float* src, size_t n, struct fp16_range_scan* scan) {
+#ifdef FP16_ARRAY_X86
+	const int simd = fp16_x86_kernels.ieee_from_fp32 != NULL && fp16_x86_has_f16c();
+#endif
+	for (size_t i = 0; i < n; i += FP16_SCAN_BLOCK) {
+		const size_t block = n - i < FP16_SCAN_BLOCK ? n - i : FP16_SCAN_BLOCK;
+		size_t j = 0;
+#ifdef FP16_ARRAY_X86
+		if (simd) {
+			j = fp16_ieee_from_fp32_scan_avx2(src + i, NULL, block, scan);
+		}
+#endif
+		fp16_range_scan_block(src + i + j, block - j, scan);
+	}
+}
+
+/*
+ * Convert n 32-bit floating-point numbers in IEEE single-precision format to 16-bit floating-point numbers in
+ * IEEE half-precision format, in bit representation, and scan the input like fp16_range_scan_fp32, in the same pass.
+ *
+ * @note dst is bit-identical to the result of fp16_ieee_from_fp32_array. It is written in full even if the scan finds
+ *       invalid values.
+ */
+static inline void fp16_ieee_from_fp32_array_scan(const float* src, uint16_t* dst, size_t n,
+	struct fp16_range_scan* scan)
+{
+#ifdef FP16_ARRAY_X86
+	const int fused = fp16_x86_kernels.ieee_from_fp32 != NULL && fp16_x86_has_f16c();
+#endif
+	for (size_t i = 0; i < n; i += FP16_SCAN_BLOCK) {
+		const size_t block = n - i < FP16_SCAN_BLOCK ? n - i : FP16_SCAN_BLOCK;
+		size_t j = 0;
+#ifdef FP16_ARRAY_X86
+		if (fused) {
+			j = fp16_ieee_from_fp32_scan_avx2(src + i, dst + i, block, scan);
+		}
+#endif
+		// The rest of the block: convert, then scan it while it is still in L1
+		fp16_ieee_from_fp32_array(src + i + j, dst + i + j, block - j);
+		fp16_range_scan_block(src + i + j, block - j, scan);
+	}
+}
+
+#endif /* FP16_SCAN_H */
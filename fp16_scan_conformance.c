@@ -0,0 +1,255 @@
+/*
+ * Check of the range scan of fp16_scan.h: fp16_range_scan_fp32 and fp16_ieee_from_fp32_array_scan, which take the AVX2
+ * loop where the CPU has it, must give the same scan as fp16_range_scan_block, and the fused one the same bits as
+ * fp16_ieee_from_fp32_array.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_scan_conformance.c -o fp16_scan_conformance -lm -pthread
+ *
+ * Usage: ./fp16_scan_conformance [-t threads] [-b first_bits] [-e last_bits]
+ *
+ * The program checks
+ * - arrays of in-range random values with one edge input (0x477FEFFF and 0x477FF000 on both sides of the overflow
+ *   threshold, 0x33000000 and 0x33000001 on both sides of the underflow threshold, NaN, Inf, zeros, fp32 subnormals)
+ *   at the first and the last index, in the 16-element steps of the AVX2 loop and in its tail, for lengths around 16
+ *   and FP16_SCAN_BLOCK; a second invalid value after the first, so that first_invalid must be the earlier one,
+ * - all-zero blocks and NaN-only blocks, of the same lengths,
+ * - every array again in two calls, split at each edge position, for the accumulation over calls,
+ * - the fp32 bit patterns first_bits..last_bits (by default all 2**32) in arrays of 2**16 consecutive patterns,
+ *   split into blocks of 2**20 inputs that the threads take from a shared counter.
+ * The reference is fp16_range_scan_block over blocks of FP16_SCAN_BLOCK elements. It prints the first mismatches and
+ * exits with 1 if there is any.
+ */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "fp16_scan.h"
+
+#define BLOCK_SIZE ((uint64_t) 1 << 20)
+#define ARRAY_SIZE ((size_t) 1 << 16)
+#define MAX_ARRAY (2 * FP16_SCAN_BLOCK + 37)
+#define MAX_THREADS 256
+#define MAX_REPORTS 8
+
+static uint64_t mismatches = 0;
+static pthread_mutex_t report_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The reference: the branch-free block scan alone, as fp16_range_scan_fp32 runs it without AVX2 */
+static void block_scan(const float* src, size_t n, struct fp16_range_scan* scan) {
+	for (size_t i = 0; i < n; i += FP16_SCAN_BLOCK) {
+		const size_t block = n - i < FP16_SCAN_BLOCK ? n - i : FP16_SCAN_BLOCK;
+		fp16_range_scan_block(src + i, block, scan);
+	}
+}
+
+static int same_scan(const struct fp16_range_scan* a, const struct fp16_range_scan* b) {
+	return a->count == b->count && a->nan == b->nan && a->infinity == b->infinity && a->overflow == b->overflow &&
+		a->underflow == b->underflow && a->first_invalid == b->first_invalid &&
+		a->min_exponent == b->min_exponent && a->max_exponent == b->max_exponent &&
+		fp32_to_bits(a->max_abs) == fp32_to_bits(b->max_abs);
+}
+
+static void print_scan(const char* name, const struct fp16_range_scan* s) {
+	printf("  %-9s count %llu nan %llu inf %llu overflow %llu underflow %llu first_invalid %lld exponents %d..%d"
+		" max_abs %a\n", name, (unsigned long long) s->count, (unsigned long long) s->nan,
+		(unsigned long long) s->infinity, (unsigned long long) s->overflow, (unsigned long long) s->underflow,
+		s->first_invalid == SIZE_MAX ? -1LL : (long long) s->first_invalid, s->min_exponent, s->max_exponent,
+		s->max_abs);
+}
+
+static void report(const char* what, size_t n, const char* name, const struct fp16_range_scan* actual,
+	const struct fp16_range_scan* expected)
+{
+	pthread_mutex_lock(&report_mutex);
+	if (mismatches++ < MAX_REPORTS) {
+		printf("%s, %zu elements:\n", what, n);
+		print_scan("reference", expected);
+		print_scan(name, actual);
+	}
+	pthread_mutex_unlock(&report_mutex);
+}
+
+/* Check one array, in one call and, if split is in (0, n), in two calls; dst and expected must hold n elements */
+static void check_array(const char* what, const float* src, uint16_t* dst, uint16_t* expected, size_t n, size_t split) {
+	struct fp16_range_scan reference, scan, fused;
+	fp16_range_scan_init(&reference);
+	block_scan(src, n, &reference);
+	fp16_ieee_from_fp32_array(src, expected, n);
+
+	fp16_range_scan_init(&scan);
+	fp16_range_scan_fp32(src, n, &scan);
+	if (!same_scan(&scan, &reference)) {
+		report(what, n, "scan", &scan, &reference);
+	}
+	fp16_range_scan_init(&fused);
+	fp16_ieee_from_fp32_array_scan(src, dst, n, &fused);
+	if (!same_scan(&fused, &reference)) {
+		report(what, n, "fused", &fused, &reference);
+	}
+	if (memcmp(dst, expected, n * sizeof(uint16_t)) != 0) {
+		pthread_mutex_lock(&report_mutex);
+		if (mismatches++ < MAX_REPORTS) {
+			printf("%s, %zu elements: fused conversion differs from fp16_ieee_from_fp32_array\n", what, n);
+		}
+		pthread_mutex_unlock(&report_mutex);
+	}
+
+	if (split != 0 && split < n) {
+		fp16_range_scan_init(&scan);
+		fp16_range_scan_fp32(src, split, &scan);
+		fp16_range_scan_fp32(src + split, n - split, &scan);
+		if (!same_scan(&scan, &reference)) {
+			report(what, n, "scan, 2 calls", &scan, &reference);
+		}
+		fp16_range_scan_init(&fused);
+		fp16_ieee_from_fp32_array_scan(src, dst, split, &fused);
+		fp16_ieee_from_fp32_array_scan(src + split, dst + split, n - split, &fused);
+		if (!same_scan(&fused, &reference)) {
+			report(what, n, "fused, 2 calls", &fused, &reference);
+		}
+	}
+}
+
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static void check_edges(void) {
+	static const uint32_t edges[] = {
+		0x477FEFFF, 0x477FF000, 0xC77FEFFF, 0xC77FF000, /* overflow threshold 65520 */
+		0x33000000, 0x33000001, 0xB3000000, 0xB3000001, /* underflow threshold 2^-25 */
+		0x7FC00000, 0xFFC00001, 0x7F800001, 0x7F800000, 0xFF800000, 0x7F7FFFFF,
+		0x00000000, 0x80000000, 0x00000001, 0x007FFFFF, 0x00800000, 0x387FE000, 0x477FE000,
+	};
+	static const size_t lengths[] = {
+		1, 2, 15, 16, 17, 31, 32, 33, 100, FP16_SCAN_BLOCK - 1, FP16_SCAN_BLOCK, FP16_SCAN_BLOCK + 1,
+		FP16_SCAN_BLOCK + 16 + 7, MAX_ARRAY,
+	};
+	const size_t edge_count = sizeof(edges) / sizeof(edges[0]);
+	float* src = (float*) malloc(MAX_ARRAY * sizeof(float));
+	uint16_t* dst = (uint16_t*) malloc(MAX_ARRAY * sizeof(uint16_t));
+	uint16_t* expected = (uint16_t*) malloc(MAX_ARRAY * sizeof(uint16_t));
+	uint32_t state = 1;
+	char what[128];
+
+	for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+		const size_t n = lengths[l];
+		/* first, middle of the AVX2 steps, first of the tail of the first block, last of the first block, last */
+		const size_t block = n < FP16_SCAN_BLOCK ? n : FP16_SCAN_BLOCK;
+		const size_t positions[] = { 0, block / 32 * 16 + 3, block / 16 * 16, block - 1, n - 1 };
+		for (size_t e = 0; e < edge_count; e++) {
+			for (size_t p = 0; p < sizeof(positions) / sizeof(positions[0]); p++) {
+				const size_t position = positions[p] < n ? positions[p] : n - 1;
+				for (int second = 0; second < 2; second++) {
+					/* in-range values from 2^-14 to 2^15 */
+					for (size_t i = 0; i < n; i++) {
+						const uint32_t r = next_random(&state);
+						src[i] = fp32_from_bits((r & UINT32_C(0x807FFFFF)) | ((113 + (r >> 23) % 30) << 23));
+					}
+					src[position] = fp32_from_bits(edges[e]);
+					if (second && position + 1 < n) {
+						const size_t later = position + 1 + next_random(&state) % (n - position - 1);
+						src[later] = fp32_from_bits(UINT32_C(0x7F800000));
+					}
+					snprintf(what, sizeof(what), "0x%08X at %zu%s", edges[e], position, second ? ", Inf after it" : "");
+					check_array(what, src, dst, expected, n, position);
+				}
+			}
+		}
+
+		for (int kind = 0; kind < 4; kind++) {
+			for (size_t i = 0; i < n; i++) {
+				const uint32_t r = next_random(&state);
+				src[i] = fp32_from_bits(kind == 0 ? 0 : kind == 1 ? (r & UINT32_C(0x80000000)) :
+					kind == 2 ? UINT32_C(0x7FC00000) : (r | UINT32_C(0x7F800001)));
+			}
+			static const char* const kinds[] = { "all +0", "all +-0", "all quiet NaN", "all NaN, random payloads" };
+			check_array(kinds[kind], src, dst, expected, n, n / 2);
+		}
+		/* NaN only, but one finite value in the tail: the block must be searched again for max_abs */
+		src[n - 1] = 1.5f;
+		check_array("NaN with 1.5 last", src, dst, expected, n, 0);
+	}
+	free(src);
+	free(dst);
+	free(expected);
+}
+
+struct sweep {
+	uint64_t end;
+	uint64_t next;
+};
+
+static void* worker_main(void* arg) {
+	struct sweep* sweep = (struct sweep*) arg;
+	float* src = (float*) malloc(ARRAY_SIZE * sizeof(float));
+	uint16_t* dst = (uint16_t*) malloc(ARRAY_SIZE * sizeof(uint16_t));
+	uint16_t* expected = (uint16_t*) malloc(ARRAY_SIZE * sizeof(uint16_t));
+	char what[64];
+	for (;;) {
+		const uint64_t first = __atomic_fetch_add(&sweep->next, BLOCK_SIZE, __ATOMIC_RELAXED);
+		if (first >= sweep->end) {
+			break;
+		}
+		const uint64_t last = sweep->end - first < BLOCK_SIZE ? sweep->end : first + BLOCK_SIZE;
+		for (uint64_t begin = first; begin < last; begin += ARRAY_SIZE) {
+			const size_t n = (size_t) (last - begin < ARRAY_SIZE ? last - begin : ARRAY_SIZE);
+			for (size_t i = 0; i < n; i++) {
+				src[i] = fp32_from_bits((uint32_t) (begin + i));
+			}
+			snprintf(what, sizeof(what), "0x%08llX..", (unsigned long long) begin);
+			check_array(what, src, dst, expected, n, 0);
+		}
+	}
+	free(src);
+	free(dst);
+	free(expected);
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	const long online = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t threads = online > 0 ? (size_t) online : 1;
+	uint64_t first_bits = 0, last_bits = UINT32_MAX;
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+			threads = (size_t) strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-b") == 0 && a + 1 < argc) {
+			first_bits = strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-e") == 0 && a + 1 < argc) {
+			last_bits = strtoull(argv[++a], NULL, 0);
+		} else {
+			fprintf(stderr, "usage: %s [-t threads] [-b first_bits] [-e last_bits]\n", argv[0]);
+			return 1;
+		}
+	}
+	threads = threads == 0 ? 1 : threads > MAX_THREADS ? MAX_THREADS : threads;
+
+	check_edges();
+	printf("edge inputs: %llu mismatches\n", (unsigned long long) mismatches);
+
+	struct sweep sweep = { last_bits + 1, first_bits };
+	pthread_t workers[MAX_THREADS];
+	for (size_t t = 1; t < threads; t++) {
+		pthread_create(&workers[t], NULL, worker_main, &sweep);
+	}
+	worker_main(&sweep);
+	for (size_t t = 1; t < threads; t++) {
+		pthread_join(workers[t], NULL);
+	}
+	printf("0x%08llX..0x%08llX: %llu mismatches\n", (unsigned long long) first_bits, (unsigned long long) last_bits,
+		(unsigned long long) mismatches);
+	return mismatches != 0;
+}
@@ -0,0 +1,558 @@
+#pragma once
+#ifndef FP16_STATS_H
+#define FP16_STATS_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cstddef>
+	#include <cstdint>
+	#include <cstring>
+#else
+	#include <stddef.h>
+	#include <stdint.h>
+	#include <string.h>
+#endif
+
+#include "fp16_array.h"
+
+/*
+ * Instrumented fp32 -> IEEE half-precision bulk conversion: the same result as fp16_ieee_from_fp32_array, plus a count
+ * of what happened to the inputs, so that the caller can tell a clean narrowing from one that needs rescaling or
+ * bfloat16.
+ *
+ * The outcome classes follow the branches of __float32_to_float16_scalar_rtn in mldev_utils_scalar.c, but are decided
+ * from the rounded result, so a value that rounds up from the largest subnormal into the normal range counts as
+ * normal, and 65519.99 (which rounds to 65504) is not an overflow:
+ *
+ * | class     | input                         | result                                  |
+ * |-----------|-------------------------------|-----------------------------------------|
+ * | zero      | +-0                           | +-0                                     |
+ * | normal    | finite                        | normal half-precision number            |
+ * | subnormal | finite                        | nonzero subnormal                       |
+ * | underflow | nonzero, |x| <= 2^-25         | +-0 (flushed)                           |
+ * | overflow  | finite, |x| >= 65520          | +-Inf                                   |
+ * | infinity  | +-Inf                         | +-Inf                                   |
+ * | nan       | NaN                           | NaN                                     |
+ *
+ * fp32 subnormals are far below the fp16 range; they count as underflow, and only exact zeros as zero. Along with the
+ * classes come first_invalid, the index of the first overflow, infinity or NaN (counted from the first element of the
+ * first call, like in fp16_scan.h), and max_abs, the largest finite |x|, so that 65504 / max_abs is the scale that
+ * makes the data fit. That is the default, FP16_STATS_COUNTS, and cheap enough to leave on for a conversion that is
+ * bound by memory bandwidth.
+ *
+ * With FP16_STATS_ERRORS, the conversion also records, for every finite input with a finite result, the absolute error
+ * |x - fp16(x)|, the relative error |x - fp16(x)| / |x| and the error in units in the last place of the result. The
+ * ULP histogram has FP16_STATS_ULP_BINS bins of 1/16 ulp: bin 0 counts exact conversions, bin k the errors in
+ * ((k - 1) / 16, k / 16] ulp. Round to nearest even never exceeds half an ulp, so bin 8 is the last one used; a
+ * flushed value is measured against the ulp of the smallest subnormal (2^-24), so underflows land in the histogram
+ * too. This costs several times the conversion itself; without the flag these fields stay 0.
+ *
+ * With AVX2 and F16C, conversion and statistics run in one fused loop, picked once from fp16_stats_kernel_table
+ * (fp16_ieee_from_fp32_counts_avx2 or _avx512f, or fp16_ieee_from_fp32_stats_avx2 for the errors). Elsewhere the
+ * conversion runs in blocks of FP16_STATS_BLOCK elements: the SIMD bulk conversion first, then branch-free passes over
+ * the block (input and output still in L1) that the compiler vectorizes. Their counters are 32-bit lanes, and the
+ * maxima are taken on the bits of the non-negative values, so the passes have no float reductions that need
+ * -ffast-math. Overflow, infinity and NaN are not counted in the loops: the inputs with |x| >= 65520, which the maximum
+ * of |x| tells apart, and a block that has any (rare) is scanned again for them.
+ */
+#define FP16_STATS_ULP_BINS 9
+#define FP16_STATS_BLOCK 2048
+
+/* Flags for fp16_conversion_stats_init */
+#define FP16_STATS_COUNTS 0
+#define FP16_STATS_ERRORS 1
+
+struct fp16_conversion_stats {
+	uint32_t flags;
+	uint64_t count;
+	uint64_t zero;
+	uint64_t normal;
+	uint64_t subnormal;
+	uint64_t underflow;
+	uint64_t overflow;
+	uint64_t infinity;
+	uint64_t nan;
+	/* SIZE_MAX if there is none */
+	size_t first_invalid;
+	float max_abs;
+	/* with FP16_STATS_ERRORS, over finite inputs with a finite result */
+	float max_abs_error;
+	float max_rel_error;
+	uint64_t ulp_histogram[FP16_STATS_ULP_BINS];
+};
+
+static inline void fp16_conversion_stats_init(struct fp16_conversion_stats* stats, uint32_t flags) {
+	memset(stats, 0, sizeof(*stats));
+	stats->flags = flags;
+	stats->first_invalid = SIZE_MAX;
+}
+
+/*
+ * Add the counts of `other`, which covers the elements after those of `stats`, to `stats`, e.g. to combine the
+ * statistics of consecutive chunks converted by several threads.
+ */
+static inline void fp16_conversion_stats_merge(struct fp16_conversion_stats* stats,
+	const struct fp16_conversion_stats* other)
+{
+	if (stats->first_invalid == SIZE_MAX && other->first_invalid != SIZE_MAX) {
+		stats->first_invalid = (size_t) stats->count + other->first_invalid;
+	}
+	stats->count += other->count;
+	stats->zero += other->zero;
+	stats->normal += other->normal;
+	stats->subnormal += other->subnormal;
+	stats->underflow += other->underflow;
+	stats->overflow += other->overflow;
+	stats->infinity += other->infinity;
+	stats->nan += other->nan;
+	stats->max_abs = other->max_abs > stats->max_abs ? other->max_abs : stats->max_abs;
+	stats->max_abs_error = other->max_abs_error > stats->max_abs_error ? other->max_abs_error : stats->max_abs_error;
+	stats->max_rel_error = other->max_rel_error > stats->max_rel_error ? other->max_rel_error : stats->max_rel_error;
+	for (int k = 0; k < FP16_STATS_ULP_BINS; k++) {
+		stats->ulp_histogram[k] += other->ulp_histogram[k];
+	}
+}
+
+/*
+ * Add the classes of n converted elements from the counts of the loops: zero inputs, and zero and below-normal results.
+ * max_bits is the largest |x| in bit representation, NaN and Inf included, as in fp16_range_scan_add. So the block
+ * has an invalid input (overflow, infinity or NaN: the results that are not finite) if max_bits >= 0x477FF000, which
+ * is rare, and then it is scanned again for their counts, its largest finite |x|, and the first one if there is none
+ * yet.
+ */
+static inline void fp16_stats_add_counts(const float* src, size_t n, struct fp16_conversion_stats* stats,
+	uint64_t zero, uint64_t result_zero, uint64_t result_below_normal, uint32_t max_bits)
+{
+	uint64_t invalid = 0, nan = 0, infinity = 0;
+	if (max_bits >= UINT32_C(0x477FF000)) {
+		max_bits = 0;
+		for (size_t i = 0; i < n; i++) {
+			const uint32_t nonsign = fp32_to_bits(src[i]) & UINT32_C(0x7FFFFFFF);
+			if (nonsign >= UINT32_C(0x477FF000) && stats->first_invalid == SIZE_MAX) {
+				stats->first_invalid = (size_t) stats->count + i;
+			}
+			invalid += nonsign >= UINT32_C(0x477FF000);
+			nan += nonsign > UINT32_C(0x7F800000);
+			infinity += nonsign == UINT32_C(0x7F800000);
+			if (nonsign < UINT32_C(0x7F800000) && nonsign > max_bits) {
+				max_bits = nonsign;
+			}
+		}
+	}
+	stats->count += n;
+	stats->zero += zero;
+	stats->underflow += result_zero - zero;
+	stats->subnormal += result_below_normal - result_zero;
+	stats->normal += n - invalid - result_below_normal;
+	stats->overflow += invalid - nan - infinity;
+	stats->infinity += infinity;
+	stats->nan += nan;
+	const float max_abs = fp32_from_bits(max_bits);
+	stats->max_abs = max_abs > stats->max_abs ? max_abs : stats->max_abs;
+}
+
+/*
+ * The classes of one block, n <= FP16_STATS_BLOCK, so that 32-bit counters can not overflow.
+ */
+static inline void fp16_stats_block_counts(const float* src, const uint16_t* dst, size_t n,
+	struct fp16_conversion_stats* stats)
+{
+	uint32_t zero = 0, result_zero = 0, result_below_normal = 0, max_bits = 0;
+	for (size_t i = 0; i < n; i++) {
+		const uint32_t nonsign = fp32_to_bits(src[i]) & UINT32_C(0x7FFFFFFF);
+		const uint32_t h = (uint32_t) dst[i] & UINT32_C(0x7FFF);
+		zero += nonsign == 0;
+		result_zero += h == 0;
+		result_below_normal += h < UINT32_C(0x0400);
+		max_bits = nonsign > max_bits ? nonsign : max_bits;
+	}
+	fp16_stats_add_counts(src, n, stats, zero, result_zero, result_below_normal, max_bits);
+}
+
+/*
+ * The errors of one block, n <= FP16_STATS_BLOCK, for FP16_STATS_ERRORS.
+ */
+static inline void fp16_stats_block_errors(const float* src, const uint16_t* dst, size_t n,
+	struct fp16_conversion_stats* stats)
+{
+	uint32_t max_abs_bits = 0, max_rel_bits = 0;
+	uint32_t histogram[FP16_STATS_ULP_BINS] = { 0 };
+	for (size_t i = 0; i < n; i++) {
+		const uint32_t nonsign = fp32_to_bits(src[i]) & UINT32_C(0x7FFFFFFF);
+		const uint32_t h = (uint32_t) dst[i] & UINT32_C(0x7FFF);
+		const uint32_t is_zero = nonsign == 0;
+		const uint32_t measured = (nonsign < UINT32_C(0x7F800000)) & (h != UINT32_C(0x7C00));
+
+		/* |fp16(x)|: the exponent rebias of fp16_ieee_to_fp32_value for normal numbers, a product for subnormals */
+		const float normal_value = fp32_from_bits((h << 13) + UINT32_C(0x38000000));
+		const float subnormal_value = (float) (int32_t) h * 0x1.0p-24f;
+		const float y = h < UINT32_C(0x0400) ? subnormal_value : normal_value;
+		const float x = fp32_from_bits(nonsign);
+		/* Exact: y is x rounded to 11 significant bits, the difference fits in 24 */
+		const float error = measured ? (x > y ? x - y : y - x) : 0.0f;
+		/* Not measured: a NaN x would give a NaN ratio, and its bits would win the unsigned maximum */
+		const float relative = measured && !is_zero ? error / x : 0.0f;
+		const uint32_t error_bits = fp32_to_bits(error);
+		const uint32_t relative_bits = fp32_to_bits(relative);
+		max_abs_bits = error_bits > max_abs_bits ? error_bits : max_abs_bits;
+		max_rel_bits = relative_bits > max_rel_bits ? relative_bits : max_rel_bits;
+
+		/* error * 16 / ulp(y), ulp(y) = 2^(max(e, 1) - 25): a power-of-two scale, so exact */
+		const uint32_t exponent = h >> 10;
+		const uint32_t ulp_exponent = exponent > 1 ? exponent : 1;
+		const float scaled = error * fp32_from_bits((UINT32_C(156) - ulp_exponent) << 23);
+		const uint32_t truncated = (uint32_t) (int32_t) scaled;
+		uint32_t bin = truncated + ((float) (int32_t) truncated < scaled);
+		bin = bin < FP16_STATS_ULP_BINS - 1 ? bin : FP16_STATS_ULP_BINS - 1;
+		for (uint32_t k = 0; k < FP16_STATS_ULP_BINS; k++) {
+			histogram[k] += measured & (bin == k);
+		}
+	}
+	const float max_abs = fp32_from_bits(max_abs_bits);
+	const float max_rel = fp32_from_bits(max_rel_bits);
+	stats->max_abs_error = max_abs > stats->max_abs_error ? max_abs : stats->max_abs_error;
+	stats->max_rel_error = max_rel > stats->max_rel_error ? max_rel : stats->max_rel_error;
+	for (int k = 0; k < FP16_STATS_ULP_BINS; k++) {
+		stats->ulp_histogram[k] += histogram[k];
+	}
+}
+
+/*
+ * The statistics of one block, n <= FP16_STATS_BLOCK: the classes, and the errors if stats has FP16_STATS_ERRORS.
+ */
+static inline void fp16_stats_block(const float* src, const uint16_t* dst, size_t n,
+	struct fp16_conversion_stats* stats)
+{
+	fp16_stats_block_counts(src, dst, n, stats);
+	if (stats->flags & FP16_STATS_ERRORS) {
+		fp16_stats_block_errors(src, dst, n, stats);
+	}
+}
+
+#ifdef FP16_ARRAY_X86
+/* Sum of the unsigned 16-bit lanes */
+FP16_X86_TARGET("avx2,f16c")
+static inline uint64_t fp16_stats_sum_epu16_avx2(__m256i v) {
+	const __m256i pairs = _mm256_madd_epi16(v, _mm256_set1_epi16(1));
+	uint32_t lanes[8];
+	_mm256_storeu_si256((__m256i*) lanes, pairs);
+	uint64_t sum = 0;
+	for (int l = 0; l < 8; l++) {
+		sum += lanes[l];
+	}
+	return sum;
+}
+
+/* Sum of the unsigned 8-bit lanes */
+FP16_X86_TARGET("avx2,f16c")
+static inline uint64_t fp16_stats_sum_epu8_avx2(__m256i v) {
+	const __m256i sums = _mm256_sad_epu8(v, _mm256_setzero_si256());
+	return (uint64_t) _mm256_extract_epi64(sums, 0) + (uint64_t) _mm256_extract_epi64(sums, 1) +
+		(uint64_t) _mm256_extract_epi64(sums, 2) + (uint64_t) _mm256_extract_epi64(sums, 3);
+}
+
+/* The class counters of the AVX2 loops, in 16-bit lanes, and the largest |x| in bit representation in 32-bit lanes */
+struct fp16_stats_counters_avx2 {
+	__m256i zero;
+	__m256i result_zero;
+	__m256i result_below_normal;
+	__m256i max_bits;
+};
+
+FP16_X86_TARGET("avx2,f16c")
+static inline void fp16_stats_counters_init_avx2(struct fp16_stats_counters_avx2* counters) {
+	counters->zero = _mm256_setzero_si256();
+	counters->result_zero = _mm256_setzero_si256();
+	counters->result_below_normal = _mm256_setzero_si256();
+	counters->max_bits = _mm256_setzero_si256();
+}
+
+/*
+ * Count 16 elements: the inputs f_lo and f_hi, the results h. The results are compared 16 at a time; the zero inputs
+ * are 32-bit masks, packed to 16 bits.
+ */
+FP16_X86_TARGET("avx2,f16c")
+static inline void fp16_stats_count_avx2(struct fp16_stats_counters_avx2* counters, __m256 f_lo, __m256 f_hi,
+	__m256i h)
+{
+	const __m256i nonsign_mask = _mm256_set1_epi32(0x7FFFFFFF);
+	const __m256i magnitude = _mm256_and_si256(h, _mm256_set1_epi16(0x7FFF));
+	counters->result_zero = _mm256_sub_epi16(counters->result_zero,
+		_mm256_cmpeq_epi16(magnitude, _mm256_setzero_si256()));
+	counters->result_below_normal = _mm256_sub_epi16(counters->result_below_normal,
+		_mm256_cmpgt_epi16(_mm256_set1_epi16(0x0400), magnitude));
+
+	const __m256i nonsign_lo = _mm256_and_si256(_mm256_castps_si256(f_lo), nonsign_mask);
+	const __m256i nonsign_hi = _mm256_and_si256(_mm256_castps_si256(f_hi), nonsign_mask);
+	const __m256i zero_lo = _mm256_cmpeq_epi32(nonsign_lo, _mm256_setzero_si256());
+	const __m256i zero_hi = _mm256_cmpeq_epi32(nonsign_hi, _mm256_setzero_si256());
+	counters->zero = _mm256_sub_epi16(counters->zero, _mm256_packs_epi32(zero_lo, zero_hi));
+	counters->max_bits = _mm256_max_epi32(counters->max_bits, _mm256_max_epi32(nonsign_lo, nonsign_hi));
+}
+
+/* Add the counters of the n elements from src to stats */
+FP16_X86_TARGET("avx2,f16c")
+static inline void fp16_stats_add_counters_avx2(const float* src, size_t n,
+	const struct fp16_stats_counters_avx2* counters, struct fp16_conversion_stats* stats)
+{
+	uint32_t lanes[8];
+	_mm256_storeu_si256((__m256i*) lanes, counters->max_bits);
+	uint32_t max_bits = 0;
+	for (int l = 0; l < 8; l++) {
+		max_bits = lanes[l] > max_bits ? lanes[l] : max_bits;
+	}
+	fp16_stats_add_counts(src, n, stats, fp16_stats_sum_epu16_avx2(counters->zero),
+		fp16_stats_sum_epu16_avx2(counters->result_zero), fp16_stats_sum_epu16_avx2(counters->result_below_normal),
+		max_bits);
+}
+
+/*
+ * Conversion and classes in one pass, 32 elements per iteration, added up every 255 iterations (the 16-bit lanes
+ * count 2 per iteration). The counting is about ten integer operations per 16 elements, which run while the loads wait
+ * for memory.
+ */
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t fp16_ieee_from_fp32_counts_avx2(const float* src, uint16_t* dst, size_t n,
+	struct fp16_conversion_stats* stats)
+{
+	size_t i = 0;
+	while (n - i >= 32) {
+		struct fp16_stats_counters_avx2 counters;
+		fp16_stats_counters_init_avx2(&counters);
+		const size_t begin = i;
+		const size_t iterations = (n - i) / 32 < 255 ? (n - i) / 32 : 255;
+		for (size_t it = 0; it < iterations; it++, i += 32) {
+			for (int half = 0; half < 2; half++) {
+				const float* s = src + i + 16 * half;
+				const __m256 f_lo = _mm256_loadu_ps(s);
+				const __m256 f_hi = _mm256_loadu_ps(s + 8);
+				const __m256i h = _mm256_set_m128i(fp16_ieee_from_fp32_f16c_x8(f_hi), fp16_ieee_from_fp32_f16c_x8(f_lo));
+				_mm256_storeu_si256((__m256i*) (dst + i + 16 * half), h);
+				fp16_stats_count_avx2(&counters, f_lo, f_hi, h);
+			}
+		}
+		fp16_stats_add_counters_avx2(src + begin, i - begin, &counters, stats);
+	}
+	return i;
+}
+
+/*
+ * fp16_ieee_from_fp32_counts_avx2 with AVX-512: 32 elements per iteration in one vector of results, compared into
+ * masks that are added to the 16-bit (results) and 32-bit (zero inputs) counters with masked adds. Half the
+ * instructions of the AVX2 loop, which is what keeps the counting under the memory traffic of the conversion.
+ */
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl")
+static inline size_t fp16_ieee_from_fp32_counts_avx512f(const float* src, uint16_t* dst, size_t n,
+	struct fp16_conversion_stats* stats)
+{
+	const __m512i nonsign_mask = _mm512_set1_epi32(0x7FFFFFFF);
+	const __m512i magnitude_mask = _mm512_set1_epi16(0x7FFF);
+	const __m512i sign_mask = _mm512_set1_epi16((short) 0x8000);
+	const __m512i nan_bits = _mm512_set1_epi16(0x7E00);
+	const __m512i fp16_min_normal = _mm512_set1_epi16(0x0400);
+	const __m512i one16 = _mm512_set1_epi16(1);
+	const __m512i one32 = _mm512_set1_epi32(1);
+
+	size_t i = 0;
+	while (n - i >= 32) {
+		__m512i zero = _mm512_setzero_si512(), result_zero = _mm512_setzero_si512();
+		__m512i result_below_normal = _mm512_setzero_si512(), max_bits = _mm512_setzero_si512();
+		const size_t begin = i;
+		const size_t iterations = (n - i) / 32 < 255 ? (n - i) / 32 : 255;
+		for (size_t it = 0; it < iterations; it++, i += 32) {
+			const __m512 f_lo = _mm512_loadu_ps(src + i);
+			const __m512 f_hi = _mm512_loadu_ps(src + i + 16);
+			const __m512i converted = _mm512_inserti64x4(_mm512_castsi256_si512(
+				_mm512_cvtps_ph(f_lo, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)),
+				_mm512_cvtps_ph(f_hi, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC), 1);
+			const __mmask32 is_nan = _mm512_kunpackw(_mm512_cmp_ps_mask(f_hi, f_hi, _CMP_UNORD_Q),
+				_mm512_cmp_ps_mask(f_lo, f_lo, _CMP_UNORD_Q));
+			const __m512i canonical = _mm512_or_si512(_mm512_and_si512(converted, sign_mask), nan_bits);
+			const __m512i h = _mm512_mask_blend_epi16(is_nan, converted, canonical);
+			_mm512_storeu_si512((void*) (dst + i), h);
+
+			const __m512i magnitude = _mm512_and_si512(h, magnitude_mask);
+			result_zero = _mm512_mask_add_epi16(result_zero,
+				_mm512_cmpeq_epi16_mask(magnitude, _mm512_setzero_si512()), result_zero, one16);
+			result_below_normal = _mm512_mask_add_epi16(result_below_normal,
+				_mm512_cmplt_epu16_mask(magnitude, fp16_min_normal), result_below_normal, one16);
+
+			const __m512i nonsign_lo = _mm512_and_si512(_mm512_castps_si512(f_lo), nonsign_mask);
+			const __m512i nonsign_hi = _mm512_and_si512(_mm512_castps_si512(f_hi), nonsign_mask);
+			zero = _mm512_mask_add_epi32(zero, _mm512_testn_epi32_mask(nonsign_lo, nonsign_lo), zero, one32);
+			zero = _mm512_mask_add_epi32(zero, _mm512_testn_epi32_mask(nonsign_hi, nonsign_hi), zero, one32);
+			max_bits = _mm512_max_epu32(max_bits, _mm512_max_epu32(nonsign_lo, nonsign_hi));
+		}
+		fp16_stats_add_counts(src + begin, i - begin, stats, (uint64_t) _mm512_reduce_add_epi32(zero),
+			(uint64_t) _mm512_reduce_add_epi32(_mm512_madd_epi16(result_zero, one16)),
+			(uint64_t) _mm512_reduce_add_epi32(_mm512_madd_epi16(result_below_normal, one16)),
+			_mm512_reduce_max_epu32(max_bits));
+	}
+	return i;
+}
+
+/*
+ * Conversion, classes and errors in one pass (FP16_STATS_ERRORS), 32 elements per iteration. On top of the counters
+ * of fp16_ieee_from_fp32_counts_avx2:
+ * - the ULP bins of 32 elements packed into the bytes of one vector and counted with byte compares, so the loop adds
+ *   up every 255 iterations. The results that are not measured (Inf, NaN) get an error of 0, and are taken out of bin
+ *   0 at the end.
+ * - the maximum relative error without a division per element: every lane keeps the (error, |x|) pair of its largest
+ *   ratio, compared by cross-multiplication, and divides once at the end.
+ */
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t fp16_ieee_from_fp32_stats_avx2(const float* src, uint16_t* dst, size_t n,
+	struct fp16_conversion_stats* stats)
+{
+	const __m256i nonsign_mask = _mm256_set1_epi32(0x7FFFFFFF);
+	const __m256i magnitude_mask = _mm256_set1_epi16(0x7FFF);
+	const __m256i fp16_inf = _mm256_set1_epi16(0x7C00);
+	const __m256 fp32_min_normal = _mm256_set1_ps(0x1.0p-126f);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i scale_base = _mm256_set1_epi32(156);
+
+	size_t i = 0;
+	while (n - i >= 32) {
+		struct fp16_stats_counters_avx2 counters;
+		fp16_stats_counters_init_avx2(&counters);
+		__m256i bins[FP16_STATS_ULP_BINS];
+		for (int k = 0; k < FP16_STATS_ULP_BINS; k++) {
+			bins[k] = _mm256_setzero_si256();
+		}
+		__m256i max_abs = _mm256_setzero_si256();
+		__m256 rel_error = _mm256_setzero_ps(), rel_value = _mm256_set1_ps(1.0f);
+
+		const size_t begin = i;
+		const size_t iterations = (n - i) / 32 < 255 ? (n - i) / 32 : 255;
+		for (size_t it = 0; it < iterations; it++, i += 32) {
+			__m256i bin[4];
+			for (int half = 0; half < 2; half++) {
+				const float* s = src + i + 16 * half;
+				const __m256 f_lo = _mm256_loadu_ps(s);
+				const __m256 f_hi = _mm256_loadu_ps(s + 8);
+				const __m256i h = _mm256_set_m128i(fp16_ieee_from_fp32_f16c_x8(f_hi), fp16_ieee_from_fp32_f16c_x8(f_lo));
+				_mm256_storeu_si256((__m256i*) (dst + i + 16 * half), h);
+				fp16_stats_count_avx2(&counters, f_lo, f_hi, h);
+
+				const __m256i magnitude = _mm256_and_si256(h, magnitude_mask);
+				const __m256i finite = _mm256_cmpgt_epi16(fp16_inf, magnitude);
+				const __m256i nonsign_lo = _mm256_and_si256(_mm256_castps_si256(f_lo), nonsign_mask);
+				const __m256i nonsign_hi = _mm256_and_si256(_mm256_castps_si256(f_hi), nonsign_mask);
+				for (int q = 0; q < 2; q++) {
+					const __m128i m16 = q == 0 ? _mm256_castsi256_si128(magnitude) : _mm256_extracti128_si256(magnitude, 1);
+					const __m128i finite16 = q == 0 ? _mm256_castsi256_si128(finite) : _mm256_extracti128_si256(finite, 1);
+					const __m256 x = _mm256_castsi256_ps(q == 0 ? nonsign_lo : nonsign_hi);
+					const __m256 y = _mm256_cvtph_ps(m16);
+					const __m256 error = _mm256_and_ps(_mm256_max_ps(_mm256_sub_ps(x, y), _mm256_sub_ps(y, x)),
+						_mm256_castsi256_ps(_mm256_cvtepi16_epi32(finite16)));
+					max_abs = _mm256_max_epi32(max_abs, _mm256_castps_si256(error));
+
+					/* error / x > rel_error / rel_value; x clamped to the normal range (underflows come from the counts) */
+					const __m256 value = _mm256_max_ps(x, fp32_min_normal);
+					const __m256 larger = _mm256_cmp_ps(_mm256_mul_ps(error, rel_value), _mm256_mul_ps(rel_error, value), _CMP_GT_OQ);
+					rel_error = _mm256_blendv_ps(rel_error, error, larger);
+					rel_value = _mm256_blendv_ps(rel_value, value, larger);
+
+					/* ceil(error * 16 / ulp(y)), ulp(y) = 2^(max(e, 1) - 25) */
+					const __m256i exponent = _mm256_max_epi32(_mm256_srli_epi32(_mm256_cvtepu16_epi32(m16), 10), one);
+					const __m256 scale = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_sub_epi32(scale_base, exponent), 23));
+					bin[2 * half + q] = _mm256_cvttps_epi32(_mm256_ceil_ps(_mm256_mul_ps(error, scale)));
+				}
+			}
+			const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(bin[0], bin[1]), _mm256_packs_epi32(bin[2], bin[3]));
+			bins[0] = _mm256_sub_epi8(bins[0], _mm256_cmpeq_epi8(packed, _mm256_setzero_si256()));
+			bins[1] = _mm256_sub_epi8(bins[1], _mm256_cmpeq_epi8(packed, _mm256_set1_epi8(1)));
+			bins[2] = _mm256_sub_epi8(bins[2], _mm256_cmpeq_epi8(packed, _mm256_set1_epi8(2)));
+			bins[3] = _mm256_sub_epi8(bins[3], _mm256_cmpeq_epi8(packed, _mm256_set1_epi8(3)));
+			bins[4] = _mm256_sub_epi8(bins[4], _mm256_cmpeq_epi8(packed, _mm256_set1_epi8(4)));
+			bins[5] = _mm256_sub_epi8(bins[5], _mm256_cmpeq_epi8(packed, _mm256_set1_epi8(5)));
+			bins[6] = _mm256_sub_epi8(bins[6], _mm256_cmpeq_epi8(packed, _mm256_set1_epi8(6)));
+			bins[7] = _mm256_sub_epi8(bins[7], _mm256_cmpeq_epi8(packed, _mm256_set1_epi8(7)));
+			bins[8] = _mm256_sub_epi8(bins[8], _mm256_cmpeq_epi8(packed, _mm256_set1_epi8(8)));
+		}
+
+		const uint64_t underflow = stats->underflow;
+		const uint64_t not_finite = stats->overflow + stats->infinity + stats->nan;
+		fp16_stats_add_counters_avx2(src + begin, i - begin, &counters, stats);
+		for (int k = 0; k < FP16_STATS_ULP_BINS; k++) {
+			stats->ulp_histogram[k] += fp16_stats_sum_epu8_avx2(bins[k]);
+		}
+		stats->ulp_histogram[0] -= stats->overflow + stats->infinity + stats->nan - not_finite;
+
+		uint32_t abs_lanes[8];
+		float error_lanes[8], value_lanes[8];
+		_mm256_storeu_si256((__m256i*) abs_lanes, max_abs);
+		_mm256_storeu_ps(error_lanes, rel_error);
+		_mm256_storeu_ps(value_lanes, rel_value);
+		for (int l = 0; l < 8; l++) {
+			const float a = fp32_from_bits(abs_lanes[l]), r = error_lanes[l] / value_lanes[l];
+			stats->max_abs_error = a > stats->max_abs_error ? a : stats->max_abs_error;
+			stats->max_rel_error = r > stats->max_rel_error ? r : stats->max_rel_error;
+		}
+		if (stats->underflow != underflow) {
+			stats->max_rel_error = 1.0f;
+		}
+	}
+	return i;
+}
+
+/*
+ * The fused loops, ordered from the slowest to the fastest, like the kernel tables of fp16_x86.h: counts for the
+ * classes only, stats for FP16_STATS_ERRORS too. Both return the number of elements they converted, a multiple of 32.
+ */
+typedef size_t (*fp16_stats_kernel_fn)(const float* src, uint16_t* dst, size_t n, struct fp16_conversion_stats* stats);
+
+struct fp16_stats_kernel {
+	const char* name;
+	int (*supported)(void);
+	fp16_stats_kernel_fn ieee_from_fp32_counts;
+	fp16_stats_kernel_fn ieee_from_fp32_stats;
+};
+
+static const struct fp16_stats_kernel fp16_stats_kernel_table[] = {
+	{ "avx2", fp16_x86_has_f16c, fp16_ieee_from_fp32_counts_avx2, fp16_ieee_from_fp32_stats_avx2 },
+	{ "avx512f", fp16_x86_has_avx512f, fp16_ieee_from_fp32_counts_avx512f, fp16_ieee_from_fp32_stats_avx2 },
+};
+
+#define FP16_STATS_KERNEL_COUNT (sizeof(fp16_stats_kernel_table) / sizeof(fp16_stats_kernel_table[0]))
+
+static struct fp16_stats_kernel fp16_stats_kernels = { "scalar", NULL, NULL, NULL };
+
+#if defined(__GNUC__)
+__attribute__((__constructor__, __unused__))
+#endif
+static void fp16_stats_init(void) {
+	for (size_t k = 0; k < FP16_STATS_KERNEL_COUNT; k++) {
+		if (fp16_stats_kernel_table[k].supported()) {
+			fp16_stats_kernels = fp16_stats_kernel_table[k];
+		}
+	}
+}
+#endif
+
+/*
+ * Convert n 32-bit floating-point numbers in IEEE single-precision format to 16-bit floating-point numbers in
+ * IEEE half-precision format, in bit representation, and add the outcome of every conversion to *stats.
+ *
+ * @note dst is bit-identical to the result of fp16_ieee_from_fp32_array.
+ * @note stats accumulates: initialize it once with fp16_conversion_stats_init, then call this for every chunk. The
+ *       flags given to fp16_conversion_stats_init choose between the classes only and the errors too.
+ */
+static inline void fp16_ieee_from_fp32_array_stats(const float* src, uint16_t* dst, size_t n,
+	struct fp16_conversion_stats* stats)
+{
+	size_t i = 0;
+#ifdef FP16_ARRAY_X86
+	const fp16_stats_kernel_fn kernel = stats->flags & FP16_STATS_ERRORS ?
+		fp16_stats_kernels.ieee_from_fp32_stats : fp16_stats_kernels.ieee_from_fp32_counts;
+	if (kernel != NULL) {
+		i = kernel(src, dst, n, stats);
+	}
+#endif
+	for (; i < n; i += FP16_STATS_BLOCK) {
+		const size_t block = n - i < FP16_STATS_BLOCK ? n - i : FP16_STATS_BLOCK;
+		fp16_ieee_from_fp32_array(src + i, dst + i, block);
+		fp16_stats_block(src + i, dst + i, block, stats);
+	}
+}
+
+#endif /* FP16_STATS_H */
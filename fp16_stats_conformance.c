@@ -0,0 +1,335 @@
+/*
+ * Check of the instrumented conversion of fp16_stats.h: the fused loops and the block pass must give the same
+ * conversion as fp16_ieee_from_fp32_array and the same statistics as a double-precision reference.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16_stats_conformance.c -o fp16_stats_conformance -lm -pthread
+ *
+ * Usage: ./fp16_stats_conformance [-t threads] [-b first_bits] [-e last_bits]
+ *
+ * The program checks
+ * - arrays built from edge inputs (NaN, Inf, the overflow threshold 65520 and 65519.99, the underflow threshold 2^-25,
+ *   fp32 subnormal inputs, fp16 subnormal results, zeros) and from random bits, of lengths around the 32-element step
+ *   and the 255-iteration flush of the fused loops, with a NaN or an Inf placed in the fused body and in the tail,
+ * - the fp32 bit patterns first_bits..last_bits (by default all 2**32) in arrays of 2**16 consecutive patterns,
+ *   split into blocks of 2**20 inputs that the threads take from a shared counter.
+ * Every array goes, with FP16_STATS_COUNTS and with FP16_STATS_ERRORS, through fp16_ieee_from_fp32_array_stats (in
+ * one call, and in two that split the array at a third), through the block pass alone, and through every fused loop
+ * of fp16_stats_kernel_table the CPU supports, each followed by the block pass. Every path must match the reference:
+ * the counts, first_invalid, the ULP histogram, and the maxima bit for bit. It prints the first mismatches and exits
+ * with 1 if there is any.
+ */
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "fp16_stats.h"
+
+#define BLOCK_SIZE ((uint64_t) 1 << 20)
+#define ARRAY_SIZE ((size_t) 1 << 16)
+#define MAX_THREADS 256
+#define MAX_REPORTS 8
+
+static uint64_t mismatches = 0;
+static pthread_mutex_t report_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The statistics of n inputs from their definition, with the errors in double precision */
+static void reference_stats(const float* src, size_t n, uint32_t flags, struct fp16_conversion_stats* stats) {
+	fp16_conversion_stats_init(stats, flags);
+	for (size_t i = 0; i < n; i++) {
+		const uint16_t h = fp16_ieee_from_fp32_value(src[i]);
+		const double x = fabs((double) src[i]);
+		const double y = fabs((double) fp16_ieee_to_fp32_value(h));
+		stats->count++;
+		if (isnan(src[i]) || isinf(y)) {
+			stats->first_invalid = stats->first_invalid == SIZE_MAX ? i : stats->first_invalid;
+		}
+		if (isnan(src[i])) {
+			stats->nan++;
+			continue;
+		}
+		if (isinf(src[i])) {
+			stats->infinity++;
+			continue;
+		}
+		stats->max_abs = (float) x > stats->max_abs ? (float) x : stats->max_abs;
+		if (isinf(y)) {
+			stats->overflow++;
+			continue;
+		}
+		if (x == 0.0) {
+			stats->zero++;
+		} else if (y == 0.0) {
+			stats->underflow++;
+		} else if (y < 0x1.0p-14) {
+			stats->subnormal++;
+		} else {
+			stats->normal++;
+		}
+		if (flags & FP16_STATS_ERRORS) {
+			const double error = fabs(x - y);
+			const float relative = x != 0.0 ? (float) (error / x) : 0.0f;
+			stats->max_abs_error = (float) error > stats->max_abs_error ? (float) error : stats->max_abs_error;
+			stats->max_rel_error = relative > stats->max_rel_error ? relative : stats->max_rel_error;
+			const double ulp = y < 0x1.0p-14 ? 0x1.0p-24 : ldexp(1.0, ilogb(y) - 10);
+			const double bin = ceil(error * 16.0 / ulp);
+			stats->ulp_histogram[bin < FP16_STATS_ULP_BINS - 1 ? (int) bin : FP16_STATS_ULP_BINS - 1]++;
+		}
+	}
+}
+
+/* The block pass for the elements from i on, as fp16_ieee_from_fp32_array_stats runs it after the fused loop */
+static void block_stats(const float* src, uint16_t* dst, size_t i, size_t n, struct fp16_conversion_stats* stats) {
+	for (; i < n; i += FP16_STATS_BLOCK) {
+		const size_t block = n - i < FP16_STATS_BLOCK ? n - i : FP16_STATS_BLOCK;
+		fp16_ieee_from_fp32_array(src + i, dst + i, block);
+		fp16_stats_block(src + i, dst + i, block, stats);
+	}
+}
+
+static int same_stats(const struct fp16_conversion_stats* a, const struct fp16_conversion_stats* b) {
+	int same = a->count == b->count && a->zero == b->zero && a->normal == b->normal && a->subnormal == b->subnormal &&
+		a->underflow == b->underflow && a->overflow == b->overflow && a->infinity == b->infinity && a->nan == b->nan &&
+		a->first_invalid == b->first_invalid && fp32_to_bits(a->max_abs) == fp32_to_bits(b->max_abs) &&
+		fp32_to_bits(a->max_abs_error) == fp32_to_bits(b->max_abs_error) &&
+		fp32_to_bits(a->max_rel_error) == fp32_to_bits(b->max_rel_error);
+	for (int k = 0; k < FP16_STATS_ULP_BINS; k++) {
+		same &= a->ulp_histogram[k] == b->ulp_histogram[k];
+	}
+	return same;
+}
+
+static void print_stats(const char* name, const struct fp16_conversion_stats* s) {
+	printf("  %-16s count %llu zero %llu normal %llu subnormal %llu underflow %llu overflow %llu inf %llu nan %llu"
+		" first_invalid %lld max_abs %a max_abs_error %a max_rel_error %a ulp", name, (unsigned long long) s->count,
+		(unsigned long long) s->zero, (unsigned long long) s->normal, (unsigned long long) s->subnormal,
+		(unsigned long long) s->underflow, (unsigned long long) s->overflow, (unsigned long long) s->infinity,
+		(unsigned long long) s->nan, s->first_invalid == SIZE_MAX ? -1LL : (long long) s->first_invalid, s->max_abs,
+		s->max_abs_error, s->max_rel_error);
+	for (int k = 0; k < FP16_STATS_ULP_BINS; k++) {
+		printf(" %llu", (unsigned long long) s->ulp_histogram[k]);
+	}
+	printf("\n");
+}
+
+/*
+ * The paths of one flag: fp16_ieee_from_fp32_array_stats in one call and in two, the block pass alone, and every
+ * fused loop the CPU supports followed by the block pass.
+ */
+#ifdef FP16_ARRAY_X86
+	#define MAX_PATHS (3 + FP16_STATS_KERNEL_COUNT)
+#else
+	#define MAX_PATHS 3
+#endif
+
+static size_t run_paths(const float* src, uint16_t* dst, const uint16_t* expected, size_t n, uint32_t flags,
+	struct fp16_conversion_stats* stats, const char** names, int* converted)
+{
+	size_t paths = 0;
+	names[paths] = "array_stats";
+	fp16_conversion_stats_init(&stats[paths], flags);
+	fp16_ieee_from_fp32_array_stats(src, dst, n, &stats[paths]);
+	converted[paths++] = memcmp(dst, expected, n * sizeof(uint16_t)) == 0;
+
+	names[paths] = "array_stats x2";
+	fp16_conversion_stats_init(&stats[paths], flags);
+	fp16_ieee_from_fp32_array_stats(src, dst, n / 3, &stats[paths]);
+	fp16_ieee_from_fp32_array_stats(src + n / 3, dst + n / 3, n - n / 3, &stats[paths]);
+	converted[paths++] = memcmp(dst, expected, n * sizeof(uint16_t)) == 0;
+
+	names[paths] = "block";
+	fp16_conversion_stats_init(&stats[paths], flags);
+	block_stats(src, dst, 0, n, &stats[paths]);
+	converted[paths++] = memcmp(dst, expected, n * sizeof(uint16_t)) == 0;
+
+#ifdef FP16_ARRAY_X86
+	for (size_t k = 0; k < FP16_STATS_KERNEL_COUNT; k++) {
+		if (!fp16_stats_kernel_table[k].supported()) {
+			continue;
+		}
+		const fp16_stats_kernel_fn kernel = flags & FP16_STATS_ERRORS ?
+			fp16_stats_kernel_table[k].ieee_from_fp32_stats : fp16_stats_kernel_table[k].ieee_from_fp32_counts;
+		names[paths] = fp16_stats_kernel_table[k].name;
+		fp16_conversion_stats_init(&stats[paths], flags);
+		block_stats(src, dst, kernel(src, dst, n, &stats[paths]), n, &stats[paths]);
+		converted[paths++] = memcmp(dst, expected, n * sizeof(uint16_t)) == 0;
+	}
+#endif
+	return paths;
+}
+
+/* Check one array through every path, with and without the errors; dst and expected must hold n elements */
+static void check_array(const char* what, const float* src, uint16_t* dst, uint16_t* expected, size_t n) {
+	fp16_ieee_from_fp32_array(src, expected, n);
+	for (uint32_t flags = FP16_STATS_COUNTS; flags <= FP16_STATS_ERRORS; flags++) {
+		struct fp16_conversion_stats reference, stats[MAX_PATHS];
+		const char* names[MAX_PATHS];
+		int converted[MAX_PATHS];
+		reference_stats(src, n, flags, &reference);
+		const size_t paths = run_paths(src, dst, expected, n, flags, stats, names, converted);
+		int ok = 1;
+		for (size_t p = 0; p < paths; p++) {
+			ok &= converted[p] && same_stats(&stats[p], &reference);
+		}
+		if (!ok) {
+			pthread_mutex_lock(&report_mutex);
+			if (mismatches++ < MAX_REPORTS) {
+				printf("%s, %zu elements, %s:\n", what, n, flags & FP16_STATS_ERRORS ? "errors" : "counts");
+				print_stats("reference", &reference);
+				for (size_t p = 0; p < paths; p++) {
+					print_stats(names[p], &stats[p]);
+					if (!converted[p]) {
+						printf("  %-16s conversion differs from fp16_ieee_from_fp32_array\n", names[p]);
+					}
+				}
+			}
+			pthread_mutex_unlock(&report_mutex);
+		}
+	}
+}
+
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static void check_edges(void) {
+	static const uint32_t edges[] = {
+		0x00000000, 0x80000000, 0x7FC00000, 0xFFC00001, 0x7F800001, 0x7F800000, 0xFF800000,
+		0x477FF000, 0x477FEFFF, 0xC77FF000, 0x47800000, 0x7F7FFFFF, /* overflow threshold 65520 and below */
+		0x33000000, 0x33000001, 0xB3000000, 0x32FFFFFF, /* underflow threshold 2^-25 */
+		0x00000001, 0x007FFFFF, 0x80400000, 0x00800000, /* fp32 subnormal and smallest normal */
+		0x33800000, 0x387FC000, 0x387FE000, 0x387FF000, 0x38800000, /* fp16 subnormal results */
+		0x3F800000, 0x3F801000, 0x3F803000, 0x3F800001, 0x3F8FFFFF, 0x3FAAAAAB, 0x477FE000,
+	};
+	static const size_t lengths[] = {
+		0, 1, 7, 31, 32, 33, 63, 64, 65, 100, 1000, FP16_STATS_BLOCK, FP16_STATS_BLOCK + 5, 32 * 255, 32 * 255 + 1,
+		32 * 255 * 2 + 37, 40000,
+	};
+	const size_t edge_count = sizeof(edges) / sizeof(edges[0]);
+	const size_t max_n = 40000;
+	float* src = (float*) malloc(max_n * sizeof(float));
+	uint16_t* dst = (uint16_t*) malloc(max_n * sizeof(uint16_t));
+	uint16_t* expected = (uint16_t*) malloc(max_n * sizeof(uint16_t));
+	uint32_t state = 1;
+	char what[128];
+
+	/* Every edge input alone, in the body and in the tail */
+	for (size_t e = 0; e < edge_count; e++) {
+		for (size_t position = 0; position < 40; position++) {
+			for (size_t i = 0; i < 40; i++) {
+				src[i] = 1.0001f + (float) i;
+			}
+			src[position] = fp32_from_bits(edges[e]);
+			snprintf(what, sizeof(what), "0x%08X at %zu", edges[e], position);
+			check_array(what, src, dst, expected, 40);
+		}
+	}
+
+	/* Mixtures of edge inputs and random numbers, with a NaN or an Inf at a random place */
+	for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+		const size_t n = lengths[l];
+		for (int kind = 0; kind < 6; kind++) {
+			for (size_t i = 0; i < n; i++) {
+				const uint32_t r = next_random(&state);
+				if (kind == 0) {
+					src[i] = fp32_from_bits(r);
+				} else if (kind == 1) {
+					src[i] = fp32_from_bits(edges[r % edge_count]);
+				} else if (kind == 2) {
+					/* mostly finite values around the fp16 range */
+					src[i] = fp32_from_bits((r & UINT32_C(0x807FFFFF)) | ((100 + (r >> 23) % 48) << 23));
+				} else {
+					src[i] = ldexpf(1.0f + (float) (r % 1000) * 0x1.0p-10f, (int) (r >> 24) % 40 - 28);
+				}
+			}
+			if (kind >= 3 && n != 0) {
+				const size_t position = kind == 3 ? n / 2 : kind == 4 ? n - 1 : next_random(&state) % n;
+				src[position] = fp32_from_bits(kind == 5 ? UINT32_C(0xFF800000) : UINT32_C(0x7FC00000));
+			}
+			snprintf(what, sizeof(what), "kind %d", kind);
+			check_array(what, src, dst, expected, n);
+		}
+	}
+	free(src);
+	free(dst);
+	free(expected);
+}
+
+struct sweep {
+	uint64_t end;
+	uint64_t next;
+};
+
+static void* worker_main(void* arg) {
+	struct sweep* sweep = (struct sweep*) arg;
+	float* src = (float*) malloc(ARRAY_SIZE * sizeof(float));
+	uint16_t* dst = (uint16_t*) malloc(ARRAY_SIZE * sizeof(uint16_t));
+	uint16_t* expected = (uint16_t*) malloc(ARRAY_SIZE * sizeof(uint16_t));
+	char what[64];
+	for (;;) {
+		const uint64_t first = __atomic_fetch_add(&sweep->next, BLOCK_SIZE, __ATOMIC_RELAXED);
+		if (first >= sweep->end) {
+			break;
+		}
+		const uint64_t last = sweep->end - first < BLOCK_SIZE ? sweep->end : first + BLOCK_SIZE;
+		for (uint64_t begin = first; begin < last; begin += ARRAY_SIZE) {
+			const size_t n = (size_t) (last - begin < ARRAY_SIZE ? last - begin : ARRAY_SIZE);
+			for (size_t i = 0; i < n; i++) {
+				src[i] = fp32_from_bits((uint32_t) (begin + i));
+			}
+			snprintf(what, sizeof(what), "0x%08llX..", (unsigned long long) begin);
+			check_array(what, src, dst, expected, n);
+		}
+	}
+	free(src);
+	free(dst);
+	free(expected);
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	const long online = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t threads = online > 0 ? (size_t) online : 1;
+	uint64_t first_bits = 0, last_bits = UINT32_MAX;
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+			threads = (size_t) strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-b") == 0 && a + 1 < argc) {
+			first_bits = strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-e") == 0 && a + 1 < argc) {
+			last_bits = strtoull(argv[++a], NULL, 0);
+		} else {
+			fprintf(stderr, "usage: %s [-t threads] [-b first_bits] [-e last_bits]\n", argv[0]);
+			return 1;
+		}
+	}
+	threads = threads == 0 ? 1 : threads > MAX_THREADS ? MAX_THREADS : threads;
+
+	check_edges();
+	printf("edge inputs: %llu mismatches\n", (unsigned long long) mismatches);
+
+	struct sweep sweep = { last_bits + 1, first_bits };
+	pthread_t workers[MAX_THREADS];
+	for (size_t t = 1; t < threads; t++) {
+		pthread_create(&workers[t], NULL, worker_main, &sweep);
+	}
+	worker_main(&sweep);
+	for (size_t t = 1; t < threads; t++) {
+		pthread_join(workers[t], NULL);
+	}
+	printf("0x%08llX..0x%08llX: %llu mismatches\n", (unsigned long long) first_bits, (unsigned long long) last_bits,
+		(unsigned long long) mismatches);
+	return mismatches != 0;
+}
@@ -281,6 +281,39 @@ static inline uint16_t fp16_ieee_from_fp32_value(float f) {
 	return (sign >> 16) | (shl1_w > UINT32_C(0xFF000000) ? UINT16_C(0x7E00) : nonsign);
 }
 
+/*
+ * Convert a 32-bit floating-point number in IEEE single-precision format, in bit representation, to a 16-bit
+ * floating-point number in IEEE half-precision format, in bit representation.
+ *
+ * The result is the same as fp16_ieee_from_fp32_value in the default floating-point environment, but the rounding is
+ * done on the bits: it does not depend on the rounding mode, and a single-precision subnormal input is never an operand
+ * of a floating-point instruction, which on x86 costs a microcode assist of 100+ cycles unless DAZ is set.
+ * - Normal results: the exponent is rebiased by subtracting 112 << 23, and the 13 dropped mantissa bits are rounded
+ *   with 0xFFF plus the lowest kept bit, so a tie rounds up only when the kept part is odd. A carry out of the mantissa
+ *   moves into the exponent, up to 0x7C00, which is why every input from 0x477FF000 (65520) up is infinity.
+ * - Subnormal results (below 2**(-14)): the mantissa with its implicit bit is shifted right by 126 - e, with the same
+ *   rounding. Below 2**(-25) the result is zero.
+ *
+ * @note The implementation doesn't use any floating-point operations.
+ */
+static inline uint16_t fp16_ieee_from_fp32_bits(uint32_t w) {
+	const uint32_t sign = (w >> 16) & UINT32_C(0x8000);
+	const uint32_t nonsign = w & UINT32_C(0x7FFFFFFF);
+	uint32_t h;
+	if (nonsign >= UINT32_C(0x477FF000)) {
+		h = nonsign > UINT32_C(0x7F800000) ? UINT32_C(0x7E00) : UINT32_C(0x7C00);
+	} else if (nonsign >= UINT32_C(0x38800000)) {
+		h = (nonsign - UINT32_C(0x38000000) + UINT32_C(0xFFF) + ((nonsign >> 13) & 1)) >> 13;
+	} else if (nonsign >= UINT32_C(0x33000000)) {
+		const uint32_t mantissa = (nonsign & UINT32_C(0x007FFFFF)) | UINT32_C(0x00800000);
+		const uint32_t shift = 126 - (nonsign >> 23);
+		h = (mantissa + (UINT32_C(1) << (shift - 1)) - 1 + ((mantissa >> shift) & 1)) >> shift;
+	} else {
+		h = 0;
+	}
+	return (uint16_t) (sign | h);
+}
+
 /*
  * Convert a 16-bit floating-point number in ARM alternative half-precision format, in bit representation, to
  * a 32-bit floating-point number in IEEE single-precision format, in bit representation.
@@ -483,4 +516,81 @@ static inline uint16_t fp16_alt_from_fp32_value(float f) {
 	return (sign >> 16) | ((exp_f & UINT32_C(0x00007C00)) + (fp32_to_bits(base) & UINT32_C(0x00000FFF)));
 }
 
+/*
+ * Convert a 32-bit floating-point number in IEEE single-precision format to a 16-bit floating-point number in
+ * bfloat16 format, in bit representation, rounding to nearest with ties to even.
+ *
+ * bfloat16 is the upper half of a single-precision number: same sign and 8-bit exponent, 7 bits of mantissa. Rounding
+ * adds 0x7FFF plus the lowest kept bit to the dropped half, so a tie rounds up only when the kept part is odd, and a
+ * carry out of the mantissa moves into the exponent (up to infinity). NaN keeps its sign and upper payload bits and gets
+ * the quiet bit 0x0040, so a NaN never turns into infinity.
+ *
+ * @note The implementation doesn't use any floating-point operations.
+ */
+static inline uint16_t bf16_from_fp32_value(float f) {
+	const uint32_t w = fp32_to_bits(f);
+	if ((w & UINT32_C(0x7FFFFFFF)) > UINT32_C(0x7F800000)) {
+		return (uint16_t) ((w >> 16) | UINT32_C(0x0040));
+	}
+	return (uint16_t) ((w + UINT32_C(0x7FFF) + ((w >> 16) & 1)) >> 16);
+}
+
+/*
+ * Convert a 32-bit floating-point number in IEEE single-precision format to a 16-bit floating-point number in
+ * bfloat16 format, in bit representation, rounding toward zero.
+ *
+ * The dropped half is simply discarded, except that NaN gets the quiet bit 0x0040 like in bf16_from_fp32_value: a NaN
+ * with a payload only in the low 16 bits would otherwise truncate to infinity.
+ *
+ * @note The implementation doesn't use any floating-point operations.
+ */
+static inline uint16_t bf16_trunc_from_fp32_value(float f) {
+	const uint32_t w = fp32_to_bits(f);
+	const uint32_t quiet = (w & UINT32_C(0x7FFFFFFF)) > UINT32_C(0x7F800000) ? UINT32_C(0x0040) : 0;
+	return (uint16_t) ((w >> 16) | quiet);
+}
+
+/*
+ * Convert a 16-bit floating-point number in bfloat16 format, in bit representation, to a 32-bit floating-point number in
+ * IEEE single-precision format, in bit representation.
+ *
+ * The conversion is exact, and signaling NaN stays signaling, like in fp16_ieee_to_fp32_bits.
+ */
+static inline uint32_t bf16_to_fp32_bits(uint16_t h) {
+	return (uint32_t) h << 16;
+}
+
+/*
+ * Convert a 16-bit floating-point number in bfloat16 format, in bit representation, to a 32-bit floating-point number in
+ * IEEE single-precision format.
+ */
+static inline float bf16_to_fp32_value(uint16_t h) {
+	return fp32_from_bits(bf16_to_fp32_bits(h));
+}
+
+/*
+ * Convert a 16-bit floating-point number in IEEE half-precision format to a 16-bit floating-point number in bfloat16
+ * format, both in bit representation.
+ *
+ * Every half-precision number (subnormals included) is a normal single-precision number, so going through
+ * fp16_ieee_to_fp32_bits is exact, and the only rounding is the one from 10 to 7 mantissa bits, to nearest even. NaN
+ * becomes a quiet NaN, like through fp16_ieee_to_fp32_value.
+ *
+ * @note The implementation doesn't use any floating-point operations.
+ */
+static inline uint16_t bf16_from_fp16_ieee_value(uint16_t h) {
+	return bf16_from_fp32_value(fp32_from_bits(fp16_ieee_to_fp32_bits(h)));
+}
+
+/*
+ * Convert a 16-bit floating-point number in bfloat16 format to a 16-bit floating-point number in IEEE half-precision
+ * format, both in bit representation.
+ *
+ * The result is the one of fp16_ieee_from_fp32_value on the (exact) single-precision value: rounded to nearest even,
+ * infinity above the half-precision range, the canonical NaN 0x7E00 with the input sign for NaN.
+ */
+static inline uint16_t fp16_ieee_from_bf16_value(uint16_t h) {
+	return fp16_ieee_from_fp32_value(bf16_to_fp32_value(h));
+}
+
 #endif /* FP16_FP16_H */
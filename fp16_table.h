@@ -0,0 +1,293 @@
+#pragma once
+#ifndef FP16_TABLE_H
+#define FP16_TABLE_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cstddef>
+	#include <cstdint>
+#else
+	#include <stddef.h>
+	#include <stdint.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+	#include <immintrin.h>
+	#define FP16_TABLE_X86 1
+#endif
+
+#include "fp16_study.h"
+
+/*
+ * Table based conversions between IEEE half precision and single precision.
+ *
+ * There are only 2**16 half-precision numbers, so the conversion can be a lookup instead of the shifts, clz and magic
+ * bias arithmetic of fp16_ieee_to_fp32_value. Two layouts:
+ *
+ * Full table, 65536 x 4 bytes = 256 KB. One load per conversion, but the table lives in L2 at best.
+ *
+ *   fp32 bits = fp16_full_table[h]
+ *
+ * Compact table, in the style of Jeroen van der Zijp, "Fast Half Float Conversions". The 6 high bits (sign + exponent)
+ * select an exponent word and an offset into a mantissa table, the 10 low bits select the mantissa word, and the two
+ * words are added:
+ *
+ *   fp32 bits = fp16_mantissa_table[fp16_offset_table[h >> 10] + (h & 0x3FF)] + fp16_exponent_table[h >> 10]
+ *
+ *   fp16_mantissa_table, 3072 entries:
+ *     [0, 1024)      subnormal mantissa m, normalized: (m * 2**(-24)) as fp32 bits, exponent included
+ *     [1024, 2048)   normal mantissa m: 0x38000000 + (m << 13), i.e. the fp32 mantissa plus an exponent bias of -15+127
+ *     [2048, 3072)   Inf/NaN mantissa m: m << 13, with the quiet bit set if m != 0
+ *   fp16_exponent_table, 64 entries: sign << 31 plus
+ *     exponent 0: 0 (the mantissa table entry already has the exponent), 1..30: e << 23, 31: 0x7F800000
+ *   fp16_offset_table, 64 entries: 0 for exponent 0, 1024 for exponent 1..30, 2048 for exponent 31
+ *
+ * Together that is 12.6 KB, which stays in L1.
+ *
+ * The third part of the mantissa table differs from the original paper: fp16_ieee_to_fp32_value turns signaling NaN into
+ * quiet NaN (through the multiplication by 2**(-112)), and the tables reproduce that bit for bit, so both layouts give
+ * exactly the result of fp16_ieee_to_fp32_value for every input.
+ *
+ * The tables are filled by fp16_table_init, which the functions below call on first use.
+ */
+static uint32_t fp16_full_table[65536];
+static uint32_t fp16_mantissa_table[3072];
+static uint32_t fp16_exponent_table[64];
+static uint16_t fp16_offset_table[64];
+static int fp16_table_ready;
+
+static inline void fp16_table_init(void) {
+	if (__atomic_load_n(&fp16_table_ready, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+
+	for (uint32_t h = 0; h < 65536; h++) {
+		fp16_full_table[h] = fp32_to_bits(fp16_ieee_to_fp32_value((uint16_t) h));
+	}
+
+	/* Subnormal: the value itself, normalizing it is exactly what fp16_ieee_to_fp32_value does */
+	for (uint32_t m = 0; m < 1024; m++) {
+		fp16_mantissa_table[m] = fp32_to_bits(fp16_ieee_to_fp32_value((uint16_t) m));
+		fp16_mantissa_table[1024 + m] = UINT32_C(0x38000000) + (m << 13);
+		fp16_mantissa_table[2048 + m] = (m << 13) | (m != 0 ? UINT32_C(0x00400000) : 0);
+	}
+	for (uint32_t i = 0; i < 64; i++) {
+		const uint32_t e = i & 31;
+		const uint32_t sign = (i >> 5) << 31;
+		fp16_exponent_table[i] = sign | (e == 0 ? 0 : e == 31 ? UINT32_C(0x7F800000) : e << 23);
+		fp16_offset_table[i] = (uint16_t) (e == 0 ? 0 : e == 31 ? 2048 : 1024);
+	}
+
+	__atomic_store_n(&fp16_table_ready, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Convert a 16-bit floating-point number in IEEE half-precision format, in bit representation, to
+ * a 32-bit floating-point number in IEEE single-precision format, with the full table.
+ *
+ * @note fp16_table_init must have been called.
+ */
+static inline float fp16_ieee_to_fp32_full_table(uint16_t h) {
+	return fp32_from_bits(fp16_full_table[h]);
+}
+
+/*
+ * Convert a 16-bit floating-point number in IEEE half-precision format, in bit representation, to
+ * a 32-bit floating-point number in IEEE single-precision format, with the compact tables.
+ *
+ * @note fp16_table_init must have been called.
+ */
+static inline float fp16_ieee_to_fp32_compact_table(uint16_t h) {
+	const uint32_t high = (uint32_t) h >> 10;
+	return fp32_from_bits(fp16_mantissa_table[fp16_offset_table[high] + (h & 0x3FF)] + fp16_exponent_table[high]);
+}
+
+#ifdef FP16_TABLE_X86
+/*
+ * AVX2 versions with vpgatherdd: one gather per 8 elements with the full table, two with the compact tables (the offset
+ * is computed with compares instead of a third gather).
+ */
+__attribute__((__target__("avx2")))
+static inline size_t fp16_ieee_to_fp32_full_table_avx2(const uint16_t* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256i h = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (src + i)));
+		_mm256_storeu_si256((__m256i*) (dst + i), _mm256_i32gather_epi32((const int*) fp16_full_table, h, 4));
+	}
+	return i;
+}
+
+__attribute__((__target__("avx2")))
+static inline size_t fp16_ieee_to_fp32_compact_table_avx2(const uint16_t* src, float* dst, size_t n) {
+	const __m256i exponent_mask = _mm256_set1_epi32(31);
+	const __m256i mantissa_mask = _mm256_set1_epi32(0x3FF);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256i h = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (src + i)));
+		const __m256i high = _mm256_srli_epi32(h, 10);
+		const __m256i e = _mm256_and_si256(high, exponent_mask);
+		/* offset = 1024 * (e != 0) + 1024 * (e == 31) */
+		const __m256i is_zero = _mm256_cmpeq_epi32(e, _mm256_setzero_si256());
+		const __m256i is_max = _mm256_cmpeq_epi32(e, exponent_mask);
+		const __m256i offset = _mm256_add_epi32(_mm256_andnot_si256(is_zero, _mm256_set1_epi32(1024)),
+			_mm256_and_si256(is_max, _mm256_set1_epi32(1024)));
+		const __m256i index = _mm256_add_epi32(offset, _mm256_and_si256(h, mantissa_mask));
+		const __m256i mantissa = _mm256_i32gather_epi32((const int*) fp16_mantissa_table, index, 4);
+		const __m256i exponent = _mm256_i32gather_epi32((const int*) fp16_exponent_table, high, 4);
+		_mm256_storeu_si256((__m256i*) (dst + i), _mm256_add_epi32(mantissa, exponent));
+	}
+	return i;
+}
+#endif
+
+/*
+ * Convert n 16-bit floating-point numbers in IEEE half-precision format, in bit representation, to
+ * 32-bit floating-point numbers in IEEE single-precision format, with the full table.
+ *
+ * @note The result is bit-identical to calling fp16_ieee_to_fp32_value on every element.
+ */
+static inline void fp16_ieee_to_fp32_full_table_array(const uint16_t* src, float* dst, size_t n) {
+	fp16_table_init();
+	for (size_t i = 0; i < n; i++) {
+		dst[i] = fp16_ieee_to_fp32_full_table(src[i]);
+	}
+}
+
+/*
+ * Convert n 16-bit floating-point numbers in IEEE half-precision format, in bit representation, to
+ * 32-bit floating-point numbers in IEEE single-precision format, with the compact tables.
+ *
+ * @note The result is bit-identical to calling fp16_ieee_to_fp32_value on every element.
+ */
+static inline void fp16_ieee_to_fp32_compact_table_array(const uint16_t* src, float* dst, size_t n) {
+	fp16_table_init();
+	for (size_t i = 0; i < n; i++) {
+		dst[i] = fp16_ieee_to_fp32_compact_table(src[i]);
+	}
+}
+
+/*
+ * Table based conversion from single precision to IEEE half precision, the encode counterpart of the tables above.
+ *
+ * The 9 high bits of the fp32 input (sign + exponent) select three table entries: a base, a shift and a rounding
+ * bias. The 23-bit mantissa, with the hidden bit always added, is rounded and shifted, and the base is added:
+ *
+ *   i = x >> 23
+ *   m = (x & 0x007FFFFF) | 0x00800000
+ *   h = fp16_base_table[i] + ((m + fp16_round_table[i] + ((m >> fp16_shift_table[i]) & 1)) >> fp16_shift_table[i])
+ *
+ * Rounding to nearest even is the trick of float_to_half_fast3_rtne, generalized to any shift: adding
+ * 2**(shift - 1) - 1 rounds up everything above the halfway point, and adding the lowest kept bit on top rounds up the
+ * halfway point itself only when the kept part is odd.
+ *
+ *   | fp32 exponent e | result                 | base                 | shift   |
+ *   |-----------------|------------------------|----------------------|---------|
+ *   | 0 .. 101        | zero                   | sign                 | 25      |
+ *   | 102 .. 112      | subnormal (or zero)    | sign                 | 126 - e |
+ *   | 113 .. 142      | normal                 | sign | (e - 113) << 10 | 13     |
+ *   | 143 .. 255      | Inf (NaN, see below)   | sign | 0x7C00        | 25      |
+ *
+ * For normal results the hidden bit lands on bit 10 and adds the missing 1 to the exponent, and a carry out of the
+ * rounding moves on into the exponent, up to Inf for e = 142. With a shift of 25 the rounded mantissa is always 0, which
+ * leaves the base. NaN is the only case the tables can not tell apart from Inf, so it gets the same quiet bit as in
+ * fp16_ieee_from_fp32_value. There are no floating-point operations, hence no subnormal intermediates.
+ */
+static uint16_t fp16_base_table[512];
+static uint8_t fp16_shift_table[512];
+static uint32_t fp16_round_table[512];
+/* base | shift << 16, for the gather of the AVX2 version */
+static uint32_t fp16_base_shift_table[512];
+static int fp16_encode_table_ready;
+
+static inline void fp16_encode_table_init(void) {
+	if (__atomic_load_n(&fp16_encode_table_ready, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < 512; i++) {
+		const uint32_t e = i & 0xFF;
+		const uint32_t sign = (i >> 8) << 15;
+		uint32_t base;
+		uint32_t shift;
+		if (e < 102) {
+			base = sign;
+			shift = 25;
+		} else if (e < 113) {
+			base = sign;
+			shift = 126 - e;
+		} else if (e < 143) {
+			base = sign | ((e - 113) << 10);
+			shift = 13;
+		} else {
+			base = sign | UINT32_C(0x7C00);
+			shift = 25;
+		}
+		fp16_base_table[i] = (uint16_t) base;
+		fp16_shift_table[i] = (uint8_t) shift;
+		fp16_round_table[i] = (UINT32_C(1) << (shift - 1)) - 1;
+		fp16_base_shift_table[i] = base | (shift << 16);
+	}
+
+	__atomic_store_n(&fp16_encode_table_ready, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Convert a 32-bit floating-point number in IEEE single-precision format to a 16-bit floating-point number in
+ * IEEE half-precision format, in bit representation, with the base/shift/rounding tables.
+ *
+ * @note fp16_encode_table_init must have been called.
+ * @note The result is bit-identical to fp16_ieee_from_fp32_value.
+ */
+static inline uint16_t fp16_ieee_from_fp32_table(float f) {
+	const uint32_t x = fp32_to_bits(f);
+	const uint32_t i = x >> 23;
+	const uint32_t m = (x & UINT32_C(0x007FFFFF)) | UINT32_C(0x00800000);
+	const uint32_t shift = fp16_shift_table[i];
+	const uint32_t h = fp16_base_table[i] + ((m + fp16_round_table[i] + ((m >> shift) & 1)) >> shift);
+	const uint32_t nan = (x & UINT32_C(0x7FFFFFFF)) > UINT32_C(0x7F800000) ? UINT32_C(0x0200) : 0;
+	return (uint16_t) (h | nan);
+}
+
+#ifdef FP16_TABLE_X86
+__attribute__((__target__("avx2")))
+static inline size_t fp16_ieee_from_fp32_table_avx2(const float* src, uint16_t* dst, size_t n) {
+	const __m256i mantissa_mask = _mm256_set1_epi32(0x007FFFFF);
+	const __m256i hidden_bit = _mm256_set1_epi32(0x00800000);
+	const __m256i low16 = _mm256_set1_epi32(0xFFFF);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i inf_bits = _mm256_set1_epi32(0x7F800000);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256i x = _mm256_loadu_si256((const __m256i*) (src + i));
+		const __m256i base_shift = _mm256_i32gather_epi32((const int*) fp16_base_shift_table, _mm256_srli_epi32(x, 23), 4);
+		const __m256i base = _mm256_and_si256(base_shift, low16);
+		const __m256i shift = _mm256_srli_epi32(base_shift, 16);
+		const __m256i m = _mm256_or_si256(_mm256_and_si256(x, mantissa_mask), hidden_bit);
+		const __m256i round = _mm256_sub_epi32(_mm256_sllv_epi32(one, _mm256_sub_epi32(shift, one)), one);
+		const __m256i odd = _mm256_and_si256(_mm256_srlv_epi32(m, shift), one);
+		const __m256i h = _mm256_add_epi32(base,
+			_mm256_srlv_epi32(_mm256_add_epi32(_mm256_add_epi32(m, round), odd), shift));
+		const __m256i nonsign = _mm256_and_si256(x, _mm256_set1_epi32(0x7FFFFFFF));
+		const __m256i nan = _mm256_and_si256(_mm256_cmpgt_epi32(nonsign, inf_bits), _mm256_set1_epi32(0x0200));
+		const __m256i result = _mm256_or_si256(h, nan);
+		/* The results are below 0x10000, so the unsigned saturating pack keeps them, in the order of the 128-bit lanes */
+		const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(result, result), 0x08);
+		_mm_storeu_si128((__m128i*) (dst + i), _mm256_castsi256_si128(packed));
+	}
+	return i;
+}
+#endif
+
+/*
+ * Convert n 32-bit floating-point numbers in IEEE single-precision format to 16-bit floating-point numbers in
+ * IEEE half-precision format, in bit representation, with the base/shift/rounding tables.
+ *
+ * @note The result is bit-identical to calling fp16_ieee_from_fp32_value on every element.
+ */
+static inline void fp16_ieee_from_fp32_table_array(const float* src, uint16_t* dst, size_t n) {
+	fp16_encode_table_init();
+	for (size_t i = 0; i < n; i++) {
+		dst[i] = fp16_ieee_from_fp32_table(src[i]);
+	}
+}
+
+#endif /* FP16_TABLE_H */
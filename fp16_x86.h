@@ -0,0 +1,768 @@
+#pragma once
+#ifndef FP16_X86_H
+#define FP16_X86_H
+
+#if defined(__cplusplus) && (__cplusplus >= 201103L)
+	#include <cstddef>
+	#include <cstdint>
+#else
+	#include <stddef.h>
+	#include <stdint.h>
+#endif
+
+#include <immintrin.h>
+
+#include "fp16_study.h"
+
+/*
+ * x86 SIMD kernels for the bulk conversions in fp16_array.h.
+ *
+ * Every kernel converts the largest multiple of its vector width that fits in n and returns the number of elements it
+ * converted. The caller converts the rest with the scalar functions.
+ *
+ * | kernel     | ISA             | fp32 -> fp16                          | fp16 -> fp32                         |
+ * |------------|-----------------|---------------------------------------|--------------------------------------|
+ * | sse2       | SSE2            | fp16_ieee_from_fp32_value, 8 lanes    | fp16_ieee_to_fp32_value, 8 lanes     |
+ * | sse2int    | SSE2            | fp16_ieee_from_fp32_bits, 8 lanes     | fp16_ieee_to_fp32_value, 8 lanes     |
+ * | f16c       | AVX + F16C      | vcvtps2ph ymm + NaN fix-up            | vcvtph2ps ymm                        |
+ * | avx512f    | AVX-512F        | vcvtps2ph zmm + NaN fix-up            | vcvtph2ps zmm                        |
+ * | avx512fp16 | AVX-512FP16     | vcvtps2phx zmm + NaN fix-up           | vcvtph2psx zmm                       |
+ *
+ * The sse2 kernels are a lane by lane port of the scalar functions: the same scaling by 2**112 and 2**(-110), the same
+ * magic bias addition, the same masks. They only need the baseline ISA of x86-64.
+ *
+ * The hardware conversions round to nearest even like the scalar code, but they keep the NaN payload, while
+ * fp16_ieee_from_fp32_value turns every NaN into the canonical 0x7E00 (with the input sign). The fp32 -> fp16 hardware
+ * kernels therefore blend the canonical NaN back in. In the fp16 -> fp32 direction the hardware sets the quiet bit of
+ * signaling NaN, which is what the multiplication by 2**(-112) does in fp16_ieee_to_fp32_value, so no fix-up is needed.
+ *
+ * MXCSR: FTZ and DAZ do not change any result. No kernel produces a subnormal intermediate, and single-precision
+ * subnormal inputs round to zero anyway. The rounding control does: the magic bias addition of the sse2 kernel and
+ * vcvtps2phx round according to it, while vcvtps2ph takes the rounding mode from its immediate. The sse2int kernel
+ * does the rounding on the bits, and fp16_ieee_from_fp32_array switches to fp16_x86_rounding_kernels when MXCSR does
+ * not round to nearest (see fp16_x86_rounds_to_nearest).
+ *
+ * The kernels are compiled with function-level target attributes, so the file can be built without -mavx2 etc., and
+ * fp16_x86_kernels is filled once at startup with the best kernels the CPU supports.
+ */
+#if defined(__GNUC__)
+	#define FP16_X86_TARGET(isa) __attribute__((__target__(isa)))
+#else
+	#define FP16_X86_TARGET(isa)
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 12) || defined(__clang__) && (__clang_major__ >= 14)
+	#define FP16_X86_HAVE_AVX512FP16 1
+#else
+	#define FP16_X86_HAVE_AVX512FP16 0
+#endif
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 10) || defined(__clang__) && (__clang_major__ >= 11)
+	#define FP16_X86_HAVE_AVX512BF16 1
+#else
+	#define FP16_X86_HAVE_AVX512BF16 0
+#endif
+
+/*
+ * fp16_ieee_from_fp32_value, 4 lanes.
+ */
+FP16_X86_TARGET("sse2")
+static inline __m128i fp16_ieee_from_fp32_sse2_x4(__m128 f) {
+	const __m128 scale_to_inf = _mm_set1_ps(fp32_from_bits(UINT32_C(0x77800000)));
+	const __m128 scale_to_zero = _mm_set1_ps(fp32_from_bits(UINT32_C(0x08800000)));
+	const __m128i w = _mm_castps_si128(f);
+	const __m128i nonsign_w = _mm_and_si128(w, _mm_set1_epi32(0x7FFFFFFF));
+	const __m128i sign = _mm_and_si128(w, _mm_set1_epi32((int) 0x80000000u));
+
+	// Single-precision subnormals round to zero anyway. Zeroing them before the multiplication keeps them away from the
+	// multiplier, which would take a microcode assist for every one of them unless DAZ is set.
+	const __m128i is_normal = _mm_cmpgt_epi32(nonsign_w, _mm_set1_epi32(0x007FFFFF));
+	const __m128 abs_f = _mm_castsi128_ps(_mm_and_si128(nonsign_w, is_normal));
+
+	// If 15 < e then inf, otherwise e += 2
+	__m128 base = _mm_mul_ps(_mm_mul_ps(abs_f, scale_to_inf), scale_to_zero);
+
+	// Scalar code: bias = max(shl1_w & 0xFF000000, 0x71000000), then (bias >> 1) + 0x07800000.
+	// Working on the unshifted word keeps everything positive, so the signed compare of SSE2 can be used.
+	__m128i bias = _mm_and_si128(w, _mm_set1_epi32(0x7F800000));
+	const __m128i bias_min = _mm_set1_epi32(0x38800000);
+	const __m128i below_min = _mm_cmplt_epi32(bias, bias_min);
+	bias = _mm_or_si128(_mm_and_si128(below_min, bias_min), _mm_andnot_si128(below_min, bias));
+	bias = _mm_add_epi32(bias, _mm_set1_epi32(0x07800000));
+
+	base = _mm_add_ps(_mm_castsi128_ps(bias), base);
+	const __m128i bits = _mm_castps_si128(base);
+	const __m128i exp_bits = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(0x00007C00));
+	const __m128i mantissa_bits = _mm_and_si128(bits, _mm_set1_epi32(0x00000FFF));
+	const __m128i nonsign = _mm_add_epi32(exp_bits, mantissa_bits);
+
+	// shl1_w > 0xFF000000 is the same as nonsign_w > 0x7F800000, which is a signed compare of positive numbers
+	const __m128i is_nan = _mm_cmpgt_epi32(nonsign_w, _mm_set1_epi32(0x7F800000));
+	const __m128i result = _mm_or_si128(_mm_srli_epi32(sign, 16),
+		_mm_or_si128(_mm_and_si128(is_nan, _mm_set1_epi32(0x7E00)), _mm_andnot_si128(is_nan, nonsign)));
+	// Sign-extend from 16 bits so that the saturating signed pack keeps the low 16 bits unchanged
+	return _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+}
+
+/*
+ * fp16_ieee_to_fp32_value, 4 lanes. h holds the half-precision number in the high 16 bits of each 32-bit lane,
+ * i.e. it is already the w of the scalar code.
+ */
+FP16_X86_TARGET("sse2")
+static inline __m128 fp16_ieee_to_fp32_sse2_x4(__m128i w) {
+	const __m128i sign = _mm_and_si128(w, _mm_set1_epi32((int) 0x80000000u));
+	const __m128i two_w = _mm_add_epi32(w, w);
+
+	const __m128i exp_offset = _mm_set1_epi32(0xE0 << 23);
+	const __m128 exp_scale = _mm_set1_ps(fp32_from_bits(UINT32_C(0x07800000)));
+	const __m128 normalized_value =
+		_mm_mul_ps(_mm_castsi128_ps(_mm_add_epi32(_mm_srli_epi32(two_w, 4), exp_offset)), exp_scale);
+
+	const __m128i magic_mask = _mm_set1_epi32(126 << 23);
+	const __m128 magic_bias = _mm_set1_ps(0.5f);
+	const __m128 denormalized_value =
+		_mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_srli_epi32(two_w, 17), magic_mask)), magic_bias);
+
+	// two_w < 2**27 as unsigned is the same as (two_w >> 1) < 2**26 as signed
+	const __m128i denormalized_cutoff = _mm_set1_epi32(1 << 26);
+	const __m128i is_denormalized = _mm_cmplt_epi32(_mm_srli_epi32(two_w, 1), denormalized_cutoff);
+	const __m128i result = _mm_or_si128(sign,
+		_mm_or_si128(_mm_and_si128(is_denormalized, _mm_castps_si128(denormalized_value)),
+			_mm_andnot_si128(is_denormalized, _mm_castps_si128(normalized_value))));
+	return _mm_castsi128_ps(result);
+}
+
+FP16_X86_TARGET("sse2")
+static inline size_t fp16_ieee_from_fp32_sse2(const float* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m128i lo = fp16_ieee_from_fp32_sse2_x4(_mm_loadu_ps(src + i));
+		const __m128i hi = fp16_ieee_from_fp32_sse2_x4(_mm_loadu_ps(src + i + 4));
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_packs_epi32(lo, hi));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("sse2")
+static inline size_t fp16_ieee_to_fp32_sse2(const uint16_t* src, float* dst, size_t n) {
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m128i h = _mm_loadu_si128((const __m128i*) (src + i));
+		_mm_storeu_ps(dst + i, fp16_ieee_to_fp32_sse2_x4(_mm_unpacklo_epi16(zero, h)));
+		_mm_storeu_ps(dst + i + 4, fp16_ieee_to_fp32_sse2_x4(_mm_unpackhi_epi16(zero, h)));
+	}
+	return i;
+}
+
+/*
+ * fp16_ieee_from_fp32_bits, 4 lanes: the rounding is integer work, so the result does not depend on MXCSR.
+ *
+ * SSE2 has no per-lane shift for the subnormal results, so the mantissa (shifted up by 8) is multiplied by 2**(e - 102)
+ * with pmuludq instead: the high half of the 64-bit product is the mantissa shifted right by 126 - e, and the low half
+ * holds the dropped bits, bit 31 being the round bit. The power of two comes from cvttps2dq of a float built from e;
+ * it is between 1 and 1024, so the conversion is exact and never sees a subnormal, and it truncates whatever the
+ * rounding mode is. Lanes with e < 102 are zeroed.
+ */
+FP16_X86_TARGET("sse2")
+static inline __m128i fp16_ieee_from_fp32_sse2int_x4(__m128i w) {
+	const __m128i nonsign = _mm_and_si128(w, _mm_set1_epi32(0x7FFFFFFF));
+	const __m128i sign = _mm_srli_epi32(_mm_and_si128(w, _mm_set1_epi32((int) 0x80000000u)), 16);
+
+	// Normal results: rebias the exponent, round the 13 dropped bits to nearest even
+	const __m128i odd = _mm_and_si128(_mm_srli_epi32(nonsign, 13), _mm_set1_epi32(1));
+	const __m128i rebiased = _mm_add_epi32(nonsign, _mm_set1_epi32(0xFFF - 0x38000000));
+	const __m128i normal = _mm_srli_epi32(_mm_add_epi32(rebiased, odd), 13);
+
+	// Subnormal results: (mantissa << 8) * 2**(e - 102), even and odd lanes separately
+	const __m128i power = _mm_slli_epi32(_mm_add_epi32(_mm_srli_epi32(nonsign, 23), _mm_set1_epi32(127 - 102)), 23);
+	const __m128i multiplier = _mm_cvttps_epi32(_mm_castsi128_ps(power));
+	const __m128i mantissa = _mm_slli_epi32(
+		_mm_or_si128(_mm_and_si128(nonsign, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x00800000)), 8);
+	const __m128i product02 = _mm_mul_epu32(mantissa, multiplier);
+	const __m128i product13 = _mm_mul_epu32(_mm_srli_epi64(mantissa, 32), _mm_srli_epi64(multiplier, 32));
+	const __m128i low = _mm_unpacklo_epi32(
+		_mm_shuffle_epi32(product02, _MM_SHUFFLE(3, 1, 2, 0)), _mm_shuffle_epi32(product13, _MM_SHUFFLE(3, 1, 2, 0)));
+	const __m128i high = _mm_unpacklo_epi32(
+		_mm_shuffle_epi32(product02, _MM_SHUFFLE(2, 0, 3, 1)), _mm_shuffle_epi32(product13, _MM_SHUFFLE(2, 0, 3, 1)));
+	// Round up if low > 0x80000000, or low == 0x80000000 and high is odd: a signed compare of low - 2**31 with -lsb
+	const __m128i lsb = _mm_and_si128(high, _mm_set1_epi32(1));
+	const __m128i round_up = _mm_cmpgt_epi32(
+		_mm_xor_si128(low, _mm_set1_epi32((int) 0x80000000u)), _mm_sub_epi32(_mm_setzero_si128(), lsb));
+	const __m128i not_zero = _mm_cmpgt_epi32(nonsign, _mm_set1_epi32(0x32FFFFFF));
+	const __m128i subnormal = _mm_and_si128(_mm_sub_epi32(high, round_up), not_zero);
+
+	const __m128i is_normal = _mm_cmpgt_epi32(nonsign, _mm_set1_epi32(0x387FFFFF));
+	const __m128i finite = _mm_or_si128(_mm_and_si128(is_normal, normal), _mm_andnot_si128(is_normal, subnormal));
+	// 65520 and up is infinity, NaN is the canonical 0x7E00
+	const __m128i is_large = _mm_cmpgt_epi32(nonsign, _mm_set1_epi32(0x477FEFFF));
+	const __m128i is_nan = _mm_cmpgt_epi32(nonsign, _mm_set1_epi32(0x7F800000));
+	const __m128i special = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(is_nan, _mm_set1_epi32(0x0200)));
+	const __m128i result = _mm_or_si128(sign,
+		_mm_or_si128(_mm_and_si128(is_large, special), _mm_andnot_si128(is_large, finite)));
+	// Sign-extend from 16 bits so that the saturating signed pack keeps the low 16 bits unchanged
+	return _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+}
+
+FP16_X86_TARGET("sse2")
+static inline size_t fp16_ieee_from_fp32_sse2int(const float* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m128i lo = fp16_ieee_from_fp32_sse2int_x4(_mm_loadu_si128((const __m128i*) (src + i)));
+		const __m128i hi = fp16_ieee_from_fp32_sse2int_x4(_mm_loadu_si128((const __m128i*) (src + i + 4)));
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_packs_epi32(lo, hi));
+	}
+	return i;
+}
+
+/*
+ * fp16_ieee_from_fp32_value, 8 lanes, with vcvtps2ph.
+ */
+FP16_X86_TARGET("avx2,f16c")
+static inline __m128i fp16_ieee_from_fp32_f16c_x8(__m256 f) {
+	const __m128i h = _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	// Canonical NaN: keep the sign bit of the hardware result, replace exponent and mantissa with 0x7E00
+	const __m256i is_nan32 = _mm256_castps_si256(_mm256_cmp_ps(f, f, _CMP_UNORD_Q));
+	const __m128i is_nan = _mm_packs_epi32(_mm256_castsi256_si128(is_nan32), _mm256_extracti128_si256(is_nan32, 1));
+	const __m128i canonical = _mm_or_si128(_mm_and_si128(h, _mm_set1_epi16((short) 0x8000)), _mm_set1_epi16(0x7E00));
+	return _mm_blendv_epi8(h, canonical, is_nan);
+}
+
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t fp16_ieee_from_fp32_f16c(const float* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		_mm_storeu_si128((__m128i*) (dst + i), fp16_ieee_from_fp32_f16c_x8(_mm256_loadu_ps(src + i)));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t fp16_ieee_to_fp32_f16c(const uint16_t* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (src + i))));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl")
+static inline size_t fp16_ieee_from_fp32_avx512f(const float* src, uint16_t* dst, size_t n) {
+	const __m256i sign_mask = _mm256_set1_epi16((short) 0x8000);
+	const __m256i nan_bits = _mm256_set1_epi16(0x7E00);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m512 f = _mm512_loadu_ps(src + i);
+		const __m256i h = _mm512_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		const __mmask16 is_nan = _mm512_cmp_ps_mask(f, f, _CMP_UNORD_Q);
+		const __m256i canonical = _mm256_or_si256(_mm256_and_si256(h, sign_mask), nan_bits);
+		_mm256_storeu_si256((__m256i*) (dst + i), _mm256_mask_blend_epi16(is_nan, h, canonical));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx512f")
+static inline size_t fp16_ieee_to_fp32_avx512f(const uint16_t* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		_mm512_storeu_ps(dst + i, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*) (src + i))));
+	}
+	return i;
+}
+
+#if FP16_X86_HAVE_AVX512FP16
+/*
+ * vcvtps2phx / vcvtph2psx round according to MXCSR instead of an immediate, and are the forms the AVX-512FP16
+ * arithmetic expects, so they are preferred on CPUs that have them.
+ */
+FP16_X86_TARGET("avx512fp16,avx512bw,avx512vl")
+static inline size_t fp16_ieee_from_fp32_avx512fp16(const float* src, uint16_t* dst, size_t n) {
+	const __m256i sign_mask = _mm256_set1_epi16((short) 0x8000);
+	const __m256i nan_bits = _mm256_set1_epi16(0x7E00);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m512 f = _mm512_loadu_ps(src + i);
+		const __m256i h = _mm256_castph_si256(_mm512_cvtxps_ph(f));
+		const __mmask16 is_nan = _mm512_cmp_ps_mask(f, f, _CMP_UNORD_Q);
+		const __m256i canonical = _mm256_or_si256(_mm256_and_si256(h, sign_mask), nan_bits);
+		_mm256_storeu_si256((__m256i*) (dst + i), _mm256_mask_blend_epi16(is_nan, h, canonical));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx512fp16,avx512vl")
+static inline size_t fp16_ieee_to_fp32_avx512fp16(const uint16_t* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		_mm512_storeu_ps(dst + i, _mm512_cvtxph_ps(_mm256_castsi256_ph(_mm256_loadu_si256((const __m256i*) (src + i)))));
+	}
+	return i;
+}
+#endif
+
+/*
+ * bfloat16 kernels, for bf16_from_fp32_value, bf16_to_fp32_value and the two transcodings between IEEE half precision
+ * and bfloat16 of fp16_study.h. The fp32 -> bf16 rounding is integer work (add the rounding bias, shift, patch NaN), so
+ * SSE2 and AVX2 do it lane by lane. The transcodings never go through memory in fp32: the fp16 side is widened in
+ * registers (with the kernels above, or with vcvtph2ps) and narrowed to the other format right away.
+ *
+ * AVX-512 BF16 has vcvtne2ps2bf16, which rounds 32 numbers in one instruction and quiets NaN exactly like
+ * bf16_from_fp32_value, but it always treats fp32 subnormal inputs as zero. Blocks with a subnormal input are rare, and
+ * get the integer rounding for those lanes.
+ */
+
+/*
+ * bf16_from_fp32_value, 4 lanes.
+ */
+FP16_X86_TARGET("sse2")
+static inline __m128i bf16_from_fp32_sse2_x4(__m128 f) {
+	const __m128i w = _mm_castps_si128(f);
+	const __m128i lsb = _mm_and_si128(_mm_srli_epi32(w, 16), _mm_set1_epi32(1));
+	const __m128i rounded = _mm_srli_epi32(_mm_add_epi32(w, _mm_add_epi32(lsb, _mm_set1_epi32(0x7FFF))), 16);
+	const __m128i quiet = _mm_or_si128(_mm_srli_epi32(w, 16), _mm_set1_epi32(0x0040));
+	// nonsign > 0x7F800000 is a signed compare of positive numbers
+	const __m128i is_nan = _mm_cmpgt_epi32(_mm_and_si128(w, _mm_set1_epi32(0x7FFFFFFF)), _mm_set1_epi32(0x7F800000));
+	const __m128i result = _mm_or_si128(_mm_and_si128(is_nan, quiet), _mm_andnot_si128(is_nan, rounded));
+	// Sign-extend from 16 bits so that the saturating signed pack keeps the low 16 bits unchanged
+	return _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+}
+
+FP16_X86_TARGET("sse2")
+static inline size_t bf16_from_fp32_sse2(const float* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m128i lo = bf16_from_fp32_sse2_x4(_mm_loadu_ps(src + i));
+		const __m128i hi = bf16_from_fp32_sse2_x4(_mm_loadu_ps(src + i + 4));
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_packs_epi32(lo, hi));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("sse2")
+static inline size_t bf16_to_fp32_sse2(const uint16_t* src, float* dst, size_t n) {
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m128i h = _mm_loadu_si128((const __m128i*) (src + i));
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_unpacklo_epi16(zero, h));
+		_mm_storeu_si128((__m128i*) (dst + i + 4), _mm_unpackhi_epi16(zero, h));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("sse2")
+static inline size_t bf16_from_fp16_ieee_sse2(const uint16_t* src, uint16_t* dst, size_t n) {
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m128i h = _mm_loadu_si128((const __m128i*) (src + i));
+		const __m128i lo = bf16_from_fp32_sse2_x4(fp16_ieee_to_fp32_sse2_x4(_mm_unpacklo_epi16(zero, h)));
+		const __m128i hi = bf16_from_fp32_sse2_x4(fp16_ieee_to_fp32_sse2_x4(_mm_unpackhi_epi16(zero, h)));
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_packs_epi32(lo, hi));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("sse2")
+static inline size_t fp16_ieee_from_bf16_sse2(const uint16_t* src, uint16_t* dst, size_t n) {
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m128i h = _mm_loadu_si128((const __m128i*) (src + i));
+		const __m128i lo = fp16_ieee_from_fp32_sse2_x4(_mm_castsi128_ps(_mm_unpacklo_epi16(zero, h)));
+		const __m128i hi = fp16_ieee_from_fp32_sse2_x4(_mm_castsi128_ps(_mm_unpackhi_epi16(zero, h)));
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_packs_epi32(lo, hi));
+	}
+	return i;
+}
+
+/*
+ * bf16_from_fp32_value, 8 lanes.
+ */
+FP16_X86_TARGET("avx2")
+static inline __m128i bf16_from_fp32_avx2_x8(__m256 f) {
+	const __m256i w = _mm256_castps_si256(f);
+	const __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(w, 16), _mm256_set1_epi32(1));
+	const __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(w, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7FFF))), 16);
+	const __m256i quiet = _mm256_or_si256(_mm256_srli_epi32(w, 16), _mm256_set1_epi32(0x0040));
+	const __m256i is_nan =
+		_mm256_cmpgt_epi32(_mm256_and_si256(w, _mm256_set1_epi32(0x7FFFFFFF)), _mm256_set1_epi32(0x7F800000));
+	const __m256i result = _mm256_blendv_epi8(rounded, quiet, is_nan);
+	return _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+}
+
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t bf16_from_fp32_f16c(const float* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		_mm_storeu_si128((__m128i*) (dst + i), bf16_from_fp32_avx2_x8(_mm256_loadu_ps(src + i)));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t bf16_to_fp32_f16c(const uint16_t* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256i w = _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (src + i))), 16);
+		_mm256_storeu_si256((__m256i*) (dst + i), w);
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t bf16_from_fp16_ieee_f16c(const uint16_t* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256 f = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (src + i)));
+		_mm_storeu_si128((__m128i*) (dst + i), bf16_from_fp32_avx2_x8(f));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx2,f16c")
+static inline size_t fp16_ieee_from_bf16_f16c(const uint16_t* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256i w = _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (src + i))), 16);
+		_mm_storeu_si128((__m128i*) (dst + i), fp16_ieee_from_fp32_f16c_x8(_mm256_castsi256_ps(w)));
+	}
+	return i;
+}
+
+#if FP16_X86_HAVE_AVX512BF16
+/*
+ * bf16_from_fp32_value, 16 lanes, as 32-bit lanes.
+ */
+FP16_X86_TARGET("avx512f")
+static inline __m512i bf16_from_fp32_avx512f_x16(__m512i w) {
+	const __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(w, 16), _mm512_set1_epi32(1));
+	const __m512i rounded = _mm512_srli_epi32(_mm512_add_epi32(w, _mm512_add_epi32(lsb, _mm512_set1_epi32(0x7FFF))), 16);
+	const __m512i quiet = _mm512_or_si512(_mm512_srli_epi32(w, 16), _mm512_set1_epi32(0x0040));
+	const __mmask16 is_nan =
+		_mm512_cmpgt_epu32_mask(_mm512_and_si512(w, _mm512_set1_epi32(0x7FFFFFFF)), _mm512_set1_epi32(0x7F800000));
+	return _mm512_mask_blend_epi32(is_nan, rounded, quiet);
+}
+
+/* Lanes holding a fp32 subnormal (exponent 0, mantissa not 0), which vcvtne2ps2bf16 flushes to zero */
+FP16_X86_TARGET("avx512f")
+static inline __mmask16 bf16_fp32_subnormal_avx512f(__m512i w) {
+	const __m512i nonsign = _mm512_and_si512(w, _mm512_set1_epi32(0x7FFFFFFF));
+	return _mm512_cmplt_epu32_mask(_mm512_sub_epi32(nonsign, _mm512_set1_epi32(1)), _mm512_set1_epi32(0x007FFFFF));
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,avx512bf16")
+static inline size_t bf16_from_fp32_avx512bf16(const float* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		const __m512 lo = _mm512_loadu_ps(src + i);
+		const __m512 hi = _mm512_loadu_ps(src + i + 16);
+		__m512i h = (__m512i) _mm512_cvtne2ps_pbh(hi, lo);
+		const __mmask16 subnormal_lo = bf16_fp32_subnormal_avx512f(_mm512_castps_si512(lo));
+		const __mmask16 subnormal_hi = bf16_fp32_subnormal_avx512f(_mm512_castps_si512(hi));
+		if ((subnormal_lo | subnormal_hi) != 0) {
+			const __m512i exact = _mm512_inserti64x4(
+				_mm512_castsi256_si512(_mm512_cvtepi32_epi16(bf16_from_fp32_avx512f_x16(_mm512_castps_si512(lo)))),
+				_mm512_cvtepi32_epi16(bf16_from_fp32_avx512f_x16(_mm512_castps_si512(hi))), 1);
+			h = _mm512_mask_blend_epi16(((__mmask32) subnormal_hi << 16) | subnormal_lo, h, exact);
+		}
+		_mm512_storeu_si512((void*) (dst + i), h);
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,avx512bf16")
+static inline size_t bf16_to_fp32_avx512bf16(const uint16_t* src, float* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m512i w = _mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*) (src + i))), 16);
+		_mm512_storeu_si512((void*) (dst + i), w);
+	}
+	return i;
+}
+
+/* Half-precision numbers are never fp32 subnormals, so vcvtne2ps2bf16 needs no patching here */
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,avx512bf16")
+static inline size_t bf16_from_fp16_ieee_avx512bf16(const uint16_t* src, uint16_t* dst, size_t n) {
+	size_t i = 0;
+	for (; n - i >= 32; i += 32) {
+		const __m512 lo = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*) (src + i)));
+		const __m512 hi = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*) (src + i + 16)));
+		_mm512_storeu_si512((void*) (dst + i), (__m512i) _mm512_cvtne2ps_pbh(hi, lo));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl,avx512bf16")
+static inline size_t fp16_ieee_from_bf16_avx512bf16(const uint16_t* src, uint16_t* dst, size_t n) {
+	const __m256i sign_mask = _mm256_set1_epi16((short) 0x8000);
+	const __m256i nan_bits = _mm256_set1_epi16(0x7E00);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m512 f = _mm512_castsi512_ps(
+			_mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*) (src + i))), 16));
+		const __m256i h = _mm512_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		const __mmask16 is_nan = _mm512_cmp_ps_mask(f, f, _CMP_UNORD_Q);
+		const __m256i canonical = _mm256_or_si256(_mm256_and_si256(h, sign_mask), nan_bits);
+		_mm256_storeu_si256((__m256i*) (dst + i), _mm256_mask_blend_epi16(is_nan, h, canonical));
+	}
+	return i;
+}
+#endif
+
+/*
+ * Fused scale kernels, for fp16_ieee_from_fp32_scaled_value of fp16_array.h: y = x * scale + bias with one rounding
+ * (FMA), clamped to +-65504, then narrowed like fp16_ieee_from_fp32_value. The scale and bias are either the same for
+ * every element (scaled) or given per element (scaled_channels, bias may be NULL). vminps / vmaxps return the second
+ * operand when one of them is NaN, so the clamp is written with the value second and NaN reaches the NaN fix-up.
+ */
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline __m128i fp16_ieee_from_fp32_scaled_f16c_x8(__m256 f, __m256 scale, __m256 bias) {
+	const __m256 max = _mm256_set1_ps(65504.0f);
+	__m256 y = _mm256_fmadd_ps(f, scale, bias);
+	y = _mm256_max_ps(_mm256_set1_ps(-65504.0f), _mm256_min_ps(max, y));
+	return fp16_ieee_from_fp32_f16c_x8(y);
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline size_t fp16_ieee_from_fp32_scaled_f16c(const float* src, uint16_t* dst, size_t n, float scale, float bias) {
+	const __m256 scale_v = _mm256_set1_ps(scale);
+	const __m256 bias_v = _mm256_set1_ps(bias);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m128i lo = fp16_ieee_from_fp32_scaled_f16c_x8(_mm256_loadu_ps(src + i), scale_v, bias_v);
+		const __m128i hi = fp16_ieee_from_fp32_scaled_f16c_x8(_mm256_loadu_ps(src + i + 8), scale_v, bias_v);
+		_mm_storeu_si128((__m128i*) (dst + i), lo);
+		_mm_storeu_si128((__m128i*) (dst + i + 8), hi);
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx2,f16c,fma")
+static inline size_t fp16_ieee_from_fp32_scaled_channels_f16c(const float* src, uint16_t* dst, size_t n,
+	const float* scale, const float* bias)
+{
+	const __m256 no_bias = _mm256_set1_ps(-0.0f);
+	size_t i = 0;
+	for (; n - i >= 8; i += 8) {
+		const __m256 bias_v = bias != NULL ? _mm256_loadu_ps(bias + i) : no_bias;
+		_mm_storeu_si128((__m128i*) (dst + i),
+			fp16_ieee_from_fp32_scaled_f16c_x8(_mm256_loadu_ps(src + i), _mm256_loadu_ps(scale + i), bias_v));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl")
+static inline __m256i fp16_ieee_from_fp32_scaled_avx512f_x16(__m512 f, __m512 scale, __m512 bias) {
+	__m512 y = _mm512_fmadd_ps(f, scale, bias);
+	y = _mm512_max_ps(_mm512_set1_ps(-65504.0f), _mm512_min_ps(_mm512_set1_ps(65504.0f), y));
+	const __m256i h = _mm512_cvtps_ph(y, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	const __mmask16 is_nan = _mm512_cmp_ps_mask(y, y, _CMP_UNORD_Q);
+	const __m256i canonical = _mm256_or_si256(_mm256_and_si256(h, _mm256_set1_epi16((short) 0x8000)),
+		_mm256_set1_epi16(0x7E00));
+	return _mm256_mask_blend_epi16(is_nan, h, canonical);
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl")
+static inline size_t fp16_ieee_from_fp32_scaled_avx512f(const float* src, uint16_t* dst, size_t n, float scale, float bias) {
+	const __m512 scale_v = _mm512_set1_ps(scale);
+	const __m512 bias_v = _mm512_set1_ps(bias);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		_mm256_storeu_si256((__m256i*) (dst + i),
+			fp16_ieee_from_fp32_scaled_avx512f_x16(_mm512_loadu_ps(src + i), scale_v, bias_v));
+	}
+	return i;
+}
+
+FP16_X86_TARGET("avx512f,avx512bw,avx512vl")
+static inline size_t fp16_ieee_from_fp32_scaled_channels_avx512f(const float* src, uint16_t* dst, size_t n,
+	const float* scale, const float* bias)
+{
+	const __m512 no_bias = _mm512_set1_ps(-0.0f);
+	size_t i = 0;
+	for (; n - i >= 16; i += 16) {
+		const __m512 bias_v = bias != NULL ? _mm512_loadu_ps(bias + i) : no_bias;
+		_mm256_storeu_si256((__m256i*) (dst + i),
+			fp16_ieee_from_fp32_scaled_avx512f_x16(_mm512_loadu_ps(src + i), _mm512_loadu_ps(scale + i), bias_v));
+	}
+	return i;
+}
+
+/*
+ * Runtime dispatch.
+ *
+ * fp16_x86_kernel_table lists every kernel together with the CPU feature check, from the slowest to the fastest.
+ * fp16_x86_kernels is the best supported entry, picked once at startup by fp16_x86_init, and so are
+ * fp16_x86_bf16_kernels from fp16_x86_bf16_kernel_table and fp16_x86_scaled_kernels from
+ * fp16_x86_scaled_kernel_table. Their kernel pointers stay NULL if not even SSE2 is available, and fp16_array.h then
+ * uses the scalar loop.
+ */
+typedef size_t (*fp16_from_fp32_kernel)(const float* src, uint16_t* dst, size_t n);
+typedef size_t (*fp16_to_fp32_kernel)(const uint16_t* src, float* dst, size_t n);
+
+struct fp16_x86_kernel {
+	const char* name;
+	int (*supported)(void);
+	fp16_from_fp32_kernel ieee_from_fp32;
+	fp16_to_fp32_kernel ieee_to_fp32;
+};
+
+static inline int fp16_x86_has_sse2(void) {
+#if defined(__x86_64__) || defined(_M_X64)
+	return 1;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static inline int fp16_x86_has_f16c(void) {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+}
+
+static inline int fp16_x86_has_avx512f(void) {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+		__builtin_cpu_supports("avx512vl");
+}
+
+#if FP16_X86_HAVE_AVX512FP16
+static inline int fp16_x86_has_avx512fp16(void) {
+	__builtin_cpu_init();
+	return fp16_x86_has_avx512f() && __builtin_cpu_supports("avx512fp16");
+}
+#endif
+
+static const struct fp16_x86_kernel fp16_x86_kernel_table[] = {
+	{ "sse2", fp16_x86_has_sse2, fp16_ieee_from_fp32_sse2, fp16_ieee_to_fp32_sse2 },
+	{ "f16c", fp16_x86_has_f16c, fp16_ieee_from_fp32_f16c, fp16_ieee_to_fp32_f16c },
+	{ "avx512f", fp16_x86_has_avx512f, fp16_ieee_from_fp32_avx512f, fp16_ieee_to_fp32_avx512f },
+#if FP16_X86_HAVE_AVX512FP16
+	{ "avx512fp16", fp16_x86_has_avx512fp16, fp16_ieee_from_fp32_avx512fp16, fp16_ieee_to_fp32_avx512fp16 },
+#endif
+};
+
+#define FP16_X86_KERNEL_COUNT (sizeof(fp16_x86_kernel_table) / sizeof(fp16_x86_kernel_table[0]))
+
+static struct fp16_x86_kernel fp16_x86_kernels = { "scalar", NULL, NULL, NULL };
+
+/*
+ * The fp32 -> fp16 kernels that do not depend on the rounding mode in MXCSR, for the threads that change it. The
+ * fp16 -> fp32 direction is exact, so the entries keep the decoders of the main table.
+ */
+static const struct fp16_x86_kernel fp16_x86_rounding_kernel_table[] = {
+	{ "sse2int", fp16_x86_has_sse2, fp16_ieee_from_fp32_sse2int, fp16_ieee_to_fp32_sse2 },
+	{ "f16c", fp16_x86_has_f16c, fp16_ieee_from_fp32_f16c, fp16_ieee_to_fp32_f16c },
+	{ "avx512f", fp16_x86_has_avx512f, fp16_ieee_from_fp32_avx512f, fp16_ieee_to_fp32_avx512f },
+};
+
+#define FP16_X86_ROUNDING_KERNEL_COUNT (sizeof(fp16_x86_rounding_kernel_table) / sizeof(fp16_x86_rounding_kernel_table[0]))
+
+static struct fp16_x86_kernel fp16_x86_rounding_kernels = { "scalar", NULL, NULL, NULL };
+
+/*
+ * Whether MXCSR of the calling thread rounds to nearest, as it does unless the program changed it. MXCSR is per thread
+ * and can change between two calls, so it is read on every call rather than at startup; stmxcsr costs a few cycles.
+ */
+FP16_X86_TARGET("sse")
+static inline int fp16_x86_rounds_to_nearest(void) {
+	return (_mm_getcsr() & _MM_ROUND_MASK) == _MM_ROUND_NEAREST;
+}
+
+/*
+ * The bfloat16 kernels have a table of their own, because AVX-512 BF16 and AVX-512 FP16 are independent extensions.
+ */
+typedef size_t (*fp16_transcode_kernel)(const uint16_t* src, uint16_t* dst, size_t n);
+
+struct fp16_x86_bf16_kernel {
+	const char* name;
+	int (*supported)(void);
+	fp16_from_fp32_kernel bf16_from_fp32;
+	fp16_to_fp32_kernel bf16_to_fp32;
+	fp16_transcode_kernel bf16_from_fp16_ieee;
+	fp16_transcode_kernel fp16_ieee_from_bf16;
+};
+
+#if FP16_X86_HAVE_AVX512BF16
+static inline int fp16_x86_has_avx512bf16(void) {
+	__builtin_cpu_init();
+	return fp16_x86_has_avx512f() && __builtin_cpu_supports("avx512bf16");
+}
+#endif
+
+static const struct fp16_x86_bf16_kernel fp16_x86_bf16_kernel_table[] = {
+	{ "sse2", fp16_x86_has_sse2,
+		bf16_from_fp32_sse2, bf16_to_fp32_sse2, bf16_from_fp16_ieee_sse2, fp16_ieee_from_bf16_sse2 },
+	{ "f16c", fp16_x86_has_f16c,
+		bf16_from_fp32_f16c, bf16_to_fp32_f16c, bf16_from_fp16_ieee_f16c, fp16_ieee_from_bf16_f16c },
+#if FP16_X86_HAVE_AVX512BF16
+	{ "avx512bf16", fp16_x86_has_avx512bf16,
+		bf16_from_fp32_avx512bf16, bf16_to_fp32_avx512bf16, bf16_from_fp16_ieee_avx512bf16, fp16_ieee_from_bf16_avx512bf16 },
+#endif
+};
+
+#define FP16_X86_BF16_KERNEL_COUNT (sizeof(fp16_x86_bf16_kernel_table) / sizeof(fp16_x86_bf16_kernel_table[0]))
+
+static struct fp16_x86_bf16_kernel fp16_x86_bf16_kernels = { "scalar", NULL, NULL, NULL, NULL, NULL };
+
+/*
+ * The fused scale kernels need FMA, so that they round x * scale + bias once like fmaf, and have a table of their own
+ * too. There is no SSE2 entry: without FMA the scalar loop is used.
+ */
+typedef size_t (*fp16_from_fp32_scaled_kernel)(const float* src, uint16_t* dst, size_t n, float scale, float bias);
+typedef size_t (*fp16_from_fp32_scaled_channels_kernel)(const float* src, uint16_t* dst, size_t n,
+	const float* scale, const float* bias);
+
+struct fp16_x86_scaled_kernel {
+	const char* name;
+	int (*supported)(void);
+	fp16_from_fp32_scaled_kernel ieee_from_fp32_scaled;
+	fp16_from_fp32_scaled_channels_kernel ieee_from_fp32_scaled_channels;
+};
+
+static inline int fp16_x86_has_fma(void) {
+	__builtin_cpu_init();
+	return fp16_x86_has_f16c() && __builtin_cpu_supports("fma");
+}
+
+static inline int fp16_x86_has_avx512f_fma(void) {
+	return fp16_x86_has_avx512f() && fp16_x86_has_fma();
+}
+
+static const struct fp16_x86_scaled_kernel fp16_x86_scaled_kernel_table[] = {
+	{ "f16c", fp16_x86_has_fma, fp16_ieee_from_fp32_scaled_f16c, fp16_ieee_from_fp32_scaled_channels_f16c },
+	{ "avx512f", fp16_x86_has_avx512f_fma, fp16_ieee_from_fp32_scaled_avx512f, fp16_ieee_from_fp32_scaled_channels_avx512f },
+};
+
+#define FP16_X86_SCALED_KERNEL_COUNT (sizeof(fp16_x86_scaled_kernel_table) / sizeof(fp16_x86_scaled_kernel_table[0]))
+
+static struct fp16_x86_scaled_kernel fp16_x86_scaled_kernels = { "scalar", NULL, NULL, NULL };
+
+#if defined(__GNUC__)
+__attribute__((__constructor__, __unused__))
+#endif
+static void fp16_x86_init(void) {
+	for (size_t k = 0; k < FP16_X86_KERNEL_COUNT; k++) {
+		if (fp16_x86_kernel_table[k].supported()) {
+			fp16_x86_kernels = fp16_x86_kernel_table[k];
+		}
+	}
+	for (size_t k = 0; k < FP16_X86_ROUNDING_KERNEL_COUNT; k++) {
+		if (fp16_x86_rounding_kernel_table[k].supported()) {
+			fp16_x86_rounding_kernels = fp16_x86_rounding_kernel_table[k];
+		}
+	}
+	for (size_t k = 0; k < FP16_X86_BF16_KERNEL_COUNT; k++) {
+		if (fp16_x86_bf16_kernel_table[k].supported()) {
+			fp16_x86_bf16_kernels = fp16_x86_bf16_kernel_table[k];
+		}
+	}
+	for (size_t k = 0; k < FP16_X86_SCALED_KERNEL_COUNT; k++) {
+		if (fp16_x86_scaled_kernel_table[k].supported()) {
+			fp16_x86_scaled_kernels = fp16_x86_scaled_kernel_table[k];
+		}
+	}
+}
+
+#endif /* FP16_X86_H */
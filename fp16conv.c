@@ -0,0 +1,521 @@
+/*
+ * fp16conv: converts a raw file of fp32 numbers to IEEE half precision (or back) with the bulk functions of
+ * fp16_array.h, at disk speed and with a fixed amount of memory whatever the size of the file.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16conv.c -o fp16conv -lm -pthread
+ *
+ * Usage: ./fp16conv [options] input output
+ *   -r               half precision to fp32 (default: fp32 to half precision)
+ *   -o bytes         skip that many bytes at the start of the input, e.g. a header (default 0)
+ *   -n elements      convert that many elements (default: up to the end of the input)
+ *   -s elements      take every s-th element of the input, e.g. one channel of interleaved data (default 1)
+ *   -E little|big    byte order of the input (default little)
+ *   -e little|big    byte order of the output (default little)
+ *   -m direct|read|mmap
+ *                    how the input is read (default direct, see below)
+ *   -b MiB           size of one input buffer (default 16)
+ *   -q               do not print the throughput
+ * The output may be "-" for the standard output.
+ *
+ * The input is read in chunks of -b MiB:
+ * - direct: O_DIRECT reads into two buffers, by a reader thread, so that reading chunk i + 1 overlaps converting
+ *   chunk i, and the input does not fill the page cache. File systems without O_DIRECT (tmpfs, some network file
+ *   systems) fall back to read.
+ * - read: the same double buffering with ordinary buffered reads.
+ * - mmap: each chunk is mapped, converted straight from the mapping and unmapped again.
+ * The converted chunk is written with write(2) from a buffer of its own. With stride 1 and the native byte order the
+ * conversion reads the input buffer (or mapping) in place; otherwise the elements are first gathered and byte-swapped
+ * into a staging buffer. The memory used is at most two input buffers, the staging buffer and the output buffer.
+ *
+ * The throughput is printed on the standard error at the end: bytes read and written, and MB/s of input.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fp16_array.h"
+
+/* O_DIRECT needs the file offset, the length and the buffer address aligned to the logical block size */
+#define FP16CONV_DIRECT_ALIGNMENT 4096
+
+enum fp16conv_io {
+	fp16conv_io_direct,
+	fp16conv_io_read,
+	fp16conv_io_mmap,
+};
+
+struct fp16conv_options {
+	int reverse;
+	uint64_t offset;
+	uint64_t count;
+	int count_given;
+	uint64_t stride;
+	int swap_input;
+	int swap_output;
+	enum fp16conv_io io;
+	size_t buffer_bytes;
+	int quiet;
+	const char* input;
+	const char* output;
+};
+
+/* One chunk of input: elements [first, first + elements) of the conversion */
+struct fp16conv_chunk {
+	uint8_t* buffer;
+	/* first byte of element `first` inside buffer */
+	const uint8_t* data;
+	uint64_t first;
+	size_t elements;
+	/* 0 = empty, 1 = full, -1 = read error (errno in error) */
+	int state;
+	int error;
+};
+
+struct fp16conv_reader {
+	int fd;
+	int direct;
+	const struct fp16conv_options* options;
+	size_t in_size;
+	size_t chunk_elements;
+	uint64_t total_elements;
+	struct fp16conv_chunk chunks[2];
+	/* set by the main thread on a write error, under the mutex */
+	int stop;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static int host_is_big_endian(void) {
+	const uint16_t probe = 1;
+	return *(const uint8_t*) &probe == 0;
+}
+
+/* Byte range of the input that holds `elements` elements starting at element `first` */
+static void chunk_range(const struct fp16conv_options* options, size_t in_size, uint64_t first, size_t elements,
+	uint64_t* begin, uint64_t* length)
+{
+	*begin = options->offset + first * options->stride * in_size;
+	*length = (uint64_t) (elements - 1) * options->stride * in_size + in_size;
+}
+
+/* pread until `length` bytes or the end of the file; returns the number of bytes read, or -1 */
+static ssize_t read_fully(int fd, uint8_t* buffer, size_t length, uint64_t position) {
+	size_t done = 0;
+	while (done < length) {
+		const ssize_t r = pread(fd, buffer + done, length - done, (off_t) (position + done));
+		if (r < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		if (r == 0) {
+			break;
+		}
+		done += (size_t) r;
+	}
+	return (ssize_t) done;
+}
+
+static int write_fully(int fd, const uint8_t* buffer, size_t length) {
+	while (length != 0) {
+		const ssize_t w = write(fd, buffer, length);
+		if (w < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		buffer += w;
+		length -= (size_t) w;
+	}
+	return 0;
+}
+
+/*
+ * Reads one chunk into chunk->buffer. With O_DIRECT the read starts at the aligned-down offset and its length is
+ * rounded up, so the buffer has FP16CONV_DIRECT_ALIGNMENT bytes of slack on both ends; the last read of the file
+ * returns short, which is fine.
+ */
+static int read_chunk(struct fp16conv_reader* reader, struct fp16conv_chunk* chunk) {
+	uint64_t begin, length;
+	chunk_range(reader->options, reader->in_size, chunk->first, chunk->elements, &begin, &length);
+	uint64_t read_begin = begin, read_length = length;
+	if (reader->direct) {
+		read_begin = begin & ~(uint64_t) (FP16CONV_DIRECT_ALIGNMENT - 1);
+		read_length = (begin + length - read_begin + FP16CONV_DIRECT_ALIGNMENT - 1) &
+			~(uint64_t) (FP16CONV_DIRECT_ALIGNMENT - 1);
+	}
+	const ssize_t got = read_fully(reader->fd, chunk->buffer, (size_t) read_length, read_begin);
+	if (got < 0) {
+		return errno;
+	}
+	if ((uint64_t) got < begin - read_begin + length) {
+		return EIO;
+	}
+	chunk->data = chunk->buffer + (begin - read_begin);
+	return 0;
+}
+
+static void* reader_thread(void* argument) {
+	struct fp16conv_reader* reader = (struct fp16conv_reader*) argument;
+	size_t index = 0;
+	for (uint64_t first = 0; first < reader->total_elements; first += reader->chunk_elements, index ^= 1) {
+		struct fp16conv_chunk* chunk = &reader->chunks[index];
+		pthread_mutex_lock(&reader->mutex);
+		while (chunk->state != 0 && !reader->stop) {
+			pthread_cond_wait(&reader->cond, &reader->mutex);
+		}
+		const int stop = reader->stop;
+		pthread_mutex_unlock(&reader->mutex);
+		if (stop) {
+			break;
+		}
+
+		chunk->first = first;
+		chunk->elements = (size_t) (reader->total_elements - first < reader->chunk_elements ?
+			reader->total_elements - first : reader->chunk_elements);
+		const int error = read_chunk(reader, chunk);
+
+		pthread_mutex_lock(&reader->mutex);
+		chunk->error = error;
+		chunk->state = error == 0 ? 1 : -1;
+		pthread_cond_broadcast(&reader->cond);
+		pthread_mutex_unlock(&reader->mutex);
+		if (error != 0) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+static uint16_t swap16(uint16_t x) {
+	return (uint16_t) ((x >> 8) | (x << 8));
+}
+
+static uint32_t swap32(uint32_t x) {
+	return (x >> 24) | ((x >> 8) & UINT32_C(0x0000FF00)) | ((x << 8) & UINT32_C(0x00FF0000)) | (x << 24);
+}
+
+/*
+ * Converts `elements` elements starting at `data` into `out`. In place when the elements are contiguous, aligned and
+ * in the native byte order, through `staging` otherwise.
+ */
+static void convert_chunk(const struct fp16conv_options* options, const uint8_t* data, size_t elements,
+	void* staging, void* out)
+{
+	const size_t in_size = options->reverse ? sizeof(uint16_t) : sizeof(float);
+	const void* src = data;
+	if (options->stride != 1 || options->swap_input || ((uintptr_t) data & (in_size - 1)) != 0) {
+		const size_t step = (size_t) options->stride * in_size;
+		if (options->reverse) {
+			uint16_t* s = (uint16_t*) staging;
+			for (size_t i = 0; i < elements; i++) {
+				uint16_t h;
+				memcpy(&h, data + i * step, sizeof(h));
+				s[i] = options->swap_input ? swap16(h) : h;
+			}
+		} else {
+			uint32_t* s = (uint32_t*) staging;
+			for (size_t i = 0; i < elements; i++) {
+				uint32_t w;
+				memcpy(&w, data + i * step, sizeof(w));
+				s[i] = options->swap_input ? swap32(w) : w;
+			}
+		}
+		src = staging;
+	}
+
+	if (options->reverse) {
+		fp16_ieee_to_fp32_array((const uint16_t*) src, (float*) out, elements);
+		if (options->swap_output) {
+			uint32_t* o = (uint32_t*) out;
+			for (size_t i = 0; i < elements; i++) {
+				o[i] = swap32(o[i]);
+			}
+		}
+	} else {
+		fp16_ieee_from_fp32_array((const float*) src, (uint16_t*) out, elements);
+		if (options->swap_output) {
+			uint16_t* o = (uint16_t*) out;
+			for (size_t i = 0; i < elements; i++) {
+				o[i] = swap16(o[i]);
+			}
+		}
+	}
+}
+
+static int parse_endian(const char* s, int* swap) {
+	if (strcmp(s, "little") == 0) {
+		*swap = host_is_big_endian();
+	} else if (strcmp(s, "big") == 0) {
+		*swap = !host_is_big_endian();
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+static void usage(const char* program) {
+	fprintf(stderr,
+		"usage: %s [-r] [-o offset] [-n count] [-s stride] [-E little|big] [-e little|big]\n"
+		"       [-m direct|read|mmap] [-b MiB] [-q] input output\n", program);
+}
+
+static int parse_options(int argc, char** argv, struct fp16conv_options* options) {
+	memset(options, 0, sizeof(*options));
+	options->stride = 1;
+	options->io = fp16conv_io_direct;
+	options->buffer_bytes = (size_t) 16 << 20;
+	parse_endian("little", &options->swap_input);
+	parse_endian("little", &options->swap_output);
+
+	int positional = 0;
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "-r") == 0) {
+			options->reverse = 1;
+		} else if (strcmp(argv[a], "-q") == 0) {
+			options->quiet = 1;
+		} else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+			options->offset = strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-n") == 0 && a + 1 < argc) {
+			options->count = strtoull(argv[++a], NULL, 0);
+			options->count_given = 1;
+		} else if (strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+			options->stride = strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-E") == 0 && a + 1 < argc) {
+			if (parse_endian(argv[++a], &options->swap_input) != 0) {
+				return -1;
+			}
+		} else if (strcmp(argv[a], "-e") == 0 && a + 1 < argc) {
+			if (parse_endian(argv[++a], &options->swap_output) != 0) {
+				return -1;
+			}
+		} else if (strcmp(argv[a], "-m") == 0 && a + 1 < argc) {
+			const char* io = argv[++a];
+			if (strcmp(io, "direct") == 0) {
+				options->io = fp16conv_io_direct;
+			} else if (strcmp(io, "read") == 0) {
+				options->io = fp16conv_io_read;
+			} else if (strcmp(io, "mmap") == 0) {
+				options->io = fp16conv_io_mmap;
+			} else {
+				return -1;
+			}
+		} else if (strcmp(argv[a], "-b") == 0 && a + 1 < argc) {
+			options->buffer_bytes = (size_t) strtoull(argv[++a], NULL, 0) << 20;
+		} else if (argv[a][0] == '-' && argv[a][1] != '\0') {
+			return -1;
+		} else if (positional == 0) {
+			options->input = argv[a];
+			positional++;
+		} else if (positional == 1) {
+			options->output = argv[a];
+			positional++;
+		} else {
+			return -1;
+		}
+	}
+	if (positional != 2 || options->stride == 0 || options->buffer_bytes == 0) {
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	struct fp16conv_options options;
+	if (parse_options(argc, argv, &options) != 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	const size_t in_size = options.reverse ? sizeof(uint16_t) : sizeof(float);
+	const size_t out_size = options.reverse ? sizeof(float) : sizeof(uint16_t);
+
+	int direct = options.io == fp16conv_io_direct;
+	int in_fd = open(options.input, O_RDONLY | (direct ? O_DIRECT : 0));
+	if (in_fd < 0 && direct && errno == EINVAL) {
+		direct = 0;
+		in_fd = open(options.input, O_RDONLY);
+	}
+	if (in_fd < 0) {
+		fprintf(stderr, "%s: %s\n", options.input, strerror(errno));
+		return 1;
+	}
+	struct stat st;
+	if (fstat(in_fd, &st) != 0) {
+		fprintf(stderr, "%s: %s\n", options.input, strerror(errno));
+		return 1;
+	}
+	const uint64_t file_size = (uint64_t) st.st_size;
+
+	/* Elements available from the offset: the first one, then one every stride * in_size bytes */
+	const uint64_t step = options.stride * in_size;
+	uint64_t available = 0;
+	if (file_size >= options.offset + in_size) {
+		available = (file_size - options.offset - in_size) / step + 1;
+	}
+	if (options.count_given && options.count > available) {
+		fprintf(stderr, "%s: %llu elements requested, %llu available\n", options.input,
+			(unsigned long long) options.count, (unsigned long long) available);
+		return 1;
+	}
+	const uint64_t total = options.count_given ? options.count : available;
+
+	/* A chunk of input is at most buffer_bytes, and at least one element */
+	size_t chunk_elements = (size_t) (options.buffer_bytes / step);
+	if (chunk_elements == 0) {
+		chunk_elements = 1;
+	}
+	const size_t chunk_bytes = (chunk_elements - 1) * (size_t) step + in_size;
+
+	int out_fd = STDOUT_FILENO;
+	if (strcmp(options.output, "-") != 0) {
+		out_fd = open(options.output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (out_fd < 0) {
+			fprintf(stderr, "%s: %s\n", options.output, strerror(errno));
+			return 1;
+		}
+	}
+
+	void* out = NULL;
+	void* staging = NULL;
+	if (posix_memalign(&out, FP16_ARRAY_ALIGNMENT, chunk_elements * out_size) != 0 ||
+		posix_memalign(&staging, FP16_ARRAY_ALIGNMENT, chunk_elements * in_size) != 0)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	int status = 0;
+	const double start = now_seconds();
+	if (options.io == fp16conv_io_mmap) {
+		const uint64_t page = (uint64_t) sysconf(_SC_PAGESIZE);
+		for (uint64_t first = 0; first < total && status == 0; first += chunk_elements) {
+			const size_t elements = (size_t) (total - first < chunk_elements ? total - first : chunk_elements);
+			uint64_t begin, length;
+			chunk_range(&options, in_size, first, elements, &begin, &length);
+			const uint64_t map_begin = begin & ~(page - 1);
+			const size_t map_length = (size_t) (begin + length - map_begin);
+			void* map = mmap(NULL, map_length, PROT_READ, MAP_PRIVATE, in_fd, (off_t) map_begin);
+			if (map == MAP_FAILED) {
+				fprintf(stderr, "%s: mmap: %s\n", options.input, strerror(errno));
+				status = 1;
+				break;
+			}
+			/* The advice values are not flags, each one takes a call of its own */
+			madvise(map, map_length, MADV_SEQUENTIAL);
+			madvise(map, map_length, MADV_WILLNEED);
+			convert_chunk(&options, (const uint8_t*) map + (begin - map_begin), elements, staging, out);
+			munmap(map, map_length);
+			if (write_fully(out_fd, (const uint8_t*) out, elements * out_size) != 0) {
+				fprintf(stderr, "%s: %s\n", options.output, strerror(errno));
+				status = 1;
+			}
+		}
+	} else {
+		struct fp16conv_reader reader;
+		memset(&reader, 0, sizeof(reader));
+		reader.fd = in_fd;
+		reader.direct = direct;
+		reader.options = &options;
+		reader.in_size = in_size;
+		reader.chunk_elements = chunk_elements;
+		reader.total_elements = total;
+		pthread_mutex_init(&reader.mutex, NULL);
+		pthread_cond_init(&reader.cond, NULL);
+		const size_t buffer_bytes = chunk_bytes + 2 * FP16CONV_DIRECT_ALIGNMENT;
+		for (int b = 0; b < 2; b++) {
+			void* buffer = NULL;
+			if (posix_memalign(&buffer, FP16CONV_DIRECT_ALIGNMENT, buffer_bytes) != 0) {
+				fprintf(stderr, "out of memory\n");
+				return 1;
+			}
+			reader.chunks[b].buffer = (uint8_t*) buffer;
+		}
+		if (!direct) {
+			posix_fadvise(in_fd, (off_t) options.offset, 0, POSIX_FADV_SEQUENTIAL);
+		}
+
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, reader_thread, &reader) != 0) {
+			fprintf(stderr, "cannot start the reader thread\n");
+			return 1;
+		}
+		size_t index = 0;
+		for (uint64_t first = 0; first < total; first += chunk_elements, index ^= 1) {
+			struct fp16conv_chunk* chunk = &reader.chunks[index];
+			pthread_mutex_lock(&reader.mutex);
+			while (chunk->state == 0) {
+				pthread_cond_wait(&reader.cond, &reader.mutex);
+			}
+			pthread_mutex_unlock(&reader.mutex);
+			if (chunk->state < 0) {
+				fprintf(stderr, "%s: %s\n", options.input,
+					chunk->error == EIO ? "input shorter than expected or I/O error" : strerror(chunk->error));
+				status = 1;
+				break;
+			}
+
+			convert_chunk(&options, chunk->data, chunk->elements, staging, out);
+			const size_t elements = chunk->elements;
+
+			pthread_mutex_lock(&reader.mutex);
+			chunk->state = 0;
+			pthread_cond_broadcast(&reader.cond);
+			pthread_mutex_unlock(&reader.mutex);
+
+			if (write_fully(out_fd, (const uint8_t*) out, elements * out_size) != 0) {
+				fprintf(stderr, "%s: %s\n", options.output, strerror(errno));
+				status = 1;
+				break;
+			}
+		}
+		if (status != 0) {
+			pthread_mutex_lock(&reader.mutex);
+			reader.stop = 1;
+			pthread_cond_broadcast(&reader.cond);
+			pthread_mutex_unlock(&reader.mutex);
+		}
+		pthread_join(thread, NULL);
+		free(reader.chunks[0].buffer);
+		free(reader.chunks[1].buffer);
+		pthread_mutex_destroy(&reader.mutex);
+		pthread_cond_destroy(&reader.cond);
+	}
+	const double seconds = now_seconds() - start;
+
+	if (out_fd != STDOUT_FILENO && close(out_fd) != 0) {
+		fprintf(stderr, "%s: %s\n", options.output, strerror(errno));
+		status = 1;
+	}
+	close(in_fd);
+	free(out);
+	free(staging);
+
+	if (status == 0 && !options.quiet) {
+		const double bytes_in = (double) total * (double) in_size;
+		const double bytes_out = (double) total * (double) out_size;
+		fprintf(stderr, "%llu elements, %.0f bytes read, %.0f bytes written, %.3f s, %.1f MB/s (%s)\n",
+			(unsigned long long) total, bytes_in, bytes_out, seconds, seconds > 0.0 ? bytes_in / seconds * 1e-6 : 0.0,
+			options.io == fp16conv_io_mmap ? "mmap" : direct ? "O_DIRECT" : "read");
+	}
+	return status;
+}
@@ -0,0 +1,267 @@
+/*
+ * Check of the fp16conv tool: it runs fp16conv on generated files with every reading mode and the options that change
+ * the data path (-o, -n, -s, -E, -e, -b, -r, output to stdout), and compares every output element with
+ * fp16_ieee_from_fp32_value, or fp16_ieee_to_fp32_value with -r.
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16conv.c -o fp16conv -lm -pthread
+ *   cc -O2 -I<FP16>/include fp16conv_check.c -o fp16conv_check -lm -pthread
+ *
+ * Usage: ./fp16conv_check [-d directory for the files] [path of fp16conv]
+ *
+ * The files go to $TMPDIR (or /tmp) by default and are removed at the end. O_DIRECT is refused by tmpfs, so -m direct
+ * only takes the O_DIRECT path with a directory on a disk file system. The inputs hold random bit patterns (NaN, Inf,
+ * subnormal numbers included) and are larger than the 1 MiB buffer of -b 1, so that the conversion spans several
+ * chunks. The program prints each failing run and exits with 1 if there is any.
+ */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fp16_array.h"
+
+/* Elements of the fp32 and fp16 inputs: not a multiple of any chunk size */
+#define FP32_ELEMENTS ((size_t) 600007)
+#define FP16_ELEMENTS ((size_t) 1200011)
+
+struct fp16conv_case {
+	const char* name;
+	int reverse;
+	uint64_t offset;
+	/* 0: up to the end of the input */
+	uint64_t count;
+	uint64_t stride;
+	int big_input;
+	int big_output;
+	/* 0: the default of 16 MiB */
+	int buffer_mib;
+	int to_stdout;
+};
+
+static const struct fp16conv_case cases[] = {
+	{ "whole file", 0, 0, 0, 1, 0, 0, 0, 0 },
+	{ "header, stride 3, count", 0, 12, 100000, 3, 0, 0, 0, 0 },
+	{ "big-endian input", 0, 0, 0, 1, 1, 0, 0, 0 },
+	{ "big-endian output", 0, 0, 0, 1, 0, 1, 0, 0 },
+	{ "1 MiB chunks, stride 2", 0, 4, 0, 2, 0, 0, 1, 0 },
+	{ "1 MiB chunks, big-endian", 0, 0, 0, 1, 1, 1, 1, 0 },
+	{ "standard output", 0, 0, 0, 1, 0, 0, 0, 1 },
+	{ "reverse", 1, 0, 0, 1, 0, 0, 0, 0 },
+	{ "reverse, header, stride 5", 1, 6, 0, 5, 0, 0, 0, 0 },
+	{ "reverse, big-endian, 1 MiB", 1, 2, 0, 1, 1, 1, 1, 0 },
+};
+
+static const char* const modes[] = { "direct", "read", "mmap" };
+
+static uint32_t next_random(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static uint64_t load(const uint8_t* p, size_t size, int big) {
+	uint64_t value = 0;
+	for (size_t b = 0; b < size; b++) {
+		value |= (uint64_t) p[big ? size - 1 - b : b] << (8 * b);
+	}
+	return value;
+}
+
+static void store(uint8_t* p, uint64_t value, size_t size, int big) {
+	for (size_t b = 0; b < size; b++) {
+		p[big ? size - 1 - b : b] = (uint8_t) (value >> (8 * b));
+	}
+}
+
+static int write_file(const char* path, const uint8_t* data, size_t size) {
+	FILE* file = fopen(path, "wb");
+	if (file == NULL || fwrite(data, 1, size, file) != size || fclose(file) != 0) {
+		perror(path);
+		return -1;
+	}
+	return 0;
+}
+
+static uint8_t* read_file(const char* path, size_t* size) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		perror(path);
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	*size = (size_t) ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t* data = (uint8_t*) malloc(*size + 1);
+	if (data == NULL || fread(data, 1, *size, file) != *size) {
+		fclose(file);
+		free(data);
+		return NULL;
+	}
+	fclose(file);
+	return data;
+}
+
+/* Run fp16conv with argv, the standard output going to stdout_path if it is not NULL; returns the exit status */
+static int run(const char* const* argv, const char* stdout_path) {
+	const pid_t pid = fork();
+	if (pid == 0) {
+		if (stdout_path != NULL && freopen(stdout_path, "wb", stdout) == NULL) {
+			_exit(127);
+		}
+		execv(argv[0], (char* const*) argv);
+		_exit(127);
+	}
+	int status;
+	if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+		return -1;
+	}
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* Compare the output of a case with the conversion of the input by fp16_study.h; returns the number of mismatches */
+static size_t compare(const struct fp16conv_case* c, const uint8_t* input, size_t input_size, const uint8_t* output,
+	size_t output_size)
+{
+	const size_t in_size = c->reverse ? 2 : 4;
+	const size_t out_size = c->reverse ? 4 : 2;
+	const size_t step = (size_t) c->stride * in_size;
+	size_t count = (input_size - (size_t) c->offset - in_size) / step + 1;
+	if (c->count != 0) {
+		count = (size_t) c->count;
+	}
+	if (output_size != count * out_size) {
+		fprintf(stderr, "%zu bytes of output instead of %zu\n", output_size, count * out_size);
+		return 1;
+	}
+	size_t mismatches = 0;
+	for (size_t i = 0; i < count; i++) {
+		const uint64_t x = load(input + c->offset + i * step, in_size, c->big_input);
+		const uint64_t expected = c->reverse ? fp32_to_bits(fp16_ieee_to_fp32_value((uint16_t) x)) :
+			fp16_ieee_from_fp32_value(fp32_from_bits((uint32_t) x));
+		const uint64_t actual = load(output + i * out_size, out_size, c->big_output);
+		if (actual != expected && mismatches++ < 4) {
+			fprintf(stderr, "element %zu: input 0x%llX -> 0x%llX, expected 0x%llX\n", i, (unsigned long long) x,
+				(unsigned long long) actual, (unsigned long long) expected);
+		}
+	}
+	return mismatches;
+}
+
+int main(int argc, char** argv) {
+	const char* tool = "./fp16conv";
+	const char* directory = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "-d") == 0 && a + 1 < argc) {
+			directory = argv[++a];
+		} else if (argv[a][0] != '-') {
+			tool = argv[a];
+		} else {
+			fprintf(stderr, "usage: %s [-d directory] [fp16conv]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (access(tool, X_OK) != 0) {
+		fprintf(stderr, "%s is not an executable, build fp16conv.c first\n", tool);
+		return 1;
+	}
+
+	char paths[3][4096];
+	snprintf(paths[0], sizeof(paths[0]), "%s/fp16conv_check.%d.in", directory, (int) getpid());
+	snprintf(paths[1], sizeof(paths[1]), "%s/fp16conv_check.%d.in.big", directory, (int) getpid());
+	snprintf(paths[2], sizeof(paths[2]), "%s/fp16conv_check.%d.out", directory, (int) getpid());
+
+	/* The fp32 and fp16 inputs, in both byte orders */
+	const size_t fp32_size = FP32_ELEMENTS * 4;
+	const size_t fp16_size = FP16_ELEMENTS * 2;
+	uint8_t* inputs[2][2];
+	uint32_t state = 1;
+	for (int reverse = 0; reverse < 2; reverse++) {
+		inputs[reverse][0] = (uint8_t*) malloc(reverse ? fp16_size : fp32_size);
+		inputs[reverse][1] = (uint8_t*) malloc(reverse ? fp16_size : fp32_size);
+		if (inputs[reverse][0] == NULL || inputs[reverse][1] == NULL) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		const size_t size = reverse ? 2 : 4;
+		const size_t elements = reverse ? FP16_ELEMENTS : FP32_ELEMENTS;
+		for (size_t i = 0; i < elements; i++) {
+			const uint32_t x = next_random(&state);
+			store(inputs[reverse][0] + i * size, x, size, 0);
+			store(inputs[reverse][1] + i * size, x, size, 1);
+		}
+	}
+
+	int failures = 0;
+	for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+		const struct fp16conv_case* c = &cases[k];
+		const uint8_t* input = inputs[c->reverse][c->big_input];
+		const size_t input_size = c->reverse ? fp16_size : fp32_size;
+		if (write_file(paths[c->big_input], input, input_size) != 0) {
+			return 1;
+		}
+		for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+			char offset[32], count[32], stride[32], buffer[32];
+			snprintf(offset, sizeof(offset), "%llu", (unsigned long long) c->offset);
+			snprintf(count, sizeof(count), "%llu", (unsigned long long) c->count);
+			snprintf(stride, sizeof(stride), "%llu", (unsigned long long) c->stride);
+			snprintf(buffer, sizeof(buffer), "%d", c->buffer_mib);
+			const char* args[32];
+			int n = 0;
+			args[n++] = tool;
+			args[n++] = "-q";
+			args[n++] = "-m";
+			args[n++] = modes[m];
+			args[n++] = "-o";
+			args[n++] = offset;
+			args[n++] = "-s";
+			args[n++] = stride;
+			args[n++] = "-E";
+			args[n++] = c->big_input ? "big" : "little";
+			args[n++] = "-e";
+			args[n++] = c->big_output ? "big" : "little";
+			if (c->reverse) {
+				args[n++] = "-r";
+			}
+			if (c->count != 0) {
+				args[n++] = "-n";
+				args[n++] = count;
+			}
+			if (c->buffer_mib != 0) {
+				args[n++] = "-b";
+				args[n++] = buffer;
+			}
+			args[n++] = paths[c->big_input];
+			args[n++] = c->to_stdout ? "-" : paths[2];
+			args[n] = NULL;
+
+			unlink(paths[2]);
+			const int status = run(args, c->to_stdout ? paths[2] : NULL);
+			size_t output_size = 0;
+			uint8_t* output = status == 0 ? read_file(paths[2], &output_size) : NULL;
+			if (output == NULL || compare(c, input, input_size, output, output_size) != 0) {
+				fprintf(stderr, "FAILED: %s, -m %s (exit status %d)\n", c->name, modes[m], status);
+				failures++;
+			}
+			free(output);
+		}
+	}
+	printf("%zu runs, %d failed\n", sizeof(cases) / sizeof(cases[0]) * sizeof(modes) / sizeof(modes[0]), failures);
+
+	unlink(paths[0]);
+	unlink(paths[1]);
+	unlink(paths[2]);
+	for (int reverse = 0; reverse < 2; reverse++) {
+		free(inputs[reverse][0]);
+		free(inputs[reverse][1]);
+	}
+	return failures != 0;
+}
@@ -0,0 +1,838 @@
+/*
+ * fp16conv_tensors: converts the F32 tensors of a safetensors or .npy file to F16 or BF16, rewriting the header, with
+ * the bulk functions of fp16_array.h (bit-identical to fp16_ieee_from_fp32_value / bf16_from_fp32_value, see
+ * fp16_conformance.c).
+ *
+ * Build (fp16_study.h needs <fp16/bitcasts.h> from https://github.com/Maratyszcza/FP16 on the include path):
+ *   cc -O2 -I<FP16>/include fp16conv_tensors.c -o fp16conv_tensors -lm -pthread
+ *
+ * Usage: ./fp16conv_tensors [-t F16|BF16] [-k regex] [-j threads] [-v] input output
+ *   -t F16|BF16   target type of the converted tensors (default F16)
+ *   -k regex      convert only the F32 tensors whose name matches this POSIX extended regex (default: all of them);
+ *                 the name is matched as written in the JSON header, escapes included
+ *   -j threads    number of threads (default: all online CPUs)
+ *   -v            list the tensors and what was done with them
+ *
+ * The format is detected from the first bytes of the input:
+ * - safetensors: 8-byte little-endian header length, JSON header, then the data. Selected F32 tensors get dtype F16
+ *   or BF16 and half the bytes; every other tensor (and __metadata__) is kept as it is. The data is laid out again in
+ *   the order of the input, without gaps, and the header is padded with spaces to a multiple of 8 bytes.
+ * - .npy: a '<f4' or '>f4' array becomes '<f2' (F16 only, NumPy has no bfloat16 type); any other array is copied.
+ *
+ * The work is split into jobs of at most FP16CONV_TENSORS_JOB_BYTES of input: chunks of converted tensors, and ranges of
+ * kept tensors, which are copied with copy_file_range(2), in the kernel, without going through user space (pread +
+ * pwrite where the kernel refuses). The threads take jobs from a shared counter and write them at their final
+ * position with pwrite, so the tensors run in parallel and the order of completion does not matter.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <regex.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fp16_array.h"
+
+#define FP16CONV_TENSORS_JOB_BYTES ((size_t) 16 << 20)
+#define FP16CONV_TENSORS_MAX_THREADS 256
+
+enum target_type {
+	target_f16,
+	target_bf16,
+};
+
+struct tensor {
+	/* raw JSON text of the name (with the quotes) and of the shape array, in the input header */
+	const char* name;
+	size_t name_length;
+	const char* shape;
+	size_t shape_length;
+	char dtype[16];
+	/* byte range in the data section of the input and of the output */
+	uint64_t begin;
+	uint64_t end;
+	uint64_t out_begin;
+	uint64_t out_end;
+	int convert;
+	/* the .npy input is big-endian */
+	int swap;
+};
+
+/* Converts or copies [first, first + bytes) of the tensor's input bytes */
+struct job {
+	size_t tensor;
+	uint64_t first;
+	uint64_t bytes;
+};
+
+struct context {
+	int in_fd;
+	int out_fd;
+	uint64_t in_data;
+	uint64_t out_data;
+	enum target_type target;
+	const struct tensor* tensors;
+	const struct job* jobs;
+	size_t job_count;
+	size_t next_job;
+	int error;
+	const char* error_what;
+};
+
+static void set_error(struct context* context, int error, const char* what) {
+	int expected = 0;
+	if (__atomic_compare_exchange_n(&context->error, &expected, error, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		context->error_what = what;
+	}
+}
+
+static int read_at(int fd, void* buffer, size_t length, uint64_t position) {
+	uint8_t* p = (uint8_t*) buffer;
+	while (length != 0) {
+		const ssize_t r = pread(fd, p, length, (off_t) position);
+		if (r < 0 && errno == EINTR) {
+			continue;
+		}
+		if (r <= 0) {
+			return r == 0 ? EIO : errno;
+		}
+		p += r;
+		position += (uint64_t) r;
+		length -= (size_t) r;
+	}
+	return 0;
+}
+
+static int write_at(int fd, const void* buffer, size_t length, uint64_t position) {
+	const uint8_t* p = (const uint8_t*) buffer;
+	while (length != 0) {
+		const ssize_t w = pwrite(fd, p, length, (off_t) position);
+		if (w < 0 && errno == EINTR) {
+			continue;
+		}
+		if (w < 0) {
+			return errno;
+		}
+		p += w;
+		position += (uint64_t) w;
+		length -= (size_t) w;
+	}
+	return 0;
+}
+
+/* copy_file_range, or pread + pwrite through `buffer` when the kernel or the file systems do not support it */
+static int copy_range(int in_fd, uint64_t in_position, int out_fd, uint64_t out_position, uint64_t length,
+	void* buffer, size_t buffer_bytes)
+{
+	while (length != 0) {
+		loff_t in_offset = (loff_t) in_position, out_offset = (loff_t) out_position;
+		const ssize_t c = copy_file_range(in_fd, &in_offset, out_fd, &out_offset, (size_t) length, 0);
+		if (c < 0 && errno == EINTR) {
+			continue;
+		}
+		if (c <= 0) {
+			break;
+		}
+		in_position += (uint64_t) c;
+		out_position += (uint64_t) c;
+		length -= (uint64_t) c;
+	}
+	while (length != 0) {
+		const size_t part = length < buffer_bytes ? (size_t) length : buffer_bytes;
+		int error = read_at(in_fd, buffer, part, in_position);
+		if (error == 0) {
+			error = write_at(out_fd, buffer, part, out_position);
+		}
+		if (error != 0) {
+			return error;
+		}
+		in_position += part;
+		out_position += part;
+		length -= part;
+	}
+	return 0;
+}
+
+static void* worker_main(void* argument) {
+	struct context* context = (struct context*) argument;
+	const size_t elements = FP16CONV_TENSORS_JOB_BYTES / sizeof(float);
+	float* src = (float*) malloc(FP16CONV_TENSORS_JOB_BYTES);
+	uint16_t* dst = (uint16_t*) malloc(elements * sizeof(uint16_t));
+	if (src == NULL || dst == NULL) {
+		set_error(context, ENOMEM, "buffer");
+		free(src);
+		free(dst);
+		return NULL;
+	}
+	for (;;) {
+		const size_t j = __atomic_fetch_add(&context->next_job, 1, __ATOMIC_RELAXED);
+		if (j >= context->job_count || __atomic_load_n(&context->error, __ATOMIC_RELAXED) != 0) {
+			break;
+		}
+		const struct job* job = &context->jobs[j];
+		const struct tensor* tensor = &context->tensors[job->tensor];
+		const uint64_t in_position = context->in_data + tensor->begin + job->first;
+		if (!tensor->convert) {
+			const int error = copy_range(context->in_fd, in_position,
+				context->out_fd, context->out_data + tensor->out_begin + job->first, job->bytes,
+				src, FP16CONV_TENSORS_JOB_BYTES);
+			if (error != 0) {
+				set_error(context, error, "copy");
+			}
+			continue;
+		}
+
+		const size_t n = (size_t) (job->bytes / sizeof(float));
+		int error = read_at(context->in_fd, src, (size_t) job->bytes, in_position);
+		if (error != 0) {
+			set_error(context, error, "read");
+			continue;
+		}
+		if (tensor->swap) {
+			uint32_t* words = (uint32_t*) src;
+			for (size_t i = 0; i < n; i++) {
+				words[i] = __builtin_bswap32(words[i]);
+			}
+		}
+		if (context->target == target_bf16) {
+			bf16_from_fp32_array(src, dst, n);
+		} else {
+			fp16_ieee_from_fp32_array(src, dst, n);
+		}
+		error = write_at(context->out_fd, dst, n * sizeof(uint16_t),
+			context->out_data + tensor->out_begin + job->first / 2);
+		if (error != 0) {
+			set_error(context, error, "write");
+		}
+	}
+	free(src);
+	free(dst);
+	return NULL;
+}
+
+/*
+ * Just enough JSON for a safetensors header: a top-level object whose values are tensor objects with "dtype",
+ * "shape" and "data_offsets", and "__metadata__", which is kept as raw text.
+ */
+struct json {
+	const char* p;
+	const char* end;
+};
+
+static void json_skip_space(struct json* json) {
+	while (json->p != json->end && (*json->p == ' ' || *json->p == '\t' || *json->p == '\n' || *json->p == '\r')) {
+		json->p++;
+	}
+}
+
+static int json_expect(struct json* json, char c) {
+	json_skip_space(json);
+	if (json->p == json->end || *json->p != c) {
+		return -1;
+	}
+	json->p++;
+	return 0;
+}
+
+/* A string, with its quotes, as raw text */
+static int json_string(struct json* json, const char** begin, size_t* length) {
+	json_skip_space(json);
+	if (json->p == json->end || *json->p != '"') {
+		return -1;
+	}
+	const char* start = json->p++;
+	while (json->p != json->end && *json->p != '"') {
+		if (*json->p == '\\' && json->end - json->p > 1) {
+			json->p++;
+		}
+		json->p++;
+	}
+	if (json->p == json->end) {
+		return -1;
+	}
+	json->p++;
+	*begin = start;
+	*length = (size_t) (json->p - start);
+	return 0;
+}
+
+/* Any value, as raw text */
+static int json_value(struct json* json, const char** begin, size_t* length) {
+	json_skip_space(json);
+	if (json->p == json->end) {
+		return -1;
+	}
+	const char* start = json->p;
+	if (*json->p == '"') {
+		return json_string(json, begin, length);
+	}
+	if (*json->p == '{' || *json->p == '[') {
+		int depth = 0;
+		do {
+			if (*json->p == '"') {
+				const char* s;
+				size_t l;
+				if (json_string(json, &s, &l) != 0) {
+					return -1;
+				}
+				continue;
+			}
+			if (*json->p == '{' || *json->p == '[') {
+				depth++;
+			} else if (*json->p == '}' || *json->p == ']') {
+				depth--;
+			}
+			json->p++;
+		} while (depth != 0 && json->p != json->end);
+		if (depth != 0) {
+			return -1;
+		}
+	} else {
+		while (json->p != json->end && *json->p != ',' && *json->p != '}' && *json->p != ']' &&
+			*json->p != ' ' && *json->p != '\n')
+		{
+			json->p++;
+		}
+	}
+	*begin = start;
+	*length = (size_t) (json->p - start);
+	return 0;
+}
+
+static int raw_equals(const char* raw, size_t length, const char* quoted) {
+	return length == strlen(quoted) && memcmp(raw, quoted, length) == 0;
+}
+
+/* [a, b] of two non-negative integers */
+static int json_offsets(struct json* json, uint64_t* a, uint64_t* b) {
+	char* end;
+	if (json_expect(json, '[') != 0) {
+		return -1;
+	}
+	json_skip_space(json);
+	*a = strtoull(json->p, &end, 10);
+	json->p = end;
+	if (json_expect(json, ',') != 0) {
+		return -1;
+	}
+	json_skip_space(json);
+	*b = strtoull(json->p, &end, 10);
+	json->p = end;
+	return json_expect(json, ']');
+}
+
+static int parse_tensor(struct json* json, struct tensor* tensor) {
+	if (json_expect(json, '{') != 0) {
+		return -1;
+	}
+	int fields = 0;
+	for (;;) {
+		const char* key;
+		size_t key_length;
+		if (json_string(json, &key, &key_length) != 0 || json_expect(json, ':') != 0) {
+			return -1;
+		}
+		if (raw_equals(key, key_length, "\"dtype\"")) {
+			const char* value;
+			size_t value_length;
+			if (json_string(json, &value, &value_length) != 0 || value_length - 2 >= sizeof(tensor->dtype)) {
+				return -1;
+			}
+			memcpy(tensor->dtype, value + 1, value_length - 2);
+			tensor->dtype[value_length - 2] = '\0';
+			fields |= 1;
+		} else if (raw_equals(key, key_length, "\"shape\"")) {
+			if (json_value(json, &tensor->shape, &tensor->shape_length) != 0) {
+				return -1;
+			}
+			fields |= 2;
+		} else if (raw_equals(key, key_length, "\"data_offsets\"")) {
+			if (json_offsets(json, &tensor->begin, &tensor->end) != 0) {
+				return -1;
+			}
+			fields |= 4;
+		} else {
+			const char* value;
+			size_t value_length;
+			if (json_value(json, &value, &value_length) != 0) {
+				return -1;
+			}
+		}
+		json_skip_space(json);
+		if (json->p != json->end && *json->p == ',') {
+			json->p++;
+			continue;
+		}
+		if (json_expect(json, '}') != 0 || fields != 7 || tensor->end < tensor->begin) {
+			return -1;
+		}
+		return 0;
+	}
+}
+
+/* Appends to a growing string; returns -1 when out of memory */
+struct text {
+	char* data;
+	size_t length;
+	size_t capacity;
+};
+
+static int text_append(struct text* text, const char* s, size_t length) {
+	if (text->length + length + 1 > text->capacity) {
+		size_t capacity = text->capacity == 0 ? 4096 : text->capacity;
+		while (text->length + length + 1 > capacity) {
+			capacity *= 2;
+		}
+		char* data = (char*) realloc(text->data, capacity);
+		if (data == NULL) {
+			return -1;
+		}
+		text->data = data;
+		text->capacity = capacity;
+	}
+	memcpy(text->data + text->length, s, length);
+	text->length += length;
+	text->data[text->length] = '\0';
+	return 0;
+}
+
+static int text_appendf(struct text* text, const char* format, unsigned long long a, unsigned long long b) {
+	char buffer[64];
+	const int length = snprintf(buffer, sizeof(buffer), format, a, b);
+	return text_append(text, buffer, (size_t) length);
+}
+
+static int compare_begin(const void* a, const void* b) {
+	const struct tensor* x = *(const struct tensor* const*) a;
+	const struct tensor* y = *(const struct tensor* const*) b;
+	return x->begin < y->begin ? -1 : x->begin > y->begin;
+}
+
+/*
+ * Parses the safetensors header, selects the tensors, assigns the output offsets and builds the output header
+ * (length prefix included). Returns the number of tensors, or -1 with a message printed.
+ */
+static long plan_safetensors(const char* header, size_t header_length, uint64_t data_bytes, const regex_t* regex,
+	enum target_type target, struct tensor** tensors_out, struct text* out_header)
+{
+	struct json json = { header, header + header_length };
+	const char* metadata = NULL;
+	size_t metadata_length = 0;
+	size_t count = 0, capacity = 0;
+	struct tensor* tensors = NULL;
+
+	if (json_expect(&json, '{') != 0) {
+		goto invalid;
+	}
+	json_skip_space(&json);
+	if (json.p != json.end && *json.p == '}') {
+		json.p++;
+	} else {
+		for (;;) {
+			const char* key;
+			size_t key_length;
+			if (json_string(&json, &key, &key_length) != 0 || json_expect(&json, ':') != 0) {
+				goto invalid;
+			}
+			if (raw_equals(key, key_length, "\"__metadata__\"")) {
+				if (json_value(&json, &metadata, &metadata_length) != 0) {
+					goto invalid;
+				}
+			} else {
+				if (count == capacity) {
+					capacity = capacity == 0 ? 64 : 2 * capacity;
+					struct tensor* grown = (struct tensor*) realloc(tensors, capacity * sizeof(struct tensor));
+					if (grown == NULL) {
+						fprintf(stderr, "out of memory\n");
+						free(tensors);
+						return -1;
+					}
+					tensors = grown;
+				}
+				struct tensor* tensor = &tensors[count++];
+				memset(tensor, 0, sizeof(*tensor));
+				tensor->name = key;
+				tensor->name_length = key_length;
+				if (parse_tensor(&json, tensor) != 0) {
+					goto invalid;
+				}
+			}
+			json_skip_space(&json);
+			if (json.p != json.end && *json.p == ',') {
+				json.p++;
+				continue;
+			}
+			if (json_expect(&json, '}') != 0) {
+				goto invalid;
+			}
+			break;
+		}
+	}
+
+	/* Selection, and the output layout in the order of the input data */
+	struct tensor** order = (struct tensor**) malloc((count + 1) * sizeof(struct tensor*));
+	if (order == NULL) {
+		fprintf(stderr, "out of memory\n");
+		free(tensors);
+		return -1;
+	}
+	for (size_t t = 0; t < count; t++) {
+		struct tensor* tensor = &tensors[t];
+		if (strcmp(tensor->dtype, "F32") == 0 && (tensor->end - tensor->begin) % sizeof(float) == 0) {
+			char* name = strndup(tensor->name + 1, tensor->name_length - 2);
+			tensor->convert = name != NULL && (regex == NULL || regexec(regex, name, 0, NULL, 0) == 0);
+			free(name);
+		}
+		order[t] = tensor;
+	}
+	qsort(order, count, sizeof(struct tensor*), compare_begin);
+	uint64_t position = 0, out_position = 0;
+	for (size_t t = 0; t < count; t++) {
+		struct tensor* tensor = order[t];
+		if (tensor->begin < position || tensor->end > data_bytes) {
+			fprintf(stderr, "overlapping or out of range data_offsets for %.*s\n",
+				(int) tensor->name_length, tensor->name);
+			free(order);
+			free(tensors);
+			return -1;
+		}
+		/* A gap in the input is not kept */
+		position = tensor->end;
+		tensor->out_begin = out_position;
+		tensor->out_end = out_position + (tensor->convert ? (tensor->end - tensor->begin) / 2 : tensor->end - tensor->begin);
+		out_position = tensor->out_end;
+	}
+	free(order);
+
+	/* The output header: 8 bytes of length, then the JSON, padded with spaces to a multiple of 8 bytes */
+	int failed = text_append(out_header, "\0\0\0\0\0\0\0\0{", 9);
+	int first = 1;
+	if (metadata != NULL) {
+		failed |= text_append(out_header, "\"__metadata__\":", 15);
+		failed |= text_append(out_header, metadata, metadata_length);
+		first = 0;
+	}
+	for (size_t t = 0; t < count; t++) {
+		const struct tensor* tensor = &tensors[t];
+		if (!first) {
+			failed |= text_append(out_header, ",", 1);
+		}
+		first = 0;
+		const char* dtype = tensor->convert ? (target == target_bf16 ? "BF16" : "F16") : tensor->dtype;
+		failed |= text_append(out_header, tensor->name, tensor->name_length);
+		failed |= text_append(out_header, ":{\"dtype\":\"", 11);
+		failed |= text_append(out_header, dtype, strlen(dtype));
+		failed |= text_append(out_header, "\",\"shape\":", 10);
+		failed |= text_append(out_header, tensor->shape, tensor->shape_length);
+		failed |= text_appendf(out_header, ",\"data_offsets\":[%llu,%llu]}",
+			(unsigned long long) tensor->out_begin, (unsigned long long) tensor->out_end);
+	}
+	failed |= text_append(out_header, "}", 1);
+	while (out_header->length % 8 != 0) {
+		failed |= text_append(out_header, " ", 1);
+	}
+	if (failed) {
+		fprintf(stderr, "out of memory\n");
+		free(tensors);
+		return -1;
+	}
+	const uint64_t json_length = out_header->length - 8;
+	for (int b = 0; b < 8; b++) {
+		out_header->data[b] = (char) (json_length >> (8 * b));
+	}
+	*tensors_out = tensors;
+	return (long) count;
+
+invalid:
+	fprintf(stderr, "invalid safetensors header near byte %ld\n", (long) (json.p - header));
+	free(tensors);
+	return -1;
+}
+
+/*
+ * Parses a .npy header (after the magic) and builds the output header. One tensor covers the data; it is converted if
+ * its descr is '<f4' or '>f4'.
+ */
+static int plan_npy(const char* dict, size_t dict_length, uint64_t data_bytes, enum target_type target,
+	struct tensor* tensor, struct text* out_header)
+{
+	memset(tensor, 0, sizeof(*tensor));
+	tensor->name = "'array'";
+	tensor->name_length = 7;
+	tensor->end = data_bytes;
+	const char* descr = memmem(dict, dict_length, "'descr':", 8);
+	if (descr == NULL) {
+		fprintf(stderr, "invalid .npy header\n");
+		return -1;
+	}
+	descr += 8;
+	while (descr < dict + dict_length && *descr == ' ') {
+		descr++;
+	}
+	const size_t descr_offset = (size_t) (descr - dict);
+	if (dict_length - descr_offset >= 5 && (memcmp(descr, "'<f4'", 5) == 0 || memcmp(descr, "'>f4'", 5) == 0)) {
+		if (target == target_bf16) {
+			fprintf(stderr, ".npy has no bfloat16 type: use -t F16\n");
+			return -1;
+		}
+		tensor->convert = 1;
+		tensor->swap = descr[1] == '>';
+		strcpy(tensor->dtype, descr[1] == '>' ? ">f4" : "<f4");
+	} else {
+		strcpy(tensor->dtype, "other");
+	}
+	tensor->out_end = tensor->convert ? data_bytes / 2 : data_bytes;
+
+	/* The dictionary with the new descr, then spaces and a newline up to a multiple of 64 bytes (format 1.0 or 2.0) */
+	struct text dict_out = { NULL, 0, 0 };
+	const char* dict_end = dict + dict_length;
+	while (dict_end > dict && (dict_end[-1] == ' ' || dict_end[-1] == '\n')) {
+		dict_end--;
+	}
+	int failed = text_append(&dict_out, dict, descr_offset);
+	if (tensor->convert) {
+		failed |= text_append(&dict_out, "'<f2'", 5);
+		failed |= text_append(&dict_out, descr + 5, (size_t) (dict_end - descr - 5));
+	} else {
+		failed |= text_append(&dict_out, descr, (size_t) (dict_end - descr));
+	}
+	const size_t prefix_v1 = 10, prefix_v2 = 12;
+	const int v2 = prefix_v1 + dict_out.length + 1 > 65535;
+	const size_t prefix = v2 ? prefix_v2 : prefix_v1;
+	while ((prefix + dict_out.length + 1) % 64 != 0) {
+		failed |= text_append(&dict_out, " ", 1);
+	}
+	failed |= text_append(&dict_out, "\n", 1);
+	unsigned char magic[12] = { 0x93, 'N', 'U', 'M', 'P', 'Y', (unsigned char) (v2 ? 2 : 1), 0 };
+	const uint32_t length = (uint32_t) dict_out.length;
+	for (size_t b = 0; b < prefix - 8; b++) {
+		magic[8 + b] = (unsigned char) (length >> (8 * b));
+	}
+	failed |= text_append(out_header, (const char*) magic, prefix);
+	failed |= text_append(out_header, dict_out.data, dict_out.length);
+	free(dict_out.data);
+	if (failed) {
+		fprintf(stderr, "out of memory\n");
+		return -1;
+	}
+	return 0;
+}
+
+static void usage(const char* program) {
+	fprintf(stderr, "usage: %s [-t F16|BF16] [-k regex] [-j threads] [-v] input output\n", program);
+}
+
+int main(int argc, char** argv) {
+	enum target_type target = target_f16;
+	const char* pattern = NULL;
+	const long online = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t threads = online > 0 ? (size_t) online : 1;
+	int verbose = 0;
+	const char* input = NULL;
+	const char* output = NULL;
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+			const char* t = argv[++a];
+			if (strcmp(t, "F16") == 0) {
+				target = target_f16;
+			} else if (strcmp(t, "BF16") == 0) {
+				target = target_bf16;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+		} else if (strcmp(argv[a], "-k") == 0 && a + 1 < argc) {
+			pattern = argv[++a];
+		} else if (strcmp(argv[a], "-j") == 0 && a + 1 < argc) {
+			threads = (size_t) strtoull(argv[++a], NULL, 0);
+		} else if (strcmp(argv[a], "-v") == 0) {
+			verbose = 1;
+		} else if (argv[a][0] != '-' && input == NULL) {
+			input = argv[a];
+		} else if (argv[a][0] != '-' && output == NULL) {
+			output = argv[a];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (input == NULL || output == NULL || threads == 0 || threads > FP16CONV_TENSORS_MAX_THREADS) {
+		usage(argv[0]);
+		return 1;
+	}
+	{
+		const uint16_t probe = 1;
+		if (*(const uint8_t*) &probe != 1) {
+			fprintf(stderr, "safetensors data is little-endian: big-endian hosts are not supported\n");
+			return 1;
+		}
+	}
+	regex_t regex;
+	if (pattern != NULL && regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB) != 0) {
+		fprintf(stderr, "invalid regex: %s\n", pattern);
+		return 1;
+	}
+
+	const int in_fd = open(input, O_RDONLY);
+	struct stat st;
+	if (in_fd < 0 || fstat(in_fd, &st) != 0) {
+		fprintf(stderr, "%s: %s\n", input, strerror(errno));
+		return 1;
+	}
+	const uint64_t file_size = (uint64_t) st.st_size;
+
+	unsigned char prefix[12];
+	if (file_size < sizeof(prefix) || read_at(in_fd, prefix, sizeof(prefix), 0) != 0) {
+		fprintf(stderr, "%s: too short for safetensors or .npy\n", input);
+		return 1;
+	}
+	struct tensor* tensors = NULL;
+	struct tensor npy_tensor;
+	size_t tensor_count;
+	uint64_t in_data;
+	struct text out_header = { NULL, 0, 0 };
+	/* The tensors point into the safetensors header for their names and shapes, so it is kept until the end */
+	char* header = NULL;
+	if (memcmp(prefix, "\x93NUMPY", 6) == 0) {
+		const int v1 = prefix[6] == 1;
+		const uint64_t dict_length = v1 ? (uint64_t) prefix[8] | (uint64_t) prefix[9] << 8 :
+			(uint64_t) prefix[8] | (uint64_t) prefix[9] << 8 | (uint64_t) prefix[10] << 16 | (uint64_t) prefix[11] << 24;
+		in_data = (v1 ? 10 : 12) + dict_length;
+		char* dict = (char*) malloc((size_t) dict_length + 1);
+		if (in_data > file_size || dict == NULL || read_at(in_fd, dict, (size_t) dict_length, v1 ? 10 : 12) != 0 ||
+			plan_npy(dict, (size_t) dict_length, file_size - in_data, target, &npy_tensor, &out_header) != 0)
+		{
+			fprintf(stderr, "%s: cannot convert the .npy file\n", input);
+			return 1;
+		}
+		free(dict);
+		tensors = &npy_tensor;
+		tensor_count = 1;
+	} else {
+		uint64_t header_length = 0;
+		for (int b = 0; b < 8; b++) {
+			header_length |= (uint64_t) prefix[b] << (8 * b);
+		}
+		in_data = 8 + header_length;
+		/* +1 for a terminating zero, so that strtoull stops at the end of the header */
+		header = header_length < file_size ? (char*) malloc((size_t) header_length + 1) : NULL;
+		if (header == NULL || read_at(in_fd, header, (size_t) header_length, 8) != 0) {
+			fprintf(stderr, "%s: not a safetensors or .npy file\n", input);
+			return 1;
+		}
+		header[header_length] = '\0';
+		const long count = plan_safetensors(header, (size_t) header_length, file_size - in_data,
+			pattern != NULL ? &regex : NULL, target, &tensors, &out_header);
+		if (count < 0) {
+			return 1;
+		}
+		tensor_count = (size_t) count;
+	}
+
+	const int out_fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (out_fd < 0 || write_at(out_fd, out_header.data, out_header.length, 0) != 0) {
+		fprintf(stderr, "%s: %s\n", output, strerror(errno));
+		return 1;
+	}
+
+	/* Jobs: every tensor cut into FP16CONV_TENSORS_JOB_BYTES pieces of input */
+	size_t job_count = 0;
+	for (size_t t = 0; t < tensor_count; t++) {
+		const uint64_t bytes = tensors[t].end - tensors[t].begin;
+		job_count += (size_t) ((bytes + FP16CONV_TENSORS_JOB_BYTES - 1) / FP16CONV_TENSORS_JOB_BYTES);
+	}
+	struct job* jobs = (struct job*) malloc((job_count + 1) * sizeof(struct job));
+	if (jobs == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	size_t j = 0;
+	uint64_t converted = 0, copied = 0;
+	for (size_t t = 0; t < tensor_count; t++) {
+		const uint64_t bytes = tensors[t].end - tensors[t].begin;
+		for (uint64_t first = 0; first < bytes; first += FP16CONV_TENSORS_JOB_BYTES) {
+			jobs[j].tensor = t;
+			jobs[j].first = first;
+			jobs[j].bytes = bytes - first < FP16CONV_TENSORS_JOB_BYTES ? bytes - first : FP16CONV_TENSORS_JOB_BYTES;
+			j++;
+		}
+		if (tensors[t].convert) {
+			converted += bytes;
+		} else {
+			copied += bytes;
+		}
+		if (verbose) {
+			fprintf(stderr, "%-8s %.*s %s -> %s, %llu bytes\n", tensors[t].convert ? "convert" : "keep",
+				(int) tensors[t].name_length, tensors[t].name, tensors[t].dtype,
+				tensors[t].convert ? (target == target_bf16 ? "BF16" : "F16") : tensors[t].dtype,
+				(unsigned long long) bytes);
+		}
+	}
+
+	struct context context;
+	memset(&context, 0, sizeof(context));
+	context.in_fd = in_fd;
+	context.out_fd = out_fd;
+	context.in_data = in_data;
+	context.out_data = out_header.length;
+	context.target = target;
+	context.tensors = tensors;
+	context.jobs = jobs;
+	context.job_count = job_count;
+	if (threads > job_count) {
+		threads = job_count == 0 ? 1 : job_count;
+	}
+	pthread_t workers[FP16CONV_TENSORS_MAX_THREADS];
+	size_t started = 0;
+	for (; started + 1 < threads; started++) {
+		if (pthread_create(&workers[started], NULL, worker_main, &context) != 0) {
+			break;
+		}
+	}
+	worker_main(&context);
+	for (size_t t = 0; t < started; t++) {
+		pthread_join(workers[t], NULL);
+	}
+
+	/* Nothing is written past the last tensor, but a jobs failure can leave the file short: set its size */
+	uint64_t out_end = out_header.length;
+	for (size_t t = 0; t < tensor_count; t++) {
+		if (out_header.length + tensors[t].out_end > out_end) {
+			out_end = out_header.length + tensors[t].out_end;
+		}
+	}
+	if (context.error == 0 && ftruncate(out_fd, (off_t) out_end) != 0) {
+		context.error = errno;
+		context.error_what = "truncate";
+	}
+	if (close(out_fd) != 0 && context.error == 0) {
+		context.error = errno;
+		context.error_what = "close";
+	}
+	if (context.error != 0) {
+		fprintf(stderr, "%s: %s: %s\n", output, context.error_what, strerror(context.error));
+		return 1;
+	}
+	if (verbose) {
+		fprintf(stderr, "%llu bytes converted, %llu bytes copied, %zu threads\n",
+			(unsigned long long) converted, (unsigned long long) copied, threads);
+	}
+	close(in_fd);
+	free(jobs);
+	free(out_header.data);
+	if (tensors != &npy_tensor) {
+		free(tensors);
+	}
+	free(header);
+	if (pattern != NULL) {
+		regfree(&regex);
+	}
+	return 0;
+}